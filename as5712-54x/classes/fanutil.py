@@ -26,6 +26,7 @@ try:
     import time
     import logging
     from collections import namedtuple
+    from sensorio import SensorNodes
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -109,25 +110,7 @@ class FanUtil(object):
             return None
 
         device_path = self.get_fan_to_device_path(fan_num, node_num)
-        try:
-            val_file = open(device_path, 'r')
-        except IOError as e:
-            logging.error('GET. unable to open file: %s', str(e))
-            return None
-
-        content = val_file.readline().rstrip()
-
-        if content == '':
-            logging.debug('GET. content is NULL. device_path:%s', device_path)
-            return None
-
-        try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
-            return None
-
-        return int(content)
+        return self._nodes.read_int(device_path)
 
     def _set_fan_node_val(self, fan_num, node_num, val):
         if fan_num < self.FAN_NUM_1_IDX or fan_num > self.FAN_NUM_ON_MAIN_BROAD:
@@ -144,23 +127,13 @@ class FanUtil(object):
             return None
 
         device_path = self.get_fan_to_device_path(fan_num, node_num)
-        try:
-            val_file = open(device_path, 'w')
-        except IOError as e:
-            logging.error('GET. unable to open file: %s', str(e))
-            return None
-
-        val_file.write(content)
-
-        try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
+        if not self._nodes.write(device_path, content):
             return None
 
         return True
 
     def __init__(self):
+        self._nodes = SensorNodes()
         fan_path = self.BASE_VAL_PATH
 
         for fan_num in range(self.FAN_NUM_1_IDX, self.FAN_NUM_ON_MAIN_BROAD+1):
@@ -34,6 +34,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_i2c_trace.h"
 
 
 #define PSU_STATUS_I2C_ADDR			0x60
@@ -63,6 +64,7 @@ struct as5712_54x_psu_data {
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
     char model_name[14]; /* Model name, read from eeprom */
+    struct accton_i2c_trace i2c_trace;
 };
 
 static struct as5712_54x_psu_data *as5712_54x_psu_update_device(struct device *dev);
@@ -182,6 +184,8 @@ static int as5712_54x_psu_probe(struct i2c_client *client,
     dev_info(&client->dev, "%s: psu '%s'\n",
          dev_name(data->hwmon_dev), client->name);
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
+
     return 0;
 
 exit_remove:
@@ -197,6 +201,7 @@ static int as5712_54x_psu_remove(struct i2c_client *client)
 {
     struct as5712_54x_psu_data *data = i2c_get_clientdata(client);
 
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as5712_54x_psu_group);
     kfree(data);
@@ -231,7 +236,10 @@ static struct i2c_driver as5712_54x_psu_driver = {
 static int as5712_54x_psu_read_block(struct i2c_client *client, u8 command, u8 *data,
               int data_len)
 {
-    int result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
+    struct as5712_54x_psu_data *psu = i2c_get_clientdata(client);
+    int result = accton_i2c_traced(&psu->i2c_trace, client,
+            I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+            i2c_smbus_read_i2c_block_data(client, command, data_len, data));
 
     if (unlikely(result < 0))
         goto abort;
@@ -74,6 +74,10 @@ class accton_as5712_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
     def manage_fans(self):
         FAN_LEV1_UP_TEMP = 57500  # temperature
         FAN_LEV1_DOWN_TEMP = 0    # unused
@@ -92,8 +96,8 @@ class accton_as5712_monitor(object):
         FAN_LEV4_SPEED_PERC = 40
 
 
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
 
         temp1 = thermal.get_thermal_1_val()
         if temp1 is None:
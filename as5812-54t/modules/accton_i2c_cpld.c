@@ -27,6 +27,7 @@
 #include <linux/slab.h>
 #include <linux/list.h>
 #include <linux/dmi.h>
+#include "accton_i2c_trace.h"
 
 static LIST_HEAD(cpld_client_list);
 static struct mutex	 list_lock;
@@ -34,6 +35,7 @@ static struct mutex	 list_lock;
 struct cpld_client_node {
 	struct i2c_client *client;
 	struct list_head   list;
+	struct accton_i2c_trace i2c_trace;
 };
 
 /* Addresses scanned for accton_i2c_cpld
@@ -66,6 +68,7 @@ static void accton_i2c_cpld_add_client(struct i2c_client *client)
 	}
 	
 	node->client = client;
+	accton_i2c_trace_add(&node->i2c_trace, client);
 	
 	mutex_lock(&list_lock);
 	list_add(&node->list, &cpld_client_list);
@@ -92,6 +95,7 @@ static void accton_i2c_cpld_remove_client(struct i2c_client *client)
 	
 	if (found) {
 		list_del(list_node);
+		accton_i2c_trace_remove(&cpld_node->i2c_trace);
 		kfree(cpld_node);
 	}
 	
@@ -161,7 +165,9 @@ int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
+			ret = accton_i2c_traced(&cpld_node->i2c_trace, cpld_node->client,
+					I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+					i2c_smbus_read_byte_data(cpld_node->client, reg));
 			break;
 		}
 	}
@@ -185,7 +191,9 @@ int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
+			ret = accton_i2c_traced(&cpld_node->i2c_trace, cpld_node->client,
+					I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+					i2c_smbus_write_byte_data(cpld_node->client, reg, value));
 			break;
 		}
 	}
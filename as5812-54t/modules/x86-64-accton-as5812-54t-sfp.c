@@ -31,6 +31,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_i2c_trace.h"
 
 #define QSFP_PORT_START_INDEX 49
 #define BIT_INDEX(i) (1ULL << (i))
@@ -49,6 +50,7 @@ struct as5812_54t_sfp_data {
     int                 port;            /* Front port index */
     char                eeprom[256];     /* eeprom data */
     u8                  status;       /* bit0:port49, bit1:port50 and so on */
+    struct accton_i2c_trace i2c_trace;
 };
 
 static struct as5812_54t_sfp_data *as5812_54t_sfp_update_device(struct device *dev, int update_eeprom);
@@ -165,6 +167,8 @@ static int as5812_54t_sfp_probe(struct i2c_client *client,
 
     dev_info(&client->dev, "%s: sfp '%s'\n",
          dev_name(data->hwmon_dev), client->name);
+
+    accton_i2c_trace_add(&data->i2c_trace, client);
     
     return 0;
 
@@ -181,6 +185,7 @@ static int as5812_54t_sfp_remove(struct i2c_client *client)
 {
     struct as5812_54t_sfp_data *data = i2c_get_clientdata(client);
 
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as5812_54t_sfp_group);
     kfree(data);
@@ -218,7 +223,10 @@ static struct i2c_driver as5812_54t_sfp_driver = {
 
 static int as5812_54t_sfp_read_byte(struct i2c_client *client, u8 command, u8 *data)
 {
-    int result = i2c_smbus_read_byte_data(client, command);
+    struct as5812_54t_sfp_data *sfp = i2c_get_clientdata(client);
+    int result = accton_i2c_traced(&sfp->i2c_trace, client,
+            I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, command, 1,
+            i2c_smbus_read_byte_data(client, command));
 
     if (unlikely(result < 0)) {
         dev_dbg(&client->dev, "sfp read byte data failed, command(0x%2x), data(0x%2x)\r\n", command, result);
@@ -31,6 +31,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_i2c_trace.h"
 
 #define MAX_FAN_DUTY_CYCLE 100
 
@@ -75,6 +76,7 @@ struct ym2651y_data {
 	u16  mfr_pout_max;   /* Register value */
 	u16  mfr_vout_min;   /* Register value */
 	u16  mfr_vout_max;   /* Register value */
+	struct accton_i2c_trace i2c_trace;
 };
 
 static ssize_t show_byte(struct device *dev, struct device_attribute *da,
@@ -452,6 +454,8 @@ static int ym2651y_probe(struct i2c_client *client,
 	dev_info(&client->dev, "%s: psu '%s'\n",
 		 dev_name(data->hwmon_dev), client->name);
 
+	accton_i2c_trace_add(&data->i2c_trace, client);
+
 	return 0;
 
 exit_remove:
@@ -467,6 +471,7 @@ static int ym2651y_remove(struct i2c_client *client)
 {
 	struct ym2651y_data *data = i2c_get_clientdata(client);
 
+	accton_i2c_trace_remove(&data->i2c_trace);
 	hwmon_device_unregister(data->hwmon_dev);
 	sysfs_remove_group(&client->dev.kobj, &ym2651y_group);
 	kfree(data);
@@ -494,23 +499,38 @@ static struct i2c_driver ym2651y_driver = {
 
 static int ym2651y_read_byte(struct i2c_client *client, u8 reg)
 {
-	return i2c_smbus_read_byte_data(client, reg);
+	struct ym2651y_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+			i2c_smbus_read_byte_data(client, reg));
 }
 
 static int ym2651y_read_word(struct i2c_client *client, u8 reg)
 {
-	return i2c_smbus_read_word_data(client, reg);
+	struct ym2651y_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_WORD_DATA, reg, 2,
+			i2c_smbus_read_word_data(client, reg));
 }
 
 static int ym2651y_write_word(struct i2c_client *client, u8 reg, u16 value)
 {
-	return i2c_smbus_write_word_data(client, reg, value);
+	struct ym2651y_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_WRITE, I2C_SMBUS_WORD_DATA, reg, 2,
+			i2c_smbus_write_word_data(client, reg, value));
 }
 
 static int ym2651y_read_block(struct i2c_client *client, u8 command, u8 *data,
 			  int data_len)
 {
-	int result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
+	struct ym2651y_data *priv = i2c_get_clientdata(client);
+	int result = accton_i2c_traced(&priv->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+			i2c_smbus_read_i2c_block_data(client, command, data_len, data));
 
 	if (unlikely(result < 0))
 		goto abort;
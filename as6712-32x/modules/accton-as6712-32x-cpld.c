@@ -36,9 +36,8 @@
 #include <linux/stat.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/delay.h>
-
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define NUM_OF_CPLD1_CHANS 0x0
 #define NUM_OF_CPLD2_CHANS 0x10
@@ -72,6 +71,8 @@ struct as6712_32x_cpld_data {
 #endif
     struct device      *hwmon_dev;
     struct mutex        update_lock;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 struct chip_desc {
@@ -195,6 +196,8 @@ static ssize_t access(struct device *dev, struct device_attribute *da,
 static ssize_t show_version(struct device *dev, struct device_attribute *da,
              char *buf);
 static int as6712_32x_cpld_read_internal(struct i2c_client *client, u8 reg);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf);
 static int as6712_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 /* transceiver attributes */
@@ -277,9 +280,12 @@ DECLARE_TRANSCEIVER_RESET_SENSOR_DEVICE_ATTR(31);
 DECLARE_TRANSCEIVER_RESET_SENSOR_DEVICE_ATTR(32);
 
 
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+
 static struct attribute *as6712_32x_cpld1_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -324,6 +330,7 @@ static struct attribute *as6712_32x_cpld2_attributes[] = {
 	DECLARE_TRANSCEIVER_RESET_ATTR(14),
 	DECLARE_TRANSCEIVER_RESET_ATTR(15),
 	DECLARE_TRANSCEIVER_RESET_ATTR(16),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -368,6 +375,7 @@ static struct attribute *as6712_32x_cpld3_attributes[] = {
 	DECLARE_TRANSCEIVER_RESET_ATTR(30),
 	DECLARE_TRANSCEIVER_RESET_ATTR(31),
 	DECLARE_TRANSCEIVER_RESET_ATTR(32),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -532,6 +540,7 @@ exit:
 static int as6712_32x_cpld_mux_reg_write(struct i2c_adapter *adap,
 			     struct i2c_client *client, u8 val)
 {
+	struct as6712_32x_cpld_data *cpld = i2c_get_clientdata(client);
 	unsigned long orig_jiffies;
     unsigned short flags;
 	union i2c_smbus_data data;
@@ -546,9 +555,12 @@ static int as6712_32x_cpld_mux_reg_write(struct i2c_adapter *adap,
 		/* Retry automatically on arbitration loss */
 		orig_jiffies = jiffies;
 		for (res = 0, try = 0; try <= adap->retries; try++) {
-			res = adap->algo->smbus_xfer(adap, client->addr, flags,
+			res = accton_i2c_traced(&cpld->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA,
+				CPLD_CHANNEL_SELECT_REG, 1,
+				adap->algo->smbus_xfer(adap, client->addr, flags,
                              I2C_SMBUS_WRITE, CPLD_CHANNEL_SELECT_REG,
-                             I2C_SMBUS_BYTE_DATA, &data);
+                             I2C_SMBUS_BYTE_DATA, &data));
 			if (res != -EAGAIN)
 				break;
 			if (time_after(jiffies,
@@ -668,8 +680,11 @@ static ssize_t show_version(struct device *dev, struct device_attribute *attr, c
 {
     int val = 0;
     struct i2c_client *client = to_i2c_client(dev);
+    struct as6712_32x_cpld_data *data = i2c_get_clientdata(client);
 	
-	val = i2c_smbus_read_byte_data(client, 0x1);
+	val = accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, 0x1, 1,
+			i2c_smbus_read_byte_data(client, 0x1));
 
     if (val < 0) {
         dev_dbg(&client->dev, "cpld(0x%x) reg(0x1) err %d\n", client->addr, val);
@@ -770,6 +785,7 @@ static int as6712_32x_cpld_mux_probe(struct i2c_client *client,
         }
     }
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
     as6712_32x_cpld_add_client(client);
 
     return 0;
@@ -781,8 +797,8 @@ exit_mux_register:
 	for (chan--; chan >= 0; chan--) {
 		i2c_del_mux_adapter(data->virt_adaps[chan]);
     }
-#endif
     kfree(data);
+#endif
 exit:
 	return ret;
 } 
@@ -792,14 +808,15 @@ static int as6712_32x_cpld_mux_remove(struct i2c_client *client)
     struct as6712_32x_cpld_data *data = i2c_get_clientdata(client);
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
     struct i2c_mux_core *muxc = data->muxc;
-
-    i2c_mux_del_adapters(muxc);
 #else
     const struct chip_desc *chip = &chips[data->type];
     int chan;
+#endif
     const struct attribute_group *group = NULL;
 
+    /* The accessors must not find the client once data is gone */
     as6712_32x_cpld_remove_client(client);
+    accton_i2c_trace_remove(&data->i2c_trace);
 
     /* Remove sysfs hooks */
     switch (data->type) {
@@ -820,52 +837,49 @@ static int as6712_32x_cpld_mux_remove(struct i2c_client *client)
         sysfs_remove_group(&client->dev.kobj, group);
     }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,7,0)
+    /* data is part of muxc, which is device managed */
+    i2c_mux_del_adapters(muxc);
+#else
     for (chan = 0; chan < chip->nchans; ++chan) {
         if (data->virt_adaps[chan]) {
             i2c_del_mux_adapter(data->virt_adaps[chan]);
             data->virt_adaps[chan] = NULL;
         }
     }
-#endif
     kfree(data);
+#endif
 
     return 0;
 }
 
-static int as6712_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_read_byte_data(client, reg);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as6712_32x_cpld_data *data = i2c_get_clientdata(client);
 
-		break;
-	}
+	return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
 
-    return status;
+static int as6712_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+{
+	struct as6712_32x_cpld_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as6712_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_write_byte_data(client, reg, value);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
-	}
+	struct as6712_32x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 int as6712_32x_cpld_read(unsigned short cpld_addr, u8 reg)
@@ -33,6 +33,8 @@
 #include <linux/device.h>
 #include <linux/platform_device.h>
 #include <linux/delay.h>
+#include "accton_lm75.h"
+#include "accton_fan_governor.h"
 
 #define DRVNAME "as6712_32x_fan"
 
@@ -66,6 +68,20 @@
 #define CPLD_FAN4_INFO_BIT_MASK           0x8
 #define CPLD_FAN5_INFO_BIT_MASK           0x10
 
+#define NUM_THERMAL_SENSORS     (3)     /* Get sum of this number of sensors.*/
+#define THERMAL_SENSORS_ADDRS   {0x48, 0x49, 0x4a}
+
+#define FAN_FAULT_DUTY_CYCLE    100
+
+/* Thermal governor, accton_as6712_monitor.py loads its policy and enables it */
+static bool governor = false;
+module_param(governor, bool, S_IRUGO);
+MODULE_PARM_DESC(governor, "Enable the fan governor at probe, without waiting for the monitor (default false)");
+
+static unsigned int governor_interval_ms = 10000;
+module_param(governor_interval_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(governor_interval_ms, "Fan governor period in ms (default 10000)");
+
 #define PROJECT_NAME                      
 
 #define DEBUG_MODE 0
@@ -90,6 +106,20 @@ struct accton_as6712_32x_fan {
     u32              duty_cycle[FAN_MAX_NUMBER]; /* control the speed of inner first and second fans */
     u8               r_status[FAN_MAX_NUMBER];   /* inner second fan status */
     u32              r_speed[FAN_MAX_NUMBER];    /* inner second fan speed */
+    struct accton_lm75_sensors lm75;
+    struct accton_fan_governor governor;
+};
+
+/* Same as accton_as6712_monitor.py, on the sum of the LM75 sensors */
+static const struct accton_fan_policy default_policy[ACCTON_FAN_DIR_MAX] = {
+    [ACCTON_FAN_DIR_B2F] = { 4, { {40,  0,      105000, 0},
+                                  {60,  105000, 120000, 40000},
+                                  {75,  120000, 135000, 45000},
+                                  {100, 135000, 0,      50000} } },
+    [ACCTON_FAN_DIR_F2B] = { 4, { {30,  0,      105000, 0},
+                                  {50,  105000, 120000, 40000},
+                                  {65,  120000, 135000, 45000},
+                                  {100, 135000, 0,      50000} } },
 };
 
 /*******************/
@@ -141,6 +171,14 @@ static ssize_t fan_show_value(struct device *dev,
                     struct device_attribute *da, char *buf);
 static ssize_t show_name(struct device *dev, 
                     struct device_attribute *da, char *buf);
+static ssize_t show_governor(struct device *dev, 
+                    struct device_attribute *da, char *buf);
+static ssize_t set_governor(struct device *dev, 
+                    struct device_attribute *da, const char *buf, size_t count);
+static ssize_t show_policy(struct device *dev, 
+                    struct device_attribute *da, char *buf);
+static ssize_t set_policy(struct device *dev, 
+                    struct device_attribute *da, const char *buf, size_t count);
 
 extern int as6712_32x_cpld_read(unsigned short cpld_addr, u8 reg);
 extern int as6712_32x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
@@ -168,6 +206,9 @@ MAKE_SENSOR_DEVICE_ATTR(PROJECT_NAME ,4 ,14)
 MAKE_SENSOR_DEVICE_ATTR(PROJECT_NAME ,5 ,15)
 
 static SENSOR_DEVICE_ATTR(name, S_IRUGO, show_name, NULL, 0);
+static SENSOR_DEVICE_ATTR(governor_enable, S_IWUSR | S_IRUGO, show_governor, set_governor, 0);
+static SENSOR_DEVICE_ATTR(fan_policy_b2f, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_B2F);
+static SENSOR_DEVICE_ATTR(fan_policy_f2b, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_F2B);
 /*******************/
 
 #define _MAKE_FAN_ATTR(prj, id, id2) \
@@ -192,6 +233,9 @@ static struct attribute *accton_as6712_32x_fan_attributes[] = {
     MAKE_FAN_ATTR(PROJECT_NAME,4 ,14)
     MAKE_FAN_ATTR(PROJECT_NAME,5 ,15)                  
     &sensor_dev_attr_name.dev_attr.attr,  
+    &sensor_dev_attr_governor_enable.dev_attr.attr,
+    &sensor_dev_attr_fan_policy_b2f.dev_attr.attr,
+    &sensor_dev_attr_fan_policy_f2b.dev_attr.attr,
     NULL
 };
 /*******************/
@@ -272,6 +316,81 @@ static ssize_t fan_set_duty_cycle(struct device *dev, struct device_attribute *d
     return count;
 }
 
+static const unsigned short thermal_sensors_addrs[] = THERMAL_SENSORS_ADDRS;
+
+static int round_duty_cycle(int duty_cycle)
+{
+    return (duty_cycle / FAN_SPEED_PRECENT_TO_CPLD_STEP) * FAN_SPEED_PRECENT_TO_CPLD_STEP;
+}
+
+static int governor_read(struct device *dev, struct accton_fan_state *st)
+{
+    int i, found;
+
+    accton_as6712_32x_fan_update_device(dev);
+    if (fan_data->valid == 0)
+        return -EIO;
+
+    for (i = 0; i < FAN_MAX_NUMBER; i++) {
+        if (fan_data->status[i] || fan_data->r_status[i])
+            st->fault = true;
+    }
+    /* As the monitor did, direction 0 picks the F2B table */
+    st->dir = fan_data->direction[0] ? ACCTON_FAN_DIR_B2F : ACCTON_FAN_DIR_F2B;
+    st->duty_cycle = fan_data->duty_cycle[0];
+
+    found = accton_lm75_sum(&fan_data->lm75, &st->temp_mc);
+    st->temp_valid = (found == NUM_THERMAL_SENSORS);
+    st->max_mc = accton_lm75_max(&fan_data->lm75);
+
+    return 0;
+}
+
+static int governor_set_duty_cycle(struct device *dev, int duty_cycle)
+{
+    accton_as6712_32x_fan_write_value(CPLD_REG_FAN_PWM_CYCLE_OFFSET, duty_cycle/FAN_SPEED_PRECENT_TO_CPLD_STEP);
+
+    mutex_lock(&fan_data->update_lock);
+    fan_data->valid = 0;    /* re-read the duty cycle next time */
+    mutex_unlock(&fan_data->update_lock);
+    return 0;
+}
+
+static const struct accton_fan_governor_ops governor_ops = {
+    .read = governor_read,
+    .set_duty_cycle = governor_set_duty_cycle,
+    .round_duty_cycle = round_duty_cycle,
+};
+
+static ssize_t show_governor(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    return accton_fan_governor_show(&fan_data->governor, buf);
+}
+
+static ssize_t set_governor(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count)
+{
+    return accton_fan_governor_store(&fan_data->governor, buf, count);
+}
+
+static ssize_t show_policy(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+
+    return accton_fan_policy_show(&fan_data->governor, attr->index, buf);
+}
+
+static ssize_t set_policy(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+
+    return accton_fan_policy_store(&fan_data->governor, attr->index, buf, count,
+                                   FAN_DUTY_CYCLE_MAX);
+}
+
 static const struct attribute_group accton_as6712_32x_fan_group = {
     .attrs = accton_as6712_32x_fan_attributes,
 };
@@ -374,6 +493,14 @@ static int accton_as6712_32x_fan_probe(struct platform_device *pdev)
 {
     int status = -1;
 
+    status = accton_lm75_init(&fan_data->lm75, thermal_sensors_addrs, NUM_THERMAL_SENSORS);
+    if (status) {
+        goto exit_lm75;
+    }
+    accton_fan_governor_init(&fan_data->governor, &pdev->dev, &governor_ops,
+                             default_policy, &governor_interval_ms,
+                             FAN_FAULT_DUTY_CYCLE, false);
+
     /* Register sysfs hooks */
     status = sysfs_create_group(&pdev->dev.kobj, &accton_as6712_32x_fan_group);
     if (status) {
@@ -388,19 +515,26 @@ static int accton_as6712_32x_fan_probe(struct platform_device *pdev)
 	}
 
     dev_info(&pdev->dev, "accton_as6712_32x_fan\n");
+
+    if (governor)
+        accton_fan_governor_set_enable(&fan_data->governor, true);
     
     return 0;
     
 exit_remove:
     sysfs_remove_group(&pdev->dev.kobj, &accton_as6712_32x_fan_group);
 exit:
+    accton_lm75_exit(&fan_data->lm75);
+exit_lm75:
     return status;
 }
 
 static int accton_as6712_32x_fan_remove(struct platform_device *pdev)
 {
+    accton_fan_governor_set_enable(&fan_data->governor, false);
     hwmon_device_unregister(fan_data->hwmon_dev);
     sysfs_remove_group(&fan_data->pdev->dev.kobj, &accton_as6712_32x_fan_group);
+    accton_lm75_exit(&fan_data->lm75);
     
     return 0;
 }
@@ -0,0 +1 @@
+../../common/modules/accton_pmbus_telemetry.h
\ No newline at end of file
@@ -28,6 +28,7 @@ try:
     import logging
     import glob
     from collections import namedtuple
+    from sensorio import SensorNodes
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -54,6 +55,7 @@ class ThermalUtil(object):
            }
 
     def __init__(self):
+        self._nodes = SensorNodes()
         thermal_path = self.BASE_VAL_PATH
 
         for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1):
@@ -67,26 +69,7 @@ class ThermalUtil(object):
             return None
 
         device_path = self.get_thermal_to_device_path(thermal_num)
-        for filename in glob.glob(device_path):
-            try:
-                val_file = open(filename, 'r')
-            except IOError as e:
-                logging.error('GET. unable to open file: %s', str(e))
-                return None
-
-        content = val_file.readline().rstrip()
-
-        if content == '':
-            logging.debug('GET. content is NULL. device_path:%s', device_path)
-            return None
-
-        try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
-            return None
-      
-        return int(content)
+        return self._nodes.read_int(device_path)
 
 
     def get_num_thermals(self):
@@ -110,7 +93,9 @@ class ThermalUtil(object):
     def get_thermal_2_val(self):
         return self._get_thermal_node_val(self.THERMAL_NUM_2_IDX)
     def get_thermal_temp(self):
-        return (self._get_thermal_node_val(self.THERMAL_NUM_1_IDX) + self._get_thermal_node_val(self.THERMAL_NUM_2_IDX) +self._get_thermal_node_val(self.THERMAL_NUM_3_IDX))
+        paths = [self.get_thermal_to_device_path(x)
+                 for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_3_IDX+1)]
+        return sum(self._nodes.read_many(paths))
 
 #def main():
 #    thermal = ThermalUtil()
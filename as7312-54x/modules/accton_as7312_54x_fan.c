@@ -29,17 +29,26 @@
 #include <linux/sysfs.h>
 #include <linux/slab.h>
 #include <linux/dmi.h>
-#include <linux/fs.h>
-#include <asm/uaccess.h>
+#include "accton_lm75.h"
+#include "accton_fan_governor.h"
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define DRVNAME "as7312_54x_fan"
 
 #define NUM_THERMAL_SENSORS     (3)     /* Get sum of this number of sensors.*/
-#define THERMAL_SENSORS_DRIVER     "lm75"
 #define THERMAL_SENSORS_ADDRS   {0x48, 0x49, 0x4a}
 
-#define		IN
-#define		OUT
+#define FAN_FAULT_DUTY_CYCLE    100
+
+/* Thermal governor, accton_as7312_monitor.py loads its policy and enables it */
+static bool governor = false;
+module_param(governor, bool, S_IRUGO);
+MODULE_PARM_DESC(governor, "Enable the fan governor at probe, without waiting for the monitor (default false)");
+
+static unsigned int governor_interval_ms = 10000;
+module_param(governor_interval_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(governor_interval_ms, "Fan governor period in ms (default 10000)");
 
 static struct as7312_54x_fan_data *as7312_54x_fan_update_device(struct device *dev);
 static ssize_t fan_show_value(struct device *dev, struct device_attribute *da, char *buf);
@@ -49,6 +58,12 @@ static ssize_t get_enable(struct device *dev, struct device_attribute *da, char
 static ssize_t set_enable(struct device *dev, struct device_attribute *da,
                           const char *buf, size_t count);
 static ssize_t get_sys_temp(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t show_governor(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_governor(struct device *dev, struct device_attribute *da,
+                            const char *buf, size_t count);
+static ssize_t show_policy(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_policy(struct device *dev, struct device_attribute *da,
+                          const char *buf, size_t count);
 extern int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg);
 extern int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
 
@@ -72,6 +87,20 @@ static const u8 fan_reg[] = {
     0x27,       /* rear fan 6 speed(rpm) */
 };
 
+/* Same as accton_as7312_monitor.py, on the sum of the LM75 sensors. As the
+ * monitor did, direction 1 picks the F2B table.
+ */
+static const struct accton_fan_policy default_policy[ACCTON_FAN_DIR_MAX] = {
+    [ACCTON_FAN_DIR_B2F] = { 4, { {44,  0,      105000, 0},
+                                  {63,  105000, 120000, 40000},
+                                  {75,  120000, 135000, 45000},
+                                  {100, 135000, 0,      50000} } },
+    [ACCTON_FAN_DIR_F2B] = { 4, { {32,  0,      105000, 0},
+                                  {50,  105000, 120000, 40000},
+                                  {63,  120000, 135000, 45000},
+                                  {100, 135000, 0,      50000} } },
+};
+
 /* Each client has this additional data */
 struct as7312_54x_fan_data {
     struct device   *hwmon_dev;
@@ -82,6 +111,10 @@ struct as7312_54x_fan_data {
     u8               enable;
     int              system_temp;    /*In unit of mini-Celsius*/
     int              sensors_found;
+    struct accton_lm75_sensors lm75;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_fan_governor governor;
+    struct accton_i2c_trace i2c_trace;
 };
 
 enum fan_id {
@@ -155,6 +188,15 @@ enum sysfs_fan_attributes {
 
 #define DECLARE_FAN_SYSTEM_TEMP_ATTR()  &sensor_dev_attr_sys_temp.dev_attr.attr
 
+#define DECLARE_FAN_GOVERNOR_SENSOR_DEV_ATTR() \
+    static SENSOR_DEVICE_ATTR(governor_enable, S_IWUSR | S_IRUGO, show_governor, set_governor, 0);\
+    static SENSOR_DEVICE_ATTR(fan_policy_b2f, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_B2F);\
+    static SENSOR_DEVICE_ATTR(fan_policy_f2b, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_F2B)
+
+#define DECLARE_FAN_GOVERNOR_ATTR()  &sensor_dev_attr_governor_enable.dev_attr.attr, \
+                                     &sensor_dev_attr_fan_policy_b2f.dev_attr.attr, \
+                                     &sensor_dev_attr_fan_policy_f2b.dev_attr.attr
+
 
 #define DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(index) \
     static SENSOR_DEVICE_ATTR(fan##index##_present, S_IRUGO, fan_show_value, NULL, FAN##index##_PRESENT)
@@ -202,6 +244,8 @@ DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(6);
 DECLARE_FAN_DUTY_CYCLE_SENSOR_DEV_ATTR(1);
 /* System temperature for fancontrol */
 DECLARE_FAN_SYSTEM_TEMP_SENSOR_DEV_ATTR();
+/* Fan governor */
+DECLARE_FAN_GOVERNOR_SENSOR_DEV_ATTR();
 
 static struct attribute *as7312_54x_fan_attributes[] = {
     /* fan related attributes */
@@ -231,6 +275,7 @@ static struct attribute *as7312_54x_fan_attributes[] = {
     DECLARE_FAN_DIRECTION_ATTR(6),
     DECLARE_FAN_DUTY_CYCLE_ATTR(1),
     DECLARE_FAN_SYSTEM_TEMP_ATTR(),
+    DECLARE_FAN_GOVERNOR_ATTR(),
     NULL
 };
 
@@ -240,12 +285,22 @@ static struct attribute *as7312_54x_fan_attributes[] = {
 
 static int as7312_54x_fan_read_value(struct i2c_client *client, u8 reg)
 {
-    return i2c_smbus_read_byte_data(client, reg);
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7312_54x_fan_write_value(struct i2c_client *client, u8 reg, u8 value)
 {
-    return i2c_smbus_write_byte_data(client, reg, value);
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 /* fan utility functions
@@ -328,6 +383,12 @@ static ssize_t get_enable(struct device *dev, struct device_attribute *da,
 
     return sprintf(buf, "%u\n", data->enable);
 }
+static void write_duty_cycle(struct i2c_client *client, int duty_cycle)
+{
+    as7312_54x_fan_write_value(client, 0x33, 0); /* Disable fan speed watch dog */
+    as7312_54x_fan_write_value(client, fan_reg[FAN_DUTY_CYCLE_PERCENTAGE], duty_cycle_to_reg_val(duty_cycle));
+}
+
 static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
                               const char *buf, size_t count)
 {
@@ -343,270 +404,109 @@ static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
 
     value = (value > FAN_MAX_DUTY_CYCLE)? FAN_MAX_DUTY_CYCLE : value;
 
-    as7312_54x_fan_write_value(client, 0x33, 0); /* Disable fan speed watch dog */
-    as7312_54x_fan_write_value(client, fan_reg[FAN_DUTY_CYCLE_PERCENTAGE], duty_cycle_to_reg_val(value));
+    write_duty_cycle(client, value);
     return count;
 }
 
-/* Due to this struct is declared at lm75.c, it cannot be include
- * under Sonic environment. I duplicate it from lm75.c.
- */
-struct lm75_data {
-    struct i2c_client       *client;
-    struct device           *hwmon_dev;
-    struct thermal_zone_device      *tz;
-    struct mutex            update_lock;
-    u8                      orig_conf;
-    u8                      resolution;     /* In bits, between 9 and 12 */
-    u8                      resolution_limits;
-    char                    valid;          /* !=0 if registers are valid */
-    unsigned long           last_updated;   /* In jiffies */
-    unsigned long           sample_time;    /* In jiffies */
-    s16                     temp[3];        /* Register values,
-                                                   0 = input
-                                                   1 = max
-                                                   2 = hyst */
-};
+static const unsigned short thermal_sensors_addrs[] = THERMAL_SENSORS_ADDRS;
 
-/*Copied from lm75.c*/
-static inline long lm75_reg_to_mc(s16 temp, u8 resolution)
-{
-    return ((temp >> (16 - resolution)) * 1000) >> (resolution - 8);
-}
-
-/*Get hwmon_dev from i2c_client, set hwmon_dev = NULL is failed.*/
-static struct device * get_hwmon_dev(
-    struct i2c_client *client)
+/*Return sum of the temperatures of the lm75 devices.*/
+static ssize_t get_sys_temp(struct device *dev, struct device_attribute *da,
+                            char *buf)
 {
-    struct lm75_data *data = NULL;
+    ssize_t ret = 0;
+    struct as7312_54x_fan_data *data = as7312_54x_fan_update_device(dev);
 
-    data = i2c_get_clientdata(client);
-    if(data)
+    data->sensors_found = accton_lm75_sum(&data->lm75, &data->system_temp);
+    if (NUM_THERMAL_SENSORS != data->sensors_found)
     {
-        if( data->valid == 1  && data->hwmon_dev)
-        {
-            return data->hwmon_dev;
-        }
-
-    }
-    return NULL;
-}
-
-/* To find hwmon index by opening hwmon under that i2c address.
- */
-static int find_hwmon_index_by_FileOpen(
-    int bus_nr,
-    unsigned short addr,
-    OUT int *index)
-{
-#define MAX_HWMON_DEVICE        (10)    /* Find hwmon device in 0~10*/
-    struct file *sfd;
-    char client_name[96];
-    int  i=0;
-
-    do {
-        snprintf(client_name, sizeof(client_name),
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/hwmon%d/temp1_input",
-                 bus_nr, addr, i);
-
-        sfd = filp_open(client_name, O_RDONLY, 0);
-        i++;
-    } while( IS_ERR(sfd) && i < MAX_HWMON_DEVICE);
-
-    if (IS_ERR(sfd)) {
-        pr_err("Failed to open file(%s)#%d\r\n", client_name, __LINE__);
-        return -ENOENT;
+        dev_dbg(dev,"only %d of %d temps are found\n",
+                data->sensors_found, NUM_THERMAL_SENSORS);
+        data->system_temp = INT_MAX;
     }
-    filp_close(sfd, 0);
-    *index = i - 1;
-    return 0;
-
-#undef MAX_HWMON_DEVICE
+    ret = sprintf(buf, "%d\n",data->system_temp);
+    return ret;
 }
 
-static int get_temp_file_path(
-    int bus_nr, unsigned short addr,
-    struct device *hwmon_dev
-    ,char *path, int max_len)
+static int round_duty_cycle(int duty_cycle)
 {
-
-    if(hwmon_dev && strlen(dev_name(hwmon_dev)))
-    {
-        snprintf(path, max_len,
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/%s/temp1_input",
-                 bus_nr, addr, dev_name(hwmon_dev));
-    }
-    else
-    {
-        int  i=0;
-        if(find_hwmon_index_by_FileOpen( bus_nr, addr, &i))
-        {
-            return  -EIO;
-        }
-        snprintf(path, max_len,
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/hwmon%d/temp1_input",
-                 bus_nr, addr, i);
-    }
-    return 0;
+    return reg_val_to_duty_cycle(duty_cycle_to_reg_val(duty_cycle));
 }
 
-/*File read the dev file at user space.*/
-static int read_devfile_temp1_input(
-    struct device *dev,
-    int bus_nr,
-    unsigned short addr,
-    struct device *hwmon_dev,
-    int *miniCelsius)
+static int governor_read(struct device *dev, struct accton_fan_state *st)
 {
-    struct file *sfd;
-    char buffer[96];
-    char devfile[96];
-    int     rc, status;
-    int     rdlen, value;
-    mm_segment_t old_fs;
-
-    rc = 0;
-    get_temp_file_path(bus_nr, addr, hwmon_dev, devfile, sizeof(devfile));
-    sfd = filp_open(devfile, O_RDONLY, 0);
-    if (IS_ERR(sfd)) {
-        pr_err("Failed to open file(%s)#%d\r\n", devfile, __LINE__);
-        return -ENOENT;
-    }
-    dev_dbg(dev, "Found device:%s\n",devfile);
+    struct as7312_54x_fan_data *data = as7312_54x_fan_update_device(dev);
+    int i, found;
 
-    if(!(sfd->f_op) || !(sfd->f_op->read) ) {
-        pr_err("file %s cann't readable ?\n",devfile);
-        return -ENOENT;
-    }
+    if (!data->valid)
+        return -EIO;
 
-    old_fs = get_fs();
-    set_fs(KERNEL_DS);
-    rdlen = sfd->f_op->read(sfd, buffer, sizeof(buffer), &sfd->f_pos);
-    if (rdlen == 0) {
-        pr_err( "File(%s) empty!\n", devfile);
-        rc = -EIO;
-        goto exit;
+    for (i = FAN1_ID; i <= FAN6_ID; i++) {
+        if (is_fan_fault(data, i))
+            st->fault = true;
     }
-    status = sscanf(buffer, "%d", &value);
-    if (status != 1) {
-        rc = -EIO;
-        goto exit;
-    }
-    *miniCelsius = value;
-    dev_dbg(dev,"found sensors: %d @i2c %d-%04x\n", value, bus_nr, addr);
+    st->dir = reg_val_to_direction(data->reg_val[FAN_DIRECTION_REG], FAN1_ID) ?
+              ACCTON_FAN_DIR_F2B : ACCTON_FAN_DIR_B2F;
+    st->duty_cycle = reg_val_to_duty_cycle(data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE]);
 
-exit:
-    set_fs(old_fs);
-    filp_close(sfd, 0);
-    return rc;
-}
+    found = accton_lm75_sum(&data->lm75, &st->temp_mc);
+    st->temp_valid = (found == NUM_THERMAL_SENSORS);
+    st->max_mc = accton_lm75_max(&data->lm75);
 
-static u8 is_lm75_data_due(struct i2c_client *client)
-{
-    struct lm75_data *data = NULL;
-
-    data = i2c_get_clientdata(client);
-    if (time_after(jiffies, data->last_updated + data->sample_time))
-    {
-        return 1;
-    }
     return 0;
 }
-static int get_lm75_temp(struct i2c_client *client, int *miniCelsius)
+
+static int governor_set_duty_cycle(struct device *dev, int duty_cycle)
 {
-    struct lm75_data *data = NULL;
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-    data = i2c_get_clientdata(client);
-    *miniCelsius = lm75_reg_to_mc(data->temp[0], data->resolution);
+    write_duty_cycle(to_i2c_client(dev), duty_cycle);
 
+    mutex_lock(&data->update_lock);
+    data->valid = 0;    /* re-read the duty cycle next time */
+    mutex_unlock(&data->update_lock);
     return 0;
 }
 
-static bool lm75_addr_mached(unsigned short addr)
-{
-    int i;
-    unsigned short addrs[] = THERMAL_SENSORS_ADDRS;
-    
-    for (i = 0; i < ARRAY_SIZE(addrs); i++)
-    {
-        if( addr == addrs[i])
-            return 1;
-    }
-    return 0;
-}
+static const struct accton_fan_governor_ops governor_ops = {
+    .read = governor_read,
+    .set_duty_cycle = governor_set_duty_cycle,
+    .round_duty_cycle = round_duty_cycle,
+};
 
-static int _find_lm75_device(struct device *dev, void *data)
+static ssize_t show_governor(struct device *dev, struct device_attribute *da,
+                             char *buf)
 {
-    struct device_driver *driver;
-    struct as7312_54x_fan_data *prv = data;
-    char *driver_name = THERMAL_SENSORS_DRIVER;
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-    driver = dev->driver;
-    if (driver && driver->name &&
-            strcmp(driver->name, driver_name) == 0)
-    {
-        struct i2c_client *client;
-        client = to_i2c_client(dev);
-        if (client)
-        {
-            /*cannot use "struct i2c_adapter *adap = to_i2c_adapter(dev);"*/
-            struct i2c_adapter *adap = client->adapter;
-            int miniCelsius = 0;
-
-            if (! lm75_addr_mached(client->addr))
-            {
-                return 0;
-            }
-
-            if (!adap) {
-                return -ENXIO;
-            }
+    return accton_fan_governor_show(&data->governor, buf);
+}
 
-            /* If the data is not updated, read them from devfile
-               to drive them updateing data from chip.*/
-            if (is_lm75_data_due(client))
-            {
-                struct device *hwmon_dev;
+static ssize_t set_governor(struct device *dev, struct device_attribute *da,
+                            const char *buf, size_t count)
+{
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-                hwmon_dev = get_hwmon_dev(client);
-                if(0 == read_devfile_temp1_input(dev, adap->nr,
-                                                 client->addr, hwmon_dev, &miniCelsius))
-                {
-                    prv->system_temp += miniCelsius;
-                    prv->sensors_found++;
-                }
+    return accton_fan_governor_store(&data->governor, buf, count);
+}
 
-            }
-            else
-            {
-                get_lm75_temp(client, &miniCelsius);
-                prv->system_temp += miniCelsius;
-                prv->sensors_found++;
+static ssize_t show_policy(struct device *dev, struct device_attribute *da,
+                           char *buf)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-            }
-        }
-    }
-    return 0;
+    return accton_fan_policy_show(&data->governor, attr->index, buf);
 }
 
-/*Find all lm75 devices and return sum of temperatures.*/
-static ssize_t get_sys_temp(struct device *dev, struct device_attribute *da,
-                            char *buf)
+static ssize_t set_policy(struct device *dev, struct device_attribute *da,
+                          const char *buf, size_t count)
 {
-    ssize_t ret = 0;
-    struct as7312_54x_fan_data *data = as7312_54x_fan_update_device(dev);
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+    struct as7312_54x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-    data->system_temp=0;
-    data->sensors_found=0;
-    i2c_for_each_dev(data, _find_lm75_device);
-    if (NUM_THERMAL_SENSORS != data->sensors_found)
-    {
-        dev_dbg(dev,"only %d of %d temps are found\n",
-                data->sensors_found, NUM_THERMAL_SENSORS);
-        data->system_temp = INT_MAX;
-    }
-    ret = sprintf(buf, "%d\n",data->system_temp);
-    return ret;
+    return accton_fan_policy_store(&data->governor, attr->index, buf, count,
+                                   FAN_MAX_DUTY_CYCLE);
 }
 
 static ssize_t fan_show_value(struct device *dev, struct device_attribute *da,
@@ -739,6 +639,14 @@ static int as7312_54x_fan_probe(struct i2c_client *client,
     data->enable = 0;
     mutex_init(&data->update_lock);
 
+    status = accton_lm75_init(&data->lm75, thermal_sensors_addrs, NUM_THERMAL_SENSORS);
+    if (status) {
+        goto exit_free;
+    }
+    accton_fan_governor_init(&data->governor, &client->dev, &governor_ops,
+                             default_policy, &governor_interval_ms,
+                             FAN_FAULT_DUTY_CYCLE, false);
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -756,11 +664,17 @@ static int as7312_54x_fan_probe(struct i2c_client *client,
     dev_info(&client->dev, "%s: fan '%s'\n",
              dev_name(data->hwmon_dev), client->name);
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
+
+    if (governor)
+        accton_fan_governor_set_enable(&data->governor, true);
+
     return 0;
 
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &as7312_54x_fan_group);
 exit_free:
+    accton_lm75_exit(&data->lm75);
     kfree(data);
 exit:
 
@@ -770,8 +684,12 @@ exit:
 static int as7312_54x_fan_remove(struct i2c_client *client)
 {
     struct as7312_54x_fan_data *data = i2c_get_clientdata(client);
+
+    accton_fan_governor_set_enable(&data->governor, false);
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7312_54x_fan_group);
+    accton_lm75_exit(&data->lm75);
 
     return 0;
 }
@@ -33,6 +33,7 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/dmi.h>
+#include "accton_i2c_trace.h"
 
 static ssize_t show_status(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t show_model_name(struct device *dev, struct device_attribute *da, char *buf);
@@ -53,6 +54,7 @@ struct as7312_54x_psu_data {
     u8  index;           /* PSU index */
     u8  status;          /* Status(present/power_good) register read from CPLD */
     char model_name[9]; /* Model name, read from eeprom */
+    struct accton_i2c_trace i2c_trace;
 };
 
 static struct as7312_54x_psu_data *as7312_54x_psu_update_device(struct device *dev);
@@ -144,6 +146,8 @@ static int as7312_54x_psu_probe(struct i2c_client *client,
     dev_info(&client->dev, "%s: psu '%s'\n",
              dev_name(data->hwmon_dev), client->name);
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
+
     return 0;
 
 exit_remove:
@@ -159,6 +163,7 @@ static int as7312_54x_psu_remove(struct i2c_client *client)
 {
     struct as7312_54x_psu_data *data = i2c_get_clientdata(client);
 
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7312_54x_psu_group);
     kfree(data);
@@ -193,13 +198,16 @@ static struct i2c_driver as7312_54x_psu_driver = {
 static int as7312_54x_psu_read_block(struct i2c_client *client, u8 command, u8 *data,
                                      int data_len)
 {
+    struct as7312_54x_psu_data *psu = i2c_get_clientdata(client);
     int result = 0;
     int retry_count = 5;
 
     while (retry_count) {
         retry_count--;
 
-        result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
+        result = accton_i2c_traced(&psu->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+                    i2c_smbus_read_i2c_block_data(client, command, data_len, data));
 
         if (unlikely(result < 0)) {
             msleep(10);
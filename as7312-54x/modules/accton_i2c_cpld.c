@@ -33,9 +33,8 @@
 #include <linux/stat.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/delay.h>
-
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 static LIST_HEAD(cpld_client_list);
 static struct mutex     list_lock;
@@ -55,6 +54,8 @@ struct as7312_54x_cpld_data {
     enum cpld_type   type;
     struct device   *hwmon_dev;
     struct mutex     update_lock;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 static const struct i2c_device_id as7312_54x_cpld_id[] = {
@@ -300,6 +301,8 @@ static ssize_t access(struct device *dev, struct device_attribute *da,
 static ssize_t show_version(struct device *dev, struct device_attribute *da,
              char *buf);
 static int as7312_54x_cpld_read_internal(struct i2c_client *client, u8 reg);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf);
 static int as7312_54x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 /* transceiver attributes */
@@ -436,9 +439,12 @@ DECLARE_SFP_TRANSCEIVER_SENSOR_DEVICE_ATTR(46);
 DECLARE_SFP_TRANSCEIVER_SENSOR_DEVICE_ATTR(47);
 DECLARE_SFP_TRANSCEIVER_SENSOR_DEVICE_ATTR(48);
 
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+
 static struct attribute *as7312_54x_cpld1_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -508,6 +514,7 @@ static struct attribute *as7312_54x_cpld2_attributes[] = {
 	DECLARE_SFP_TRANSCEIVER_ATTR(22),
 	DECLARE_SFP_TRANSCEIVER_ATTR(23),
 	DECLARE_SFP_TRANSCEIVER_ATTR(24),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -573,6 +580,7 @@ static struct attribute *as7312_54x_cpld3_attributes[] = {
 	DECLARE_SFP_TRANSCEIVER_ATTR(46),
 	DECLARE_SFP_TRANSCEIVER_ATTR(47),
 	DECLARE_SFP_TRANSCEIVER_ATTR(48),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -1009,8 +1017,11 @@ static ssize_t show_version(struct device *dev, struct device_attribute *attr, c
 {
     int val = 0;
     struct i2c_client *client = to_i2c_client(dev);
+    struct as7312_54x_cpld_data *data = i2c_get_clientdata(client);
 	
-	val = i2c_smbus_read_byte_data(client, 0x1);
+	val = accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, 0x1, 1,
+			i2c_smbus_read_byte_data(client, 0x1));
 
     if (val < 0) {
         dev_dbg(&client->dev, "cpld(0x%x) reg(0x1) err %d\n", client->addr, val);
@@ -1065,6 +1076,7 @@ static int as7312_54x_cpld_probe(struct i2c_client *client,
         }
     }
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
     as7312_54x_cpld_add_client(client);
     return 0;
 
@@ -1080,6 +1092,7 @@ static int as7312_54x_cpld_remove(struct i2c_client *client)
     const struct attribute_group *group = NULL;
 
     as7312_54x_cpld_remove_client(client);
+    accton_i2c_trace_remove(&data->i2c_trace);
 
     /* Remove sysfs hooks */
     switch (data->type) {
@@ -1105,40 +1118,33 @@ static int as7312_54x_cpld_remove(struct i2c_client *client)
     return 0;
 }
 
-static int as7312_54x_cpld_read_internal(struct i2c_client *client, u8 reg)
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as7312_54x_cpld_data *data = i2c_get_clientdata(client);
 
-	while (retry) {
-		status = i2c_smbus_read_byte_data(client, reg);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
+	return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
 
-		break;
-	}
+static int as7312_54x_cpld_read_internal(struct i2c_client *client, u8 reg)
+{
+	struct as7312_54x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7312_54x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_write_byte_data(client, reg, value);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
-	}
+	struct as7312_54x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 int as7312_54x_cpld_read(unsigned short cpld_addr, u8 reg)
@@ -0,0 +1 @@
+../../common/modules/accton_i2c_trace.c
\ No newline at end of file
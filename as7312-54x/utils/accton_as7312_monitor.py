@@ -47,6 +47,31 @@ FUNCTION_NAME = 'accton_as7312_monitor'
 global log_file
 global log_level
 
+# Kernel fan governor in the as7312_54x_fan driver
+FAN_GOVERNOR_PATH = '/sys/bus/i2c/devices/2-0066/governor_enable'
+FAN_POLICY_PATH = '/sys/bus/i2c/devices/2-0066/fan_policy_{0}'
+
+# [duty cycle, step down below, step up above], in milli-Celsius
+max_duty = 100
+fan_policy_f2b = {
+   0: [32, 0,      105000],
+   1: [50, 105000, 120000],
+   2: [63, 120000, 135000],
+   3: [max_duty, 135000, sys.maxsize],
+}
+fan_policy_b2f = {
+   0: [44, 0,      105000],
+   1: [63, 105000, 120000],
+   2: [75, 120000, 135000],
+   3: [max_duty, 135000, sys.maxsize],
+}
+# Any single sensor above [y] raises the duty cycle to level y+1
+fan_policy_single = {
+   0: 40000,
+   1: 45000,
+   2: 50000,
+}
+
 #   (LM75_1+ LM75_2+ LM75_3) is LM75 at i2c addresses 0x48, 0x49, and 0x4A.
 #   TMP = (LM75_1+ LM75_2+ LM75_3)/3
 #1. If TMP < 35, All fans run with duty 31.25%.
@@ -97,28 +122,39 @@ class accton_as7312_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
+    def load_policy(self):
+        """Push the fan policy to the kernel governor and enable it.
+        Return False if the fan driver has no governor."""
+        if not os.path.exists(FAN_GOVERNOR_PATH):
+            return False
+
+        try:
+            for name, policy in (('f2b', fan_policy_f2b), ('b2f', fan_policy_b2f)):
+                levels = []
+                for x in sorted(policy):
+                    duty, down, up = policy[x]
+                    if up == sys.maxsize:
+                        up = 0  # the top level never steps up
+                    levels.append('%d %d %d %d' % (duty, down, up,
+                                  fan_policy_single.get(x - 1, 0)))
+                with open(FAN_POLICY_PATH.format(name), 'w') as f:
+                    f.write('\n'.join(levels) + '\n')
+            with open(FAN_GOVERNOR_PATH, 'w') as f:
+                f.write('1\n')
+        except IOError as e:
+            logging.error('SET. unable to load fan policy: %s', str(e))
+            return False
+
+        logging.info('INFO. fan policy loaded to the kernel governor')
+        return True
+
     def manage_fans(self):
-        max_duty = 100
-        fan_policy_f2b = {
-           0: [32, 0,      105000],
-           1: [50, 105000, 120000],
-           2: [63, 120000, 135000],
-           3: [max_duty, 135000, sys.maxsize],
-        }
-        fan_policy_b2f = {
-           0: [44, 0,      105000],
-           1: [63, 105000, 120000],
-           2: [75, 120000, 135000],
-           3: [max_duty, 135000, sys.maxsize],
-        }
-        fan_policy_single = {
-           0: 40000,
-           1: 45000,
-           2: 50000,
-        }
-  
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         for x in range(fan.get_idx_fan_start(), fan.get_num_fans()+1):
             fan_status = fan.get_fan_status(x)
             if fan_status is None:
@@ -199,6 +235,10 @@ def main(argv):
 
     monitor = accton_as7312_monitor(log_file, log_level)
 
+    # The fan driver runs the policy itself when it has a governor.
+    if monitor.load_policy():
+        return 0
+
     # Loop forever, doing something useful hopefully:
     while True:
         monitor.manage_fans()
@@ -27,6 +27,7 @@ try:
     import time
     import logging
     from collections import namedtuple
+    from sensorio import SensorNodes
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -98,26 +99,7 @@ class FanUtil(object):
             return None
 
         device_path = self.get_fan_to_device_path(fan_num, node_num)
-       
-        try:
-            val_file = open(device_path, 'r')
-        except IOError as e:
-            logging.error('GET. unable to open file: %s', str(e))
-            return None
-
-        content = val_file.readline().rstrip()
-        
-        if content == '':
-            logging.debug('GET. content is NULL. device_path:%s', device_path)
-            return None
-
-        try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
-            return None
-
-        return int(content)
+        return self._nodes.read_int(device_path)
 
     def _set_fan_node_val(self, fan_num, node_num, val):
         if fan_num < self.FAN_NUM_1_IDX or fan_num > self.FAN_NUM_ON_MAIN_BROAD:
@@ -134,23 +116,13 @@ class FanUtil(object):
             return None
 
         device_path = self.get_fan_to_device_path(fan_num, node_num)
-        try:
-            val_file = open(device_path, 'w')
-        except IOError as e:
-            logging.error('GET. unable to open file: %s', str(e))
-            return None
-
-        val_file.write(content)
-
-        try:
-		    val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
+        if not self._nodes.write(device_path, content):
             return None
 
         return True
 
     def __init__(self):
+        self._nodes = SensorNodes()
         fan_path = self.BASE_VAL_PATH 
 
         for fan_num in range(self.FAN_NUM_1_IDX, self.FAN_NUM_ON_MAIN_BROAD+1):
@@ -190,16 +162,11 @@ class FanUtil(object):
 
     def get_fan_duty_cycle(self):
         #duty_path = self.FAN_DUTY_PATH
-        try:
-            val_file = open(self.FAN_DUTY_PATH)
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)          
+        val = self._nodes.read_int(self.FAN_DUTY_PATH)
+        if val is None:
             return False
 
-        content = val_file.readline().rstrip()
-        val_file.close()
-        
-        return int(content)
+        return val
         #self._get_fan_node_val(fan_num, self.FAN_NODE_DUTY_IDX_OF_MAP)
 #static u32 reg_val_to_duty_cycle(u8 reg_val) 
 #{
@@ -208,15 +175,7 @@ class FanUtil(object):
 #}
 #
     def set_fan_duty_cycle(self, val):
-        
-        try:
-            fan_file = open(self.FAN_DUTY_PATH, 'r+')
-        except IOError as e:
-            print "Error: unable to open file: %s" % str(e)          
-            return False       
-        fan_file.write(str(val))
-        fan_file.close()
-        return True
+        return self._nodes.write(self.FAN_DUTY_PATH, val)
 
     #def get_fanr_fault(self, fan_num):
     #    return self._get_fan_node_val(fan_num, self.FANR_NODE_FAULT_IDX_OF_MAP)
@@ -29,6 +29,7 @@ try:
     import glob
     import commands
     from collections import namedtuple
+    from sensorio import SensorNodes
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -81,8 +82,9 @@ class ThermalUtil(object):
     THERMAL_NUM_5_IDX: ["/sys/class/hwmon/hwmon0/temp1_input"],     
     }
 
-    #def __init__(self):
-       
+    def __init__(self):
+        self._nodes = SensorNodes()
+
     def _get_thermal_val(self, thermal_num):
         if thermal_num < self.THERMAL_NUM_1_IDX or thermal_num > self.THERMAL_NUM_MAX:
             logging.debug('GET. Parameter error. thermal_num, %d', thermal_num)
@@ -90,28 +92,12 @@ class ThermalUtil(object):
        
         if thermal_num < self.THERMAL_NUM_6_IDX:
             device_path = self.get_thermal_to_device_path(thermal_num)
-            if(os.path.isfile(device_path)):                
-                for filename in glob.glob(device_path):
-                    try:
-                        val_file = open(filename, 'r')
-                    except IOError as e:
-                        logging.error('GET. unable to open file: %s', str(e))
-                        return None
-                content = val_file.readline().rstrip()
-                if content == '':
-                    logging.debug('GET. content is NULL. device_path:%s', device_path)
-                    return None
-                try:
-		            val_file.close()
-                except:
-                    logging.debug('GET. unable to close file. device_path:%s', device_path)
-                    return None      
-                return int(content)
-            
-            else:
+            val = self._nodes.read_int(device_path)
+            if val is None:
                 print "No such device_path=%s"%device_path
                 return 0
-            
+            return val
+
         else:
             log_os_system(self.BCM_thermal_cmd,0)
             file_path = self.BCM_thermal_path
@@ -164,7 +150,9 @@ class ThermalUtil(object):
     def get_thermal_2_val(self):
         return self._get_thermal_node_val(self.THERMAL_NUM_2_IDX)
     def get_thermal_temp(self):
-        return (self._get_thermal_node_val(self.THERMAL_NUM_1_IDX) + self._get_thermal_node_val(self.THERMAL_NUM_2_IDX) +self._get_thermal_node_val(self.THERMAL_NUM_3_IDX))
+        paths = [self.get_thermal_to_device_path(x)
+                 for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_3_IDX+1)]
+        return sum(self._nodes.read_many(paths))
 
 def main():
     thermal = ThermalUtil()
@@ -0,0 +1,139 @@
+/*
+ * Board driver for accton as7326_56x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "as7326_56x_platform"
+
+/* The layout accton_as7326_util.py used to build from user space */
+static const struct accton_i2c_mux muxes[] = {
+	{  0, 0x77,  1 },
+	{  1, 0x70,  9 },
+	{  1, 0x71, 17 },
+	{ 24, 0x72, 25 },
+	{  2, 0x70, 33 },
+	{ 33, 0x71, 41 },
+	{ 34, 0x72, 49 },
+	{ 35, 0x73, 57 },
+	{ 36, 0x74, 65 },
+	{ 37, 0x75, 73 },
+	{ 38, 0x76, 81 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{  0, "24c04",            0x56 },
+	{ 11, "as7326_56x_fan",   0x66 },
+	{ 15, "lm75",             0x48 },
+	{ 15, "lm75",             0x49 },
+	{ 15, "lm75",             0x4a },
+	{ 15, "lm75",             0x4b },
+	{ 17, "as7326_56x_psu1",  0x51 },
+	{ 17, "ym2651",           0x59 },
+	{ 13, "as7326_56x_psu2",  0x53 },
+	{ 13, "ym2651",           0x5b },
+	{ 18, "as7326_56x_cpld1", 0x60 },
+	{ 12, "as7326_56x_cpld2", 0x62 },
+	{ 19, "as7326_56x_cpld3", 0x64 },
+};
+
+/* Bus of port 1 to port 58: SFP28, QSFP28, then the two SFP+ of the CPU NIF */
+static const u8 sfp_bus[] = {
+	42, 41, 44, 43, 47, 45, 46, 50, 48, 49, 52, 51, 53, 56, 55, 54,
+	58, 57, 60, 59, 61, 63, 62, 64, 66, 68, 65, 67, 69, 71, 72, 70,
+	74, 73, 76, 75, 77, 79, 78, 80, 81, 82, 84, 85, 83, 87, 88, 86,
+	25, 26, 27, 28, 29, 30, 31, 32, 22, 23
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, 48, "optoe2" },
+	{ sfp_bus + 48, 8, "optoe1" },
+	{ sfp_bus + 56, 2, "optoe2" },
+};
+
+static const struct accton_i2c_board_desc as7326_56x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int as7326_56x_platform_probe(struct platform_device *pdev)
+{
+	return accton_i2c_board_probe(pdev, &as7326_56x_board);
+}
+
+static int as7326_56x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver as7326_56x_platform_driver = {
+	.probe		= as7326_56x_platform_probe,
+	.remove		= as7326_56x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init as7326_56x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&as7326_56x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&as7326_56x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit as7326_56x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&as7326_56x_platform_driver);
+}
+
+module_init(as7326_56x_platform_init);
+module_exit(as7326_56x_platform_exit);
+
+MODULE_DESCRIPTION("as7326_56x board driver");
+MODULE_LICENSE("GPL");
@@ -0,0 +1 @@
+../../common/modules/accton_fan_governor.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../common/modules/accton_i2c_retry.h
\ No newline at end of file
@@ -47,6 +47,18 @@ FUNCTION_NAME = '/usr/local/bin/accton_as7326_monitor'
 global log_file
 global log_level
 
+# Kernel fan governor in the as7326_56x_fan driver
+FAN_GOVERNOR_PATH = '/sys/bus/i2c/devices/11-0066/governor_enable'
+FAN_POLICY_PATH = '/sys/bus/i2c/devices/11-0066/fan_policy_{0}'
+
+# The fan speed part of fan_policy in manage_fans(), for both directions:
+# [duty cycle, step down below, step up above], in milli-Celsius
+fan_policy_governor = {
+   0: [38,  0,     39000],
+   1: [75,  39000, 45000],
+   2: [100, 45000, 0],
+}
+
 
 #Default FAN speed: 37.5%(0x05)
 #Ori is that detect: (U45_BCM56873 + Thermal sensor_LM75_CPU:0x4B) /2 
@@ -99,6 +111,7 @@ class device_monitor(object):
     pwm=0
     ori_pwm = 0
     default_pwm=0x4
+    governor = False    # the fan driver sets the duty cycle
 
     def __init__(self, log_file, log_level):
         """Needs a logger and a logger level."""
@@ -123,7 +136,33 @@ class device_monitor(object):
         logging.getLogger('').addHandler(sys_handler)
 
         #logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
+
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
           
+    def load_policy(self):
+        """Push the fan policy to the kernel governor and enable it.
+        The monitor then only raises the temperature alarms."""
+        if not os.path.exists(FAN_GOVERNOR_PATH):
+            return False
+
+        try:
+            levels = [' '.join(str(v) for v in fan_policy_governor[x])
+                      for x in sorted(fan_policy_governor)]
+            for name in ('f2b', 'b2f'):
+                with open(FAN_POLICY_PATH.format(name), 'w') as f:
+                    f.write('\n'.join(levels) + '\n')
+            with open(FAN_GOVERNOR_PATH, 'w') as f:
+                f.write('1\n')
+        except IOError as e:
+            logging.error('SET. unable to load fan policy: %s', str(e))
+            return False
+
+        logging.info('INFO. fan policy loaded to the kernel governor')
+        self.governor = True
+        return True
+
     def get_state_from_fan_policy(self, temp, policy):
         state=0
          
@@ -173,8 +212,8 @@ class device_monitor(object):
         4: [66000, 200000,  LEVEL_TEMP_CRITICAL],        
         }
               
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         fan_dir=fan.get_fan_dir(1)            
         if fan_dir > 1:
             fan_dri=1 #something wrong, set fan_dir to default val
@@ -221,12 +260,12 @@ class device_monitor(object):
         logging.debug('ori_state=%d, fan_policy_state=%d', ori_state, fan_policy_state)
         new_pwm = fan_policy_state_pwm_tlb[fan_policy_state][0]
         if fan_fail==0:
-        logging.debug('new_pwm=%d', new_pwm)
+            logging.debug('new_pwm=%d', new_pwm)
         
-        if fan_fail==0:
-        if new_pwm!=ori_pwm:
-            fan.set_fan_duty_cycle(new_pwm)
-            logging.info('Set fan speed from %d to %d', ori_pwm, new_pwm)
+        if fan_fail==0 and not self.governor:
+            if new_pwm!=ori_pwm:
+                fan.set_fan_duty_cycle(new_pwm)
+                logging.info('Set fan speed from %d to %d', ori_pwm, new_pwm)
         
         for i in range (fan.FAN_NUM_1_IDX, fan.FAN_NUM_ON_MAIN_BROAD+1):
             if fan.get_fan_status(i)==0:
@@ -234,7 +273,8 @@ class device_monitor(object):
                 logging.debug('fan_%d fail, set pwm to 100',i)
                 if test_temp==0:
                     fan_fail=1
-                    fan.set_fan_duty_cycle(new_pwm)
+                    if not self.governor:
+                        fan.set_fan_duty_cycle(new_pwm)
                     break
             else:
                 fan_fail=0
@@ -330,6 +370,9 @@ def main(argv):
     fan.set_fan_duty_cycle(38)
     print "set default fan speed to 37.5%"
     monitor = device_monitor(log_file, log_level)
+    # With the governor, keep looping for the temperature alarms only
+    if test_temp==0:
+        monitor.load_policy()
     # Loop forever, doing something useful hopefully:
     while True:
         monitor.manage_fans()
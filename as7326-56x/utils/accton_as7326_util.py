@@ -308,7 +308,12 @@ kos = [
 'modprobe accton_as7326_56x_fan'     ,
 'modprobe optoe'      ,
 'modprobe accton_as7326_56x_leds'      ,
-'modprobe accton_as7326_56x_psu' ]
+'modprobe accton_as7326_56x_psu',
+'modprobe accton_as7326_56x_platform' ]
+
+# Set when the board driver has created the devices; they are then
+# removed together with the driver.
+board_path = '/sys/bus/platform/devices/as7326_56x_platform'
 
 def driver_install():
     global FORCE
@@ -452,6 +457,9 @@ def device_install():
 def device_uninstall():
     global FORCE
 
+    if os.path.exists(board_path):
+        return 0
+
     status, output =log_os_system("ls /sys/bus/i2c/devices/1-0076", 0)
     if status==0:
         I2C_ORDER=1
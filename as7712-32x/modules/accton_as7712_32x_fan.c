@@ -29,18 +29,15 @@
 #include <linux/sysfs.h>
 #include <linux/slab.h>
 #include <linux/dmi.h>
-#include <linux/fs.h>
-#include <asm/uaccess.h>
+#include "accton_lm75.h"
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define DRVNAME "as7712_32x_fan"
 
 #define NUM_THERMAL_SENSORS     (3)     /* Get sum of this number of sensors.*/
-#define THERMAL_SENSORS_DRIVER     "lm75"
 #define THERMAL_SENSORS_ADDRS   {0x48, 0x49, 0x4a}
 
-#define		IN
-#define		OUT
-
 static struct as7712_32x_fan_data *as7712_32x_fan_update_device(struct device *dev);
 static ssize_t fan_show_value(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
@@ -81,6 +78,9 @@ struct as7712_32x_fan_data {
     u8               enable;
     int              system_temp;    /*In unit of mini-Celsius*/
     int              sensors_found;
+    struct accton_lm75_sensors lm75;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 enum fan_id {
@@ -219,12 +219,22 @@ static struct attribute *as7712_32x_fan_attributes[] = {
 
 static int as7712_32x_fan_read_value(struct i2c_client *client, u8 reg)
 {
-    return i2c_smbus_read_byte_data(client, reg);
+    struct as7712_32x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7712_32x_fan_write_value(struct i2c_client *client, u8 reg, u8 value)
 {
-    return i2c_smbus_write_byte_data(client, reg, value);
+    struct as7712_32x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 /* fan utility functions
@@ -319,257 +329,16 @@ static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
     return count;
 }
 
-/* Due to this struct is declared at lm75.c, it cannot be include
- * under Sonic environment. I duplicate it from lm75.c.
- */
-struct lm75_data {
-    struct i2c_client       *client;
-    struct device           *hwmon_dev;
-    struct thermal_zone_device      *tz;
-    struct mutex            update_lock;
-    u8                      orig_conf;
-    u8                      resolution;     /* In bits, between 9 and 12 */
-    u8                      resolution_limits;
-    char                    valid;          /* !=0 if registers are valid */
-    unsigned long           last_updated;   /* In jiffies */
-    unsigned long           sample_time;    /* In jiffies */
-    s16                     temp[3];        /* Register values,
-                                                   0 = input
-                                                   1 = max
-                                                   2 = hyst */
-};
-
-/*Copied from lm75.c*/
-static inline long lm75_reg_to_mc(s16 temp, u8 resolution)
-{
-    return ((temp >> (16 - resolution)) * 1000) >> (resolution - 8);
-}
-
-/*Get hwmon_dev from i2c_client, set hwmon_dev = NULL is failed.*/
-static struct device * get_hwmon_dev(
-    struct i2c_client *client)
-{
-    struct lm75_data *data = NULL;
-
-    data = i2c_get_clientdata(client);
-    if(data)
-    {
-        if( data->valid == 1  && data->hwmon_dev)
-        {
-            return data->hwmon_dev;
-        }
-
-    }
-    return NULL;
-}
-
-/* To find hwmon index by opening hwmon under that i2c address.
- */
-static int find_hwmon_index_by_FileOpen(
-    int bus_nr,
-    unsigned short addr,
-    OUT int *index)
-{
-#define MAX_HWMON_DEVICE        (10)    /* Find hwmon device in 0~10*/
-    struct file *sfd;
-    char client_name[96];
-    int  i=0;
-
-    do {
-        snprintf(client_name, sizeof(client_name),
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/hwmon%d/temp1_input",
-                 bus_nr, addr, i);
-
-        sfd = filp_open(client_name, O_RDONLY, 0);
-        i++;
-    } while( IS_ERR(sfd) && i < MAX_HWMON_DEVICE);
-
-    if (IS_ERR(sfd)) {
-        pr_err("Failed to open file(%s)#%d\r\n", client_name, __LINE__);
-        return -ENOENT;
-    }
-    filp_close(sfd, 0);
-    *index = i - 1;
-    return 0;
-
-#undef MAX_HWMON_DEVICE
-}
-
-static int get_temp_file_path(
-    int bus_nr, unsigned short addr,
-    struct device *hwmon_dev
-    ,char *path, int max_len)
-{
-
-    if(hwmon_dev && strlen(dev_name(hwmon_dev)))
-    {
-        snprintf(path, max_len,
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/%s/temp1_input",
-                 bus_nr, addr, dev_name(hwmon_dev));
-    }
-    else
-    {
-        int  i=0;
-        if(find_hwmon_index_by_FileOpen( bus_nr, addr, &i))
-        {
-            return  -EIO;
-        }
-        snprintf(path, max_len,
-                 "/sys/bus/i2c/devices/%d-%04x/hwmon/hwmon%d/temp1_input",
-                 bus_nr, addr, i);
-    }
-    return 0;
-}
-
-/*File read the dev file at user space.*/
-static int read_devfile_temp1_input(
-    struct device *dev,
-    int bus_nr,
-    unsigned short addr,
-    struct device *hwmon_dev,
-    int *miniCelsius)
-{
-    struct file *sfd;
-    char buffer[96];
-    char devfile[96];
-    int     rc, status;
-    int     rdlen, value;
-    mm_segment_t old_fs;
-
-    rc = 0;
-    get_temp_file_path(bus_nr, addr, hwmon_dev, devfile, sizeof(devfile));
-    sfd = filp_open(devfile, O_RDONLY, 0);
-    if (IS_ERR(sfd)) {
-        pr_err("Failed to open file(%s)#%d\r\n", devfile, __LINE__);
-        return -ENOENT;
-    }
-    dev_dbg(dev, "Found device:%s\n",devfile);
-
-    if(!(sfd->f_op) || !(sfd->f_op->read) ) {
-        pr_err("file %s cann't readable ?\n",devfile);
-        return -ENOENT;
-    }
-
-    old_fs = get_fs();
-    set_fs(KERNEL_DS);
-    rdlen = sfd->f_op->read(sfd, buffer, sizeof(buffer), &sfd->f_pos);
-    if (rdlen == 0) {
-        pr_err( "File(%s) empty!\n", devfile);
-        rc = -EIO;
-        goto exit;
-    }
-    status = sscanf(buffer, "%d", &value);
-    if (status != 1) {
-        rc = -EIO;
-        goto exit;
-    }
-    *miniCelsius = value;
-    dev_dbg(dev,"found sensors: %d @i2c %d-%04x\n", value, bus_nr, addr);
+static const unsigned short thermal_sensors_addrs[] = THERMAL_SENSORS_ADDRS;
 
-exit:
-    set_fs(old_fs);
-    filp_close(sfd, 0);
-    return rc;
-}
-
-static u8 is_lm75_data_due(struct i2c_client *client)
-{
-    struct lm75_data *data = NULL;
-
-    data = i2c_get_clientdata(client);
-    if (time_after(jiffies, data->last_updated + data->sample_time))
-    {
-        return 1;
-    }
-    return 0;
-}
-static int get_lm75_temp(struct i2c_client *client, int *miniCelsius)
-{
-    struct lm75_data *data = NULL;
-
-    data = i2c_get_clientdata(client);
-    *miniCelsius = lm75_reg_to_mc(data->temp[0], data->resolution);
-
-    return 0;
-}
-
-static bool lm75_addr_mached(unsigned short addr)
-{
-    int i;
-    unsigned short addrs[] = THERMAL_SENSORS_ADDRS;
-    
-    for (i = 0; i < ARRAY_SIZE(addrs); i++)
-    {
-        if( addr == addrs[i])
-            return 1;
-    }
-    return 0;
-}
-
-static int _find_lm75_device(struct device *dev, void *data)
-{
-    struct device_driver *driver;
-    struct as7712_32x_fan_data *prv = data;
-    char *driver_name = THERMAL_SENSORS_DRIVER;
-
-    driver = dev->driver;
-    if (driver && driver->name &&
-            strcmp(driver->name, driver_name) == 0)
-    {
-        struct i2c_client *client;
-        client = to_i2c_client(dev);
-        if (client)
-        {
-            /*cannot use "struct i2c_adapter *adap = to_i2c_adapter(dev);"*/
-            struct i2c_adapter *adap = client->adapter;
-            int miniCelsius = 0;
-
-            if (! lm75_addr_mached(client->addr))
-            {
-                return 0;
-            }
-
-            if (!adap) {
-                return -ENXIO;
-            }
-
-            /* If the data is not updated, read them from devfile
-               to drive them updateing data from chip.*/
-            if (is_lm75_data_due(client))
-            {
-                struct device *hwmon_dev;
-
-                hwmon_dev = get_hwmon_dev(client);
-                if(0 == read_devfile_temp1_input(dev, adap->nr,
-                                                 client->addr, hwmon_dev, &miniCelsius))
-                {
-                    prv->system_temp += miniCelsius;
-                    prv->sensors_found++;
-                }
-
-            }
-            else
-            {
-                get_lm75_temp(client, &miniCelsius);
-                prv->system_temp += miniCelsius;
-                prv->sensors_found++;
-
-            }
-        }
-    }
-    return 0;
-}
-
-/*Find all lm75 devices and return sum of temperatures.*/
+/*Return sum of the temperatures of the lm75 devices.*/
 static ssize_t get_sys_temp(struct device *dev, struct device_attribute *da,
                             char *buf)
 {
     ssize_t ret = 0;
     struct as7712_32x_fan_data *data = as7712_32x_fan_update_device(dev);
 
-    data->system_temp=0;
-    data->sensors_found=0;
-    i2c_for_each_dev(data, _find_lm75_device);
+    data->sensors_found = accton_lm75_sum(&data->lm75, &data->system_temp);
     if (NUM_THERMAL_SENSORS != data->sensors_found)
     {
         dev_dbg(dev,"only %d of %d temps are found\n",
@@ -700,6 +469,11 @@ static int as7712_32x_fan_probe(struct i2c_client *client,
     data->enable = 0;
     mutex_init(&data->update_lock);
 
+    status = accton_lm75_init(&data->lm75, thermal_sensors_addrs, NUM_THERMAL_SENSORS);
+    if (status) {
+        goto exit_free;
+    }
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -717,11 +491,14 @@ static int as7712_32x_fan_probe(struct i2c_client *client,
     dev_info(&client->dev, "%s: fan '%s'\n",
              dev_name(data->hwmon_dev), client->name);
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
+
     return 0;
 
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &as7712_32x_fan_group);
 exit_free:
+    accton_lm75_exit(&data->lm75);
     kfree(data);
 exit:
 
@@ -731,8 +508,11 @@ exit:
 static int as7712_32x_fan_remove(struct i2c_client *client)
 {
     struct as7712_32x_fan_data *data = i2c_get_clientdata(client);
+
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7712_32x_fan_group);
+    accton_lm75_exit(&data->lm75);
 
     return 0;
 }
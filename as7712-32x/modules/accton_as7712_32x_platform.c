@@ -0,0 +1,174 @@
+/*
+ * Board driver for accton as7712_32x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "as7712_32x_platform"
+
+/*
+ * The layouts accton_as7712_util.py used to build from user space: the
+ * second one when the 0x76 mux is not on i2c-0, which is then i2c-1.
+ */
+static const struct accton_i2c_mux muxes[] = {
+	{  0, 0x76,  2 },
+	{  1, 0x71, 10 },
+	{  1, 0x72, 18 },
+	{  1, 0x73, 26 },
+	{  1, 0x74, 34 },
+	{  1, 0x75, 42 },
+};
+
+static const struct accton_i2c_mux muxes2[] = {
+	{  1, 0x76,  2 },
+	{  0, 0x71, 10 },
+	{  0, 0x72, 18 },
+	{  0, 0x73, 26 },
+	{  0, 0x74, 34 },
+	{  0, 0x75, 42 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{  1, "24c02",           0x57 },
+	{  2, "as7712_32x_fan",  0x66 },
+	{  3, "lm75",            0x48 },
+	{  3, "lm75",            0x49 },
+	{  3, "lm75",            0x4a },
+	{  3, "lm75",            0x4b },
+	{ 11, "as7712_32x_psu1", 0x53 },
+	{ 11, "ym2651",          0x5b },
+	{ 10, "as7712_32x_psu2", 0x50 },
+	{ 10, "ym2651",          0x58 },
+	{  4, "cpld_as7712",     0x60 },
+	{  5, "cpld_plain",      0x62 },
+	{  6, "cpld_plain",      0x64 },
+};
+
+static const struct accton_i2c_dev i2c_devs2[] = {
+	{  0, "24c02",           0x57 },
+	{  2, "as7712_32x_fan",  0x66 },
+	{  3, "lm75",            0x48 },
+	{  3, "lm75",            0x49 },
+	{  3, "lm75",            0x4a },
+	{  3, "lm75",            0x4b },
+	{ 11, "as7712_32x_psu1", 0x53 },
+	{ 11, "ym2651",          0x5b },
+	{ 10, "as7712_32x_psu2", 0x50 },
+	{ 10, "ym2651",          0x58 },
+	{  4, "cpld_as7712",     0x60 },
+	{  5, "cpld_plain",      0x62 },
+	{  6, "cpld_plain",      0x64 },
+};
+
+/* Bus of port 1 to port 32 */
+static const u8 sfp_bus[] = {
+	22, 23, 24, 25, 27, 26, 29, 28, 18, 19, 20, 21, 30, 31, 32, 33,
+	34, 35, 36, 37, 46, 47, 48, 49, 38, 39, 40, 41, 42, 43, 44, 45
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, ARRAY_SIZE(sfp_bus), "optoe1" },
+};
+
+static const struct accton_i2c_board_desc as7712_32x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static const struct accton_i2c_board_desc as7712_32x_board2 = {
+	.muxes     = muxes2,
+	.num_muxes = ARRAY_SIZE(muxes2),
+	.devs      = i2c_devs2,
+	.num_devs  = ARRAY_SIZE(i2c_devs2),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int as7712_32x_platform_probe(struct platform_device *pdev)
+{
+	const struct accton_i2c_board_desc *desc = &as7712_32x_board;
+
+	/* Buses 0 and 1 may come up in either order */
+	if (!accton_i2c_board_detect(0, 0x76)) {
+		desc = &as7712_32x_board2;
+	}
+
+	return accton_i2c_board_probe(pdev, desc);
+}
+
+static int as7712_32x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver as7712_32x_platform_driver = {
+	.probe		= as7712_32x_platform_probe,
+	.remove		= as7712_32x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init as7712_32x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&as7712_32x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&as7712_32x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit as7712_32x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&as7712_32x_platform_driver);
+}
+
+module_init(as7712_32x_platform_init);
+module_exit(as7712_32x_platform_exit);
+
+MODULE_DESCRIPTION("as7712_32x board driver");
+MODULE_LICENSE("GPL");
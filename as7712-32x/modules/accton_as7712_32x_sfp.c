@@ -31,6 +31,11 @@
 #include <linux/sysfs.h>
 #include <linux/slab.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/version.h>
+#include <linux/notifier.h>
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define DRIVER_NAME 	"as7712_32x_sfp"
 
@@ -48,8 +53,7 @@
 #define EEPROM_SIZE				256	/*  256 byte eeprom */
 #define BIT_INDEX(i) 			(1ULL << (i))
 #define USE_I2C_BLOCK_READ 		1
-#define I2C_RW_RETRY_COUNT		3
-#define I2C_RW_RETRY_INTERVAL	100 /* ms */
+#define SFP_I2C_XFER_MAX		128	/* one page per transfer on plain I2C */
 
 #define SFP_EEPROM_A0_I2C_ADDR (0xA0 >> 1)
 #define SFP_EEPROM_A2_I2C_ADDR (0xA2 >> 1)
@@ -73,6 +77,9 @@ static ssize_t sfp_eeprom_read(struct i2c_client *, u8, u8 *,int);
 static ssize_t sfp_eeprom_write(struct i2c_client *, u8 , const char *,int);
 extern int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg);
 extern int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
+extern int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg, u8 *values, u8 len);
+extern int accton_i2c_cpld_register_present_notifier(struct notifier_block *nb);
+extern int accton_i2c_cpld_unregister_present_notifier(struct notifier_block *nb);
 
 /* Addresses scanned
  */
@@ -174,6 +181,12 @@ struct sfp_port_data {
 	struct qsfp_data 	  *qsfp;
 
 	struct i2c_client 	  *client;
+
+	s64 probe_us;			/* time spent in sfp_device_probe() */
+	unsigned int xfer_max;	/* EEPROM bytes per read transfer */
+	struct accton_i2c_stats i2c_stats;
+	struct accton_i2c_trace i2c_trace;
+	struct notifier_block present_nb;	/* presence changes from the CPLD */
 };
 
 enum sfp_sysfs_attributes {
@@ -215,24 +228,22 @@ static struct sfp_port_data *sfp_update_present(struct i2c_client *client)
 	struct sfp_port_data *data = i2c_get_clientdata(client);
 	int i = 0;
 	int status = -1;
-	u8 regs[] = {0x30, 0x31, 0x32, 0x33};
+	u8 values[4];
 
 	DEBUG_PRINT("Starting sfp present status update");
 	mutex_lock(&data->update_lock);
 
-	/* Read present status of port 1~32 */
+	/* Read present status of port 1~32, reg 0x30~0x33 */
     data->present = 0;
-	
-    for (i = 0; i < ARRAY_SIZE(regs); i++) {
-        status = accton_i2c_cpld_read(0x60, regs[i]);
-        
-        if (status < 0) {
-            DEBUG_PRINT("cpld(0x60) reg(0x%x) err %d", regs[i], status);
-            goto exit;
-        }
-        
-        DEBUG_PRINT("Present status = 0x%llx", data->present);
-        data->present |= (u64)status << (i*8);
+
+    status = accton_i2c_cpld_read_block(0x60, 0x30, values, ARRAY_SIZE(values));
+    if (status < 0) {
+        DEBUG_PRINT("cpld(0x60) reg(0x30) err %d", status);
+        goto exit;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(values); i++) {
+        data->present |= (u64)values[i] << (i*8);
     }
 
 	DEBUG_PRINT("Present status = 0x%llx", data->present);
@@ -360,23 +371,21 @@ static struct sfp_port_data *sfp_update_port_reset(struct i2c_client *client)
     struct sfp_port_data *data = i2c_get_clientdata(client);
     int i = 0;
     int status = -1;
-    u8 regs[] = {0x4, 0x5, 0x6, 0x7};
+    u8 values[4];
 
     mutex_lock(&data->update_lock);
 
-    /* Read reset status of port 1~32 */
+    /* Read reset status of port 1~32, reg 0x4~0x7 */
     data->port_reset = 0;
 
-    for (i = 0; i < ARRAY_SIZE(regs); i++) {
-        status = accton_i2c_cpld_read(0x60, regs[i]);
+    status = accton_i2c_cpld_read_block(0x60, 0x4, values, ARRAY_SIZE(values));
+    if (status < 0) {
+        DEBUG_PRINT("cpld(0x60) reg(0x4) err %d", status);
+        goto exit;
+    }
 
-        if (status < 0) {
-            DEBUG_PRINT("cpld(0x60) reg(0x%x) err %d", regs[i], status);
-            goto exit;
-        }
-        
-        DEBUG_PRINT("reset status = 0x%x", status);
-        data->port_reset |= (u64)status << (i*8);
+    for (i = 0; i < ARRAY_SIZE(values); i++) {
+        data->port_reset |= (u64)values[i] << (i*8);
     }
 
     DEBUG_PRINT("reset status = 0x%llx", data->port_reset);
@@ -651,6 +660,17 @@ static SENSOR_DEVICE_ATTR(sfp_tx_fault1, S_IRUGO, qsfp_show_tx_rx_status, NULL,
 static SENSOR_DEVICE_ATTR(sfp_tx_fault2, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT2);
 static SENSOR_DEVICE_ATTR(sfp_tx_fault3, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT3);
 static SENSOR_DEVICE_ATTR(sfp_tx_fault4, S_IRUGO, qsfp_show_tx_rx_status, NULL, TX_FAULT4);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+			char *buf);
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+static ssize_t show_xfer_max(struct device *dev, struct device_attribute *da,
+			char *buf);
+static ssize_t set_xfer_max(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count);
+static DEVICE_ATTR(sfp_xfer_max, S_IWUSR | S_IRUGO, show_xfer_max, set_xfer_max);
+static ssize_t show_probe_time(struct device *dev, struct device_attribute *da,
+			char *buf);
+static DEVICE_ATTR(sfp_probe_time_us, S_IRUGO, show_probe_time, NULL);
 static struct attribute *qsfp_attributes[] = {
 	&sensor_dev_attr_sfp_port_number.dev_attr.attr,
 	&sensor_dev_attr_sfp_port_type.dev_attr.attr,
@@ -669,6 +689,9 @@ static struct attribute *qsfp_attributes[] = {
 	&sensor_dev_attr_sfp_tx_fault2.dev_attr.attr,
 	&sensor_dev_attr_sfp_tx_fault3.dev_attr.attr,
 	&sensor_dev_attr_sfp_tx_fault4.dev_attr.attr,	
+	&dev_attr_i2c_stats.attr,
+	&dev_attr_sfp_xfer_max.attr,
+	&dev_attr_sfp_probe_time_us.attr,
 	NULL
 };
 
@@ -679,6 +702,9 @@ static struct attribute *sfp_msa_attributes[] = {
 	&sensor_dev_attr_sfp_port_type.dev_attr.attr,
 	&sensor_dev_attr_sfp_is_present.dev_attr.attr,
 	&sensor_dev_attr_sfp_ddm_implemented.dev_attr.attr,
+	&dev_attr_i2c_stats.attr,
+	&dev_attr_sfp_xfer_max.attr,
+	&dev_attr_sfp_probe_time_us.attr,
 	NULL
 };
 
@@ -693,26 +719,74 @@ static struct attribute *sfp_ddm_attributes[] = {
 	NULL
 };
 
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+			char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+
+	return accton_i2c_stats_show(&port->i2c_stats, buf);
+}
+
+static ssize_t show_xfer_max(struct device *dev, struct device_attribute *da,
+			char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+
+	return sprintf(buf, "%u\n", port->xfer_max);
+}
+
+static ssize_t set_xfer_max(struct device *dev, struct device_attribute *da,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	unsigned int limit, max;
+	int status;
+
+	status = kstrtouint(buf, 10, &limit);
+	if (status) {
+		return status;
+	}
+
+	max = i2c_check_functionality(client->adapter, I2C_FUNC_I2C) ?
+		  SFP_I2C_XFER_MAX : I2C_SMBUS_BLOCK_MAX;
+	if (limit < 1 || limit > max) {
+		return -EINVAL;
+	}
+
+	mutex_lock(&port->update_lock);
+	port->xfer_max = limit;
+	mutex_unlock(&port->update_lock);
+
+	return count;
+}
+
+static ssize_t show_probe_time(struct device *dev, struct device_attribute *da,
+			char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+
+	return sprintf(buf, "%lld\n", port->probe_us);
+}
+
 static ssize_t sfp_eeprom_write(struct i2c_client *client, u8 command, const char *data,
 			  int data_len)
 {
 #if USE_I2C_BLOCK_READ
-	int result, retry = I2C_RW_RETRY_COUNT;
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	int result;
 
 	if (data_len > I2C_SMBUS_BLOCK_MAX) {
 		data_len = I2C_SMBUS_BLOCK_MAX;
 	} 
 
-	while (retry) {
-		result = i2c_smbus_write_i2c_block_data(client, command, data_len, data);
-		if (result < 0) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
- 
-		break;
-	}
+	result = accton_i2c_retry(&port->i2c_stats,
+			accton_i2c_traced(&port->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+				i2c_smbus_write_i2c_block_data(client, command, data_len, data)));
 
 	if (unlikely(result < 0)) {
 		return result;
@@ -720,18 +794,13 @@ static ssize_t sfp_eeprom_write(struct i2c_client *client, u8 command, const cha
 
 	return data_len;
 #else
-	int result, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		result = i2c_smbus_write_byte_data(client, command, *data);
-		if (result < 0) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
- 
-		break;
-	}
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	int result;
+
+	result = accton_i2c_retry(&port->i2c_stats,
+			accton_i2c_traced(&port->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, command, 1,
+				i2c_smbus_write_byte_data(client, command, *data)));
 	
 	if (unlikely(result < 0)) {
 		return result;
@@ -790,26 +859,61 @@ static ssize_t sfp_bin_write(struct file *filp, struct kobject *kobj,
 	return sfp_port_write(data, buf, off, count);
 }
 
+/*
+ * Read with one combined write/read transfer, so that an adapter speaking
+ * plain I2C returns a whole page instead of 32 byte SMBus blocks.
+ */
+static ssize_t sfp_eeprom_read_i2c(struct i2c_client *client, u8 command,
+			  u8 *data, int data_len)
+{
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	struct i2c_msg msg[2];
+	int status;
+
+	data_len = min3(data_len, (int)port->xfer_max, EEPROM_SIZE - command);
+
+	msg[0].addr  = client->addr;
+	msg[0].flags = 0;
+	msg[0].len   = 1;
+	msg[0].buf   = &command;
+	msg[1].addr  = client->addr;
+	msg[1].flags = I2C_M_RD;
+	msg[1].len   = data_len;
+	msg[1].buf   = data;
+
+	status = accton_i2c_retry(&port->i2c_stats,
+			accton_i2c_traced(&port->i2c_trace, client,
+				I2C_SMBUS_READ, ACCTON_I2C_XFER_RAW, command, data_len,
+				i2c_transfer(client->adapter, msg, 2)));
+	if (unlikely(status < 0)) {
+		return status;
+	}
+	if (unlikely(status != 2)) {
+		return -EIO;
+	}
+
+	return data_len;
+}
+
 static ssize_t sfp_eeprom_read(struct i2c_client *client, u8 command, u8 *data,
 			  int data_len)
 {
 #if USE_I2C_BLOCK_READ
-	int result, retry = I2C_RW_RETRY_COUNT;
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	int result;
 
-	if (data_len > I2C_SMBUS_BLOCK_MAX) {
-		data_len = I2C_SMBUS_BLOCK_MAX;
+	if (port->xfer_max > I2C_SMBUS_BLOCK_MAX) {
+		return sfp_eeprom_read_i2c(client, command, data, data_len);
 	}
 
-	while (retry) {
-		result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
-		if (result < 0) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
+	if (data_len > port->xfer_max) {
+		data_len = port->xfer_max;
 	}
+
+	result = accton_i2c_retry(&port->i2c_stats,
+			accton_i2c_traced(&port->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+				i2c_smbus_read_i2c_block_data(client, command, data_len, data)));
 	
 	if (unlikely(result < 0))
 		goto abort;
@@ -823,18 +927,13 @@ static ssize_t sfp_eeprom_read(struct i2c_client *client, u8 command, u8 *data,
 abort:
 	return result;
 #else
-	int result, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		result = i2c_smbus_read_byte_data(client, command);
-		if (result < 0) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
- 
-		break;
-	}
+	struct sfp_port_data *port = i2c_get_clientdata(client);
+	int result;
+
+	result = accton_i2c_retry(&port->i2c_stats,
+			accton_i2c_traced(&port->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, command, 1,
+				i2c_smbus_read_byte_data(client, command)));
 
 	if (unlikely(result < 0)) {
 		dev_dbg(&client->dev, "sfp read byte data failed, command(0x%2x), data(0x%2x)\r\n", command, result);
@@ -1079,10 +1178,32 @@ exit:
 	return status;	
 }
 
+/* The CPLD presence poller found a change: wake up pollers of the
+ * presence attributes of this port
+ */
+static int sfp_present_notify(struct notifier_block *nb,
+			unsigned long cpld_addr, void *changed)
+{
+	struct sfp_port_data *data = container_of(nb, struct sfp_port_data, present_nb);
+
+	if (cpld_addr != 0x60) {
+		return NOTIFY_DONE;
+	}
+
+	sysfs_notify(&data->client->dev.kobj, NULL, "sfp_is_present_all");
+	if (*(u64 *)changed & BIT_ULL(data->port)) {
+		sysfs_notify(&data->client->dev.kobj, NULL, "sfp_is_present");
+	}
+
+	return NOTIFY_OK;
+}
+
 static int sfp_device_probe(struct i2c_client *client,
 			const struct i2c_device_id *dev_id)
 {
 	struct sfp_port_data *data = NULL;
+	ktime_t start = ktime_get();
+	int ret;
 
 	data = kzalloc(sizeof(struct sfp_port_data), GFP_KERNEL);
 	if (!data) {
@@ -1091,6 +1212,8 @@ static int sfp_device_probe(struct i2c_client *client,
 
 	i2c_set_clientdata(client, data);
 	mutex_init(&data->update_lock);
+	data->xfer_max = i2c_check_functionality(client->adapter, I2C_FUNC_I2C) ?
+					 SFP_I2C_XFER_MAX : I2C_SMBUS_BLOCK_MAX;
 	data->port 	 = dev_id->driver_data;
 	data->client = client;
 	
@@ -1099,7 +1222,16 @@ static int sfp_device_probe(struct i2c_client *client,
 	}
 	
 	data->driver_type = DRIVER_TYPE_QSFP;
-	return qsfp_probe(client, dev_id, &data->qsfp);
+	ret = qsfp_probe(client, dev_id, &data->qsfp);
+	if (ret < 0) {
+		return ret;
+	}
+
+	accton_i2c_trace_add(&data->i2c_trace, client);
+	data->present_nb.notifier_call = sfp_present_notify;
+	accton_i2c_cpld_register_present_notifier(&data->present_nb);
+	data->probe_us = ktime_us_delta(ktime_get(), start);
+	return 0;
 }
 
 static int sfp_msa_remove(struct i2c_client *client, struct sfp_msa_data *data)
@@ -1130,6 +1262,9 @@ static int sfp_device_remove(struct i2c_client *client)
 {
 	struct sfp_port_data *data = i2c_get_clientdata(client);
 
+	accton_i2c_cpld_unregister_present_notifier(&data->present_nb);
+	accton_i2c_trace_remove(&data->i2c_trace);
+
 	switch (data->driver_type) {
 		case DRIVER_TYPE_SFP_MSA:
 			return sfp_msa_remove(client, data->msa);
@@ -1145,6 +1280,10 @@ static int sfp_device_remove(struct i2c_client *client)
 static struct i2c_driver sfp_driver = {
     .driver = {
         .name     = DRIVER_NAME,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,2,0)
+        /* probing does no bus I/O, let ports come up in parallel */
+        .probe_type = PROBE_PREFER_ASYNCHRONOUS,
+#endif
     },
     .probe        = sfp_device_probe,
     .remove       = sfp_device_remove,
@@ -0,0 +1 @@
+../../common/modules/accton_i2c_board.h
\ No newline at end of file
@@ -162,7 +162,12 @@ kos = [
 'modprobe accton_as7712_32x_fan'     ,
 'modprobe optoe'      ,
 'modprobe leds-accton_as7712_32x'      ,
-'modprobe accton_as7712_32x_psu' ]
+'modprobe accton_as7712_32x_psu',
+'modprobe accton_as7712_32x_platform' ]
+
+# Set when the board driver has created the devices; they are then
+# removed together with the driver.
+board_path = '/sys/bus/platform/devices/as7712_32x_platform'
 
 def driver_install():
     global FORCE
@@ -300,6 +305,9 @@ def device_install():
     
 def device_uninstall():
     global FORCE
+
+    if os.path.exists(board_path):
+        return 0
     
     status, output =log_os_system("ls /sys/bus/i2c/devices/1-0076", 0)
     if status==0:
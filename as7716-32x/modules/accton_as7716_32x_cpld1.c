@@ -33,6 +33,8 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/list.h>
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 static LIST_HEAD(cpld_client_list);
 static struct mutex	 list_lock;
@@ -42,8 +44,6 @@ struct cpld_client_node {
 	struct list_head   list;
 };
 
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
 
 static ssize_t show_present(struct device *dev, struct device_attribute *da,
              char *buf);
@@ -59,11 +59,15 @@ static ssize_t set_mode_reset(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 
 static int as7716_32x_cpld_read_internal(struct i2c_client *client, u8 reg);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf);
 static int as7716_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 struct as7716_32x_cpld_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 /* Addresses scanned for as7716_32x_cpld
@@ -229,6 +233,8 @@ DECLARE_TRANSCEIVER_SENSOR_DEVICE_RESET_ATTR(31);
 DECLARE_TRANSCEIVER_SENSOR_DEVICE_RESET_ATTR(32);
 
 
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+
 static struct attribute *as7716_32x_cpld_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
@@ -298,6 +304,7 @@ static struct attribute *as7716_32x_cpld_attributes[] = {
 	DECLARE_TRANSCEIVER_RESET_ATTR(30),
 	DECLARE_TRANSCEIVER_RESET_ATTR(31),
 	DECLARE_TRANSCEIVER_RESET_ATTR(32),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -443,40 +450,33 @@ exit:
 	return status;
 }
 
-static int as7716_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_read_byte_data(client, reg);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
 
-		break;
-	}
+	return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
 
-    return status;
+static int as7716_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+{
+	struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7716_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_write_byte_data(client, reg, value);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
-	}
+	struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 static void as7716_32x_cpld_add_client(struct i2c_client *client)
@@ -555,6 +555,7 @@ static int as7716_32x_cpld_probe(struct i2c_client *client,
 		goto exit_remove;
 	}
 
+	accton_i2c_trace_add(&data->i2c_trace, client);
 	as7716_32x_cpld_add_client(client);
 
 	dev_info(&client->dev, "%s: cpld '%s'\n",
@@ -575,10 +576,11 @@ static int as7716_32x_cpld_remove(struct i2c_client *client)
 {
     struct as7716_32x_cpld_data *data = i2c_get_clientdata(client);
 
+	as7716_32x_cpld_remove_client(client);
+	accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7716_32x_cpld_group);
     kfree(data);
-	as7716_32x_cpld_remove_client(client);
 
     return 0;
 }
@@ -587,6 +589,7 @@ int as7716_32x_cpld_read(unsigned short cpld_addr, u8 reg)
 {
 	struct list_head   *list_node = NULL;
 	struct cpld_client_node *cpld_node = NULL;
+	struct as7716_32x_cpld_data *data;
 	int ret = -EPERM;
 	
 	mutex_lock(&list_lock);
@@ -596,7 +599,10 @@ int as7716_32x_cpld_read(unsigned short cpld_addr, u8 reg)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
+			data = i2c_get_clientdata(cpld_node->client);
+			ret = accton_i2c_traced(&data->i2c_trace, cpld_node->client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(cpld_node->client, reg));
 			break;
 		}
 	}
@@ -611,6 +617,7 @@ int as7716_32x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
 	struct list_head   *list_node = NULL;
 	struct cpld_client_node *cpld_node = NULL;
+	struct as7716_32x_cpld_data *data;
 	int ret = -EIO;
 	
 	mutex_lock(&list_lock);
@@ -620,7 +627,10 @@ int as7716_32x_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
+			data = i2c_get_clientdata(cpld_node->client);
+			ret = accton_i2c_traced(&data->i2c_trace, cpld_node->client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(cpld_node->client, reg, value));
 			break;
 		}
 	}
@@ -0,0 +1,130 @@
+/*
+ * Board driver for accton as7716_32x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "as7716_32x_platform"
+
+/* The layout accton_as7716_util.py used to build from user space */
+static const struct accton_i2c_mux muxes[] = {
+	{  0, 0x77,  1 },
+	{  1, 0x76,  9 },
+	{  2, 0x71, 17 },
+	{  2, 0x72, 25 },
+	{  2, 0x73, 33 },
+	{  2, 0x74, 41 },
+	{  2, 0x75, 49 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{  1, "24c02",            0x56 },
+	{  9, "as7716_32x_fan",   0x66 },
+	{ 10, "lm75",             0x48 },
+	{ 10, "lm75",             0x49 },
+	{ 10, "lm75",             0x4a },
+	{ 11, "as7716_32x_cpld1", 0x60 },
+	{ 12, "accton_i2c_cpld",  0x62 },
+	{ 13, "accton_i2c_cpld",  0x64 },
+	{ 18, "as7716_32x_psu1",  0x53 },
+	{ 18, "ym2651",           0x5b },
+	{ 17, "as7716_32x_psu2",  0x50 },
+	{ 17, "ym2651",           0x58 },
+};
+
+/* Bus of port 1 to port 32 */
+static const u8 sfp_bus[] = {
+	29, 30, 31, 32, 34, 33, 36, 35, 25, 26, 27, 28, 37, 38, 39, 40,
+	41, 42, 43, 44, 53, 54, 55, 56, 45, 46, 47, 48, 49, 50, 51, 52
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, ARRAY_SIZE(sfp_bus), "optoe1" },
+};
+
+static const struct accton_i2c_board_desc as7716_32x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int as7716_32x_platform_probe(struct platform_device *pdev)
+{
+	return accton_i2c_board_probe(pdev, &as7716_32x_board);
+}
+
+static int as7716_32x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver as7716_32x_platform_driver = {
+	.probe		= as7716_32x_platform_probe,
+	.remove		= as7716_32x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init as7716_32x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&as7716_32x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&as7716_32x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit as7716_32x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&as7716_32x_platform_driver);
+}
+
+module_init(as7716_32x_platform_init);
+module_exit(as7716_32x_platform_exit);
+
+MODULE_DESCRIPTION("as7716_32x board driver");
+MODULE_LICENSE("GPL");
@@ -31,6 +31,7 @@
 #include <linux/hwmon-sysfs.h>
 #include <linux/err.h>
 #include <linux/mutex.h>
+#include "accton_i2c_trace.h"
 
 #define CPLD_VERSION_REG    0x1
 
@@ -43,6 +44,8 @@ enum as5712_54x_cpld_sysfs_attributes {
 static ssize_t read_cpld_version(struct device *dev, struct device_attribute *da,
              char *buf);
 int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg);
+int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg,
+                               u8 *values, u8 len);
 
 
 static LIST_HEAD(cpld_client_list);
@@ -51,6 +54,7 @@ static struct mutex	 list_lock;
 struct cpld_client_node {
 	struct i2c_client *client;
 	struct list_head   list;
+	struct accton_i2c_trace trace;
 };
 
 /* Addresses scanned for accton_i2c_cpld
@@ -94,6 +98,7 @@ static void accton_i2c_cpld_add_client(struct i2c_client *client)
 	}
 	
 	node->client = client;
+	accton_i2c_trace_add(&node->trace, client);
 	
 	mutex_lock(&list_lock);
 	list_add(&node->list, &cpld_client_list);
@@ -120,6 +125,7 @@ static void accton_i2c_cpld_remove_client(struct i2c_client *client)
 	
 	if (found) {
 		list_del(list_node);
+		accton_i2c_trace_remove(&cpld_node->trace);
 		kfree(cpld_node);
 	}
 	
@@ -189,7 +195,9 @@ int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
+			ret = accton_i2c_traced(&cpld_node->trace, cpld_node->client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(cpld_node->client, reg));
 			break;
 		}
 	}
@@ -213,7 +221,9 @@ int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
+			ret = accton_i2c_traced(&cpld_node->trace, cpld_node->client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(cpld_node->client, reg, value));
 			break;
 		}
 	}
@@ -224,6 +234,72 @@ int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 }
 EXPORT_SYMBOL(accton_i2c_cpld_write);
 
+/* Read registers [reg, reg+len) of the CPLD. Use I2C block read if the
+ * adapter supports it, otherwise fall back to byte reads.
+ * Return len on success, or a negative errno.
+ */
+static int cpld_read_block_internal(struct cpld_client_node *cpld_node,
+				    u8 reg, u8 *values, u8 len)
+{
+	struct i2c_client *client = cpld_node->client;
+	int status, i, chunk;
+
+	if (!i2c_check_functionality(client->adapter,
+				     I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+		for (i = 0; i < len; i++) {
+			status = accton_i2c_traced(&cpld_node->trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg + i, 1,
+				i2c_smbus_read_byte_data(client, reg + i));
+			if (unlikely(status < 0))
+				return status;
+			values[i] = status;
+		}
+		return len;
+	}
+
+	for (i = 0; i < len; i += chunk) {
+		chunk = min_t(int, len - i, I2C_SMBUS_BLOCK_MAX);
+		status = accton_i2c_traced(&cpld_node->trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA,
+				reg + i, chunk,
+				i2c_smbus_read_i2c_block_data(client, reg + i,
+							      chunk, values + i));
+		if (unlikely(status < 0))
+			return status;
+		if (unlikely(status != chunk))
+			return -EIO;
+	}
+	return len;
+}
+
+int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg,
+			       u8 *values, u8 len)
+{
+	struct list_head   *list_node = NULL;
+	struct cpld_client_node *cpld_node = NULL;
+	int ret = -EPERM;
+
+	if (!values)
+		return -EINVAL;
+
+	mutex_lock(&list_lock);
+
+	list_for_each(list_node, &cpld_client_list)
+	{
+		cpld_node = list_entry(list_node, struct cpld_client_node, list);
+
+		if (cpld_node->client->addr == cpld_addr) {
+			ret = cpld_read_block_internal(cpld_node, reg, values, len);
+			break;
+		}
+	}
+
+	mutex_unlock(&list_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL(accton_i2c_cpld_read_block);
+
 static int __init accton_i2c_cpld_init(void)
 {
 	mutex_init(&list_lock);
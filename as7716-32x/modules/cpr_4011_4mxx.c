@@ -33,6 +33,8 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define MAX_FAN_DUTY_CYCLE 100
 
@@ -58,6 +60,8 @@ struct cpr_4011_4mxx_data {
     u8   fan_fault;     /* Register value */
     u16  fan_duty_cycle[2];  /* Register value */
     u16  fan_speed[2];  /* Register value */
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 static ssize_t show_linear(struct device *dev, struct device_attribute *da, char *buf);
@@ -255,6 +259,8 @@ static int cpr_4011_4mxx_probe(struct i2c_client *client,
 
     dev_info(&client->dev, "%s: psu '%s'\n",
          dev_name(data->hwmon_dev), client->name);
+
+    accton_i2c_trace_add(&data->i2c_trace, client);
     
     return 0;
 
@@ -271,6 +277,7 @@ static int cpr_4011_4mxx_remove(struct i2c_client *client)
 {
     struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
 
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_group);
     kfree(data);
@@ -297,17 +304,32 @@ static struct i2c_driver cpr_4011_4mxx_driver = {
 
 static int cpr_4011_4mxx_read_byte(struct i2c_client *client, u8 reg)
 {
-    return i2c_smbus_read_byte_data(client, reg);
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int cpr_4011_4mxx_read_word(struct i2c_client *client, u8 reg)
 {
-    return i2c_smbus_read_word_data(client, reg);
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_WORD_DATA, reg, 2,
+                    i2c_smbus_read_word_data(client, reg)));
 }
 
 static int cpr_4011_4mxx_write_word(struct i2c_client *client, u8 reg, u16 value)
 {
-    return i2c_smbus_write_word_data(client, reg, value);
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_WORD_DATA, reg, 2,
+                    i2c_smbus_write_word_data(client, reg, value)));
 }
 
 struct reg_data_byte {
@@ -120,6 +120,13 @@
 #include <linux/i2c.h>
 #include <linux/types.h>
 #include <linux/memory.h>
+#include <linux/list.h>
+#include <linux/kref.h>
+#include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include "accton_i2c_trace.h"
 
 /*
  * The optoe driver is for read/write access to the EEPROM on standard
@@ -174,8 +181,73 @@ struct optoe_platform_data {
 #define TWO_ADDR_PAGEABLE (1<<4)
 #define OPTOE_ID_REG 0
 
+/*
+ * DOM monitor ranges, as linear offsets:
+ * QSFP lower page 00h bytes 22-57 (temp, vcc, rx power, tx bias, tx power)
+ * SFP A2h bytes 96-105 (temp, vcc, tx bias, tx power, rx power)
+ */
+#define ONE_ADDR_DOM_OFFSET 22
+#define ONE_ADDR_DOM_LEN 36
+#define TWO_ADDR_DOM_OFFSET (2 * OPTOE_PAGE_SIZE + 96)
+#define TWO_ADDR_DOM_LEN 10
+#define OPTOE_DOM_LEN 36
+
+/*
+ * Module identity is the identifier byte plus the vendor serial number,
+ * QSFP upper page 00h bytes 196-211, SFP A0h bytes 68-83.
+ */
+#define ONE_ADDR_SN_OFFSET 196
+#define TWO_ADDR_SN_OFFSET 68
+#define OPTOE_SN_LEN 16
+
 /* The maximum length of a port name */
 #define MAX_PORT_NAME_LEN 20
+
+/* One cached 128 byte chunk of the linear EEPROM address space */
+struct optoe_cache_page {
+	bool valid;
+	unsigned long stamp;		/* jiffies when filled */
+	u8 data[OPTOE_PAGE_SIZE];
+};
+
+/* DOM monitors as last fetched by the prefetch worker */
+struct optoe_dom {
+	bool valid;
+	unsigned long stamp;		/* jiffies when fetched */
+	u8 data[OPTOE_DOM_LEN];
+};
+
+/* One port in the dom_snapshot binary attribute, multi-byte fields LE */
+struct optoe_dom_record {
+	char port_name[MAX_PORT_NAME_LEN];
+	u8 valid;
+	u8 dev_class;
+	u8 len;
+	u8 reserved;
+	__le32 age_ms;
+	u8 data[OPTOE_DOM_LEN];
+} __packed;
+
+/*
+ * Ports whose channels hang off the same parent bus form a mux segment.
+ * A whole request runs under the segment lock, so a port's transfers
+ * are not interleaved with those of its neighbours on the segment, and
+ * a DOM sweep drains one segment before moving to the next.
+ */
+struct optoe_segment {
+	struct list_head node;		/* on optoe_segments, by bus number */
+	struct list_head ports;		/* optoe_data.seg_node, by bus number */
+	struct mutex lock;
+	struct i2c_adapter *bus;	/* mux parent, or the port's own bus */
+	struct i2c_adapter *root;	/* top of the mux tree */
+	bool muxed;
+	unsigned refcount;
+
+	/* protected by lock */
+	unsigned long transfers;	/* transfers issued by optoe */
+	unsigned long sweeps;
+};
+
 struct optoe_data {
 	struct optoe_platform_data chip;
 	struct memory_accessor macc;
@@ -192,9 +264,43 @@ struct optoe_data {
 
 	u8 *writebuf;
 	unsigned write_max;
+	unsigned read_max;	/* bytes per read transaction, see xfer_max */
+	s64 probe_us;		/* time spent in optoe_probe() */
+	struct accton_i2c_trace i2c_trace;	/* all addresses of the port */
 
 	unsigned num_addresses;
 
+	/* page cache, indexed by 128 byte chunk, entries allocated on use */
+	struct optoe_cache_page **cache;
+	unsigned cache_pages;
+	unsigned long cache_hits;
+	unsigned long cache_misses;
+
+	/* last value written to the page select register, -1 if unknown */
+	int cur_page;
+	unsigned long page_writes;
+	unsigned long page_writes_elided;
+
+	/* identity of the module the cache and cur_page belong to */
+	bool sig_valid;
+	unsigned long sig_stamp;	/* jiffies of the last check */
+	u8 sig[1 + OPTOE_SN_LEN];
+
+	/* DOM snapshot, on optoe_ports while bound */
+	struct optoe_dom dom;
+	struct list_head node;
+
+	/*
+	 * Workers hold a reference while they use a port outside
+	 * optoe_ports_lock.  gone (under lock) is set by optoe_remove(),
+	 * after which they must not touch the bus.
+	 */
+	struct kref ref;
+	bool gone;
+
+	struct optoe_segment *seg;
+	struct list_head seg_node;
+
 #ifdef EEPROM_CLASS
 	struct eeprom_device *eeprom_dev;
 #endif
@@ -220,6 +326,8 @@ typedef enum optoe_opcode {
  * This value is forced to be a power of two so that writes align on pages.
  */
 static unsigned io_limit = OPTOE_PAGE_SIZE;
+module_param(io_limit, uint, S_IRUGO);
+MODULE_PARM_DESC(io_limit, "Default maximum bytes per I/O (default 128)");
 
 /*
  * specs often allow 5 msec for a page write, sometimes 20 msec;
@@ -227,6 +335,119 @@ static unsigned io_limit = OPTOE_PAGE_SIZE;
  */
 static unsigned write_timeout = 25;
 
+/*
+ * Optional EEPROM page cache.  Static pages (ID, thresholds, ...) stay
+ * cached until a write, an access failure (eg. module removed), a
+ * failed module check (see module_check_ms), or a write to the
+ * cache_flush attribute.  Volatile pages (QSFP lower page 00h, SFP A2h
+ * lower half) expire after dom_ttl_ms; 0 disables caching them.
+ */
+static bool cache_enable;
+module_param(cache_enable, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(cache_enable, "Cache EEPROM pages (default false)");
+
+static unsigned static_ttl_ms;
+module_param(static_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(static_ttl_ms, "Lifetime of cached static pages in ms, 0 means until invalidated");
+
+static unsigned dom_ttl_ms = 1000;
+module_param(dom_ttl_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dom_ttl_ms, "Lifetime of cached volatile (DOM) pages in ms, 0 disables");
+
+/*
+ * Leave the last page selected after a paged access instead of
+ * restoring page 0.  The next access selects its own page if needed.
+ */
+static bool lazy_page_restore;
+module_param(lazy_page_restore, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(lazy_page_restore, "Do not restore page 0 after paged accesses (default false)");
+
+/*
+ * The cached pages and, with lazy_page_restore, the remembered page
+ * select only hold for the module they came from.  A failed access
+ * drops them.  A module swapped while the port was idle does not fail
+ * any access, so before using them an access first compares the
+ * module identity with the one they were taken from, if the last
+ * comparison is older than module_check_ms.
+ */
+static unsigned module_check_ms = 1000;
+module_param(module_check_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(module_check_ms, "Recheck the module identity before using cached state after this long in ms (default 1000)");
+
+static LIST_HEAD(optoe_ports);
+static LIST_HEAD(optoe_segments);
+/*
+ * protects optoe_ports, optoe_segments and their port lists, dom_cursor
+ * and dom_work_ready.  Never held across bus I/O.
+ */
+static DEFINE_MUTEX(optoe_ports_lock);
+static unsigned dom_cursor;
+static bool dom_work_ready;	/* dom_work may be queued */
+static struct delayed_work dom_work;
+static struct kobject *optoe_kobj;
+static struct dentry *optoe_debugfs;
+
+/*
+ * DOM prefetch.  A worker walks all ports round-robin, one port per
+ * step, so that every port is refreshed once per dom_prefetch_ms.
+ * Reads falling entirely within the DOM range are then served from
+ * the snapshot while it is younger than two periods.  The worker stops
+ * while the period is 0 or there are no ports, setting the period or
+ * probing a port starts it again.
+ */
+static unsigned dom_prefetch_ms;
+
+/* Start the DOM prefetch worker, under optoe_ports_lock */
+static void optoe_dom_kick(bool now)
+{
+	if (!dom_work_ready || !dom_prefetch_ms)
+		return;
+	if (now)
+		mod_delayed_work(system_wq, &dom_work, 0);
+	else
+		schedule_delayed_work(&dom_work, 0);
+}
+
+static int set_dom_prefetch_ms(const char *val, const struct kernel_param *kp)
+{
+	int err;
+
+	err = param_set_uint(val, kp);
+	if (err)
+		return err;
+
+	/* apply the new period right away */
+	mutex_lock(&optoe_ports_lock);
+	optoe_dom_kick(true);
+	mutex_unlock(&optoe_ports_lock);
+	return 0;
+}
+
+static const struct kernel_param_ops dom_prefetch_ms_ops = {
+	.set = set_dom_prefetch_ms,
+	.get = param_get_uint,
+};
+module_param_cb(dom_prefetch_ms, &dom_prefetch_ms_ops, &dom_prefetch_ms,
+		S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(dom_prefetch_ms, "DOM refresh period for all ports in ms, 0 disables");
+
+/*
+ * A sweep runs one job per root adapter on an unbound workqueue.  Ports
+ * on independent buses are read in parallel, ports sharing a root stay
+ * serialized.  Results of the last sweep, under optoe_ports_lock.
+ */
+struct optoe_sweep_job {
+	struct work_struct work;
+	struct i2c_adapter *root;
+	struct optoe_data **ports;	/* all ports, in segment order */
+	unsigned nports;
+};
+
+static struct workqueue_struct *optoe_sweep_wq;
+static unsigned sweep_ports;
+static unsigned sweep_buses;
+static s64 sweep_us;
+
 /*
  * flags to distinguish one-address (QSFP family) from two-address (SFP family)
  * If the family is not known, figure it out when the device is accessed
@@ -311,9 +532,13 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 	u8 msgbuf[2];
 	unsigned long timeout, read_time;
 	int status, i;
+	u64 start;
 
 	memset(msg, 0, sizeof(msg));
 
+	if (count > optoe->read_max)
+		count = optoe->read_max;
+
 	switch (optoe->use_smbus) {
 	case I2C_SMBUS_I2C_BLOCK_DATA:
 		/*smaller eeproms can work given some SMBus extension calls */
@@ -355,6 +580,8 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 	timeout = jiffies + msecs_to_jiffies(write_timeout);
 	do {
 		read_time = jiffies;
+		optoe->seg->transfers++;
+		start = accton_i2c_trace_start();
 
 		switch (optoe->use_smbus) {
 		case I2C_SMBUS_I2C_BLOCK_DATA:
@@ -383,6 +610,11 @@ static ssize_t optoe_eeprom_read(struct optoe_data *optoe,
 				status = count;
 		}
 
+		accton_i2c_trace_end(&optoe->i2c_trace, client, I2C_SMBUS_READ,
+				optoe->use_smbus ? optoe->use_smbus :
+						   ACCTON_I2C_XFER_RAW,
+				offset, count, status, start);
+
 		dev_dbg(&client->dev, "eeprom read %zu@%d --> %d (%ld)\n",
 				count, offset, status, jiffies);
 
@@ -409,6 +641,7 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 	unsigned long timeout, write_time;
 	unsigned next_page_start;
 	int i = 0;
+	u64 start;
 
 	/* write max is at most a page
 	 * (In this driver, write_max is actually one byte!)
@@ -456,6 +689,8 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 	timeout = jiffies + msecs_to_jiffies(write_timeout);
 	do {
 		write_time = jiffies;
+		optoe->seg->transfers++;
+		start = accton_i2c_trace_start();
 
 		switch (optoe->use_smbus) {
 		case I2C_SMBUS_I2C_BLOCK_DATA:
@@ -489,6 +724,11 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 			break;
 		}
 
+		accton_i2c_trace_end(&optoe->i2c_trace, client, I2C_SMBUS_WRITE,
+				optoe->use_smbus ? optoe->use_smbus :
+						   ACCTON_I2C_XFER_RAW,
+				offset, count, status, start);
+
 		dev_dbg(&client->dev, "eeprom write %zu@%d --> %ld (%lu)\n",
 				count, offset, (long int) status, jiffies);
 
@@ -503,6 +743,22 @@ static ssize_t optoe_eeprom_write(struct optoe_data *optoe,
 }
 
 
+static int optoe_select_page(struct optoe_data *optoe,
+		struct i2c_client *client, uint8_t page)
+{
+	int ret;
+
+	ret = optoe_eeprom_write(optoe, client, &page,
+		OPTOE_PAGE_SELECT_REG, 1);
+	if (ret < 0) {
+		optoe->cur_page = -1;
+		return ret;
+	}
+	optoe->cur_page = page;
+	optoe->page_writes++;
+	return 0;
+}
+
 static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 				char *buf, loff_t off, 
 				size_t count, optoe_opcode_e opcode)
@@ -517,15 +773,23 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 	dev_dbg(&client->dev,
 			"optoe_eeprom_update_client off %lld  page:%d phy_offset:%lld, count:%ld, opcode:%d\n",
 			off, page, phy_offset, (long int) count, opcode);
-	if (page > 0) {
-		ret = optoe_eeprom_write(optoe, client, &page, 
-			OPTOE_PAGE_SELECT_REG, 1);
+	/*
+	 * Only the upper half is paged.  Skip the page select if the page
+	 * is already selected.  An unknown page is taken as page 0 unless
+	 * lazy restore may have left another page selected.
+	 */
+	if (phy_offset >= OPTOE_PAGE_SIZE && page != optoe->cur_page &&
+	    (page > 0 || optoe->cur_page > 0 ||
+	     (optoe->cur_page < 0 && lazy_page_restore))) {
+		ret = optoe_select_page(optoe, client, page);
 		if (ret < 0) {
 			dev_dbg(&client->dev,
 				"Write page register for page %d failed ret:%d!\n",
 					page, ret);
 			return ret;
 		}
+	} else if (page > 0) {
+		optoe->page_writes_elided++;
 	}
 
 	while (count) {
@@ -550,11 +814,11 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 	}
 
 
-	if (page > 0) {
+	if (page > 0 && lazy_page_restore) {
+		optoe->page_writes_elided++;
+	} else if (page > 0) {
 		/* return the page register to page 0 (why?) */
-		page = 0;
-		ret = optoe_eeprom_write(optoe, client, &page, 
-			OPTOE_PAGE_SELECT_REG, 1);
+		ret = optoe_select_page(optoe, client, 0);
 		if (ret < 0) {
 			dev_err(&client->dev,
 				"Restore page register to 0 failed:%d!\n", ret);
@@ -565,6 +829,557 @@ static ssize_t optoe_eeprom_update_client(struct optoe_data *optoe,
 	return retval;
 }
 
+/*
+ * Chunks holding flags, monitors and controls change on their own;
+ * everything else is static ID or threshold data.
+ */
+static bool optoe_chunk_volatile(struct optoe_data *optoe, int chunk)
+{
+	if (optoe->dev_class == TWO_ADDR)
+		return chunk == 2;	/* A2h lower half */
+	return chunk == 0;		/* lower page 00h */
+}
+
+/* Caller must hold optoe->lock */
+static void optoe_cache_flush(struct optoe_data *optoe)
+{
+	int i;
+
+	if (!optoe->cache)
+		return;
+	for (i = 0; i < optoe->cache_pages; i++) {
+		if (optoe->cache[i])
+			optoe->cache[i]->valid = false;
+	}
+}
+
+static void optoe_cache_free(struct optoe_data *optoe)
+{
+	int i;
+
+	if (!optoe->cache)
+		return;
+	for (i = 0; i < optoe->cache_pages; i++)
+		kfree(optoe->cache[i]);
+	kfree(optoe->cache);
+	optoe->cache = NULL;
+}
+
+/* The module went away or was replaced.  Caller must hold optoe->lock */
+static void optoe_module_gone(struct optoe_data *optoe)
+{
+	optoe_cache_flush(optoe);
+	optoe->dom.valid = false;
+	optoe->cur_page = -1;
+	optoe->sig_valid = false;
+}
+
+/*
+ * Make sure the cached pages and page select belong to the module in
+ * the cage.  Caller must hold optoe->lock.
+ */
+static int optoe_module_check(struct optoe_data *optoe)
+{
+	u8 sig[sizeof(optoe->sig)];
+	loff_t sn_off;
+	ssize_t status;
+
+	if (optoe->sig_valid && time_before(jiffies, optoe->sig_stamp +
+			msecs_to_jiffies(module_check_ms)))
+		return 0;
+
+	sn_off = (optoe->dev_class == TWO_ADDR) ?
+			TWO_ADDR_SN_OFFSET : ONE_ADDR_SN_OFFSET;
+	status = optoe_eeprom_update_client(optoe, sig, OPTOE_ID_REG, 1,
+				OPTOE_READ_OP);
+	if (status == 1)
+		status = optoe_eeprom_update_client(optoe, sig + 1, sn_off,
+					OPTOE_SN_LEN, OPTOE_READ_OP);
+	if (status >= 0 && status != OPTOE_SN_LEN)
+		status = -EIO;
+
+	if (status < 0 ||
+	    (optoe->sig_valid && memcmp(sig, optoe->sig, sizeof(sig)))) {
+		dev_dbg(&optoe->client[0]->dev, "module gone or replaced\n");
+		optoe_module_gone(optoe);
+	}
+	if (status < 0)
+		return status;
+
+	memcpy(optoe->sig, sig, sizeof(sig));
+	optoe->sig_valid = true;
+	optoe->sig_stamp = jiffies;
+	return 0;
+}
+
+/*
+ * Serve a read within one chunk from the cache, filling the whole
+ * chunk from the device on a miss.  Caller must hold optoe->lock.
+ */
+static ssize_t optoe_cache_read(struct optoe_data *optoe, char *buf,
+		int chunk, loff_t off, size_t count)
+{
+	struct optoe_cache_page *page;
+	loff_t chunk_start = (loff_t)chunk * OPTOE_PAGE_SIZE;
+	unsigned ttl = static_ttl_ms;
+	ssize_t status;
+
+	if (optoe_chunk_volatile(optoe, chunk)) {
+		ttl = dom_ttl_ms;
+		if (!ttl)
+			return optoe_eeprom_update_client(optoe, buf, off,
+						count, OPTOE_READ_OP);
+	}
+	if (!optoe->cache || chunk >= optoe->cache_pages)
+		return optoe_eeprom_update_client(optoe, buf, off,
+					count, OPTOE_READ_OP);
+
+	page = optoe->cache[chunk];
+	if (page && page->valid && (!ttl ||
+	    time_before(jiffies, page->stamp + msecs_to_jiffies(ttl)))) {
+		optoe->cache_hits++;
+		memcpy(buf, page->data + (off - chunk_start), count);
+		return count;
+	}
+
+	optoe->cache_misses++;
+	if (!page) {
+		page = kzalloc(sizeof(*page), GFP_KERNEL);
+		if (!page)
+			return optoe_eeprom_update_client(optoe, buf, off,
+						count, OPTOE_READ_OP);
+		optoe->cache[chunk] = page;
+	}
+
+	page->valid = false;
+	status = optoe_eeprom_update_client(optoe, page->data, chunk_start,
+				OPTOE_PAGE_SIZE, OPTOE_READ_OP);
+	if (status != OPTOE_PAGE_SIZE)
+		return (status < 0) ? status : -EIO;
+
+	page->valid = true;
+	page->stamp = jiffies;
+	memcpy(buf, page->data + (off - chunk_start), count);
+	return count;
+}
+
+/* Find or create the segment of a port's bus, under optoe_ports_lock */
+static struct optoe_segment *optoe_segment_get(struct i2c_adapter *adap)
+{
+	struct i2c_adapter *parent = i2c_parent_is_i2c_adapter(adap);
+	struct i2c_adapter *bus = parent ? parent : adap;
+	struct optoe_segment *seg;
+	struct list_head *pos = &optoe_segments;
+
+	list_for_each_entry(seg, &optoe_segments, node) {
+		if (seg->bus == bus) {
+			seg->refcount++;
+			return seg;
+		}
+		if (seg->bus->nr > bus->nr && pos == &optoe_segments)
+			pos = &seg->node;
+	}
+
+	seg = kzalloc(sizeof(*seg), GFP_KERNEL);
+	if (!seg)
+		return NULL;
+
+	INIT_LIST_HEAD(&seg->ports);
+	mutex_init(&seg->lock);
+	seg->bus = bus;
+	seg->root = bus;
+	while ((parent = i2c_parent_is_i2c_adapter(seg->root)))
+		seg->root = parent;
+	seg->muxed = bus != adap;
+	seg->refcount = 1;
+	list_add_tail(&seg->node, pos);
+	return seg;
+}
+
+static void optoe_segment_put(struct optoe_segment *seg)
+{
+	if (--seg->refcount)
+		return;
+
+	list_del(&seg->node);
+	kfree(seg);
+}
+
+/* Add a probed port to its segment, keeping the channels in bus order */
+static void optoe_segment_add_port(struct optoe_data *optoe)
+{
+	struct optoe_data *other;
+	struct list_head *pos = &optoe->seg->ports;
+	int nr = optoe->client[0]->adapter->nr;
+
+	list_for_each_entry(other, &optoe->seg->ports, seg_node) {
+		if (other->client[0]->adapter->nr > nr) {
+			pos = &other->seg_node;
+			break;
+		}
+	}
+	list_add_tail(&optoe->seg_node, pos);
+}
+
+/* The last reference to a removed port is gone.  Not under optoe_ports_lock */
+static void optoe_release(struct kref *ref)
+{
+	struct optoe_data *optoe = container_of(ref, struct optoe_data, ref);
+
+	mutex_lock(&optoe_ports_lock);
+	optoe_segment_put(optoe->seg);
+	mutex_unlock(&optoe_ports_lock);
+
+	kfree(optoe->writebuf);
+	optoe_cache_free(optoe);
+	kfree(optoe);
+}
+
+static void optoe_dom_range(struct optoe_data *optoe, loff_t *off, size_t *len)
+{
+	if (optoe->dev_class == TWO_ADDR) {
+		*off = TWO_ADDR_DOM_OFFSET;
+		*len = TWO_ADDR_DOM_LEN;
+	} else {
+		*off = ONE_ADDR_DOM_OFFSET;
+		*len = ONE_ADDR_DOM_LEN;
+	}
+}
+
+/* Caller must hold optoe->lock */
+static bool optoe_dom_read(struct optoe_data *optoe, char *buf,
+		loff_t off, size_t len)
+{
+	loff_t dom_off;
+	size_t dom_len;
+
+	if (!dom_prefetch_ms || !optoe->dom.valid)
+		return false;
+
+	optoe_dom_range(optoe, &dom_off, &dom_len);
+	if (off < dom_off || off + len > dom_off + dom_len)
+		return false;
+	if (time_after_eq(jiffies, optoe->dom.stamp +
+			msecs_to_jiffies(2 * dom_prefetch_ms)))
+		return false;
+
+	memcpy(buf, optoe->dom.data + (off - dom_off), len);
+	return true;
+}
+
+/* Caller must hold optoe->seg->lock */
+static void __optoe_dom_refresh(struct optoe_data *optoe)
+{
+	u8 data[OPTOE_DOM_LEN];
+	loff_t off;
+	size_t len;
+	ssize_t status;
+
+	mutex_lock(&optoe->lock);
+	if (optoe->gone) {
+		mutex_unlock(&optoe->lock);
+		return;
+	}
+	optoe_dom_range(optoe, &off, &len);
+	status = optoe_eeprom_update_client(optoe, data, off, len,
+				OPTOE_READ_OP);
+	if (status == (ssize_t)len) {
+		memcpy(optoe->dom.data, data, len);
+		optoe->dom.stamp = jiffies;
+		optoe->dom.valid = true;
+	} else {
+		/* no module */
+		optoe_module_gone(optoe);
+	}
+	mutex_unlock(&optoe->lock);
+}
+
+static void optoe_dom_refresh(struct optoe_data *optoe)
+{
+	mutex_lock(&optoe->seg->lock);
+	__optoe_dom_refresh(optoe);
+	mutex_unlock(&optoe->seg->lock);
+}
+
+/*
+ * Refresh the DOM of every port under one root adapter, one segment at
+ * a time, so that each mux channel is visited once and the sweep never
+ * goes back to a segment.  The job holds references to the ports, a
+ * port holds one on its segment.
+ */
+static void optoe_sweep_job_fn(struct work_struct *work)
+{
+	struct optoe_sweep_job *job = container_of(work,
+					struct optoe_sweep_job, work);
+	struct optoe_segment *seg = NULL;
+	struct optoe_data *optoe;
+	unsigned i;
+
+	for (i = 0; i < job->nports; i++) {
+		optoe = job->ports[i];
+		if (optoe->seg->root != job->root)
+			continue;
+
+		if (optoe->seg != seg) {
+			if (seg) {
+				seg->sweeps++;
+				mutex_unlock(&seg->lock);
+			}
+			seg = optoe->seg;
+			mutex_lock(&seg->lock);
+		}
+		__optoe_dom_refresh(optoe);
+	}
+	if (seg) {
+		seg->sweeps++;
+		mutex_unlock(&seg->lock);
+	}
+}
+
+static int optoe_dom_sweep(void)
+{
+	struct optoe_sweep_job *jobs;
+	struct optoe_data **ports;
+	struct optoe_segment *seg;
+	struct optoe_data *optoe;
+	unsigned nsegs = 0, njobs = 0, nports = 0, i;
+	ktime_t start = ktime_get();
+
+	mutex_lock(&optoe_ports_lock);
+	list_for_each_entry(seg, &optoe_segments, node) {
+		nsegs++;
+		list_for_each_entry(optoe, &seg->ports, seg_node)
+			nports++;
+	}
+
+	jobs = kcalloc(max(nsegs, 1U), sizeof(*jobs), GFP_KERNEL);
+	ports = kcalloc(max(nports, 1U), sizeof(*ports), GFP_KERNEL);
+	if (!jobs || !ports) {
+		mutex_unlock(&optoe_ports_lock);
+		kfree(ports);
+		kfree(jobs);
+		return -ENOMEM;
+	}
+
+	/* take the ports in segment order, one job per root adapter */
+	nports = 0;
+	list_for_each_entry(seg, &optoe_segments, node) {
+		list_for_each_entry(optoe, &seg->ports, seg_node) {
+			kref_get(&optoe->ref);
+			ports[nports++] = optoe;
+		}
+
+		for (i = 0; i < njobs; i++) {
+			if (jobs[i].root == seg->root)
+				break;
+		}
+		if (i == njobs)
+			jobs[njobs++].root = seg->root;
+	}
+	mutex_unlock(&optoe_ports_lock);
+
+	for (i = 0; i < njobs; i++) {
+		jobs[i].ports = ports;
+		jobs[i].nports = nports;
+		INIT_WORK(&jobs[i].work, optoe_sweep_job_fn);
+		queue_work(optoe_sweep_wq, &jobs[i].work);
+	}
+	for (i = 0; i < njobs; i++)
+		flush_work(&jobs[i].work);
+
+	for (i = 0; i < nports; i++)
+		kref_put(&ports[i]->ref, optoe_release);
+
+	mutex_lock(&optoe_ports_lock);
+	sweep_ports = nports;
+	sweep_buses = njobs;
+	sweep_us = ktime_us_delta(ktime_get(), start);
+	mutex_unlock(&optoe_ports_lock);
+
+	kfree(ports);
+	kfree(jobs);
+	return 0;
+}
+
+static void optoe_dom_work(struct work_struct *work)
+{
+	struct optoe_data *optoe, *next = NULL, *first = NULL;
+	struct optoe_segment *seg;
+	unsigned period = dom_prefetch_ms;
+	unsigned nports = 0;
+	unsigned long delay;
+
+	/* set_dom_prefetch_ms() starts us again */
+	if (!period)
+		return;
+
+	mutex_lock(&optoe_ports_lock);
+	/* walk the ports segment by segment */
+	list_for_each_entry(seg, &optoe_segments, node) {
+		list_for_each_entry(optoe, &seg->ports, seg_node) {
+			if (!first)
+				first = optoe;
+			if (nports++ == dom_cursor)
+				next = optoe;
+		}
+	}
+	if (!next && first) {
+		next = first;
+		dom_cursor = 0;
+	}
+	dom_cursor++;
+	if (next)
+		kref_get(&next->ref);
+	mutex_unlock(&optoe_ports_lock);
+
+	/* optoe_probe() starts us again */
+	if (!next)
+		return;
+
+	optoe_dom_refresh(next);
+	kref_put(&next->ref, optoe_release);
+
+	delay = msecs_to_jiffies(period / nports);
+	schedule_delayed_work(&dom_work, delay ? delay : 1);
+}
+
+static ssize_t dom_snapshot_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr,
+		char *buf, loff_t off, size_t count)
+{
+	struct optoe_dom_record rec;
+	struct optoe_data *optoe, **ports;
+	unsigned first, max, nports = 0, i = 0;
+	loff_t pos;
+	size_t copied = 0;
+	size_t skip, n;
+	loff_t dom_off;
+
+	if (!count)
+		return 0;
+
+	/* take the ports of the requested records, then read them unlocked */
+	first = off / sizeof(rec);
+	max = (off + count - 1) / sizeof(rec) - first + 1;
+	ports = kcalloc(max, sizeof(*ports), GFP_KERNEL);
+	if (!ports)
+		return -ENOMEM;
+
+	mutex_lock(&optoe_ports_lock);
+	list_for_each_entry(optoe, &optoe_ports, node) {
+		if (i++ < first)
+			continue;
+		if (nports == max)
+			break;
+		kref_get(&optoe->ref);
+		ports[nports++] = optoe;
+	}
+	mutex_unlock(&optoe_ports_lock);
+
+	pos = (loff_t)first * sizeof(rec);
+	for (i = 0; i < nports; i++) {
+		optoe = ports[i];
+
+		memset(&rec, 0, sizeof(rec));
+		mutex_lock(&optoe->lock);
+		strlcpy(rec.port_name, optoe->port_name, sizeof(rec.port_name));
+		rec.dev_class = optoe->dev_class;
+		rec.valid = optoe->dom.valid;
+		if (rec.valid) {
+			n = sizeof(rec.data);
+			optoe_dom_range(optoe, &dom_off, &n);
+			rec.len = n;
+			rec.age_ms = cpu_to_le32(jiffies_to_msecs(jiffies -
+						optoe->dom.stamp));
+			memcpy(rec.data, optoe->dom.data, n);
+		}
+		mutex_unlock(&optoe->lock);
+		kref_put(&optoe->ref, optoe_release);
+
+		skip = (off > pos) ? off - pos : 0;
+		n = min(sizeof(rec) - skip, count - copied);
+		memcpy(buf + copied, (u8 *)&rec + skip, n);
+		copied += n;
+		pos += sizeof(rec);
+	}
+	kfree(ports);
+
+	return copied;
+}
+
+static struct bin_attribute dom_snapshot_attr = {
+	.attr = {
+		.name = "dom_snapshot",
+		.mode = S_IRUGO,
+	},
+	.read = dom_snapshot_read,
+};
+
+static ssize_t dom_sweep_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	ssize_t count;
+
+	mutex_lock(&optoe_ports_lock);
+	count = sprintf(buf, "%u ports on %u buses in %lld us\n",
+			sweep_ports, sweep_buses, sweep_us);
+	mutex_unlock(&optoe_ports_lock);
+
+	return count;
+}
+
+/* Writing anything refreshes the DOM snapshot of all ports */
+static ssize_t dom_sweep_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	int err;
+
+	err = optoe_dom_sweep();
+	return err ? err : count;
+}
+
+static struct kobj_attribute dom_sweep_attr =
+	__ATTR(dom_sweep, S_IRUGO | S_IWUSR, dom_sweep_show, dom_sweep_store);
+
+/* debugfs optoe/segments: transfers and sweeps per segment */
+static int optoe_segments_show(struct seq_file *s, void *unused)
+{
+	struct optoe_segment *seg;
+	struct optoe_data *optoe;
+	unsigned nports;
+
+	seq_printf(s, "%-8s %5s %5s %10s %8s\n", "bus", "muxed",
+		   "ports", "transfers", "sweeps");
+
+	mutex_lock(&optoe_ports_lock);
+	list_for_each_entry(seg, &optoe_segments, node) {
+		nports = 0;
+		list_for_each_entry(optoe, &seg->ports, seg_node)
+			nports++;
+
+		/* seg->lock is held across I/O, read the counters without it */
+		seq_printf(s, "i2c-%-4d %5d %5u %10lu %8lu\n",
+			   seg->bus->nr, seg->muxed, nports, seg->transfers,
+			   seg->sweeps);
+	}
+	mutex_unlock(&optoe_ports_lock);
+
+	return 0;
+}
+
+static int optoe_segments_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, optoe_segments_show, inode->i_private);
+}
+
+static const struct file_operations optoe_segments_fops = {
+	.owner = THIS_MODULE,
+	.open = optoe_segments_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 /*
  * Figure out if this access is within the range of supported pages.
  * Note this is called on every access because we don't know if the
@@ -652,10 +1467,25 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 
 	/*
 	 * Read data from chip, protecting against concurrent updates
-	 * from this host, but not from other I2C masters.
+	 * from this host, but not from other I2C masters.  The segment
+	 * lock keeps the whole request on one visit to the mux channel.
 	 */
+	mutex_lock(&optoe->seg->lock);
 	mutex_lock(&optoe->lock);
+
+	if (opcode == OPTOE_READ_OP && optoe_dom_read(optoe, buf, off, len)) {
+		mutex_unlock(&optoe->lock);
+		mutex_unlock(&optoe->seg->lock);
+		return len;
+	}
 	
+	/* cached pages and page select may be from a swapped module */
+	if (cache_enable || lazy_page_restore) {
+		status = optoe_module_check(optoe);
+		if (status < 0)
+			goto err;
+	}
+
 	/*
 	 * Confirm this access fits within the device suppored addr range 
 	 */
@@ -715,8 +1545,12 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 		 * note: chunk_offset is from the start of the EEPROM, 
 		 * not the start of the chunk 
 		 */
-		status = optoe_eeprom_update_client(optoe, buf, 
-				chunk_offset, chunk_len, opcode);
+		if (opcode == OPTOE_READ_OP && cache_enable)
+			status = optoe_cache_read(optoe, buf, chunk,
+					chunk_offset, chunk_len);
+		else
+			status = optoe_eeprom_update_client(optoe, buf,
+					chunk_offset, chunk_len, opcode);
 		if (status != chunk_len) {
 			/* This is another 'no device present' path */
 			dev_dbg(&client->dev, 
@@ -728,12 +1562,21 @@ static ssize_t optoe_read_write(struct optoe_data *optoe,
 		pending_len -= status;
 		retval += status;
 	}
+	/* a write may change any page, e.g. through page select or password */
+	if (opcode == OPTOE_WRITE_OP) {
+		optoe_cache_flush(optoe);
+		optoe->cur_page = -1;
+	}
 	mutex_unlock(&optoe->lock);
+	mutex_unlock(&optoe->seg->lock);
 
 	return retval;
 
 err:
+	/* module may be gone or replaced */
+	optoe_module_gone(optoe);
 	mutex_unlock(&optoe->lock);
+	mutex_unlock(&optoe->seg->lock);
 
 	return status;
 }
@@ -795,18 +1638,30 @@ static int optoe_remove(struct i2c_client *client)
 	int i;
 
 	optoe = i2c_get_clientdata(client);
+
+	/* wait out readers and writers, they use optoe->seg */
 	sysfs_remove_group(&client->dev.kobj, &optoe->attr_group);
 	sysfs_remove_bin_file(&client->dev.kobj, &optoe->bin);
-
-	for (i = 1; i < optoe->num_addresses; i++)
-		i2c_unregister_device(optoe->client[i]);
-
 #ifdef EEPROM_CLASS
 	eeprom_device_unregister(optoe->eeprom_dev);
 #endif
 
-	kfree(optoe->writebuf);
-	kfree(optoe);
+	mutex_lock(&optoe_ports_lock);
+	list_del(&optoe->node);
+	list_del(&optoe->seg_node);
+	mutex_unlock(&optoe_ports_lock);
+
+	/* a DOM worker may still hold the port, keep it off the bus */
+	mutex_lock(&optoe->lock);
+	optoe->gone = true;
+	mutex_unlock(&optoe->lock);
+
+	accton_i2c_trace_remove(&optoe->i2c_trace);
+	for (i = 1; i < optoe->num_addresses; i++)
+		i2c_unregister_device(optoe->client[i]);
+
+	/* the segment and the memory go with the last reference */
+	kref_put(&optoe->ref, optoe_release);
 	return 0;
 }
 
@@ -879,6 +1734,7 @@ static ssize_t set_dev_class(struct device *dev,
 
 	mutex_lock(&optoe->lock);
 	optoe->dev_class = dev_class;
+	optoe_module_gone(optoe);
 	mutex_unlock(&optoe->lock);
 
 	return count;
@@ -887,9 +1743,162 @@ static ssize_t set_dev_class(struct device *dev,
 static DEVICE_ATTR(dev_class,  S_IRUGO | S_IWUSR,
 					show_dev_class, set_dev_class);
 
+static ssize_t show_cache_hits(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%lu\n", optoe->cache_hits);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(cache_hits, S_IRUGO, show_cache_hits, NULL);
+
+static ssize_t show_cache_misses(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%lu\n", optoe->cache_misses);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(cache_misses, S_IRUGO, show_cache_misses, NULL);
+
+static ssize_t set_cache_flush(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+
+	mutex_lock(&optoe->lock);
+	optoe_module_gone(optoe);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(cache_flush, S_IWUSR, NULL, set_cache_flush);
+
+static ssize_t show_page_writes(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%lu\n", optoe->page_writes);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(page_writes, S_IRUGO, show_page_writes, NULL);
+
+static ssize_t show_page_writes_elided(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%lu\n", optoe->page_writes_elided);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(page_writes_elided, S_IRUGO, show_page_writes_elided, NULL);
+
+/* Largest transfer this adapter can do: a full page with plain I2C */
+static unsigned optoe_xfer_limit(struct optoe_data *optoe)
+{
+	switch (optoe->use_smbus) {
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		return I2C_SMBUS_BLOCK_MAX;
+	case I2C_SMBUS_WORD_DATA:
+		return 2;
+	case I2C_SMBUS_BYTE_DATA:
+		return 1;
+	default:
+		return OPTOE_PAGE_SIZE;
+	}
+}
+
+static ssize_t show_xfer_max(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	ssize_t count;
+
+	mutex_lock(&optoe->lock);
+	count = sprintf(buf, "%u\n", optoe->read_max);
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+/*
+ * Bytes per read transaction, up to what the adapter allows.  Lower it
+ * for muxes or modules that misbehave on long transfers.
+ */
+static ssize_t set_xfer_max(struct device *dev,
+			struct device_attribute *attr,
+			const char *buf, size_t count)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+	unsigned read_max;
+
+	if (kstrtouint(buf, 0, &read_max))
+		return -EINVAL;
+	if (read_max < 1 || read_max > optoe_xfer_limit(optoe))
+		return -EINVAL;
+
+	mutex_lock(&optoe->lock);
+	optoe->read_max = read_max;
+	mutex_unlock(&optoe->lock);
+
+	return count;
+}
+
+static DEVICE_ATTR(xfer_max, S_IRUGO | S_IWUSR, show_xfer_max, set_xfer_max);
+
+static ssize_t show_probe_time_us(struct device *dev,
+			struct device_attribute *dattr, char *buf)
+{
+	struct i2c_client *client = to_i2c_client(dev);
+	struct optoe_data *optoe = i2c_get_clientdata(client);
+
+	return sprintf(buf, "%lld\n", optoe->probe_us);
+}
+
+static DEVICE_ATTR(probe_time_us, S_IRUGO, show_probe_time_us, NULL);
+
 static struct attribute *optoe_attrs[] = {
 	&dev_attr_port_name.attr,
 	&dev_attr_dev_class.attr,
+	&dev_attr_cache_hits.attr,
+	&dev_attr_cache_misses.attr,
+	&dev_attr_cache_flush.attr,
+	&dev_attr_page_writes.attr,
+	&dev_attr_page_writes_elided.attr,
+	&dev_attr_xfer_max.attr,
+	&dev_attr_probe_time_us.attr,
 	NULL,
 };
 
@@ -906,6 +1915,7 @@ static int optoe_probe(struct i2c_client *client,
 	struct optoe_data *optoe;
 	int num_addresses = 0;
 	int i = 0;
+	ktime_t start = ktime_get();
 
 	if (client->addr != 0x50) {
 		dev_dbg(&client->dev, "probe, bad i2c addr: 0x%x\n",
@@ -963,6 +1973,7 @@ static int optoe_probe(struct i2c_client *client,
 	}
 
 	mutex_init(&optoe->lock);
+	kref_init(&optoe->ref);
 
 	/* determine whether this is a one-address or two-address module */
 	if ((strcmp(client->name, "optoe1") == 0) || 
@@ -983,8 +1994,10 @@ static int optoe_probe(struct i2c_client *client,
 
 	dev_dbg(&client->dev, "dev_class: %d\n", optoe->dev_class);
 	optoe->use_smbus = use_smbus;
+	optoe->read_max = min(io_limit, optoe_xfer_limit(optoe));
 	optoe->chip = chip;
 	optoe->num_addresses = num_addresses;
+	optoe->cur_page = -1;
 	strcpy(optoe->port_name, "unitialized");
 
 	/*
@@ -1037,6 +2050,14 @@ static int optoe_probe(struct i2c_client *client,
 				"cannot write due to controller restrictions.");
 	}
 
+	optoe->cache_pages = chip.byte_len / OPTOE_PAGE_SIZE;
+	optoe->cache = kcalloc(optoe->cache_pages, sizeof(*optoe->cache),
+				GFP_KERNEL);
+	if (!optoe->cache) {
+		err = -ENOMEM;
+		goto err_struct;
+	}
+
 	optoe->client[0] = client;
 
 	/* use a dummy I2C device for two-address chips */
@@ -1051,6 +2072,17 @@ static int optoe_probe(struct i2c_client *client,
 		}
 	}
 
+	mutex_lock(&optoe_ports_lock);
+	optoe->seg = optoe_segment_get(client->adapter);
+	mutex_unlock(&optoe_ports_lock);
+	if (!optoe->seg) {
+		err = -ENOMEM;
+		goto err_struct;
+	}
+
+	/* the attribute handlers may run as soon as the files exist */
+	i2c_set_clientdata(client, optoe);
+
 	/* create the sysfs eeprom file */
 	err = sysfs_create_bin_file(&client->dev.kobj, &optoe->bin);
 	if (err)
@@ -1073,8 +2105,6 @@ static int optoe_probe(struct i2c_client *client,
 	}
 #endif
 
-	i2c_set_clientdata(client, optoe);
-
 	dev_info(&client->dev, "%zu byte %s EEPROM, %s\n",
 		optoe->bin.size, client->name,
 		optoe->bin.write ? "read/write" : "read-only");
@@ -1089,6 +2119,14 @@ static int optoe_probe(struct i2c_client *client,
 	if (chip.setup)
 		chip.setup(&optoe->macc, chip.context);
 
+	mutex_lock(&optoe_ports_lock);
+	list_add_tail(&optoe->node, &optoe_ports);
+	optoe_segment_add_port(optoe);
+	optoe_dom_kick(false);
+	mutex_unlock(&optoe_ports_lock);
+
+	accton_i2c_trace_add(&optoe->i2c_trace, client);
+	optoe->probe_us = ktime_us_delta(ktime_get(), start);
 	return 0;
 
 #ifdef EEPROM_CLASS
@@ -1098,11 +2136,17 @@ err_sysfs_cleanup:
 #endif
 
 err_struct:
+	if (optoe->seg) {
+		mutex_lock(&optoe_ports_lock);
+		optoe_segment_put(optoe->seg);
+		mutex_unlock(&optoe_ports_lock);
+	}
 	for (i = 1; i < num_addresses; i++) {
 		if (optoe->client[i])
 			i2c_unregister_device(optoe->client[i]);
 	}
 
+	optoe_cache_free(optoe);
 	kfree(optoe->writebuf);
 exit_kfree:
 	kfree(optoe);
@@ -1118,6 +2162,10 @@ static struct i2c_driver optoe_driver = {
 	.driver = {
 		.name = "optoe",
 		.owner = THIS_MODULE,
+		/*
+		 * Probed synchronously: the platform utils write port_name
+		 * right after new_device returns.
+		 */
 	},
 	.probe = optoe_probe,
 	.remove = optoe_remove,
@@ -1126,6 +2174,7 @@ static struct i2c_driver optoe_driver = {
 
 static int __init optoe_init(void)
 {
+	int err;
 
 	if (!io_limit) {
 		pr_err("optoe: io_limit must not be 0!\n");
@@ -1133,13 +2182,61 @@ static int __init optoe_init(void)
 	}
 
 	io_limit = rounddown_pow_of_two(io_limit);
-	return i2c_add_driver(&optoe_driver);
+
+	optoe_sweep_wq = alloc_workqueue("optoe_sweep", WQ_UNBOUND, 0);
+	if (!optoe_sweep_wq)
+		return -ENOMEM;
+
+	/* /sys/kernel/optoe/dom_snapshot: DOM of all ports in one read */
+	optoe_kobj = kobject_create_and_add("optoe", kernel_kobj);
+	if (!optoe_kobj) {
+		destroy_workqueue(optoe_sweep_wq);
+		return -ENOMEM;
+	}
+
+	err = sysfs_create_bin_file(optoe_kobj, &dom_snapshot_attr);
+	if (err)
+		goto exit_kobj;
+
+	/* /sys/kernel/optoe/dom_sweep: refresh all ports, one worker per root bus */
+	err = sysfs_create_file(optoe_kobj, &dom_sweep_attr.attr);
+	if (err)
+		goto exit_kobj;
+
+	optoe_debugfs = debugfs_create_dir("optoe", NULL);
+	debugfs_create_file("segments", S_IRUGO, optoe_debugfs, NULL,
+			    &optoe_segments_fops);
+
+	INIT_DELAYED_WORK(&dom_work, optoe_dom_work);
+	err = i2c_add_driver(&optoe_driver);
+	if (err)
+		goto exit_kobj;
+
+	mutex_lock(&optoe_ports_lock);
+	dom_work_ready = true;
+	optoe_dom_kick(false);
+	mutex_unlock(&optoe_ports_lock);
+
+	return 0;
+
+exit_kobj:
+	debugfs_remove_recursive(optoe_debugfs);
+	kobject_put(optoe_kobj);
+	destroy_workqueue(optoe_sweep_wq);
+	return err;
 }
 module_init(optoe_init);
 
 static void __exit optoe_exit(void)
 {
 	i2c_del_driver(&optoe_driver);
+	mutex_lock(&optoe_ports_lock);
+	dom_work_ready = false;
+	mutex_unlock(&optoe_ports_lock);
+	cancel_delayed_work_sync(&dom_work);
+	debugfs_remove_recursive(optoe_debugfs);
+	kobject_put(optoe_kobj);
+	destroy_workqueue(optoe_sweep_wq);
 }
 module_exit(optoe_exit);
 
@@ -46,6 +46,24 @@ FUNCTION_NAME = 'accton_as7716_monitor'
 global log_file
 global log_level
 
+# Kernel fan governor in the as7716_32x_fan driver
+FAN_GOVERNOR_PATH = '/sys/bus/i2c/devices/9-0066/governor_enable'
+FAN_POLICY_PATH = '/sys/bus/i2c/devices/9-0066/fan_policy_{0}'
+
+# [duty cycle, step down below, step up above], sum of LM75 in milli-Celsius
+fan_policy_f2b = {
+   0: [32, 0,      174000],
+   1: [38, 170000, 182000],
+   2: [50, 178000, 190000],
+   3: [63, 186000, 0],
+}
+fan_policy_b2f = {
+   0: [32, 0,      140000],
+   1: [38, 135000, 150000],
+   2: [50, 145000, 160000],
+   3: [69, 155000, 0],
+}
+
  # For AC power Front to Back :
  #	 If any fan fail, please fan speed register to 15
  #	 The max value of Fan speed register is 9
@@ -107,23 +125,33 @@ class accton_as7716_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
+    def load_policy(self):
+        """Push the fan policy to the kernel governor and enable it.
+        Return False if the fan driver has no governor."""
+        if not os.path.exists(FAN_GOVERNOR_PATH):
+            return False
+
+        try:
+            for name, policy in (('f2b', fan_policy_f2b), ('b2f', fan_policy_b2f)):
+                levels = [' '.join(str(v) for v in policy[x]) for x in sorted(policy)]
+                with open(FAN_POLICY_PATH.format(name), 'w') as f:
+                    f.write('\n'.join(levels) + '\n')
+            with open(FAN_GOVERNOR_PATH, 'w') as f:
+                f.write('1\n')
+        except IOError as e:
+            logging.error('SET. unable to load fan policy: %s', str(e))
+            return False
+
+        logging.info('INFO. fan policy loaded to the kernel governor')
+        return True
+
     def manage_fans(self):
-        
-        fan_policy_f2b = {
-           0: [32, 0,      174000],
-           1: [38, 170000, 182000],
-           2: [50, 178000, 190000],
-           3: [63, 186000, 0],
-        }
-        fan_policy_b2f = {
-           0: [32, 0,      140000],
-           1: [38, 135000, 150000],
-           2: [50, 145000, 160000],
-           3: [69, 15500, 0],
-        }
-  
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         get_temp = thermal.get_thermal_temp()            
         
         cur_duty_cycle = fan.get_fan_duty_cycle()
@@ -198,6 +226,10 @@ def main(argv):
 
     monitor = accton_as7716_monitor(log_file, log_level)
 
+    # The fan driver runs the policy itself when it has a governor.
+    if monitor.load_policy():
+        return 0
+
     # Loop forever, doing something useful hopefully:
     while True:
         monitor.manage_fans()
@@ -263,7 +263,25 @@ kos = [
 'modprobe accton_as7716_32x_cpld1',
 'modprobe accton_as7716_32x_fan',
 'modprobe accton_as7716_32x_leds',
-'modprobe accton_as7716_32x_psu']
+'modprobe accton_as7716_32x_psu',
+'modprobe accton_as7716_32x_platform' ]
+
+# Set when the board driver has created the devices; they are then
+# removed together with the driver.
+board_path = '/sys/bus/platform/devices/as7716_32x_platform'
+
+def set_port_names():
+    global FORCE
+    for i in range(0,len(sfp_map)):
+        node = i2c_prefix+str(sfp_map[i])+"-0050/port_name"
+        try:
+            with open(node, 'w') as f:
+                f.write("port"+str(i))
+        except IOError as e:
+            print "Error: unable to write %s: %s" % (node, str(e))
+            if FORCE == 0:
+                return 1
+    return 0
 
 def driver_install():
     global FORCE
@@ -272,6 +290,9 @@ def driver_install():
         if status:
             if FORCE == 0:
                 return status
+    # The board driver creates the ports, only their names are left
+    if os.path.exists(board_path):
+        return set_port_names()
     return 0
 
 def driver_uninstall():
@@ -330,6 +351,9 @@ def device_install():
 def device_uninstall():
     global FORCE
 
+    if os.path.exists(board_path):
+        return 0
+
     status, output =log_os_system("ls /sys/bus/i2c/devices/0-0070", 0)
     if status==0:
         I2C_ORDER=1
@@ -33,6 +33,8 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/list.h>
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 static LIST_HEAD(cpld_client_list);
 static struct mutex	 list_lock;
@@ -42,8 +44,6 @@ struct cpld_client_node {
 	struct list_head   list;
 };
 
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
 #define STRING_TO_DEC_VALUE		10
 
 static ssize_t show_present(struct device *dev, struct device_attribute *da,
@@ -60,6 +60,8 @@ static ssize_t set_mode_reset(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count);
 
 static int as7716_32xb_cpld_read_internal(struct i2c_client *client, u8 reg);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf);
 static int as7716_32xb_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 static ssize_t sfp_value_show(struct device *dev, struct device_attribute *da,
@@ -75,6 +77,8 @@ struct as7716_32xb_cpld_data {
     struct mutex        update_lock;
     unsigned int     present[PORT_NUM_MAX];
     unsigned int     reset[PORT_NUM_MAX];
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 enum port_id {
     PORT1_ID,
@@ -280,6 +284,8 @@ DECLARE_TRANSCEIVER_SENSOR_DEVICE_RESET_ATTR(31);
 DECLARE_TRANSCEIVER_SENSOR_DEVICE_RESET_ATTR(32);
 
 
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+
 static struct attribute *as7716_32xb_cpld_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
@@ -349,6 +355,7 @@ static struct attribute *as7716_32xb_cpld_attributes[] = {
 	DECLARE_TRANSCEIVER_RESET_ATTR(30),
 	DECLARE_TRANSCEIVER_RESET_ATTR(31),
 	DECLARE_TRANSCEIVER_RESET_ATTR(32),
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -687,40 +694,33 @@ exit:
 	return status;
 }
 
-static int as7716_32xb_cpld_read_internal(struct i2c_client *client, u8 reg)
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_read_byte_data(client, reg);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as7716_32xb_cpld_data *data = i2c_get_clientdata(client);
 
-		break;
-	}
+	return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
 
-    return status;
+static int as7716_32xb_cpld_read_internal(struct i2c_client *client, u8 reg)
+{
+	struct as7716_32xb_cpld_data *data = i2c_get_clientdata(client);
+
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7716_32xb_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-	while (retry) {
-		status = i2c_smbus_write_byte_data(client, reg, value);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
-	}
+	struct as7716_32xb_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 static void as7716_32xb_cpld_add_client(struct i2c_client *client)
@@ -793,6 +793,7 @@ static int as7716_32xb_cpld_probe(struct i2c_client *client,
 		goto exit_remove;
 	}
 
+	accton_i2c_trace_add(&data->i2c_trace, client);
 	as7716_32xb_cpld_add_client(client);
 
 	dev_info(&client->dev, "%s: cpld '%s'\n",
@@ -813,10 +814,12 @@ static int as7716_32xb_cpld_remove(struct i2c_client *client)
 {
     struct as7716_32xb_cpld_data *data = i2c_get_clientdata(client);
 
+	/* unlist first, the exported accessors use data->i2c_stats */
+	as7716_32xb_cpld_remove_client(client);
+	accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_cpld_group);
     kfree(data);
-	as7716_32xb_cpld_remove_client(client);
 
     return 0;
 }
@@ -825,6 +828,7 @@ int as7716_32xb_cpld_read(unsigned short cpld_addr, u8 reg)
 {
 	struct list_head   *list_node = NULL;
 	struct cpld_client_node *cpld_node = NULL;
+	struct as7716_32xb_cpld_data *data;
 	int ret = -EPERM;
 	
 	mutex_lock(&list_lock);
@@ -834,7 +838,10 @@ int as7716_32xb_cpld_read(unsigned short cpld_addr, u8 reg)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
+			data = i2c_get_clientdata(cpld_node->client);
+			ret = accton_i2c_traced(&data->i2c_trace, cpld_node->client,
+					I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+					i2c_smbus_read_byte_data(cpld_node->client, reg));
 			break;
 		}
 	}
@@ -849,6 +856,7 @@ int as7716_32xb_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
 	struct list_head   *list_node = NULL;
 	struct cpld_client_node *cpld_node = NULL;
+	struct as7716_32xb_cpld_data *data;
 	int ret = -EIO;
 	
 	mutex_lock(&list_lock);
@@ -858,7 +866,10 @@ int as7716_32xb_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 		cpld_node = list_entry(list_node, struct cpld_client_node, list);
 		
 		if (cpld_node->client->addr == cpld_addr) {
-			ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
+			data = i2c_get_clientdata(cpld_node->client);
+			ret = accton_i2c_traced(&data->i2c_trace, cpld_node->client,
+					I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+					i2c_smbus_write_byte_data(cpld_node->client, reg, value));
 			break;
 		}
 	}
@@ -1001,6 +1012,25 @@ static struct i2c_driver as7716_32xb_cpld_driver = {
     .address_list = normal_i2c,
 };
 
+/* Called by the IPMI client, which holds the device lock of @client */
+int as7716_32xb_cpld1_set_present(struct i2c_client *client, int port, int present)
+{
+    struct as7716_32xb_cpld_data *data;
+
+    if (client->dev.driver != &as7716_32xb_cpld_driver.driver)
+        return -ENODEV;
+    if (port < 1 || port > PORT_NUM_MAX)
+        return -EINVAL;
+
+    data = i2c_get_clientdata(client);
+    mutex_lock(&data->update_lock);
+    data->present[port - 1] = !!present;
+    mutex_unlock(&data->update_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_cpld1_set_present);
+
 static int __init as7716_32xb_cpld_init(void)
 {
 	mutex_init(&list_lock);
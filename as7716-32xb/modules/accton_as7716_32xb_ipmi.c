@@ -0,0 +1,578 @@
+/*
+ * An IPMI client for accton as7716_32xb
+ *
+ * The QSFP, thermal, fan, PSU and system EEPROM data of this platform
+ * sit behind the BMC. This driver asks the BMC for them with the Accton
+ * OEM commands, through the in-kernel IPMI message handler, and hands
+ * the answers to the oom, cpld1, thermal, fan, psu, pmbus and sys drivers.
+ *
+ * Copyright (C) 2018 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/i2c.h>
+#include <linux/ipmi.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+
+#define DRVNAME "as7716_32xb_ipmi"
+
+#define IPMI_NETFN_OEM          0x34
+#define IPMI_QSFP_CMD           0x10
+#define IPMI_THERMAL_CMD        0x12
+#define IPMI_FAN_CMD            0x14
+#define IPMI_PSU_CMD            0x16
+#define IPMI_SYS_EEPROM_CMD     0x18
+
+#define IPMI_QSFP_PRESENT       0x10    /* sole data byte: presence of all ports */
+#define IPMI_QSFP_LOWER_PAGE    0x00
+#define IPMI_QSFP_UPPER_PAGE    0x01
+
+#define IPMI_RETRIES            2
+#define IPMI_RETRY_MS           1000
+/* The message handler answers by itself once the retries run out */
+#define IPMI_WAIT_MS            ((IPMI_RETRIES + 2) * IPMI_RETRY_MS)
+
+#define QSFP_PORT_NUM           32
+#define FAN_NUM                 6
+#define PSU_NUM                 2
+#define THERMAL_NUM             3
+#define EEPROM_DATA_SIZE        256
+#define EEPROM_HALF_SIZE        128
+
+/* The I2C clients the utils create on i2c-0 for the data */
+#define I2C_BUS                 0
+#define CPLD1_ADDR              0x60
+#define FAN_ADDR                0x66
+#define SYS_EEPROM_ADDR         0x56
+/* as7716_32xb_oom of port 1 to 32, the port number read as hex: 0x01 to 0x32 */
+#define QSFP_ADDR(port)         ((((port) / 10) << 4) | ((port) % 10))
+static const unsigned short thermal_addr[THERMAL_NUM] = { 0x48, 0x49, 0x4a };
+static const unsigned short psu_addr[PSU_NUM]   = { 0x53, 0x50 };
+static const unsigned short pmbus_addr[PSU_NUM] = { 0x5b, 0x58 };
+
+/* Offsets in the answers, as accton_as7716_32xb_drv_handler.py used them */
+static const u8 thermal_offset[THERMAL_NUM] = { 2, 5, 8 };
+#define FAN_STRIDE              4
+#define FAN_PRESENT_OFFSET      0
+#define FAN_FRONT_RPM_OFFSET    2
+#define FAN_REAR_RPM_OFFSET     26
+#define FAN_ANSWER_LEN          (FAN_REAR_RPM_OFFSET + FAN_STRIDE * (FAN_NUM - 1) + 2)
+#define PSU_PRESENT_OFFSET      0
+#define PSU_POWER_GOOD_OFFSET   2
+#define PSU_TEMP_OFFSET         13
+#define PSU_FAN_RPM_OFFSET      15
+#define PSU_P_OUT_OFFSET        17
+#define PSU_ANSWER_LEN          (PSU_P_OUT_OFFSET + 2)
+
+static unsigned int poll_interval_ms = 1000;
+module_param(poll_interval_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(poll_interval_ms, "Time between two refreshes from the BMC");
+
+static int ipmi_interface;
+module_param(ipmi_interface, int, S_IRUGO);
+MODULE_PARM_DESC(ipmi_interface, "IPMI interface the BMC is reached on");
+
+extern int as7716_32xb_cpld1_set_present(struct i2c_client *client, int port, int present);
+extern int as7716_32xb_oom_set_eeprom(struct i2c_client *client, const u8 *eeprom, size_t len);
+extern int as7716_32xb_thermal_set_temp(struct i2c_client *client, int temp);
+extern int as7716_32xb_fan_set_status(struct i2c_client *client, int fan, int present,
+                                      int front_speed_rpm, int rear_speed_rpm);
+extern int as7716_32xb_psu_set_status(struct i2c_client *client, int present, int power_good);
+extern int as7716_32xb_pmbus_set_sensors(struct i2c_client *client, int temp,
+                                         int fan_speed, int p_out);
+extern int as7716_32xb_sys_set_eeprom(struct i2c_client *client, const u8 *eeprom, size_t len);
+
+struct as7716_32xb_ipmi_data {
+    struct ipmi_user       *user;
+    struct mutex            lock;           /* one request at a time */
+    spinlock_t              rx_lock;
+    struct completion       done;
+    long                    msgid;          /* of the request waited for */
+    unsigned char           rx[IPMI_MAX_MSG_LENGTH];
+    int                     rx_len;
+    struct delayed_work     work;
+    bool                    sys_eeprom_done;
+    u8                      eeprom[EEPROM_DATA_SIZE];
+    /* Statistics */
+    unsigned long           requests;
+    unsigned long           errors;
+    unsigned long           cycles;
+    s64                     last_cycle_us;
+};
+
+static struct platform_device *ipmi_pdev = NULL;
+static struct as7716_32xb_ipmi_data *ipmi_data = NULL;   /* of the bound device */
+
+static void as7716_32xb_ipmi_msg_handler(struct ipmi_recv_msg *msg, void *user_msg_data)
+{
+    struct as7716_32xb_ipmi_data *data = user_msg_data;
+    unsigned long flags;
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    /* A late answer to a request that was given up on */
+    if (msg->msgid != data->msgid) {
+        spin_unlock_irqrestore(&data->rx_lock, flags);
+        ipmi_free_recv_msg(msg);
+        return;
+    }
+
+    data->rx_len = min_t(int, msg->msg.data_len, sizeof(data->rx));
+    memcpy(data->rx, msg->msg.data, data->rx_len);
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+    ipmi_free_recv_msg(msg);
+    complete(&data->done);
+}
+
+static struct ipmi_user_hndl as7716_32xb_ipmi_hndl = {
+    .ipmi_recv_hndl = as7716_32xb_ipmi_msg_handler,
+};
+
+/*
+ * Send an OEM command to the BMC and wait for the answer.
+ * Return the number of data bytes copied to @rx, the completion code
+ * is not included.
+ */
+static int as7716_32xb_ipmi_xfer(struct as7716_32xb_ipmi_data *data, u8 cmd,
+                                 const u8 *tx, int tx_len, u8 *rx, int rx_len)
+{
+    struct ipmi_system_interface_addr addr = {
+        .addr_type = IPMI_SYSTEM_INTERFACE_ADDR_TYPE,
+        .channel   = IPMI_BMC_CHANNEL,
+    };
+    struct kernel_ipmi_msg msg = {
+        .netfn    = IPMI_NETFN_OEM,
+        .cmd      = cmd,
+        .data     = (unsigned char *)tx,
+        .data_len = tx_len,
+    };
+    unsigned long flags;
+    int status;
+
+    mutex_lock(&data->lock);
+    data->requests++;
+
+    if (!data->user) {
+        status = -ENODEV;
+        goto exit;
+    }
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    data->msgid++;
+    data->rx_len = 0;
+    reinit_completion(&data->done);
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+    status = ipmi_request_settime(data->user, (struct ipmi_addr *)&addr,
+                                  data->msgid, &msg, data, 0,
+                                  IPMI_RETRIES, IPMI_RETRY_MS);
+    if (status)
+        goto exit;
+
+    if (!wait_for_completion_timeout(&data->done, msecs_to_jiffies(IPMI_WAIT_MS))) {
+        status = -ETIMEDOUT;
+        goto exit;
+    }
+
+    spin_lock_irqsave(&data->rx_lock, flags);
+    if (data->rx_len < 1 || data->rx[0] != IPMI_CC_NO_ERROR) {
+        status = -EIO;
+    }
+    else {
+        status = min(rx_len, data->rx_len - 1);
+        memcpy(rx, data->rx + 1, status);
+    }
+    spin_unlock_irqrestore(&data->rx_lock, flags);
+
+exit:
+    if (status < 0)
+        data->errors++;
+    mutex_unlock(&data->lock);
+    return status;
+}
+
+static int as7716_32xb_ipmi_match_client(struct device *dev, void *addr)
+{
+    struct i2c_client *client = i2c_verify_client(dev);
+
+    return client && client->adapter->nr == I2C_BUS &&
+           client->addr == *(unsigned short *)addr;
+}
+
+/*
+ * Find the client at @addr and lock it against unbinding, the setter
+ * checks it is bound to the expected driver. NULL if it is not there.
+ */
+static struct i2c_client *as7716_32xb_ipmi_get_client(unsigned short addr)
+{
+    struct device *dev;
+
+    dev = bus_find_device(&i2c_bus_type, NULL, &addr, as7716_32xb_ipmi_match_client);
+    if (!dev)
+        return NULL;
+
+    device_lock(dev);
+    return to_i2c_client(dev);
+}
+
+static void as7716_32xb_ipmi_put_client(struct i2c_client *client)
+{
+    device_unlock(&client->dev);
+    put_device(&client->dev);
+}
+
+static inline int le16_at(const u8 *buf, int offset)
+{
+    return buf[offset] | (buf[offset + 1] << 8);
+}
+
+static void as7716_32xb_ipmi_update_qsfp(struct as7716_32xb_ipmi_data *data)
+{
+    u8 pres[QSFP_PORT_NUM];
+    u8 tx[2];
+    struct i2c_client *cpld, *oom;
+    int port, present, status;
+
+    tx[0] = IPMI_QSFP_PRESENT;
+    status = as7716_32xb_ipmi_xfer(data, IPMI_QSFP_CMD, tx, 1, pres, sizeof(pres));
+    if (status < (int)sizeof(pres))
+        return;
+
+    for (port = 1; port <= QSFP_PORT_NUM; port++) {
+        present = ((pres[port - 1] & 0xf) == 1);
+
+        cpld = as7716_32xb_ipmi_get_client(CPLD1_ADDR);
+        if (cpld) {
+            as7716_32xb_cpld1_set_present(cpld, port, present);
+            as7716_32xb_ipmi_put_client(cpld);
+        }
+
+        if (present) {
+            tx[0] = port;
+            tx[1] = IPMI_QSFP_LOWER_PAGE;
+            status = as7716_32xb_ipmi_xfer(data, IPMI_QSFP_CMD, tx, 2,
+                                           data->eeprom, EEPROM_HALF_SIZE);
+            if (status != EEPROM_HALF_SIZE)
+                continue;
+
+            tx[1] = IPMI_QSFP_UPPER_PAGE;
+            status = as7716_32xb_ipmi_xfer(data, IPMI_QSFP_CMD, tx, 2,
+                                           data->eeprom + EEPROM_HALF_SIZE,
+                                           EEPROM_HALF_SIZE);
+            if (status != EEPROM_HALF_SIZE)
+                continue;
+        }
+
+        oom = as7716_32xb_ipmi_get_client(QSFP_ADDR(port));
+        if (oom) {
+            as7716_32xb_oom_set_eeprom(oom, present ? data->eeprom : NULL,
+                                       EEPROM_DATA_SIZE);
+            as7716_32xb_ipmi_put_client(oom);
+        }
+    }
+}
+
+static void as7716_32xb_ipmi_update_thermal(struct as7716_32xb_ipmi_data *data)
+{
+    u8 rx[IPMI_MAX_MSG_LENGTH];
+    struct i2c_client *client;
+    int i, status;
+
+    status = as7716_32xb_ipmi_xfer(data, IPMI_THERMAL_CMD, NULL, 0, rx, sizeof(rx));
+    if (status <= thermal_offset[THERMAL_NUM - 1])
+        return;
+
+    for (i = 0; i < THERMAL_NUM; i++) {
+        client = as7716_32xb_ipmi_get_client(thermal_addr[i]);
+        if (!client)
+            continue;
+
+        as7716_32xb_thermal_set_temp(client, rx[thermal_offset[i]] * 1000);
+        as7716_32xb_ipmi_put_client(client);
+    }
+}
+
+static void as7716_32xb_ipmi_update_fan(struct as7716_32xb_ipmi_data *data)
+{
+    u8 rx[IPMI_MAX_MSG_LENGTH];
+    struct i2c_client *client;
+    int i, k, status;
+
+    status = as7716_32xb_ipmi_xfer(data, IPMI_FAN_CMD, NULL, 0, rx, sizeof(rx));
+    if (status < FAN_ANSWER_LEN)
+        return;
+
+    client = as7716_32xb_ipmi_get_client(FAN_ADDR);
+    if (!client)
+        return;
+
+    for (i = 0; i < FAN_NUM; i++) {
+        k = i * FAN_STRIDE;
+        as7716_32xb_fan_set_status(client, i + 1,
+                                   (rx[k + FAN_PRESENT_OFFSET] & 0xf) == 0,
+                                   le16_at(rx, k + FAN_FRONT_RPM_OFFSET),
+                                   le16_at(rx, k + FAN_REAR_RPM_OFFSET));
+    }
+    as7716_32xb_ipmi_put_client(client);
+}
+
+static void as7716_32xb_ipmi_update_psu(struct as7716_32xb_ipmi_data *data)
+{
+    u8 rx[IPMI_MAX_MSG_LENGTH];
+    u8 tx;
+    struct i2c_client *client;
+    int i, status, present, power_good;
+
+    for (i = 0; i < PSU_NUM; i++) {
+        tx = i + 1;
+        status = as7716_32xb_ipmi_xfer(data, IPMI_PSU_CMD, &tx, 1, rx, sizeof(rx));
+        if (status < PSU_ANSWER_LEN)
+            continue;
+
+        present = (rx[PSU_PRESENT_OFFSET] & 0xf) == 0;
+        power_good = (rx[PSU_POWER_GOOD_OFFSET] & 0xf) == 1;
+
+        client = as7716_32xb_ipmi_get_client(psu_addr[i]);
+        if (client) {
+            as7716_32xb_psu_set_status(client, present, present && power_good);
+            as7716_32xb_ipmi_put_client(client);
+        }
+
+        client = as7716_32xb_ipmi_get_client(pmbus_addr[i]);
+        if (client) {
+            if (power_good)
+                as7716_32xb_pmbus_set_sensors(client,
+                                              le16_at(rx, PSU_TEMP_OFFSET) * 1000,
+                                              le16_at(rx, PSU_FAN_RPM_OFFSET),
+                                              le16_at(rx, PSU_P_OUT_OFFSET));
+            else
+                as7716_32xb_pmbus_set_sensors(client, 0, 0, 0);
+            as7716_32xb_ipmi_put_client(client);
+        }
+    }
+}
+
+static void as7716_32xb_ipmi_update_sys_eeprom(struct as7716_32xb_ipmi_data *data)
+{
+    struct i2c_client *client;
+    u8 tx[2];
+    int status;
+
+    tx[0] = 0;
+    tx[1] = EEPROM_HALF_SIZE;
+    status = as7716_32xb_ipmi_xfer(data, IPMI_SYS_EEPROM_CMD, tx, 2,
+                                   data->eeprom, EEPROM_HALF_SIZE);
+    if (status != EEPROM_HALF_SIZE)
+        return;
+
+    tx[0] = EEPROM_HALF_SIZE;
+    status = as7716_32xb_ipmi_xfer(data, IPMI_SYS_EEPROM_CMD, tx, 2,
+                                   data->eeprom + EEPROM_HALF_SIZE, EEPROM_HALF_SIZE);
+    if (status != EEPROM_HALF_SIZE)
+        return;
+
+    client = as7716_32xb_ipmi_get_client(SYS_EEPROM_ADDR);
+    if (!client)
+        return;
+
+    /* It does not change, done once it has been delivered */
+    if (!as7716_32xb_sys_set_eeprom(client, data->eeprom, EEPROM_DATA_SIZE))
+        data->sys_eeprom_done = true;
+    as7716_32xb_ipmi_put_client(client);
+}
+
+/*
+ * Become a user of the interface once it is there: ipmi_si may register
+ * it after this driver is bound, and it may go away and come back.
+ */
+static int as7716_32xb_ipmi_connect(struct as7716_32xb_ipmi_data *data)
+{
+    int status = 0;
+
+    mutex_lock(&data->lock);
+    if (!data->user)
+        status = ipmi_create_user(ipmi_interface, &as7716_32xb_ipmi_hndl,
+                                  data, &data->user);
+    mutex_unlock(&data->lock);
+
+    return status;
+}
+
+static void as7716_32xb_ipmi_new_smi(int if_num, struct device *dev)
+{
+    if (if_num == ipmi_interface && ipmi_data)
+        mod_delayed_work(system_wq, &ipmi_data->work, 0);
+}
+
+static void as7716_32xb_ipmi_smi_gone(int if_num)
+{
+    struct as7716_32xb_ipmi_data *data = ipmi_data;
+
+    if (if_num != ipmi_interface || !data)
+        return;
+
+    mutex_lock(&data->lock);
+    if (data->user) {
+        ipmi_destroy_user(data->user);
+        data->user = NULL;
+    }
+    mutex_unlock(&data->lock);
+}
+
+static struct ipmi_smi_watcher as7716_32xb_ipmi_watcher = {
+    .owner    = THIS_MODULE,
+    .new_smi  = as7716_32xb_ipmi_new_smi,
+    .smi_gone = as7716_32xb_ipmi_smi_gone,
+};
+
+static void as7716_32xb_ipmi_work(struct work_struct *work)
+{
+    struct as7716_32xb_ipmi_data *data =
+        container_of(to_delayed_work(work), struct as7716_32xb_ipmi_data, work);
+    ktime_t start = ktime_get();
+
+    /* Retried every interval, new_smi brings it forward */
+    if (as7716_32xb_ipmi_connect(data)) {
+        schedule_delayed_work(&data->work, msecs_to_jiffies(poll_interval_ms));
+        return;
+    }
+
+    if (!data->sys_eeprom_done)
+        as7716_32xb_ipmi_update_sys_eeprom(data);
+
+    as7716_32xb_ipmi_update_qsfp(data);
+    as7716_32xb_ipmi_update_thermal(data);
+    as7716_32xb_ipmi_update_psu(data);
+    as7716_32xb_ipmi_update_fan(data);
+
+    data->last_cycle_us = ktime_us_delta(ktime_get(), start);
+    data->cycles++;
+
+    schedule_delayed_work(&data->work, msecs_to_jiffies(poll_interval_ms));
+}
+
+static ssize_t show_ipmi_stats(struct device *dev, struct device_attribute *da,
+                               char *buf)
+{
+    struct as7716_32xb_ipmi_data *data = dev_get_drvdata(dev);
+
+    return sprintf(buf, "requests %lu\nerrors %lu\ncycles %lu\nlast_cycle_us %lld\n",
+                   data->requests, data->errors, data->cycles, data->last_cycle_us);
+}
+
+static DEVICE_ATTR(ipmi_stats, S_IRUGO, show_ipmi_stats, NULL);
+
+static int as7716_32xb_ipmi_probe(struct platform_device *pdev)
+{
+    struct as7716_32xb_ipmi_data *data;
+    int status;
+
+    data = kzalloc(sizeof(struct as7716_32xb_ipmi_data), GFP_KERNEL);
+    if (!data)
+        return -ENOMEM;
+
+    mutex_init(&data->lock);
+    spin_lock_init(&data->rx_lock);
+    init_completion(&data->done);
+    INIT_DELAYED_WORK(&data->work, as7716_32xb_ipmi_work);
+    platform_set_drvdata(pdev, data);
+
+    status = device_create_file(&pdev->dev, &dev_attr_ipmi_stats);
+    if (status)
+        goto exit_free;
+
+    /* The work creates the IPMI user, whenever the interface shows up */
+    ipmi_data = data;
+    status = ipmi_smi_watcher_register(&as7716_32xb_ipmi_watcher);
+    if (status)
+        goto exit_remove;
+
+    schedule_delayed_work(&data->work, 0);
+    dev_info(&pdev->dev, "polling the BMC on IPMI interface %d every %u ms\n",
+             ipmi_interface, poll_interval_ms);
+    return 0;
+
+exit_remove:
+    ipmi_data = NULL;
+    device_remove_file(&pdev->dev, &dev_attr_ipmi_stats);
+exit_free:
+    kfree(data);
+    return status;
+}
+
+static int as7716_32xb_ipmi_remove(struct platform_device *pdev)
+{
+    struct as7716_32xb_ipmi_data *data = platform_get_drvdata(pdev);
+
+    ipmi_smi_watcher_unregister(&as7716_32xb_ipmi_watcher);
+    ipmi_data = NULL;
+    cancel_delayed_work_sync(&data->work);
+    device_remove_file(&pdev->dev, &dev_attr_ipmi_stats);
+    if (data->user)
+        ipmi_destroy_user(data->user);
+    kfree(data);
+
+    return 0;
+}
+
+static struct platform_driver as7716_32xb_ipmi_driver = {
+    .probe      = as7716_32xb_ipmi_probe,
+    .remove     = as7716_32xb_ipmi_remove,
+    .driver     = {
+        .name   = DRVNAME,
+        .owner  = THIS_MODULE,
+    },
+};
+
+static int __init as7716_32xb_ipmi_init(void)
+{
+    int ret;
+
+    ret = platform_driver_register(&as7716_32xb_ipmi_driver);
+    if (ret < 0)
+        return ret;
+
+    ipmi_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+    if (IS_ERR(ipmi_pdev)) {
+        ret = PTR_ERR(ipmi_pdev);
+        platform_driver_unregister(&as7716_32xb_ipmi_driver);
+        return ret;
+    }
+
+    return 0;
+}
+
+static void __exit as7716_32xb_ipmi_exit(void)
+{
+    platform_device_unregister(ipmi_pdev);
+    platform_driver_unregister(&as7716_32xb_ipmi_driver);
+}
+
+module_init(as7716_32xb_ipmi_init);
+module_exit(as7716_32xb_ipmi_exit);
+
+MODULE_DESCRIPTION("as7716_32xb IPMI client for the BMC managed devices");
+MODULE_LICENSE("GPL");
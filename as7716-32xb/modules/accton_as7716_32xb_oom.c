@@ -25,6 +25,8 @@ struct as7716_32xb_oom_data {
     struct mutex   lock;
     u8  index;
     unsigned char  eeprom[EEPROM_DATA_SIZE];
+    unsigned int   generation;      /* bumped when eeprom[] changes */
+    struct bin_attribute bin;       /* eeprom data */
     char           port_name[MAX_PORT_NAME_LEN];
    
 };
@@ -40,99 +42,110 @@ enum as7716_32xb_oom_sysfs_attributes {
 /* sysfs attributes for hwmon 
  */
 
-static ssize_t oom_info_store(struct device *dev, struct device_attribute *da,
-			const char *buf, size_t count);
-static ssize_t oom_info_show(struct device *dev, struct device_attribute *da,
+static ssize_t show_generation(struct device *dev, struct device_attribute *da,
              char *buf);
 static ssize_t show_port_name(struct device *dev,
 			struct device_attribute *dattr, char *buf);
 static ssize_t set_port_name(struct device *dev,
 			struct device_attribute *attr,
 			const char *buf, size_t count);             
-static SENSOR_DEVICE_ATTR(eeprom,  S_IWUSR|S_IRUGO, oom_info_show, oom_info_store, 0);
+static SENSOR_DEVICE_ATTR(eeprom_generation,  S_IRUGO, show_generation, NULL, 0);
 static SENSOR_DEVICE_ATTR(port_name,  S_IRUGO | S_IWUSR, show_port_name, set_port_name, 1);
 
 
 static struct attribute *as7716_32xb_oom_attributes[] = {
-    &sensor_dev_attr_eeprom.dev_attr.attr,
+    &sensor_dev_attr_eeprom_generation.dev_attr.attr,
     &sensor_dev_attr_port_name.dev_attr.attr,
     NULL
 };
 
 
-static ssize_t oom_info_show(struct device *dev, struct device_attribute *da,
-             char *buf)
+/*
+ * The module EEPROM, lower and upper page, is pushed in as raw bytes at
+ * any offset by whoever talks to the BMC, and read back the same way.
+ * The generation only moves when the content changes: a reader that
+ * sees the same eeprom_generation before and after reading the image
+ * got a consistent one. An updater changing several pages writes them
+ * in a single write().
+ */
+static ssize_t as7716_32xb_oom_update(struct as7716_32xb_oom_data *data,
+            const u8 *buf, loff_t off, size_t count)
 {
-    struct i2c_client *client = to_i2c_client(dev);
+    if (off >= EEPROM_DATA_SIZE)
+        return 0;
+    count = min_t(size_t, count, EEPROM_DATA_SIZE - off);
+
+    mutex_lock(&data->lock);
+    if (!buf) {
+        /* Blank the range, the module is gone */
+        if (memchr_inv(data->eeprom + off, 0xFF, count)) {
+            memset(data->eeprom + off, 0xFF, count);
+            data->generation++;
+        }
+    }
+    else if (memcmp(data->eeprom + off, buf, count)) {
+        memcpy(data->eeprom + off, buf, count);
+        data->generation++;
+    }
+    mutex_unlock(&data->lock);
+
+    return count;
+}
+
+static ssize_t oom_bin_read(struct file *filp, struct kobject *kobj,
+            struct bin_attribute *attr,
+            char *buf, loff_t off, size_t count)
+{
+    struct i2c_client *client = to_i2c_client(container_of(kobj, struct device, kobj));
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
-    int i;    
-  
+
+    if (off >= EEPROM_DATA_SIZE)
+        return 0;
+    count = min_t(size_t, count, EEPROM_DATA_SIZE - off);
+
     mutex_lock(&data->lock);
-    memcpy(buf, data->eeprom, EEPROM_DATA_SIZE);
-    //for(i=0; i < EEPROM_DATA_SIZE ; i++)
-    //{ 
-    //    buf[i]=data->eeprom[i];
-     //   printk("buf[%d]=0x%x ",i, buf[i]);
-    //}
-    //status = EEPROM_DATA_SIZE+1;
-   
-    
-    memcpy(buf, data->eeprom, 256);
+    memcpy(buf, data->eeprom + off, count);
     mutex_unlock(&data->lock);
-    
-    return 256;
+
+    return count;
+}
+
+static ssize_t oom_bin_write(struct file *filp, struct kobject *kobj,
+            struct bin_attribute *attr,
+            char *buf, loff_t off, size_t count)
+{
+    struct i2c_client *client = to_i2c_client(container_of(kobj, struct device, kobj));
+    struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
+
+    return as7716_32xb_oom_update(data, (const u8 *)buf, off, count);
 }
 
-static ssize_t oom_info_store(struct device *dev, struct device_attribute *da,
-			const char *buf, size_t size)
+static ssize_t show_generation(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
-    int i=0, j=0, k=0;
-    unsigned char str[3];
-    unsigned int val;
-   
-   // printk("strlen(buf)=%d\n",strlen(buf));
-    k=0;
-    mutex_lock(&data->lock);  
-    memset(data->eeprom, 0xFF, EEPROM_DATA_SIZE);  
-    memset(str, 0x0, 3);
-    if(strlen(buf) >= 256 )
-    {
-        for(i=0; i < strlen(buf) ; i++)
-        {   
-           // printk("i=%d ", i);
-            for(j=0;j<2; j++)
-            {
-                str[j]=buf[i+j];
-            }
-            sscanf(str, "%x", &val);
-            //printk("str=%s val=0x%x ", str, val);
-            i=j+i-1;
-            if(k>=EEPROM_DATA_SIZE)
-            {
-                break;
-            }
-            data->eeprom[k]=(unsigned char)val;
-            //printk("data->eeprom[%d]=0x%x\n",k, data->eeprom[k]);
-            k++;
-        }
-    }
-    //printk("buf=\n");
-    //for(i=0; i < strlen(buf) ; i++)
-    //{
-       // printk("%c%c ", buf[i], buf[i+1]);
-       // if((i % 31)==0)
-         //   printk("\n");
-    //}
-    //printk("\n");
-   
-    
+    unsigned int generation;
+
+    mutex_lock(&data->lock);
+    generation = data->generation;
     mutex_unlock(&data->lock);
-    return size;
 
+    return sprintf(buf, "%u\n", generation);
+}
+
+static int oom_sysfs_eeprom_init(struct kobject *kobj, struct bin_attribute *eeprom)
+{
+    sysfs_bin_attr_init(eeprom);
+    eeprom->attr.name = "eeprom";
+    eeprom->attr.mode = S_IWUSR | S_IRUGO;
+    eeprom->read      = oom_bin_read;
+    eeprom->write     = oom_bin_write;
+    eeprom->size      = EEPROM_DATA_SIZE;
+
+    return sysfs_create_bin_file(kobj, eeprom);
 }
-			
+
 static ssize_t show_port_name(struct device *dev,
 			struct device_attribute *dattr, char *buf)
 {
@@ -186,6 +199,8 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
     i2c_set_clientdata(client, data);
     data->index = dev_id->driver_data;
     mutex_init(&data->lock);
+    /* What an empty EEPROM reads, until the pages are pushed in */
+    memset(data->eeprom, 0xFF, sizeof(data->eeprom));
 
     dev_info(&client->dev, "chip found\n");
 
@@ -195,6 +210,11 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
         goto exit_free;
     }
 
+    status = oom_sysfs_eeprom_init(&client->dev.kobj, &data->bin);
+    if (status) {
+        goto exit_remove_group;
+    }
+
     data->hwmon_dev = hwmon_device_register(&client->dev);
     if (IS_ERR(data->hwmon_dev)) {
         status = PTR_ERR(data->hwmon_dev);
@@ -207,6 +227,8 @@ static int as7716_32xb_oom_probe(struct i2c_client *client,
     return 0;
 
 exit_remove:
+    sysfs_remove_bin_file(&client->dev.kobj, &data->bin);
+exit_remove_group:
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_oom_group);
 exit_free:
     kfree(data);
@@ -220,6 +242,7 @@ static int as7716_32xb_oom_remove(struct i2c_client *client)
     struct as7716_32xb_oom_data *data = i2c_get_clientdata(client);
 
     hwmon_device_unregister(data->hwmon_dev);
+    sysfs_remove_bin_file(&client->dev.kobj, &data->bin);
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_oom_group);
     kfree(data);
     
@@ -244,6 +267,25 @@ static struct i2c_driver as7716_32xb_oom_driver = {
     .address_list = normal_i2c,
 };
 
+/*
+ * Called by the IPMI client, which holds the device lock of @client.
+ * A NULL @eeprom blanks the image.
+ */
+int as7716_32xb_oom_set_eeprom(struct i2c_client *client, const u8 *eeprom,
+            size_t len)
+{
+    struct as7716_32xb_oom_data *data;
+
+    if (client->dev.driver != &as7716_32xb_oom_driver.driver)
+        return -ENODEV;
+
+    data = i2c_get_clientdata(client);
+    as7716_32xb_oom_update(data, eeprom, 0, eeprom ? len : EEPROM_DATA_SIZE);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_oom_set_eeprom);
+
 
 
 
@@ -9,6 +9,7 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/dmi.h>
+#include "accton_pmbus_telemetry.h"
 
 #define STRING_TO_DEC_VALUE		10
 
@@ -17,42 +18,77 @@
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
 
+/* The PSU is behind the BMC: its values are stored by the IPMI client
+ * or from userspace, never read from the bus. The table only says what
+ * PMBus command each value stands for and how wide it is.
+ */
+enum as7716_32xb_pmbus_regs {
+    AS7716_32XB_PMBUS_POWER_ON,
+    AS7716_32XB_PMBUS_TEMP_FAULT,
+    AS7716_32XB_PMBUS_POWER_GOOD,
+    AS7716_32XB_PMBUS_FAN_FAULT,
+    AS7716_32XB_PMBUS_OVER_TEMP,
+    AS7716_32XB_PMBUS_V_OUT,
+    AS7716_32XB_PMBUS_I_OUT,
+    AS7716_32XB_PMBUS_P_OUT,
+    AS7716_32XB_PMBUS_TEMP,
+    AS7716_32XB_PMBUS_FAN_SPEED,
+    AS7716_32XB_PMBUS_FAN_DUTY_CYCLE,
+    AS7716_32XB_PMBUS_FAN_DIR,
+    AS7716_32XB_PMBUS_PMBUS_REVISION,
+    AS7716_32XB_PMBUS_MFR_ID,
+    AS7716_32XB_PMBUS_MFR_MODEL,
+    AS7716_32XB_PMBUS_MFR_REVISION,
+    AS7716_32XB_PMBUS_MFR_VIN_MIN,
+    AS7716_32XB_PMBUS_MFR_VIN_MAX,
+    AS7716_32XB_PMBUS_MFR_VOUT_MIN,
+    AS7716_32XB_PMBUS_MFR_VOUT_MAX,
+    AS7716_32XB_PMBUS_MFR_IIN_MAX,
+    AS7716_32XB_PMBUS_MFR_IOUT_MAX,
+    AS7716_32XB_PMBUS_MFR_PIN_MAX,
+    AS7716_32XB_PMBUS_MFR_POUT_MAX,
+    AS7716_32XB_PMBUS_REG_COUNT
+};
+
+/* One group, never refreshed */
+static const unsigned int group_interval_ms[1];
+
+static const struct accton_pmbus_reg as7716_32xb_pmbus_regs[AS7716_32XB_PMBUS_REG_COUNT] = {
+    [AS7716_32XB_PMBUS_POWER_ON]        = ACCTON_PMBUS_REG(0x79, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_TEMP_FAULT]      = ACCTON_PMBUS_REG(0x79, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_POWER_GOOD]      = ACCTON_PMBUS_REG(0x79, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_FAN_FAULT]       = ACCTON_PMBUS_REG(0x81, ACCTON_PMBUS_BYTE, 0),
+    [AS7716_32XB_PMBUS_OVER_TEMP]       = ACCTON_PMBUS_REG(0x7d, ACCTON_PMBUS_BYTE, 0),
+    [AS7716_32XB_PMBUS_V_OUT]           = ACCTON_PMBUS_REG(0x8b, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_I_OUT]           = ACCTON_PMBUS_REG(0x8c, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_P_OUT]           = ACCTON_PMBUS_REG(0x96, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_TEMP]            = ACCTON_PMBUS_REG(0x8d, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_FAN_SPEED]       = ACCTON_PMBUS_REG(0x90, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_FAN_DUTY_CYCLE]  = ACCTON_PMBUS_REG(0x3b, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_FAN_DIR]         = ACCTON_PMBUS_BLOCK_REG(0xc3, 4, 0),
+    [AS7716_32XB_PMBUS_PMBUS_REVISION]  = ACCTON_PMBUS_REG(0x98, ACCTON_PMBUS_BYTE, 0),
+    [AS7716_32XB_PMBUS_MFR_ID]          = ACCTON_PMBUS_BLOCK_REG(0x99, 10, 0),
+    [AS7716_32XB_PMBUS_MFR_MODEL]       = ACCTON_PMBUS_BLOCK_REG(0x9a, 10, 0),
+    [AS7716_32XB_PMBUS_MFR_REVISION]    = ACCTON_PMBUS_BLOCK_REG(0x9b, 3, 0),
+    [AS7716_32XB_PMBUS_MFR_VIN_MIN]     = ACCTON_PMBUS_REG(0xa0, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_VIN_MAX]     = ACCTON_PMBUS_REG(0xa1, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_VOUT_MIN]    = ACCTON_PMBUS_REG(0xa4, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_VOUT_MAX]    = ACCTON_PMBUS_REG(0xa5, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_IIN_MAX]     = ACCTON_PMBUS_REG(0xa2, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_IOUT_MAX]    = ACCTON_PMBUS_REG(0xa6, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_PIN_MAX]     = ACCTON_PMBUS_REG(0xa3, ACCTON_PMBUS_WORD, 0),
+    [AS7716_32XB_PMBUS_MFR_POUT_MAX]    = ACCTON_PMBUS_REG(0xa7, ACCTON_PMBUS_WORD, 0),
+};
+
 /* Each client has this additional data 
  */
 struct as7716_32xb_pmbus_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
     u8  index;
-    u8   capability; 
-    u16  status_word;
-    u8   fan_fault;
-    u8   over_temp;
-    u16  v_out;
-    u16  i_out;
-    u16  p_out;
-    u16  temp;
-    u16  fan_speed;
-    u16  fan_duty_cycle;
-    u8   fan_dir[4];
-    u8   pmbus_revision;
-    u8   mfr_id[10];     
-    u8   mfr_model[10];
-    u8   mfr_revision[3];
-    u16  mfr_vin_min;
-    u16  mfr_vin_max;
-    u16  mfr_iin_max;
-    u16  mfr_iout_max;
-    u16  mfr_pin_max;
-    u16  mfr_pout_max;
-    u16  mfr_vout_min;
-    u16  mfr_vout_max;
-    u16  power_on;
-    u16  temp_fault;
-    u16  power_good;
+    struct accton_pmbus_telemetry pmbus;
 };
 
-
-
 enum as7716_32xb_pmbus_sysfs_attributes {
     PSU_POWER_ON = 0,
     PSU_TEMP_FAULT,
@@ -81,6 +117,35 @@ enum as7716_32xb_pmbus_sysfs_attributes {
     PSU_MFR_POUT_MAX
 };
 
+/* Value each attribute shows, psu_p_out and power1_input in different units */
+static const int as7716_32xb_pmbus_attr_reg[] = {
+    [PSU_POWER_ON]        = AS7716_32XB_PMBUS_POWER_ON,
+    [PSU_TEMP_FAULT]      = AS7716_32XB_PMBUS_TEMP_FAULT,
+    [PSU_POWER_GOOD]      = AS7716_32XB_PMBUS_POWER_GOOD,
+    [PSU_FAN1_FAULT]      = AS7716_32XB_PMBUS_FAN_FAULT,
+    [PSU_FAN_DIRECTION]   = AS7716_32XB_PMBUS_FAN_DIR,
+    [PSU_OVER_TEMP]       = AS7716_32XB_PMBUS_OVER_TEMP,
+    [PSU_V_OUT]           = AS7716_32XB_PMBUS_V_OUT,
+    [PSU_I_OUT]           = AS7716_32XB_PMBUS_I_OUT,
+    [PSU_P_OUT]           = AS7716_32XB_PMBUS_P_OUT,
+    [PSU_P_OUT_UV]        = AS7716_32XB_PMBUS_P_OUT,
+    [PSU_TEMP1_INPUT]     = AS7716_32XB_PMBUS_TEMP,
+    [PSU_FAN1_SPEED]      = AS7716_32XB_PMBUS_FAN_SPEED,
+    [PSU_FAN1_DUTY_CYCLE] = AS7716_32XB_PMBUS_FAN_DUTY_CYCLE,
+    [PSU_PMBUS_REVISION]  = AS7716_32XB_PMBUS_PMBUS_REVISION,
+    [PSU_MFR_ID]          = AS7716_32XB_PMBUS_MFR_ID,
+    [PSU_MFR_MODEL]       = AS7716_32XB_PMBUS_MFR_MODEL,
+    [PSU_MFR_REVISION]    = AS7716_32XB_PMBUS_MFR_REVISION,
+    [PSU_MFR_VIN_MIN]     = AS7716_32XB_PMBUS_MFR_VIN_MIN,
+    [PSU_MFR_VIN_MAX]     = AS7716_32XB_PMBUS_MFR_VIN_MAX,
+    [PSU_MFR_VOUT_MIN]    = AS7716_32XB_PMBUS_MFR_VOUT_MIN,
+    [PSU_MFR_VOUT_MAX]    = AS7716_32XB_PMBUS_MFR_VOUT_MAX,
+    [PSU_MFR_IIN_MAX]     = AS7716_32XB_PMBUS_MFR_IIN_MAX,
+    [PSU_MFR_IOUT_MAX]    = AS7716_32XB_PMBUS_MFR_IOUT_MAX,
+    [PSU_MFR_PIN_MAX]     = AS7716_32XB_PMBUS_MFR_PIN_MAX,
+    [PSU_MFR_POUT_MAX]    = AS7716_32XB_PMBUS_MFR_POUT_MAX,
+};
+
 /* sysfs attributes for hwmon 
  */
 static ssize_t pmbus_info_show(struct device *dev, struct device_attribute *da,
@@ -159,89 +224,25 @@ static ssize_t pmbus_info_show(struct device *dev, struct device_attribute *da,
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
     struct i2c_client *client = to_i2c_client(dev);
     struct as7716_32xb_pmbus_data *data = i2c_get_clientdata(client);
+    int reg = as7716_32xb_pmbus_attr_reg[attr->index];
     int status = -EINVAL;
-    //printk("pmbus_info_show\n");
-    printk("attr->index=%d\n", attr->index);
+
     mutex_lock(&data->update_lock);
     switch (attr->index)
     {
-        case PSU_POWER_ON:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->power_on);
-            break;
-        case PSU_TEMP_FAULT:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->temp_fault);
-            break;
-        case PSU_POWER_GOOD:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->power_good);
-            break;
-        case PSU_FAN1_FAULT:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->fan_fault);
-            break;
-        case PSU_FAN_DIRECTION:
-            status=snprintf(buf, PAGE_SIZE-1, "%s\r\n", data->fan_dir);
-            break;
-        case PSU_OVER_TEMP:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->over_temp);
-            break;
-        case PSU_V_OUT:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->v_out);
-            break;
-        case PSU_I_OUT:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->i_out);
-            break;        
-        case PSU_P_OUT:
-            printk("read PSU_P_OUT\n");
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->p_out);
-            break;
-        case PSU_P_OUT_UV:
-            printk("read PSU_P_OUT_UV\n");
-            status=snprintf(buf, PAGE_SIZE-1, "%ld\r\n", data->p_out * 1000000);
-            break;
-        case PSU_TEMP1_INPUT:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->temp);
-            break;
-        case PSU_FAN1_SPEED: 
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->fan_speed);
-            break;
-        case PSU_FAN1_DUTY_CYCLE:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->fan_duty_cycle);
-            break;
         case PSU_PMBUS_REVISION:
             break;
+        case PSU_FAN_DIRECTION:
         case PSU_MFR_ID:
-            status=snprintf(buf, PAGE_SIZE-1, "%s\r\n", data->mfr_id);
-            break;
         case PSU_MFR_MODEL:
-            status=snprintf(buf, PAGE_SIZE-1, "%s\r\n", data->mfr_model);
-            break;
         case PSU_MFR_REVISION:
-            status=snprintf(buf, PAGE_SIZE-1, "%s\r\n", data->mfr_revision);
-            break;
-        case PSU_MFR_VIN_MIN:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_vin_min);
+            status=snprintf(buf, PAGE_SIZE-1, "%s\r\n", accton_pmbus_block(&data->pmbus, reg));
             break;
-        case PSU_MFR_VIN_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_vin_max);
-            break;
-        case PSU_MFR_VOUT_MIN:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_vin_max);
-            break;
-        case PSU_MFR_VOUT_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_vout_max);
-            break;
-        case PSU_MFR_IIN_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_iin_max);
-            break;
-        case PSU_MFR_IOUT_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_iout_max);
-            break;
-        case PSU_MFR_PIN_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_pin_max);
-            break;
-        case PSU_MFR_POUT_MAX:
-            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", data->mfr_pout_max);
+        case PSU_P_OUT_UV:
+            status=snprintf(buf, PAGE_SIZE-1, "%ld\r\n", accton_pmbus_word(&data->pmbus, reg) * 1000000L);
             break;
         default :
+            status=snprintf(buf, PAGE_SIZE-1, "%d\r\n", accton_pmbus_word(&data->pmbus, reg));
             break;
     }
     mutex_unlock(&data->update_lock);
@@ -254,90 +255,26 @@ static ssize_t pmbus_info_store(struct device *dev, struct device_attribute *da,
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
     struct i2c_client *client = to_i2c_client(dev);
     struct as7716_32xb_pmbus_data *data = i2c_get_clientdata(client);
+    int reg = as7716_32xb_pmbus_attr_reg[attr->index];
     long keyin = 0;
     int status = -EINVAL;
-    //printk("pmbus_info_store\n");
-    //printk("attr->index=%d\n", attr->index);
+
     mutex_lock(&data->update_lock);
     status = kstrtol(buf, STRING_TO_DEC_VALUE, &keyin);
     switch (attr->index)
     {
-        case PSU_POWER_ON:
-            data->power_on=keyin;
-            break;
-        case PSU_TEMP_FAULT: 
-            data->temp_fault=keyin;
-            break;
-        case PSU_POWER_GOOD:
-            data->power_good=keyin;
-            break;
         case PSU_FAN1_FAULT:
-            break;
-        case PSU_FAN_DIRECTION:
-            memcpy(data->fan_dir, buf, sizeof(data->fan_dir));
-            break;
-        case PSU_OVER_TEMP:
-            data->over_temp=keyin;
-            break;
-        case PSU_V_OUT:
-            data->v_out=keyin;
-            break;
-        case PSU_I_OUT:
-            data->i_out=keyin;
-            break;        
-        case PSU_P_OUT:
-            printk("data->p_out=%d\n", data->p_out);
-            data->p_out=keyin;
-            break;
         case PSU_P_OUT_UV:
-            //multiplier = 1000000;  /*For lm-sensors, unit is micro-Volt.*/
-            
-            break;
-        case PSU_TEMP1_INPUT:
-            data->temp=keyin;
-            break;
-        case PSU_FAN1_SPEED:
-            data->fan_speed=keyin;
-            break;
         case PSU_FAN1_DUTY_CYCLE:
             break;
-        case PSU_PMBUS_REVISION:
-            data->pmbus_revision=keyin;
-            break;
+        case PSU_FAN_DIRECTION:
         case PSU_MFR_ID:
-            memcpy(data->mfr_id, buf, sizeof(data->mfr_id));
-            break;
         case PSU_MFR_MODEL:
-            memcpy(data->mfr_model, buf, sizeof(data->mfr_model));
-            break;
         case PSU_MFR_REVISION:
-            memcpy(data->mfr_revision, buf, sizeof(data->mfr_revision));
-            break;
-        case PSU_MFR_VIN_MIN:
-            data->mfr_vin_min=keyin;
-            break;
-        case PSU_MFR_VIN_MAX:
-            data->mfr_vin_max=keyin;
-            break;
-        case PSU_MFR_VOUT_MIN:
-            data->mfr_vout_min=keyin;
-            break;
-        case PSU_MFR_VOUT_MAX:
-            data->mfr_vout_max=keyin;
-            break;
-        case PSU_MFR_IIN_MAX:
-            data->mfr_iin_max=keyin;
-            break;
-        case PSU_MFR_IOUT_MAX:
-            data->mfr_iout_max=keyin;
-            break;
-        case PSU_MFR_PIN_MAX:
-            data->mfr_pin_max=keyin;
-            break;
-        case PSU_MFR_POUT_MAX:
-            data->mfr_pout_max=keyin;
+            accton_pmbus_store_block(&data->pmbus, reg, buf, count);
             break;
         default :
+            accton_pmbus_store(&data->pmbus, reg, keyin);
             break;
     }
     mutex_unlock(&data->update_lock);
@@ -353,7 +290,7 @@ static int as7716_32xb_pmbus_probe(struct i2c_client *client,
             const struct i2c_device_id *dev_id)
 {
     struct as7716_32xb_pmbus_data *data;
-    int status;
+    int status, i;
 
     data = kzalloc(sizeof(struct as7716_32xb_pmbus_data), GFP_KERNEL);
     if (!data) {
@@ -364,6 +301,17 @@ static int as7716_32xb_pmbus_probe(struct i2c_client *client,
     data->index = dev_id->driver_data;
     mutex_init(&data->update_lock);
 
+    status = accton_pmbus_init(&data->pmbus, client, as7716_32xb_pmbus_regs,
+                               AS7716_32XB_PMBUS_REG_COUNT, group_interval_ms);
+    if (status) {
+        goto exit_free;
+    }
+
+    /* All 0 until stored, never read from the bus */
+    for (i = 0; i < AS7716_32XB_PMBUS_REG_COUNT; i++) {
+        accton_pmbus_store(&data->pmbus, i, 0);
+    }
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -386,6 +334,7 @@ static int as7716_32xb_pmbus_probe(struct i2c_client *client,
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_pmbus_group);
 exit_free:
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
 exit:
     
@@ -398,6 +347,7 @@ static int as7716_32xb_pmbus_remove(struct i2c_client *client)
 
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_pmbus_group);
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
     
     return 0;
@@ -421,6 +371,26 @@ static struct i2c_driver as7716_32xb_pmbus_driver = {
     .address_list = normal_i2c,
 };
 
+/* Called by the IPMI client, which holds the device lock of @client */
+int as7716_32xb_pmbus_set_sensors(struct i2c_client *client, int temp,
+            int fan_speed, int p_out)
+{
+    struct as7716_32xb_pmbus_data *data;
+
+    if (client->dev.driver != &as7716_32xb_pmbus_driver.driver)
+        return -ENODEV;
+
+    data = i2c_get_clientdata(client);
+    mutex_lock(&data->update_lock);
+    accton_pmbus_store(&data->pmbus, AS7716_32XB_PMBUS_TEMP, temp);
+    accton_pmbus_store(&data->pmbus, AS7716_32XB_PMBUS_FAN_SPEED, fan_speed);
+    accton_pmbus_store(&data->pmbus, AS7716_32XB_PMBUS_P_OUT, p_out);
+    mutex_unlock(&data->update_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_pmbus_set_sensors);
+
 
 
 
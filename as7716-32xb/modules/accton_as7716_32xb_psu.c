@@ -33,6 +33,7 @@
 #include <linux/slab.h>
 #include <linux/delay.h>
 #include <linux/dmi.h>
+#include "accton_i2c_trace.h"
 
 #define MAX_MODEL_NAME          16
 #define DC12V_FAN_DIR_OFFSET    0x34
@@ -60,6 +61,7 @@ struct as7716_32xb_psu_data {
     u8  power_good;
     char model_name[MAX_MODEL_NAME+1]; /* Model name, read from eeprom */
     char fan_dir[DC12V_FAN_DIR_LEN+1]; /* DC12V fan direction */
+    struct accton_i2c_trace i2c_trace;
 };
 
 enum as7716_32xb_psu_sysfs_attributes {
@@ -207,6 +209,8 @@ static int as7716_32xb_psu_probe(struct i2c_client *client,
 
     dev_info(&client->dev, "%s: psu '%s'\n",
          dev_name(data->hwmon_dev), client->name);
+
+    accton_i2c_trace_add(&data->i2c_trace, client);
     
     return 0;
 
@@ -223,6 +227,7 @@ static int as7716_32xb_psu_remove(struct i2c_client *client)
 {
     struct as7716_32xb_psu_data *data = i2c_get_clientdata(client);
 
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7716_32xb_psu_group);
     kfree(data);
@@ -254,16 +259,38 @@ static struct i2c_driver as7716_32xb_psu_driver = {
     .address_list = normal_i2c,
 };
 
+/* Called by the IPMI client, which holds the device lock of @client */
+int as7716_32xb_psu_set_status(struct i2c_client *client, int present,
+            int power_good)
+{
+    struct as7716_32xb_psu_data *data;
+
+    if (client->dev.driver != &as7716_32xb_psu_driver.driver)
+        return -ENODEV;
+
+    data = i2c_get_clientdata(client);
+    mutex_lock(&data->update_lock);
+    data->present = !!present;
+    data->power_good = !!power_good;
+    mutex_unlock(&data->update_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_psu_set_status);
+
 static int as7716_32xb_psu_read_block(struct i2c_client *client, u8 command, u8 *data,
               int data_len)
 {
+    struct as7716_32xb_psu_data *psu = i2c_get_clientdata(client);
     int result = 0;
     int retry_count = 5;
 	
 	while (retry_count) {
 	    retry_count--;
 	
-	    result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
+	    result = accton_i2c_traced(&psu->i2c_trace, client,
+	                I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+	                i2c_smbus_read_i2c_block_data(client, command, data_len, data));
 		
 		if (unlikely(result < 0)) {
 		    msleep(10);
@@ -31,6 +31,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_i2c_trace.h"
 
 #define BIT_INDEX(i) (1UL << (i))
 #define I2C_ADDR_CPLD1	0x60
@@ -55,6 +56,7 @@ struct as7716_32x_sfp_data {
 	int					port;			 /* Front port index */
 	char				eeprom[256];	 /* eeprom data */
 	u32					is_present;		 /* present status */
+	struct accton_i2c_trace i2c_trace;
 };
 
 static struct as7716_32x_sfp_data *as7716_32x_sfp_update_device(struct device *dev);
@@ -63,6 +65,7 @@ static ssize_t show_present(struct device *dev, struct device_attribute *da,char
 static ssize_t show_eeprom(struct device *dev, struct device_attribute *da, char *buf);
 extern int accton_i2c_cpld_read(unsigned short cpld_addr, u8 reg);
 extern int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
+extern int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg, u8 *values, u8 len);
 
 enum as7716_32x_sfp_sysfs_attributes {
 	SFP_PORT_NUMBER,
@@ -114,21 +117,22 @@ static ssize_t show_present(struct device *dev, struct device_attribute *da,
 	struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
 
 	if(attr->index == SFP_IS_PRESENT_ALL) {
+		u8 raw[4];
 		int values[4];
+		int i, status;
 		/*
 		 * Report the SFP_PRESENCE status for all ports.
+		 * QSFP_PRESENT Ports 1-32 are in PRESET1~PRESET4, read them at once.
 		 */
+		status = accton_i2c_cpld_read_block(I2C_ADDR_CPLD1, CPLD1_OFFSET_QSFP_PRESET1,
+						    raw, ARRAY_SIZE(raw));
+		if (status < 0) {
+			return sprintf(buf, "READ ERROR\n");
+		}
+		for (i = 0; i < ARRAY_SIZE(values); i++) {
+			values[i] = ~raw[i] & 0xFF; /* as VALIDATED_READ did */
+		}
 
-		/* QSFP_PRESENT Ports 1-8 */
-		//VALIDATED_READ(buf, values[0], accton_i2c_cpld_read(0x62, 0x9), 1);
-		VALIDATED_READ(buf, values[0], accton_i2c_cpld_read(I2C_ADDR_CPLD1, CPLD1_OFFSET_QSFP_PRESET1), 1);
-		/* QSFP_PRESENT Ports 9-16 */
-		VALIDATED_READ(buf, values[1], accton_i2c_cpld_read(I2C_ADDR_CPLD1, CPLD1_OFFSET_QSFP_PRESET2), 1);
-		/* QSFP_PRESENT Ports 17-24 */
-		VALIDATED_READ(buf, values[2], accton_i2c_cpld_read(I2C_ADDR_CPLD1, CPLD1_OFFSET_QSFP_PRESET3), 1);
-		/* QSFP_PRESENT Ports 25-32 */
-		VALIDATED_READ(buf, values[3], accton_i2c_cpld_read(I2C_ADDR_CPLD1, CPLD1_OFFSET_QSFP_PRESET4), 1);
-		
 		/* Return values 1 -> 32 in order */
 		return sprintf(buf, "%.2x %.2x %.2x %.2x\n",
 					   values[0], values[1], values[2], values[3]);
@@ -205,6 +209,8 @@ static int as7716_32x_sfp_probe(struct i2c_client *client,
 	dev_info(&client->dev, "%s: sfp '%s'\n",
 		 dev_name(data->hwmon_dev), client->name);
 
+	accton_i2c_trace_add(&data->i2c_trace, client);
+
 	return 0;
 
 exit_remove:
@@ -220,6 +226,7 @@ static int as7716_32x_sfp_remove(struct i2c_client *client)
 {
 	struct as7716_32x_sfp_data *data = i2c_get_clientdata(client);
 
+	accton_i2c_trace_remove(&data->i2c_trace);
 	hwmon_device_unregister(data->hwmon_dev);
 	sysfs_remove_group(&client->dev.kobj, &as7716_32x_sfp_group);
 	kfree(data);
@@ -273,7 +280,10 @@ static struct i2c_driver as7716_32x_sfp_driver = {
 static int as7716_32x_sfp_read_block(struct i2c_client *client, u8 command, u8 *data,
 			  int data_len)
 {
-	int result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
+	struct as7716_32x_sfp_data *sfp = i2c_get_clientdata(client);
+	int result = accton_i2c_traced(&sfp->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA, command, data_len,
+			i2c_smbus_read_i2c_block_data(client, command, data_len, data));
 
 	if (unlikely(result < 0))
 		goto abort;
@@ -220,6 +220,26 @@ static struct i2c_driver as7716_32xb_sys_driver = {
     .address_list = normal_i2c,
 };
 
+/* Called by the IPMI client, which holds the device lock of @client */
+int as7716_32xb_sys_set_eeprom(struct i2c_client *client, const u8 *eeprom,
+            size_t len)
+{
+    struct as7716_32xb_sys_data *data;
+
+    if (client->dev.driver != &as7716_32xb_sys_driver.driver)
+        return -ENODEV;
+
+    data = i2c_get_clientdata(client);
+    len = min_t(size_t, len, EEPROM_DATA_SIZE);
+    mutex_lock(&data->lock);
+    memset(data->eeprom, 0xFF, EEPROM_DATA_SIZE);
+    memcpy(data->eeprom, eeprom, len);
+    mutex_unlock(&data->lock);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_sys_set_eeprom);
+
 
 
 
@@ -191,6 +191,23 @@ static struct i2c_driver as7716_32xb_thermal_driver = {
     .address_list = normal_i2c,
 };
 
+/* Called by the IPMI client, which holds the device lock of @client */
+int as7716_32xb_thermal_set_temp(struct i2c_client *client, int temp)
+{
+    struct as7716_32xb_thermal_data *data;
+
+    if (client->dev.driver != &as7716_32xb_thermal_driver.driver)
+        return -ENODEV;
+
+    data = i2c_get_clientdata(client);
+    mutex_lock(&data->update_lock);
+    data->temp1_input = temp;
+    mutex_unlock(&data->update_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL(as7716_32xb_thermal_set_temp);
+
 
 
 
@@ -33,6 +33,7 @@ try:
     import time  # this is only being used as part of the example
     import traceback
     import commands
+    import binascii
     from tabulate import tabulate    
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
@@ -80,6 +81,8 @@ class accton_as7716xb_drv_handler(object):
     QSFP_RESET_PATH = "/sys/bus/i2c/devices/0-0060/module_reset_"
     QSFP_PRESENT_FILE = "/tmp/ipmi_qsfp_pres"
     QSFP_EEPROM_FILE = "/tmp/ipmi_qsfp_ee_"
+    QSFP_EEPROM_SIZE = 256
+    QSFP_PAGE_SIZE = 128
     THERMAL_FILE = "/tmp/ipmi_thermal"    
     IPMI_CMD_QSFP = "ipmitool raw 0x34 0x10 "
     IPMI_CMD_THERMAL = "ipmitool raw 0x34 0x12 "
@@ -101,6 +104,8 @@ class accton_as7716xb_drv_handler(object):
     SYS_EEPROM_FILE_1 = "/tmp/ipmi_sys_eeprom_1"
     SYS_EEPROM_FILE_2 = "/tmp/ipmi_sys_eeprom_2"
     SYS_EEPROM_PATH = "/sys/bus/i2c/devices/0-0056/eeprom"
+    IPMI_DRV_PATH = "/sys/module/accton_as7716_32xb_ipmi"
+    IPMI_DEV_PATH = "/sys/bus/platform/drivers/as7716_32xb_ipmi/as7716_32xb_ipmi"
     
 
     def __init__(self, log_file, log_level):
@@ -123,6 +128,32 @@ class accton_as7716xb_drv_handler(object):
             logging.getLogger('').addHandler(console)
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
+        self.qsfp_eeprom = {}
+
+    def set_qsfp_eeprom(self, port, image):
+        # Only the pages that changed since the last push are written,
+        # in a single write so that readers never see half an update.
+        last = self.qsfp_eeprom.get(port)
+        size = self.QSFP_PAGE_SIZE
+        changed = [off for off in range(0, len(image), size)
+                   if last is None or image[off:off+size] != last[off:off+size]]
+        if not changed:
+            return True
+        start = changed[0]
+        end = changed[-1] + size
+        path = self.BASE_I2C_PATH + "0-00%02d/eeprom" % port
+        try:
+            fd = os.open(path, os.O_WRONLY)
+            try:
+                os.lseek(fd, start, os.SEEK_SET)
+                os.write(fd, image[start:end])
+            finally:
+                os.close(fd)
+        except OSError as e:
+            logging.info('Failed to write %s: %s', path, str(e))
+            return False
+        self.qsfp_eeprom[port] = image
+        return True
 
     def manage_ipmi_qsfp(self):        
         logging.debug ("drv hanlder-manage_ipmi_qsfp")
@@ -185,21 +216,17 @@ class accton_as7716xb_drv_handler(object):
                     str_line+=line.rstrip().replace(" ","")
                 check_file.close()
                 #Set QSFP EEPROM
-                if(i < 10):
-                    set_drv_cmd = "echo " + str_line+ " > " + self.BASE_I2C_PATH + "0-000"+str(i) +"/eeprom"
-                else:
-                    set_drv_cmd = "echo " + str_line+ " > " + self.BASE_I2C_PATH + "0-00"+str(i) +"/eeprom"
-                #print(set_drv_cmd)
-                log_os_system(set_drv_cmd, 0)
+                try:
+                    image = binascii.unhexlify(str_line[:self.QSFP_EEPROM_SIZE*2])
+                except TypeError as e:
+                    logging.info('Bad EEPROM of port %d: %s', i, str(e))
+                    continue
+                if len(image) == self.QSFP_EEPROM_SIZE:
+                    self.set_qsfp_eeprom(i, image)
             else:
                 ipmi_cmd = "echo 0 > " + self.QSFP_PRESENT_PATH + str(i)
                 log_os_system(ipmi_cmd, 0)
-                if(i < 10):
-                    set_drv_cmd = "echo 0 > " + self.BASE_I2C_PATH + "0-000"+str(i) +"/eeprom"
-                else:
-                    set_drv_cmd = "echo 0 > " + self.BASE_I2C_PATH + "0-00"+str(i) +"/eeprom"
-                #print(set_drv_cmd)
-                log_os_system(set_drv_cmd, 0)
+                self.set_qsfp_eeprom(i, '\xff' * self.QSFP_EEPROM_SIZE)
                 
             time.sleep(0.01) 
         return True
@@ -421,7 +448,16 @@ def main(argv):
     set_drv_cmd = "echo 100 > /sys/module/ipmi_si/parameters/kipmid_max_busy_us"
     log_os_system(set_drv_cmd, 0) 
     monitor = accton_as7716xb_drv_handler(log_file, log_level)
-   
+
+    # The accton_as7716_32xb_ipmi driver talks to the BMC itself once its
+    # device is bound; loaded but unbound, its probe failed and nothing
+    # would feed the drivers.
+    if os.path.exists(monitor.IPMI_DEV_PATH):
+        logging.info('accton_as7716_32xb_ipmi is bound, nothing to do')
+        return 0
+    if os.path.exists(monitor.IPMI_DRV_PATH):
+        logging.warning('accton_as7716_32xb_ipmi is loaded but not bound, polling the BMC here')
+
     set_sys_eeprom=0
     thermal_chk_time=0
     psu_chk_time=0
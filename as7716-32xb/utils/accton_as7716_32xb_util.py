@@ -263,7 +263,8 @@ kos = [
 'modprobe accton_as7716_32xb_oom',
 'modprobe accton_as7716_32xb_thermal',
 'modprobe accton_as7716_32xb_pmbus',
-'modprobe accton_as7716_32xb_sys']
+'modprobe accton_as7716_32xb_sys',
+'modprobe accton_as7716_32xb_ipmi']
 
 def driver_install():
     global FORCE
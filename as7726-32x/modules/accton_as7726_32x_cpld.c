@@ -33,9 +33,8 @@
 #include <linux/stat.h>
 #include <linux/hwmon-sysfs.h>
 #include <linux/delay.h>
-
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 static LIST_HEAD(cpld_client_list);
 static struct mutex     list_lock;
@@ -55,6 +54,8 @@ struct as7726_32x_cpld_data {
     enum cpld_type   type;
     struct device   *hwmon_dev;
     struct mutex     update_lock;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 static const struct i2c_device_id as7726_32x_cpld_id[] = {
@@ -166,6 +167,8 @@ static ssize_t access(struct device *dev, struct device_attribute *da,
 static ssize_t show_version(struct device *dev, struct device_attribute *da,
              char *buf);
 static int as7726_32x_cpld_read_internal(struct i2c_client *client, u8 reg);
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf);
 static int as7726_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value);
 
 /* transceiver attributes */
@@ -263,6 +266,8 @@ DECLARE_TRANSCEIVER_RESET_SENSOR_DEVICE_ATTR(30);
 DECLARE_TRANSCEIVER_RESET_SENSOR_DEVICE_ATTR(31);
 DECLARE_TRANSCEIVER_RESET_SENSOR_DEVICE_ATTR(32);
 
+static DEVICE_ATTR(i2c_stats, S_IRUGO, show_i2c_stats, NULL);
+
 static struct attribute *as7726_32x_cpld1_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
@@ -336,6 +341,7 @@ static struct attribute *as7726_32x_cpld1_attributes[] = {
     DECLARE_TRANSCEIVER_RESET_ATTR(30),
     DECLARE_TRANSCEIVER_RESET_ATTR(31),
     DECLARE_TRANSCEIVER_RESET_ATTR(32),
+    &dev_attr_i2c_stats.attr,
     NULL
 };
 
@@ -346,6 +352,7 @@ static const struct attribute_group as7726_32x_cpld1_group = {
 static struct attribute *as7726_32x_cpld2_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -356,6 +363,7 @@ static const struct attribute_group as7726_32x_cpld2_group = {
 static struct attribute *as7726_32x_cpld3_attributes[] = {
     &sensor_dev_attr_version.dev_attr.attr,
     &sensor_dev_attr_access.dev_attr.attr,	
+	&dev_attr_i2c_stats.attr,
 	NULL
 };
 
@@ -710,8 +718,11 @@ static ssize_t show_version(struct device *dev, struct device_attribute *attr, c
 {
     int val = 0;
     struct i2c_client *client = to_i2c_client(dev);
+    struct as7726_32x_cpld_data *data = i2c_get_clientdata(client);
 	
-	val = i2c_smbus_read_byte_data(client, 0x1);
+	val = accton_i2c_traced(&data->i2c_trace, client,
+			I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, 0x1, 1,
+			i2c_smbus_read_byte_data(client, 0x1));
 
     if (val < 0) {
         dev_dbg(&client->dev, "cpld(0x%x) reg(0x1) err %d\n", client->addr, val);
@@ -766,6 +777,7 @@ static int as7726_32x_cpld_probe(struct i2c_client *client,
         }
     }
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
     as7726_32x_cpld_add_client(client);
     return 0;
 
@@ -781,6 +793,7 @@ static int as7726_32x_cpld_remove(struct i2c_client *client)
     const struct attribute_group *group = NULL;
 
     as7726_32x_cpld_remove_client(client);
+    accton_i2c_trace_remove(&data->i2c_trace);
 
     /* Remove sysfs hooks */
     switch (data->type) {
@@ -806,48 +819,33 @@ static int as7726_32x_cpld_remove(struct i2c_client *client)
     return 0;
 }
 
-static int as7726_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+static ssize_t show_i2c_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
+	struct i2c_client *client = to_i2c_client(dev);
+	struct as7726_32x_cpld_data *data = i2c_get_clientdata(client);
 
-	while (retry) {
-		status = i2c_smbus_read_byte_data(client, reg);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
+	return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
 
-		break;
-	}
+static int as7726_32x_cpld_read_internal(struct i2c_client *client, u8 reg)
+{
+	struct as7726_32x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7726_32x_cpld_write_internal(struct i2c_client *client, u8 reg, u8 value)
 {
-	int status = 0, retry = I2C_RW_RETRY_COUNT;
-    //printk("%s, acc , reg=0x%x, vale=0x%x\n", __FUNCTION__, reg, value);
-
-	//if(reg==0x41)
-//{
-	  //printk("testing, return 0 for reg=0x%x\n", reg); 	
-	 // return 0;
-	//}
-	//else
-	  //printk("reg=0x%x\n",reg);
-	while (retry) {
-		status = i2c_smbus_write_byte_data(client, reg, value);
-		if (unlikely(status < 0)) {
-			msleep(I2C_RW_RETRY_INTERVAL);
-			retry--;
-			continue;
-		}
-
-		break;
-	}
+	struct as7726_32x_cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+	return accton_i2c_retry(&data->i2c_stats,
+			accton_i2c_traced(&data->i2c_trace, client,
+				I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+				i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 int as7726_32x_cpld_read(unsigned short cpld_addr, u8 reg)
@@ -0,0 +1,133 @@
+/*
+ * Board driver for accton as7726_32x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "as7726_32x_platform"
+
+/* The layout accton_as7726_32x_util.py used to build from user space */
+static const struct accton_i2c_mux muxes[] = {
+	{  0, 0x77,  1 },
+	{  1, 0x76,  9 },
+	{  1, 0x72, 17 },
+	{  1, 0x73, 25 },
+	{  1, 0x74, 33 },
+	{  1, 0x75, 41 },
+	{  2, 0x71, 49 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{  0, "24c02",            0x56 },
+	{ 11, "as7726_32x_cpld1", 0x60 },
+	{ 12, "as7726_32x_cpld2", 0x62 },
+	{ 13, "as7726_32x_cpld3", 0x64 },
+	{ 54, "as7726_32x_fan",   0x66 },
+	{ 54, "lm75",             0x4c },
+	{ 55, "lm75",             0x48 },
+	{ 55, "lm75",             0x49 },
+	{ 55, "lm75",             0x4a },
+	{ 55, "lm75",             0x4b },
+	{ 50, "as7726_32x_psu1",  0x53 },
+	{ 50, "ym2651",           0x5b },
+	{ 49, "as7726_32x_psu2",  0x50 },
+	{ 49, "ym2651",           0x58 },
+};
+
+/* Bus of port 1 to port 34 */
+static const u8 sfp_bus[] = {
+	21, 22, 23, 24, 26, 25, 28, 27, 17, 18, 19, 20, 29, 30, 31, 32,
+	33, 34, 35, 36, 45, 46, 47, 48, 37, 38, 39, 40, 41, 42, 43, 44,
+	15, 16
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, ARRAY_SIZE(sfp_bus), "optoe1" },
+};
+
+static const struct accton_i2c_board_desc as7726_32x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int as7726_32x_platform_probe(struct platform_device *pdev)
+{
+	return accton_i2c_board_probe(pdev, &as7726_32x_board);
+}
+
+static int as7726_32x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver as7726_32x_platform_driver = {
+	.probe		= as7726_32x_platform_probe,
+	.remove		= as7726_32x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init as7726_32x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&as7726_32x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&as7726_32x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit as7726_32x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&as7726_32x_platform_driver);
+}
+
+module_init(as7726_32x_platform_init);
+module_exit(as7726_32x_platform_exit);
+
+MODULE_DESCRIPTION("as7726_32x board driver");
+MODULE_LICENSE("GPL");
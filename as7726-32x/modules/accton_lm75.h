@@ -0,0 +1 @@
+../../common/modules/accton_lm75.h
\ No newline at end of file
@@ -126,6 +126,10 @@ class device_monitor(object):
         logging.getLogger('').addHandler(sys_handler)
 
         #logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
+
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
           
     def get_state_from_fan_policy(self, temp, policy):
         state=0
@@ -177,8 +181,8 @@ class device_monitor(object):
   
         fan_policy = fan_policy_f2b
         
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         fan_dir=fan.get_fan_dir(1)            
         if fan_dir == 1:
             fan_dri=1 #something wrong, set fan_dir to default val
@@ -0,0 +1 @@
+../../common/classes/sensorio.py
\ No newline at end of file
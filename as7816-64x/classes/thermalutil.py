@@ -28,6 +28,7 @@ try:
     import logging
     import glob
     from collections import namedtuple
+    from sensorio import SensorNodes
 except ImportError as e:
     raise ImportError('%s - required module not found' % str(e))
 
@@ -55,6 +56,7 @@ class ThermalUtil(object):
            }
 
     def __init__(self):
+        self._nodes = SensorNodes()
         thermal_path = self.BASE_VAL_PATH
 
         for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1):
@@ -68,26 +70,7 @@ class ThermalUtil(object):
             return None
 
         device_path = self.get_thermal_to_device_path(thermal_num)
-        for filename in glob.glob(device_path):
-            try:
-                val_file = open(filename, 'r')
-            except IOError as e:
-                logging.error('GET. unable to open file: %s', str(e))
-                return None
-
-        content = val_file.readline().rstrip()
-
-        if content == '':
-            logging.debug('GET. content is NULL. device_path:%s', device_path)
-            return None
-
-        try:
-            val_file.close()
-        except:
-            logging.debug('GET. unable to close file. device_path:%s', device_path)
-            return None
-      
-        return int(content)
+        return self._nodes.read_int(device_path)
 
 
     def get_num_thermals(self):
@@ -106,10 +89,9 @@ class ThermalUtil(object):
         return self._thermal_to_device_path_mapping[thermal_num]
 
     def get_thermal_temp(self):
-        sum = 0
-        for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1):
-            sum += self._get_thermal_node_val(x)
-        return (sum / self.get_num_thermals())
+        paths = [self.get_thermal_to_device_path(x)
+                 for x in range(self.THERMAL_NUM_1_IDX, self.THERMAL_NUM_ON_MAIN_BROAD+1)]
+        return (sum(self._nodes.read_many(paths)) / self.get_num_thermals())
 
 #def main():
 #    thermal = ThermalUtil()
@@ -29,13 +29,37 @@
 #include <linux/sysfs.h>
 #include <linux/slab.h>
 #include <linux/dmi.h>
+#include "accton_lm75.h"
+#include "accton_fan_governor.h"
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define DRVNAME "as7816_64x_fan"
 
+#define NUM_THERMAL_SENSORS     (6)     /* Average of this number of sensors */
+#define THERMAL_SENSORS_ADDRS   {0x48, 0x49, 0x4a, 0x4b, 0x4d, 0x4e}
+
+#define FAN_FAULT_DUTY_CYCLE    100
+
+/* Thermal governor, accton_as7816_monitor.py loads its policy and enables it */
+static bool governor = false;
+module_param(governor, bool, S_IRUGO);
+MODULE_PARM_DESC(governor, "Enable the fan governor at probe, without waiting for the monitor (default false)");
+
+static unsigned int governor_interval_ms = 10000;
+module_param(governor_interval_ms, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(governor_interval_ms, "Fan governor period in ms (default 10000)");
+
 static struct as7816_64x_fan_data *as7816_64x_fan_update_device(struct device *dev);                    
 static ssize_t fan_show_value(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
             const char *buf, size_t count);
+static ssize_t show_governor(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_governor(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count);
+static ssize_t show_policy(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_policy(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count);
 
 /* fan related data, the index should match sysfs_fan_attributes
  */
@@ -53,6 +77,22 @@ static const u8 fan_reg[] = {
     0x9B,       /* rear fan 4 speed(rpm) */
 };
 
+/* Same as accton_as7816_monitor.py for both directions, on the average of
+ * the LM75 sensors.
+ */
+static const struct accton_fan_policy default_policy[ACCTON_FAN_DIR_MAX] = {
+    [ACCTON_FAN_DIR_B2F] = { 5, { {52,  0,     43000},
+                                  {64,  43000, 46000},
+                                  {76,  46000, 52000},
+                                  {88,  52000, 57000},
+                                  {100, 57000, 0} } },
+    [ACCTON_FAN_DIR_F2B] = { 5, { {52,  0,     43000},
+                                  {64,  43000, 46000},
+                                  {76,  46000, 52000},
+                                  {88,  52000, 57000},
+                                  {100, 57000, 0} } },
+};
+
 /* Each client has this additional data */
 struct as7816_64x_fan_data {
     struct device   *hwmon_dev;
@@ -60,6 +100,10 @@ struct as7816_64x_fan_data {
     char             valid;           /* != 0 if registers are valid */
     unsigned long    last_updated;    /* In jiffies */
     u8               reg_val[ARRAY_SIZE(fan_reg)]; /* Register value */
+    struct accton_lm75_sensors lm75;
+    struct accton_i2c_stats i2c_stats;
+    struct accton_fan_governor governor;
+    struct accton_i2c_trace i2c_trace;
 };
 
 enum fan_id {
@@ -114,6 +158,15 @@ enum sysfs_fan_attributes {
 #define DECLARE_FAN_DUTY_CYCLE_ATTR(index) &sensor_dev_attr_fan_duty_cycle_percentage.dev_attr.attr, \
                                            &sensor_dev_attr_pwm##index.dev_attr.attr
 
+#define DECLARE_FAN_GOVERNOR_SENSOR_DEV_ATTR() \
+    static SENSOR_DEVICE_ATTR(governor_enable, S_IWUSR | S_IRUGO, show_governor, set_governor, 0);\
+    static SENSOR_DEVICE_ATTR(fan_policy_b2f, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_B2F);\
+    static SENSOR_DEVICE_ATTR(fan_policy_f2b, S_IWUSR | S_IRUGO, show_policy, set_policy, ACCTON_FAN_DIR_F2B)
+
+#define DECLARE_FAN_GOVERNOR_ATTR()  &sensor_dev_attr_governor_enable.dev_attr.attr, \
+                                     &sensor_dev_attr_fan_policy_b2f.dev_attr.attr, \
+                                     &sensor_dev_attr_fan_policy_f2b.dev_attr.attr
+
 
 #define DECLARE_FAN_PRESENT_SENSOR_DEV_ATTR(index) \
     static SENSOR_DEVICE_ATTR(fan##index##_present, S_IRUGO, fan_show_value, NULL, FAN##index##_PRESENT)
@@ -151,6 +204,8 @@ DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(3);
 DECLARE_FAN_DIRECTION_SENSOR_DEV_ATTR(4);
 /* 1 fan duty cycle attribute in this platform */
 DECLARE_FAN_DUTY_CYCLE_SENSOR_DEV_ATTR(1);
+/* Fan governor */
+DECLARE_FAN_GOVERNOR_SENSOR_DEV_ATTR();
 
 static struct attribute *as7816_64x_fan_attributes[] = {
     /* fan related attributes */
@@ -171,6 +226,7 @@ static struct attribute *as7816_64x_fan_attributes[] = {
     DECLARE_FAN_DIRECTION_ATTR(3),
     DECLARE_FAN_DIRECTION_ATTR(4),
     DECLARE_FAN_DUTY_CYCLE_ATTR(1),
+    DECLARE_FAN_GOVERNOR_ATTR(),
     NULL
 };
 
@@ -180,12 +236,22 @@ static struct attribute *as7816_64x_fan_attributes[] = {
 
 static int as7816_64x_fan_read_value(struct i2c_client *client, u8 reg)
 {
-    return i2c_smbus_read_byte_data(client, reg);
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_read_byte_data(client, reg)));
 }
 
 static int as7816_64x_fan_write_value(struct i2c_client *client, u8 reg, u8 value)
 {
-    return i2c_smbus_write_byte_data(client, reg, value);
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 /* fan utility functions
@@ -251,6 +317,12 @@ static u8 is_fan_fault(struct as7816_64x_fan_data *data, enum fan_id id)
     return ret;
 }
 
+static void write_duty_cycle(struct i2c_client *client, int duty_cycle)
+{
+    as7816_64x_fan_write_value(client, 0x28, 0); /* Disable fan speed watch dog */
+    as7816_64x_fan_write_value(client, fan_reg[FAN_DUTY_CYCLE_PERCENTAGE], duty_cycle_to_reg_val(duty_cycle));
+}
+
 static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
             const char *buf, size_t count) 
 {
@@ -264,11 +336,97 @@ static ssize_t set_duty_cycle(struct device *dev, struct device_attribute *da,
     if (value < 0 || value > FAN_MAX_DUTY_CYCLE)
         return -EINVAL;
 	
-    as7816_64x_fan_write_value(client, 0x28, 0); /* Disable fan speed watch dog */
-    as7816_64x_fan_write_value(client, fan_reg[FAN_DUTY_CYCLE_PERCENTAGE], duty_cycle_to_reg_val(value));
+    write_duty_cycle(client, value);
     return count;
 }
 
+static const unsigned short thermal_sensors_addrs[] = THERMAL_SENSORS_ADDRS;
+
+static int round_duty_cycle(int duty_cycle)
+{
+    return reg_val_to_duty_cycle(duty_cycle_to_reg_val(duty_cycle));
+}
+
+static int governor_read(struct device *dev, struct accton_fan_state *st)
+{
+    struct as7816_64x_fan_data *data = as7816_64x_fan_update_device(dev);
+    int i, found;
+
+    if (!data->valid)
+        return -EIO;
+
+    for (i = FAN1_ID; i <= FAN4_ID; i++) {
+        if (is_fan_fault(data, i))
+            st->fault = true;
+    }
+    st->dir = reg_val_to_direction(data->reg_val[FAN_DIRECTION_REG], FAN1_ID) ?
+              ACCTON_FAN_DIR_B2F : ACCTON_FAN_DIR_F2B;
+    st->duty_cycle = reg_val_to_duty_cycle(data->reg_val[FAN_DUTY_CYCLE_PERCENTAGE]);
+
+    found = accton_lm75_sum(&data->lm75, &st->temp_mc);
+    st->temp_valid = (found == NUM_THERMAL_SENSORS);
+    if (st->temp_valid)
+        st->temp_mc /= NUM_THERMAL_SENSORS;
+    else
+        dev_dbg(dev, "only %d of %d temps are found\n",
+                found, NUM_THERMAL_SENSORS);
+
+    return 0;
+}
+
+static int governor_set_duty_cycle(struct device *dev, int duty_cycle)
+{
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    write_duty_cycle(to_i2c_client(dev), duty_cycle);
+
+    mutex_lock(&data->update_lock);
+    data->valid = 0;    /* re-read the duty cycle next time */
+    mutex_unlock(&data->update_lock);
+    return 0;
+}
+
+static const struct accton_fan_governor_ops governor_ops = {
+    .read = governor_read,
+    .set_duty_cycle = governor_set_duty_cycle,
+    .round_duty_cycle = round_duty_cycle,
+};
+
+static ssize_t show_governor(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_fan_governor_show(&data->governor, buf);
+}
+
+static ssize_t set_governor(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count)
+{
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_fan_governor_store(&data->governor, buf, count);
+}
+
+static ssize_t show_policy(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_fan_policy_show(&data->governor, attr->index, buf);
+}
+
+static ssize_t set_policy(struct device *dev, struct device_attribute *da,
+            const char *buf, size_t count)
+{
+    struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
+    struct as7816_64x_fan_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_fan_policy_store(&data->governor, attr->index, buf, count,
+                                   FAN_MAX_DUTY_CYCLE);
+}
+
 static ssize_t fan_show_value(struct device *dev, struct device_attribute *da,
              char *buf)
 {
@@ -390,6 +548,14 @@ static int as7816_64x_fan_probe(struct i2c_client *client,
     data->valid = 0;
     mutex_init(&data->update_lock);
 
+    status = accton_lm75_init(&data->lm75, thermal_sensors_addrs, NUM_THERMAL_SENSORS);
+    if (status) {
+        goto exit_free;
+    }
+    accton_fan_governor_init(&data->governor, &client->dev, &governor_ops,
+                             default_policy, &governor_interval_ms,
+                             FAN_FAULT_DUTY_CYCLE, false);
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -406,12 +572,18 @@ static int as7816_64x_fan_probe(struct i2c_client *client,
 
     dev_info(&client->dev, "%s: fan '%s'\n",
          dev_name(data->hwmon_dev), client->name);
+
+    accton_i2c_trace_add(&data->i2c_trace, client);
+
+    if (governor)
+        accton_fan_governor_set_enable(&data->governor, true);
     
     return 0;
 
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &as7816_64x_fan_group);
 exit_free:
+    accton_lm75_exit(&data->lm75);
     kfree(data);
 exit:
     
@@ -421,8 +593,12 @@ exit:
 static int as7816_64x_fan_remove(struct i2c_client *client)
 {
     struct as7816_64x_fan_data *data = i2c_get_clientdata(client);
+
+    accton_fan_governor_set_enable(&data->governor, false);
+    accton_i2c_trace_remove(&data->i2c_trace);
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &as7816_64x_fan_group);
+    accton_lm75_exit(&data->lm75);
     
     return 0;
 }
@@ -0,0 +1,140 @@
+/*
+ * Board driver for accton as7816_64x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "as7816_64x_platform"
+
+/* The layout accton_as7816_util.py used to build from user space */
+static const struct accton_i2c_mux muxes[] = {
+	{ 0, 0x77,  1 },
+	{ 1, 0x71,  9 },
+	{ 1, 0x76, 17 },
+	{ 1, 0x73, 25 },
+	{ 2, 0x70, 33 },
+	{ 2, 0x71, 41 },
+	{ 2, 0x72, 49 },
+	{ 2, 0x73, 57 },
+	{ 2, 0x74, 65 },
+	{ 2, 0x75, 73 },
+	{ 2, 0x76, 81 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{  0, "24c02",           0x56 },
+	{ 10, "as7816_64x_psu1", 0x53 },
+	{ 10, "ym2851",          0x5b },
+	{  9, "as7816_64x_psu2", 0x50 },
+	{  9, "ym2851",          0x58 },
+	{ 17, "as7816_64x_fan",  0x68 },
+	{ 18, "lm75",            0x48 },
+	{ 18, "lm75",            0x49 },
+	{ 18, "lm75",            0x4a },
+	{ 18, "lm75",            0x4b },
+	{ 17, "lm75",            0x4d },
+	{ 17, "lm75",            0x4e },
+	{ 19, "cpld_as7816",     0x60 },
+	{ 20, "cpld_plain",      0x62 },
+	{ 21, "cpld_plain",      0x64 },
+	{ 22, "cpld_plain",      0x66 },
+};
+
+/* Bus of port 1 to port 64 */
+static const u8 sfp_bus[] = {
+	37, 38, 39, 40, 42, 41, 44, 43, 33, 34, 35, 36, 45, 46, 47, 48,
+	49, 50, 51, 52, 61, 62, 63, 64, 53, 54, 55, 56, 57, 58, 59, 60,
+	69, 70, 71, 72, 77, 78, 79, 80, 65, 66, 67, 68, 73, 74, 75, 76,
+	85, 86, 87, 88, 31, 32, 29, 30, 81, 82, 83, 84, 25, 26, 27, 28
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, ARRAY_SIZE(sfp_bus), "as7816_64x_port%d" },
+};
+
+static const struct accton_i2c_board_desc as7816_64x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int as7816_64x_platform_probe(struct platform_device *pdev)
+{
+	return accton_i2c_board_probe(pdev, &as7816_64x_board);
+}
+
+static int as7816_64x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver as7816_64x_platform_driver = {
+	.probe		= as7816_64x_platform_probe,
+	.remove		= as7816_64x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init as7816_64x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&as7816_64x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&as7816_64x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit as7816_64x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&as7816_64x_platform_driver);
+}
+
+module_init(as7816_64x_platform_init);
+module_exit(as7816_64x_platform_exit);
+
+MODULE_DESCRIPTION("as7816_64x board driver");
+MODULE_LICENSE("GPL");
@@ -47,6 +47,23 @@ FUNCTION_NAME = 'accton_as7816_monitor'
 global log_file
 global log_level
 
+# Kernel fan governor in the as7816_64x_fan driver
+FAN_GOVERNOR_PATH = '/sys/bus/i2c/devices/17-0068/governor_enable'
+FAN_POLICY_PATH = '/sys/bus/i2c/devices/17-0068/fan_policy_{0}'
+
+# [duty cycle, step down below, step up above], in milli-Celsius
+max_duty = 100
+fan_policy_f2b = {
+   0: [52, 0,      43000],
+   1: [64, 43000,  46000],
+   2: [76, 46000,  52000],
+   3: [88, 52000,  57000],
+   4: [max_duty, 57000, sys.maxsize],
+}
+# Same policy for both directions, no single sensor thresholds
+fan_policy_b2f = fan_policy_f2b
+fan_policy_single = {}
+
 #* 1. If any FAN failed, set all the other fans as full speed (100%)
 #* 2. When (0x48 + 0x49 + 0x4A + 0x4B + 0x4D + 0x4E)/6=T, T<= 43 C, set fan speed to 7 (52.9%)
 #* 3. When (0x48 + 0x49 + 0x4A + 0x4B + 0x4D + 0x4E)/6=T, 43<T<= 46 C, set fan speed to 9 (64.7%)
@@ -84,18 +101,39 @@ class accton_as7816_monitor(object):
 
         logging.debug('SET. logfile:%s / loglevel:%d', log_file, log_level)
 
+        # Kept across cycles, so are the sensor files they hold open
+        self.thermal = ThermalUtil()
+        self.fan = FanUtil()
+
+    def load_policy(self):
+        """Push the fan policy to the kernel governor and enable it.
+        Return False if the fan driver has no governor."""
+        if not os.path.exists(FAN_GOVERNOR_PATH):
+            return False
+
+        try:
+            for name, policy in (('f2b', fan_policy_f2b), ('b2f', fan_policy_b2f)):
+                levels = []
+                for x in sorted(policy):
+                    duty, down, up = policy[x]
+                    if up == sys.maxsize:
+                        up = 0  # the top level never steps up
+                    levels.append('%d %d %d %d' % (duty, down, up,
+                                  fan_policy_single.get(x - 1, 0)))
+                with open(FAN_POLICY_PATH.format(name), 'w') as f:
+                    f.write('\n'.join(levels) + '\n')
+            with open(FAN_GOVERNOR_PATH, 'w') as f:
+                f.write('1\n')
+        except IOError as e:
+            logging.error('SET. unable to load fan policy: %s', str(e))
+            return False
+
+        logging.info('INFO. fan policy loaded to the kernel governor')
+        return True
+
     def manage_fans(self):
-        max_duty = 100
-        fan_policy_f2b = {
-           0: [52, 0,      43000],
-           1: [64, 43000,  46000],
-           2: [76, 46000,  52000],
-           3: [88, 52000,  57000],
-           4: [max_duty, 57000, sys.maxsize],
-        }
-  
-        thermal = ThermalUtil()
-        fan = FanUtil()
+        thermal = self.thermal
+        fan = self.fan
         for x in range(fan.get_idx_fan_start(), fan.get_num_fans()+1):
             fan_status = fan.get_fan_status(x)
             if fan_status is None:
@@ -144,6 +182,10 @@ def main(argv):
 
     monitor = accton_as7816_monitor(log_file, log_level)
 
+    # The fan driver runs the policy itself when it has a governor.
+    if monitor.load_policy():
+        return 0
+
     # Loop forever, doing something useful hopefully:
     while True:
         monitor.manage_fans()
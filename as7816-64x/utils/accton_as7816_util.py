@@ -162,7 +162,8 @@ kos = [
 'modprobe x86-64-accton-as7816-64x-fan'     ,
 'modprobe x86-64-accton-as7816-64x-sfp'      ,
 'modprobe x86-64-accton-as7816-64x-leds'      ,
-'modprobe x86-64-accton-as7816-64x-psu' ]
+'modprobe x86-64-accton-as7816-64x-psu',
+'modprobe x86-64-accton-as7816-64x-platform' ]
 
 def driver_install():
     global FORCE
@@ -241,6 +242,10 @@ mknod =[
 def i2c_order_check():    
     return 0
                      
+# Set when the board driver has created the devices; they are then
+# removed together with the driver.
+board_path = '/sys/bus/platform/devices/as7816_64x_platform'
+
 def device_install():
     global FORCE
     
@@ -266,6 +271,9 @@ def device_install():
 def device_uninstall():
     global FORCE
     
+    if os.path.exists(board_path):
+        return 0
+
     status, output =log_os_system("ls /sys/bus/i2c/devices/1-0076", 0)
     
     for i in range(0,len(sfp_map)):
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------
+# Access to the sysfs nodes read by the FanUtil/ThermalUtil classes.
+#
+# A node path, glob patterns like hwmon*/temp1_input included, is
+# resolved and opened once. Later reads seek back to the start of the
+# kept descriptor and read it again, which makes sysfs call the show
+# function anew: one syscall instead of open, read, read and close
+# (plus the glob's directory reads). A descriptor that stops working,
+# because the device was removed and created again, is reopened once.
+#
+# The platform classes directories get this file through a symlink.
+# ------------------------------------------------------------------
+
+try:
+    import os
+    import glob
+    import errno
+    import logging
+except ImportError as e:
+    raise ImportError('%s - required module not found' % str(e))
+
+
+class SensorNodes(object):
+    """Open file descriptors on sysfs nodes, by path"""
+
+    READ_SIZE = 64      # sysfs values of these nodes are short
+
+    def __init__(self):
+        self._fds = {}  # (path, flags) -> fd
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        for fd in self._fds.values():
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+        self._fds.clear()
+
+    def _resolve(self, path):
+        if not glob.has_magic(path):
+            return path
+        names = glob.glob(path)
+        if not names:
+            raise OSError(errno.ENOENT, 'No such file or directory', path)
+        return names[0]
+
+    def _fd(self, path, flags):
+        fd = self._fds.get((path, flags))
+        if fd is None:
+            fd = os.open(self._resolve(path), flags)
+            self._fds[(path, flags)] = fd
+        return fd
+
+    def _drop(self, path, flags):
+        fd = self._fds.pop((path, flags), None)
+        if fd is not None:
+            try:
+                os.close(fd)
+            except OSError:
+                pass
+
+    def _pread(self, fd):
+        if hasattr(os, 'pread'):
+            return os.pread(fd, self.READ_SIZE, 0)
+        os.lseek(fd, 0, os.SEEK_SET)
+        return os.read(fd, self.READ_SIZE)
+
+    def _pwrite(self, fd, content):
+        if hasattr(os, 'pwrite'):
+            return os.pwrite(fd, content, 0)
+        os.lseek(fd, 0, os.SEEK_SET)
+        return os.write(fd, content)
+
+    def read(self, path):
+        """Content of the node, stripped, or None"""
+        for retry in (False, True):
+            try:
+                content = self._pread(self._fd(path, os.O_RDONLY))
+                break
+            except OSError as e:
+                self._drop(path, os.O_RDONLY)
+                if retry or e.errno == errno.ENOENT:
+                    logging.error('GET. unable to read file: %s', str(e))
+                    return None
+
+        content = content.rstrip()
+        if content == '':
+            logging.debug('GET. content is NULL. device_path:%s', path)
+            return None
+        return content
+
+    def read_int(self, path):
+        content = self.read(path)
+        if content is None:
+            return None
+        try:
+            return int(content)
+        except ValueError:
+            logging.debug('GET. not a number. device_path:%s', path)
+            return None
+
+    def read_many(self, paths):
+        """read_int() of each of the paths, over the kept descriptors"""
+        return [self.read_int(path) for path in paths]
+
+    def write(self, path, val):
+        content = str(val)
+        for retry in (False, True):
+            try:
+                self._pwrite(self._fd(path, os.O_WRONLY), content)
+                return True
+            except OSError as e:
+                self._drop(path, os.O_WRONLY)
+                if retry or e.errno == errno.ENOENT:
+                    logging.error('SET. unable to write file: %s', str(e))
+                    return False
@@ -0,0 +1,328 @@
+/*
+ * accton_fan_governor.h - Fan policy loop for the Accton fan drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ACCTON_FAN_GOVERNOR_H
+#define ACCTON_FAN_GOVERNOR_H
+
+#include <linux/kernel.h>
+#include <linux/device.h>
+#include <linux/errno.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
+
+/*
+ * The loop of the accton_*_monitor scripts, run from a delayed work of
+ * the fan driver. The driver reads the fans and the temperatures and
+ * sets the duty cycle; the policy is a table per airflow direction.
+ *
+ * The governor does nothing until governor_enable is set. The monitor
+ * script loads its tables, sets it and stops driving the fans, so only
+ * one of the two is in charge at any time. Clearing it hands the fans
+ * back to whoever writes the duty cycle.
+ *
+ * Each table line is "<duty_cycle> <down_mc> <up_mc> [<single_mc>]".
+ * Starting from the level of the current duty cycle, the governor steps
+ * up while the temperature is above up_mc and down while it is below
+ * down_mc, one level per period when one_step is set. Whatever that
+ * gives, a level with a single_mc is the minimum once any one sensor is
+ * above it. On a fan fault fault_duty_cycle is set instead.
+ */
+#define ACCTON_FAN_POLICY_LEVELS	8
+#define ACCTON_FAN_GOVERNOR_MIN_MS	100
+
+enum {
+	ACCTON_FAN_DIR_B2F,
+	ACCTON_FAN_DIR_F2B,
+	ACCTON_FAN_DIR_MAX
+};
+
+struct accton_fan_level {
+	int duty_cycle;		/* percent */
+	int down_mc;		/* step down below this */
+	int up_mc;		/* step up above this */
+	int single_mc;		/* 0: no single sensor threshold */
+};
+
+struct accton_fan_policy {
+	int num_levels;
+	struct accton_fan_level level[ACCTON_FAN_POLICY_LEVELS];
+};
+
+/* What the driver reads for one period */
+struct accton_fan_state {
+	int dir;		/* ACCTON_FAN_DIR_* */
+	bool fault;		/* any fan */
+	int duty_cycle;		/* as read back from the fan controller */
+	bool temp_valid;	/* false: only handle faults */
+	int temp_mc;		/* what the table is compared with */
+	int max_mc;		/* hottest single sensor */
+};
+
+struct accton_fan_governor_ops {
+	/* Return < 0 when the fans could not be read, to skip the period */
+	int (*read)(struct device *dev, struct accton_fan_state *st);
+	int (*set_duty_cycle)(struct device *dev, int duty_cycle);
+	/* What reading back a written duty cycle gives, NULL if the same */
+	int (*round_duty_cycle)(int duty_cycle);
+};
+
+struct accton_fan_governor {
+	struct device *dev;
+	const struct accton_fan_governor_ops *ops;
+	const unsigned int *interval_ms;
+	int fault_duty_cycle;
+	bool one_step;
+	struct mutex lock;	/* enable and policy */
+	bool enable;
+	struct accton_fan_policy policy[ACCTON_FAN_DIR_MAX];
+	struct delayed_work work;
+};
+
+static inline int accton_fan_round(struct accton_fan_governor *gov,
+				   int duty_cycle)
+{
+	return gov->ops->round_duty_cycle ?
+		gov->ops->round_duty_cycle(duty_cycle) : duty_cycle;
+}
+
+/* Level of the policy for the temperatures in @st */
+static inline int accton_fan_level(struct accton_fan_governor *gov,
+				   struct accton_fan_policy *policy,
+				   struct accton_fan_state *st, int *cur)
+{
+	const struct accton_fan_level *l = policy->level;
+	int level, i;
+
+	for (level = 0; level < policy->num_levels; level++) {
+		if (accton_fan_round(gov, l[level].duty_cycle) == st->duty_cycle)
+			break;
+	}
+
+	if (level == policy->num_levels) {
+		*cur = -1;	/* not a policy duty cycle, start over */
+		level = 0;
+		if (gov->one_step)
+			goto single;
+	} else {
+		*cur = level;
+	}
+
+	/* Bounded, a table whose levels overlap the wrong way would swing */
+	for (i = 0; i < policy->num_levels; i++) {
+		if (level < policy->num_levels - 1 &&
+		    st->temp_mc > l[level].up_mc)
+			level++;
+		else if (level > 0 && st->temp_mc < l[level].down_mc)
+			level--;
+		else
+			break;
+
+		if (gov->one_step)
+			break;
+	}
+
+single:
+	for (i = level + 1; i < policy->num_levels; i++) {
+		if (l[i].single_mc && st->max_mc > l[i].single_mc)
+			level = i;
+	}
+
+	return level;
+}
+
+static inline void accton_fan_governor_step(struct accton_fan_governor *gov)
+{
+	struct accton_fan_state st;
+	struct accton_fan_policy *policy;
+	int cur, level, duty_cycle;
+
+	memset(&st, 0, sizeof(st));
+	if (gov->ops->read(gov->dev, &st) < 0)
+		return;
+
+	if (st.fault) {
+		if (st.duty_cycle != accton_fan_round(gov, gov->fault_duty_cycle))
+			gov->ops->set_duty_cycle(gov->dev, gov->fault_duty_cycle);
+		return;
+	}
+
+	if (!st.temp_valid)
+		return;
+
+	mutex_lock(&gov->lock);
+	policy = &gov->policy[st.dir];
+	level = accton_fan_level(gov, policy, &st, &cur);
+	duty_cycle = policy->level[level].duty_cycle;
+	mutex_unlock(&gov->lock);
+
+	if (level != cur) {
+		dev_dbg(gov->dev, "temp %d max %d, duty cycle %d\n",
+			st.temp_mc, st.max_mc, duty_cycle);
+		gov->ops->set_duty_cycle(gov->dev, duty_cycle);
+	}
+}
+
+static inline void accton_fan_governor_work(struct work_struct *work)
+{
+	struct accton_fan_governor *gov = container_of(to_delayed_work(work),
+					struct accton_fan_governor, work);
+	bool enable;
+
+	mutex_lock(&gov->lock);
+	enable = gov->enable;
+	mutex_unlock(&gov->lock);
+
+	if (!enable)
+		return;
+
+	accton_fan_governor_step(gov);
+	schedule_delayed_work(&gov->work, msecs_to_jiffies(max(*gov->interval_ms,
+				(unsigned int)ACCTON_FAN_GOVERNOR_MIN_MS)));
+}
+
+static inline void accton_fan_governor_init(struct accton_fan_governor *gov,
+		struct device *dev, const struct accton_fan_governor_ops *ops,
+		const struct accton_fan_policy *policy,
+		const unsigned int *interval_ms, int fault_duty_cycle,
+		bool one_step)
+{
+	gov->dev = dev;
+	gov->ops = ops;
+	gov->interval_ms = interval_ms;
+	gov->fault_duty_cycle = fault_duty_cycle;
+	gov->one_step = one_step;
+	gov->enable = false;
+	mutex_init(&gov->lock);
+	memcpy(gov->policy, policy, sizeof(gov->policy));
+	INIT_DELAYED_WORK(&gov->work, accton_fan_governor_work);
+}
+
+static inline void accton_fan_governor_set_enable(struct accton_fan_governor *gov,
+						  bool enable)
+{
+	mutex_lock(&gov->lock);
+	gov->enable = enable;
+	mutex_unlock(&gov->lock);
+
+	/* The work checks enable again, whichever of two writers wins */
+	if (enable)
+		mod_delayed_work(system_wq, &gov->work, 0);
+	else
+		cancel_delayed_work_sync(&gov->work);
+}
+
+/* Bodies of the governor_enable and fan_policy_* sysfs attributes */
+static inline ssize_t accton_fan_governor_show(struct accton_fan_governor *gov,
+					       char *buf)
+{
+	return sprintf(buf, "%d\n", gov->enable);
+}
+
+static inline ssize_t accton_fan_governor_store(struct accton_fan_governor *gov,
+						const char *buf, size_t count)
+{
+	int error, value;
+
+	error = kstrtoint(buf, 10, &value);
+	if (error)
+		return error;
+
+	if (value < 0 || value > 1)
+		return -EINVAL;
+
+	accton_fan_governor_set_enable(gov, value);
+	return count;
+}
+
+static inline ssize_t accton_fan_policy_show(struct accton_fan_governor *gov,
+					     int dir, char *buf)
+{
+	struct accton_fan_policy *policy = &gov->policy[dir];
+	ssize_t ret = 0;
+	int i;
+
+	mutex_lock(&gov->lock);
+	for (i = 0; i < policy->num_levels; i++) {
+		ret += sprintf(buf + ret, "%d %d %d %d\n",
+			       policy->level[i].duty_cycle,
+			       policy->level[i].down_mc, policy->level[i].up_mc,
+			       policy->level[i].single_mc);
+	}
+	mutex_unlock(&gov->lock);
+
+	return ret;
+}
+
+static inline ssize_t accton_fan_policy_store(struct accton_fan_governor *gov,
+					      int dir, const char *buf,
+					      size_t count, int max_duty_cycle)
+{
+	struct accton_fan_policy policy;
+	struct accton_fan_level *l;
+	const char *p = skip_spaces(buf);
+	const char *eol;
+	char line[64], *rest;
+	int len;
+
+	memset(&policy, 0, sizeof(policy));
+	while (*p) {
+		if (policy.num_levels == ACCTON_FAN_POLICY_LEVELS)
+			return -EINVAL;
+
+		/* One line at a time, sscanf takes newlines for spaces */
+		eol = strchrnul(p, '\n');
+		if (eol - p >= sizeof(line))
+			return -EINVAL;
+		memcpy(line, p, eol - p);
+		line[eol - p] = '\0';
+
+		l = &policy.level[policy.num_levels];
+		if (sscanf(line, "%d %d %d%n", &l->duty_cycle, &l->down_mc,
+			   &l->up_mc, &len) != 3)
+			return -EINVAL;
+
+		rest = skip_spaces(line + len);
+		if (*rest) {
+			if (sscanf(rest, "%d%n", &l->single_mc, &len) != 1)
+				return -EINVAL;
+			if (*skip_spaces(rest + len))
+				return -EINVAL;
+		}
+
+		if (l->duty_cycle <= 0 || l->duty_cycle > max_duty_cycle)
+			return -EINVAL;
+
+		policy.num_levels++;
+		p = skip_spaces(eol);
+	}
+
+	if (!policy.num_levels)
+		return -EINVAL;
+
+	mutex_lock(&gov->lock);
+	gov->policy[dir] = policy;
+	mutex_unlock(&gov->lock);
+
+	return count;
+}
+
+#endif /* ACCTON_FAN_GOVERNOR_H */
@@ -0,0 +1,353 @@
+/*
+ * accton_i2c_board.h - I2C topology of the Accton boards, built in kernel
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ACCTON_I2C_BOARD_H
+#define ACCTON_I2C_BOARD_H
+
+#include <linux/kernel.h>
+#include <linux/platform_device.h>
+#include <linux/i2c.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+#include <linux/ktime.h>
+#include <linux/notifier.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,13,0)
+#include <linux/platform_data/pca954x.h>
+#else
+#include <linux/i2c/pca954x.h>
+#endif
+
+/*
+ * What the accton_*_util.py scripts used to build by writing new_device
+ * files, one table per board. The muxes are pca9548s given fixed bus
+ * numbers, so the layout is the one the scripts got from the order of
+ * their writes; each mux waits for its parent bus to be registered.
+ *
+ * The board driver picks its tables in probe and hands them to
+ * accton_i2c_board_probe(). Clients are created in table order: the
+ * muxes, the devices, then the ports.
+ */
+#define ACCTON_I2C_MUX_CHANNELS		8
+#define ACCTON_I2C_ADAPTER_WAIT_MS	5000	/* longest wait for a parent bus */
+#define ACCTON_I2C_PORT_ADDR		0x50	/* EEPROM of the transceivers */
+
+struct accton_i2c_mux {
+	int            parent;
+	unsigned short addr;
+	int            base_nr;	/* bus number of channel 0 */
+};
+
+struct accton_i2c_dev {
+	int            bus;
+	const char    *type;
+	unsigned short addr;
+};
+
+/* Ports numbered on from the previous group, @type may use %d for it */
+struct accton_i2c_ports {
+	const u8      *bus;
+	int            num;
+	const char    *type;
+};
+
+struct accton_i2c_board_desc {
+	const struct accton_i2c_mux   *muxes;
+	int                            num_muxes;
+	const struct accton_i2c_dev   *devs;
+	int                            num_devs;
+	const struct accton_i2c_ports *ports;
+	int                            num_ports;	/* groups */
+};
+
+struct accton_i2c_board_client {
+	struct i2c_client *client;
+	s64                probe_us;	/* i2c_new_device(), driver probe included */
+};
+
+struct accton_i2c_board {
+	const struct accton_i2c_board_desc *desc;
+	struct pca954x_platform_mode       *mux_modes;
+	struct pca954x_platform_data       *mux_pdata;
+	struct accton_i2c_board_client     *clients;
+	int                                 num_clients;
+	s64                                 total_us;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(accton_i2c_adapter_wq);
+static atomic_t accton_i2c_adapter_gen = ATOMIC_INIT(0);	/* adapters added so far */
+
+static int accton_i2c_adapter_notify(struct notifier_block *nb,
+				     unsigned long action, void *data)
+{
+	struct device *dev = data;
+
+	if (action == BUS_NOTIFY_ADD_DEVICE && i2c_verify_adapter(dev)) {
+		atomic_inc(&accton_i2c_adapter_gen);
+		wake_up_all(&accton_i2c_adapter_wq);
+	}
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block accton_i2c_adapter_nb = {
+	.notifier_call = accton_i2c_adapter_notify,
+};
+
+/*
+ * Mux channels show up when pca954x binds to the mux, wait for them
+ * to be registered rather than sleeping a fixed amount of time.
+ * i2c_get_adapter() sleeps, so it is not the wait condition: look the
+ * bus up, and wait for another adapter to be added if it is not there.
+ * The count is read first so an adapter added in between is not missed.
+ */
+static struct i2c_adapter *accton_i2c_board_get_adapter(int nr)
+{
+	long timeout = msecs_to_jiffies(ACCTON_I2C_ADAPTER_WAIT_MS);
+	struct i2c_adapter *adap;
+	int gen;
+
+	for (;;) {
+		gen = atomic_read(&accton_i2c_adapter_gen);
+		adap = i2c_get_adapter(nr);
+		if (adap || !timeout) {
+			return adap;
+		}
+
+		timeout = wait_event_timeout(accton_i2c_adapter_wq,
+					     atomic_read(&accton_i2c_adapter_gen) != gen,
+					     timeout);
+	}
+}
+
+/*
+ * Whether a chip answers at @addr on i2c-@nr, for the boards whose
+ * buses 0 and 1 may come up in either order.
+ */
+static inline bool accton_i2c_board_detect(int nr, unsigned short addr)
+{
+	struct i2c_adapter *adap;
+	union i2c_smbus_data data;
+	int ret;
+
+	adap = i2c_get_adapter(nr);
+	if (!adap) {
+		return false;
+	}
+
+	ret = i2c_smbus_xfer(adap, addr, 0, I2C_SMBUS_READ, 0,
+			     I2C_SMBUS_BYTE, &data);
+	i2c_put_adapter(adap);
+
+	return ret >= 0;
+}
+
+static int accton_i2c_board_new_client(struct device *dev,
+				       struct accton_i2c_board *board, int nr,
+				       struct i2c_board_info *info)
+{
+	struct accton_i2c_board_client *c = &board->clients[board->num_clients];
+	struct i2c_adapter *adap;
+	ktime_t start;
+
+	adap = accton_i2c_board_get_adapter(nr);
+	if (!adap) {
+		dev_err(dev, "i2c-%d not found for %s at 0x%02x\n",
+			nr, info->type, info->addr);
+		return -ENODEV;
+	}
+
+	start = ktime_get();
+	c->client = i2c_new_device(adap, info);
+	c->probe_us = ktime_us_delta(ktime_get(), start);
+	i2c_put_adapter(adap);
+
+	if (!c->client) {
+		dev_err(dev, "failed to create %s at %d-%04x\n",
+			info->type, nr, info->addr);
+		return -ENODEV;
+	}
+
+	dev_dbg(dev, "%s at %d-%04x took %lld us\n",
+		info->type, nr, info->addr, c->probe_us);
+	board->num_clients++;
+	return 0;
+}
+
+static void accton_i2c_board_free(struct accton_i2c_board *board)
+{
+	while (board->num_clients) {
+		board->num_clients--;
+		i2c_unregister_device(board->clients[board->num_clients].client);
+	}
+
+	kfree(board->clients);
+	kfree(board->mux_pdata);
+	kfree(board->mux_modes);
+	kfree(board);
+}
+
+static ssize_t accton_i2c_board_show_probe_times(struct device *dev,
+						 struct device_attribute *da,
+						 char *buf)
+{
+	struct accton_i2c_board *board = dev_get_drvdata(dev);
+	struct i2c_client *client;
+	ssize_t len;
+	int i;
+
+	len = scnprintf(buf, PAGE_SIZE, "total %lld us\n", board->total_us);
+	for (i = 0; i < board->num_clients; i++) {
+		client = board->clients[i].client;
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%s %s %lld us\n",
+				 dev_name(&client->dev), client->name,
+				 board->clients[i].probe_us);
+	}
+
+	return len;
+}
+
+static struct device_attribute accton_i2c_board_attr_probe_times =
+	__ATTR(probe_times, S_IRUGO, accton_i2c_board_show_probe_times, NULL);
+
+static int accton_i2c_board_create(struct platform_device *pdev,
+				   struct accton_i2c_board *board)
+{
+	const struct accton_i2c_board_desc *desc = board->desc;
+	struct pca954x_platform_mode *modes;
+	struct i2c_board_info info;
+	int i, j, port = 0, ret;
+
+	for (i = 0; i < desc->num_muxes; i++) {
+		modes = &board->mux_modes[i * ACCTON_I2C_MUX_CHANNELS];
+		for (j = 0; j < ACCTON_I2C_MUX_CHANNELS; j++) {
+			modes[j].adap_id = desc->muxes[i].base_nr + j;
+			modes[j].deselect_on_exit = 1;
+		}
+		board->mux_pdata[i].modes = modes;
+		board->mux_pdata[i].num_modes = ACCTON_I2C_MUX_CHANNELS;
+
+		memset(&info, 0, sizeof(info));
+		strlcpy(info.type, "pca9548", I2C_NAME_SIZE);
+		info.addr = desc->muxes[i].addr;
+		info.platform_data = &board->mux_pdata[i];
+
+		ret = accton_i2c_board_new_client(&pdev->dev, board,
+						  desc->muxes[i].parent, &info);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	for (i = 0; i < desc->num_devs; i++) {
+		memset(&info, 0, sizeof(info));
+		strlcpy(info.type, desc->devs[i].type, I2C_NAME_SIZE);
+		info.addr = desc->devs[i].addr;
+
+		ret = accton_i2c_board_new_client(&pdev->dev, board,
+						  desc->devs[i].bus, &info);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	for (i = 0; i < desc->num_ports; i++) {
+		for (j = 0; j < desc->ports[i].num; j++) {
+			port++;
+			memset(&info, 0, sizeof(info));
+			snprintf(info.type, I2C_NAME_SIZE, desc->ports[i].type, port);
+			info.addr = ACCTON_I2C_PORT_ADDR;
+
+			ret = accton_i2c_board_new_client(&pdev->dev, board,
+							  desc->ports[i].bus[j], &info);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Create the clients of @desc, on failure none is left behind */
+static int accton_i2c_board_probe(struct platform_device *pdev,
+				  const struct accton_i2c_board_desc *desc)
+{
+	struct accton_i2c_board *board;
+	ktime_t start = ktime_get();
+	int i, num_clients, ret;
+
+	num_clients = desc->num_muxes + desc->num_devs;
+	for (i = 0; i < desc->num_ports; i++) {
+		num_clients += desc->ports[i].num;
+	}
+
+	board = kzalloc(sizeof(*board), GFP_KERNEL);
+	if (!board) {
+		return -ENOMEM;
+	}
+	board->desc = desc;
+	board->mux_modes = kcalloc(desc->num_muxes * ACCTON_I2C_MUX_CHANNELS,
+				   sizeof(*board->mux_modes), GFP_KERNEL);
+	board->mux_pdata = kcalloc(desc->num_muxes, sizeof(*board->mux_pdata),
+				   GFP_KERNEL);
+	board->clients = kcalloc(num_clients, sizeof(*board->clients), GFP_KERNEL);
+	if (!board->mux_modes || !board->mux_pdata || !board->clients) {
+		ret = -ENOMEM;
+		goto exit_free;
+	}
+	platform_set_drvdata(pdev, board);
+
+	ret = bus_register_notifier(&i2c_bus_type, &accton_i2c_adapter_nb);
+	if (ret) {
+		goto exit_free;
+	}
+
+	ret = accton_i2c_board_create(pdev, board);
+	bus_unregister_notifier(&i2c_bus_type, &accton_i2c_adapter_nb);
+	if (ret) {
+		goto exit_free;
+	}
+
+	ret = device_create_file(&pdev->dev, &accton_i2c_board_attr_probe_times);
+	if (ret) {
+		goto exit_free;
+	}
+
+	board->total_us = ktime_us_delta(ktime_get(), start);
+	dev_info(&pdev->dev, "%d devices created in %lld us\n",
+		 board->num_clients, board->total_us);
+	return 0;
+
+exit_free:
+	accton_i2c_board_free(board);
+	return ret;
+}
+
+static void accton_i2c_board_remove(struct platform_device *pdev)
+{
+	struct accton_i2c_board *board = platform_get_drvdata(pdev);
+
+	device_remove_file(&pdev->dev, &accton_i2c_board_attr_probe_times);
+	accton_i2c_board_free(board);
+}
+
+#endif /* ACCTON_I2C_BOARD_H */
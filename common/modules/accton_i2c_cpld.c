@@ -34,11 +34,14 @@
 #include <linux/mutex.h>
 #include <linux/delay.h>
 #include <linux/list.h>
-
+#include <linux/srcu.h>
+#include <linux/workqueue.h>
+#include <linux/kobject.h>
+#include <linux/notifier.h>
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
 
 #define MAX_PORT_NUM				    64
-#define I2C_RW_RETRY_COUNT				10
-#define I2C_RW_RETRY_INTERVAL			60 /* ms */
 
 #define I2C_ADDR_CPLD1  0x60
 #define I2C_ADDR_CPLD2  0x62
@@ -123,11 +126,17 @@ struct cpld_data {
     u16  sfp_num;
     u8   sfp_types;
     struct model_attrs *cmn_attr;
-};
 
-struct cpld_client_node {
-    struct i2c_client *client;
-    struct list_head   list;
+    /* Module presence change detection */
+    int  present_reg;           /* First module_present_all reg, or -1 */
+    bool present_invert;        /* A set register bit means absent */
+    u64  present;               /* Last bitmap, a set bit is a present port */
+    bool present_valid;
+    struct delayed_work present_work;
+    struct list_head poll_list; /* On present_poll_list */
+
+    struct accton_i2c_stats i2c_stats;
+    struct accton_i2c_trace i2c_trace;
 };
 
 
@@ -160,9 +169,13 @@ static ssize_t set_byte(struct device *dev, struct device_attribute *da,
                         const char *buf, size_t count);
 static ssize_t access(struct device *dev, struct device_attribute *da,
                       const char *buf, size_t count);
+static ssize_t show_i2c_stats(struct device *dev,
+                              struct device_attribute *da, char *buf);
 
 int accton_i2c_cpld_read(u8 cpld_addr, u8 reg);
 int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value);
+int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg,
+                               u8 *values, u8 len);
 
 
 struct base_attrs common_attrs[NUM_COMMON_ATTR] =
@@ -180,7 +193,7 @@ struct attrs as7712_common[] = {
 struct attrs as7816_common[] = {
     [CMN_VERSION]   = {0x01, false, &common_attrs[CMN_VERSION]},
     [CMN_ACCESS]    = {0x00, false, &common_attrs[CMN_ACCESS]},
-    [CMN_PRESENT_ALL] = {0x30, false, &common_attrs[CMN_PRESENT_ALL]},
+    [CMN_PRESENT_ALL] = {0x70, false, &common_attrs[CMN_PRESENT_ALL]},
 };
 struct attrs as7312_common[] = {
     [CMN_VERSION]   = {0x01, false, &common_attrs[CMN_VERSION]},
@@ -252,8 +265,58 @@ struct model_attrs models_attr[NUM_MODEL] = {
     {.cmn = plain_cmn_list,  .portly=NULL},
 };
 
+/* Clients indexed by 7-bit address. Lookups are under SRCU only, so the
+ * exported accessors never take a global lock and may sleep on the bus.
+ * All clients are also kept on cpld_client_list, newest first, so when
+ * two CPLDs share an address and the newer one goes away the table
+ * falls back to the older one. list_lock serializes updaters.
+ */
+#define CPLD_CLIENT_ADDR_MAX    0x80
+static struct i2c_client __rcu *cpld_clients[CPLD_CLIENT_ADDR_MAX];
+static struct srcu_struct cpld_srcu;
 static LIST_HEAD(cpld_client_list);
 static struct mutex	 list_lock;
+
+struct cpld_client_node {
+    struct i2c_client *client;
+    struct list_head   list;
+};
+/* Period of presence polling. None of the CPLDs has a presence interrupt
+ * status register to use instead, so polling costs a block read per CPLD
+ * and period; it is off unless the platform sets it. 0 stops the pollers,
+ * setting it again restarts them. The CPLDs are kept on present_poll_list
+ * for that.
+ */
+static unsigned int present_poll_ms = 0;
+static BLOCKING_NOTIFIER_HEAD(present_notifier);
+static LIST_HEAD(present_poll_list);
+static DEFINE_MUTEX(present_poll_lock);
+
+static int present_poll_ms_set(const char *val, const struct kernel_param *kp)
+{
+    struct cpld_data *data;
+    int status;
+
+    status = param_set_uint(val, kp);
+    if (status)
+        return status;
+
+    /* Apply the new period now, and restart pollers stopped by 0 */
+    mutex_lock(&present_poll_lock);
+    list_for_each_entry(data, &present_poll_list, poll_list)
+        mod_delayed_work(system_wq, &data->present_work, 0);
+    mutex_unlock(&present_poll_lock);
+    return 0;
+}
+
+static const struct kernel_param_ops present_poll_ms_ops = {
+    .set = present_poll_ms_set,
+    .get = param_get_uint,
+};
+module_param_cb(present_poll_ms, &present_poll_ms_ops, &present_poll_ms,
+                S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(present_poll_ms, "Module presence poll period in ms, 0 (default) to stop polling.");
+
 /* Addresses scanned for accton_i2c_cpld
  */
 static const unsigned short normal_i2c[] = { I2C_CLIENT_END };
@@ -319,38 +382,59 @@ static int get_reg_bit(u8 reg_start, int port,
 static int cpld_write_internal(
     struct i2c_client *client, u8 reg, u8 value)
 {
-    int status = 0, retry = I2C_RW_RETRY_COUNT;
-
-    while (retry) {
-        status = i2c_smbus_write_byte_data(client, reg, value);
-        if (unlikely(status < 0)) {
-            msleep(I2C_RW_RETRY_INTERVAL);
-            retry--;
-            continue;
-        }
-
-        break;
-    }
+    struct cpld_data *data = i2c_get_clientdata(client);
 
-    return status;
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_write_byte_data(client, reg, value)));
 }
 
 static int cpld_read_internal(struct i2c_client *client, u8 reg)
 {
-    int status = 0, retry = I2C_RW_RETRY_COUNT;
+    struct cpld_data *data = i2c_get_clientdata(client);
 
-    while (retry) {
-        status = i2c_smbus_read_byte_data(client, reg);
-        if (unlikely(status < 0)) {
-            msleep(I2C_RW_RETRY_INTERVAL);
-            retry--;
-            continue;
-        }
+    return accton_i2c_retry(&data->i2c_stats,
+                accton_i2c_traced(&data->i2c_trace, client,
+                    I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+                    i2c_smbus_read_byte_data(client, reg)));
+}
 
-        break;
+/* Read registers [reg, reg+len) of the CPLD. Use I2C block read if the
+ * adapter supports it, otherwise fall back to byte reads.
+ * Return len on success, or a negative errno.
+ */
+static int cpld_read_block_internal(struct i2c_client *client, u8 reg,
+                                    u8 *values, u8 len)
+{
+    struct cpld_data *data = i2c_get_clientdata(client);
+    int status, i, chunk;
+
+    if (!i2c_check_functionality(client->adapter,
+                                 I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        for (i = 0; i < len; i++) {
+            status = cpld_read_internal(client, reg + i);
+            if (unlikely(status < 0))
+                return status;
+            values[i] = status;
+        }
+        return len;
     }
 
-    return status;
+    for (i = 0; i < len; i += chunk) {
+        chunk = min_t(int, len - i, I2C_SMBUS_BLOCK_MAX);
+        status = accton_i2c_retry(&data->i2c_stats,
+                     accton_i2c_traced(&data->i2c_trace, client,
+                         I2C_SMBUS_READ, I2C_SMBUS_I2C_BLOCK_DATA,
+                         reg + i, chunk,
+                         i2c_smbus_read_i2c_block_data(client, reg + i,
+                                                       chunk, values + i)));
+        if (unlikely(status < 0))
+            return status;
+        if (unlikely(status != chunk))
+            return -EIO;
+    }
+    return len;
 }
 
 
@@ -534,11 +618,26 @@ exit:
     return status;
 }
 
+static ssize_t show_i2c_stats(struct device *dev,
+                              struct device_attribute *da, char *buf)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct cpld_data *data = i2c_get_clientdata(client);
+
+    return accton_i2c_stats_show(&data->i2c_stats, buf);
+}
+
 static void accton_i2c_cpld_add_client(struct i2c_client *client)
 {
-    struct cpld_client_node *node =
-        kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
+    struct cpld_client_node *node;
+
+    if (client->addr >= CPLD_CLIENT_ADDR_MAX) {
+        dev_dbg(&client->dev, "Can't add cpld client (0x%x)\n",
+                client->addr);
+        return;
+    }
 
+    node = kzalloc(sizeof(struct cpld_client_node), GFP_KERNEL);
     if (!node) {
         dev_dbg(&client->dev, "Can't allocate cpld_client_node (0x%x)\n",
                 client->addr);
@@ -546,35 +645,42 @@ static void accton_i2c_cpld_add_client(struct i2c_client *client)
     }
     node->client = client;
 
+    /* The latest added client wins if addresses collide. */
     mutex_lock(&list_lock);
+    if (rcu_access_pointer(cpld_clients[client->addr]))
+        dev_warn(&client->dev, "cpld address 0x%x already in use, "
+                 "accessors now reach this one\n", client->addr);
     list_add(&node->list, &cpld_client_list);
+    rcu_assign_pointer(cpld_clients[client->addr], client);
     mutex_unlock(&list_lock);
 }
 
 static void accton_i2c_cpld_remove_client(struct i2c_client *client)
 {
-    struct list_head		*list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
-    int found = 0;
-
-    mutex_lock(&list_lock);
+    struct cpld_client_node *node, *found = NULL;
+    struct i2c_client *next = NULL;
 
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    if (client->addr >= CPLD_CLIENT_ADDR_MAX)
+        return;
 
-        if (cpld_node->client == client) {
-            found = 1;
-            break;
-        }
+    mutex_lock(&list_lock);
+    list_for_each_entry(node, &cpld_client_list, list) {
+        if (node->client == client)
+            found = node;
+        else if (!next && node->client->addr == client->addr)
+            next = node->client;
     }
+    if (found)
+        list_del(&found->list);
+    if (rcu_access_pointer(cpld_clients[client->addr]) == client)
+        rcu_assign_pointer(cpld_clients[client->addr], next);
+    mutex_unlock(&list_lock);
 
+    /* Wait for accessors still using this client. */
     if (found) {
-        list_del(list_node);
-        kfree(cpld_node);
+        synchronize_srcu(&cpld_srcu);
+        kfree(found);
     }
-
-    mutex_unlock(&list_lock);
 }
 
 static int cpld_add_attribute(struct cpld_data *data, struct attribute *attr)
@@ -718,9 +824,111 @@ static int add_attributes(struct i2c_client *client,
     /* Port-wise attributes.*/
     add_attributes_portly(data, m->portly);
 
+    /* I2C error statistics */
+    add_sensor(data, "i2c_stats", 0, 0, false, false, S_IRUGO,
+               show_i2c_stats, NULL);
+
     return 0;
 }
 
+static int get_present_all_reg(struct cpld_data *data)
+{
+    struct attrs **cmn = data->cmn_attr->cmn;
+    int i;
+
+    for (i = 0; cmn && cmn[i]; i++) {
+        if (cmn[i]->base == &common_attrs[CMN_PRESENT_ALL])
+            return cmn[i]->reg;
+    }
+    return -1;
+}
+
+static bool get_present_invert(struct cpld_data *data)
+{
+    struct attrs **portly = data->cmn_attr->portly;
+    int i;
+
+    for (i = 0; portly && portly[i]; i++) {
+        if (portly[i]->base == &portly_attrs[SFP_PRESENT])
+            return portly[i]->invert;
+    }
+    return false;
+}
+
+/* Compare the presence bitmap with the last one. On change, wake up
+ * pollers of module_present_all, emit a KOBJ_CHANGE uevent carrying the
+ * present and changed port bitmaps, a set bit meaning present as in
+ * module_present_<port>, and tell the present notifier chain so that
+ * the SFP drivers wake up pollers of their own attributes.
+ */
+static void cpld_present_check(struct cpld_data *data)
+{
+    struct i2c_client *client = to_i2c_client(data->dev);
+    u8 values[sizeof(u64)] = {0};
+    char env_present[32], env_changed[32];
+    char *envp[] = {env_present, env_changed, NULL};
+    u64 present = 0, changed;
+    int i, num, status;
+
+    num = (data->sfp_num + 7) / 8;
+    mutex_lock(&data->update_lock);
+    status = cpld_read_block_internal(client, data->present_reg, values, num);
+    mutex_unlock(&data->update_lock);
+    if (unlikely(status < 0))
+        return;
+
+    for (i = 0; i < num; i++)
+        present |= (u64)values[i] << (i * 8);
+    if (data->present_invert)
+        present = ~present;
+    if (data->sfp_num < 64)
+        present &= (1ULL << data->sfp_num) - 1;
+
+    changed = present ^ data->present;
+    if (data->present_valid && !changed)
+        return;
+
+    data->present = present;
+    if (!data->present_valid) {
+        data->present_valid = true;
+        return;
+    }
+
+    sysfs_notify(&data->dev->kobj, NULL,
+                 common_attrs[CMN_PRESENT_ALL].name);
+    snprintf(env_present, sizeof(env_present), "PRESENT=%016llx", present);
+    snprintf(env_changed, sizeof(env_changed), "CHANGED=%016llx", changed);
+    kobject_uevent_env(&data->dev->kobj, KOBJ_CHANGE, envp);
+    blocking_notifier_call_chain(&present_notifier, client->addr, &changed);
+}
+
+static void cpld_present_work(struct work_struct *work)
+{
+    struct cpld_data *data = container_of(to_delayed_work(work),
+                                          struct cpld_data, present_work);
+
+    cpld_present_check(data);
+    if (present_poll_ms)
+        schedule_delayed_work(&data->present_work,
+                              msecs_to_jiffies(present_poll_ms));
+}
+
+static void cpld_present_init(struct i2c_client *client,
+                              struct cpld_data *data)
+{
+    data->present_reg = get_present_all_reg(data);
+    if (!data->sfp_num || data->present_reg < 0)
+        return;
+
+    data->present_invert = get_present_invert(data);
+    INIT_DELAYED_WORK(&data->present_work, cpld_present_work);
+    mutex_lock(&present_poll_lock);
+    list_add(&data->poll_list, &present_poll_list);
+    if (present_poll_ms)
+        schedule_delayed_work(&data->present_work, 0);
+    mutex_unlock(&present_poll_lock);
+}
+
 static int accton_i2c_cpld_probe(struct i2c_client *client,
                                  const struct i2c_device_id *dev_id)
 {
@@ -773,7 +981,9 @@ static int accton_i2c_cpld_probe(struct i2c_client *client,
         goto exit_remove;
     }
 
+    accton_i2c_trace_add(&data->i2c_trace, client);
     accton_i2c_cpld_add_client(client);
+    cpld_present_init(client, data);
     dev_info(dev, "%s: cpld '%s'\n",
              dev_name(data->hwmon_dev), client->name);
 
@@ -790,32 +1000,35 @@ static int accton_i2c_cpld_remove(struct i2c_client *client)
 {
     struct cpld_data *data = i2c_get_clientdata(client);
 
+    if (data->sfp_num && data->present_reg >= 0) {
+        mutex_lock(&present_poll_lock);
+        list_del(&data->poll_list);
+        mutex_unlock(&present_poll_lock);
+        cancel_delayed_work_sync(&data->present_work);
+    }
     hwmon_device_unregister(data->hwmon_dev);
     sysfs_remove_group(&client->dev.kobj, &data->group);
     kfree(data->group.attrs);
     accton_i2c_cpld_remove_client(client);
+    accton_i2c_trace_remove(&data->i2c_trace);
     return 0;
 }
 
 int accton_i2c_cpld_read(u8 cpld_addr, u8 reg)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
+    struct i2c_client *client;
     int ret = -EPERM;
+    int idx;
 
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    if (cpld_addr >= CPLD_CLIENT_ADDR_MAX)
+        return ret;
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = i2c_smbus_read_byte_data(cpld_node->client, reg);
-            break;
-        }
+    idx = srcu_read_lock(&cpld_srcu);
+    client = srcu_dereference(cpld_clients[cpld_addr], &cpld_srcu);
+    if (client) {
+        ret = cpld_read_internal(client, reg);
     }
-
-    mutex_unlock(&list_lock);
+    srcu_read_unlock(&cpld_srcu, idx);
 
     return ret;
 }
@@ -823,28 +1036,62 @@ EXPORT_SYMBOL(accton_i2c_cpld_read);
 
 int accton_i2c_cpld_write(unsigned short cpld_addr, u8 reg, u8 value)
 {
-    struct list_head   *list_node = NULL;
-    struct cpld_client_node *cpld_node = NULL;
+    struct i2c_client *client;
     int ret = -EIO;
+    int idx;
 
-    mutex_lock(&list_lock);
-
-    list_for_each(list_node, &cpld_client_list)
-    {
-        cpld_node = list_entry(list_node, struct cpld_client_node, list);
+    if (cpld_addr >= CPLD_CLIENT_ADDR_MAX)
+        return ret;
 
-        if (cpld_node->client->addr == cpld_addr) {
-            ret = i2c_smbus_write_byte_data(cpld_node->client, reg, value);
-            break;
-        }
+    idx = srcu_read_lock(&cpld_srcu);
+    client = srcu_dereference(cpld_clients[cpld_addr], &cpld_srcu);
+    if (client) {
+        ret = cpld_write_internal(client, reg, value);
     }
-
-    mutex_unlock(&list_lock);
+    srcu_read_unlock(&cpld_srcu, idx);
 
     return ret;
 }
 EXPORT_SYMBOL(accton_i2c_cpld_write);
 
+int accton_i2c_cpld_read_block(unsigned short cpld_addr, u8 reg,
+                               u8 *values, u8 len)
+{
+    struct i2c_client *client;
+    int ret = -EPERM;
+    int idx;
+
+    if (cpld_addr >= CPLD_CLIENT_ADDR_MAX || !values)
+        return -EINVAL;
+
+    idx = srcu_read_lock(&cpld_srcu);
+    client = srcu_dereference(cpld_clients[cpld_addr], &cpld_srcu);
+    if (client) {
+        ret = cpld_read_block_internal(client, reg, values, len);
+    }
+    srcu_read_unlock(&cpld_srcu, idx);
+
+    return ret;
+}
+EXPORT_SYMBOL(accton_i2c_cpld_read_block);
+
+/*
+ * Be told of module presence changes found by the present_poll_ms
+ * poller: the call gets the CPLD address as action and a pointer to the
+ * u64 bitmap of the changed ports.
+ */
+int accton_i2c_cpld_register_present_notifier(struct notifier_block *nb)
+{
+    return blocking_notifier_chain_register(&present_notifier, nb);
+}
+EXPORT_SYMBOL(accton_i2c_cpld_register_present_notifier);
+
+int accton_i2c_cpld_unregister_present_notifier(struct notifier_block *nb)
+{
+    return blocking_notifier_chain_unregister(&present_notifier, nb);
+}
+EXPORT_SYMBOL(accton_i2c_cpld_unregister_present_notifier);
+
 
 static const struct i2c_device_id accton_i2c_cpld_id[] = {
     { "cpld_as7712", AS7712_32X},
@@ -870,13 +1117,23 @@ static struct i2c_driver accton_i2c_cpld_driver = {
 
 static int __init accton_i2c_cpld_init(void)
 {
+    int ret;
+
     mutex_init(&list_lock);
-    return i2c_add_driver(&accton_i2c_cpld_driver);
+    ret = init_srcu_struct(&cpld_srcu);
+    if (ret)
+        return ret;
+
+    ret = i2c_add_driver(&accton_i2c_cpld_driver);
+    if (ret)
+        cleanup_srcu_struct(&cpld_srcu);
+    return ret;
 }
 
 static void __exit accton_i2c_cpld_exit(void)
 {
     i2c_del_driver(&accton_i2c_cpld_driver);
+    cleanup_srcu_struct(&cpld_srcu);
 }
 
 module_init(accton_i2c_cpld_init);
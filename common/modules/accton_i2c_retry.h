@@ -0,0 +1,138 @@
+/*
+ * accton_i2c_retry.h - I2C retry helper shared by the Accton platform drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ACCTON_I2C_RETRY_H
+#define ACCTON_I2C_RETRY_H
+
+#include <linux/kernel.h>
+#include <linux/delay.h>
+#include <linux/jiffies.h>
+#include <linux/errno.h>
+
+/*
+ * A failed transfer is retried with exponential backoff, 1, 2, 4, 8 ms.
+ * -ENXIO (nobody acked the address, e.g. module unplugged) is not retried.
+ * After ACCTON_I2C_BREAKER_THRESHOLD failed calls in a row the device is
+ * left alone for ACCTON_I2C_BREAKER_COOLDOWN_MS, then a single attempt
+ * decides whether it is back.
+ */
+#define ACCTON_I2C_RETRY_MAX		5
+#define ACCTON_I2C_BACKOFF_MIN_US	1000
+#define ACCTON_I2C_BACKOFF_MAX_US	16000
+#define ACCTON_I2C_BREAKER_THRESHOLD	3
+#define ACCTON_I2C_BREAKER_COOLDOWN_MS	2000
+
+/* Per-client counters. Updated without locking, so only approximate. */
+struct accton_i2c_stats {
+	unsigned long retries;
+	unsigned long nacks;
+	unsigned long timeouts;
+	unsigned long errors;
+	unsigned long breaker_trips;
+	unsigned long last_error;	/* jiffies */
+	int last_errno;
+	unsigned int failures;		/* failed calls in a row */
+	unsigned long open_until;	/* jiffies */
+};
+
+static inline bool accton_i2c_breaker_open(struct accton_i2c_stats *st)
+{
+	return st->failures >= ACCTON_I2C_BREAKER_THRESHOLD &&
+	       time_before(jiffies, st->open_until);
+}
+
+/*
+ * Account for the result of one attempt. Return true if the caller
+ * should try again, after having slept for the backoff delay.
+ */
+static inline bool accton_i2c_retry_next(struct accton_i2c_stats *st,
+					 int status, int *attempt)
+{
+	unsigned int delay;
+
+	if (status >= 0) {
+		st->failures = 0;
+		return false;
+	}
+
+	st->last_error = jiffies;
+	st->last_errno = status;
+	switch (status) {
+	case -ENXIO:
+	case -EREMOTEIO:
+		st->nacks++;
+		break;
+	case -ETIMEDOUT:
+	case -EAGAIN:
+		st->timeouts++;
+		break;
+	default:
+		st->errors++;
+		break;
+	}
+
+	if (status == -ENXIO || ++(*attempt) >= ACCTON_I2C_RETRY_MAX ||
+	    st->failures >= ACCTON_I2C_BREAKER_THRESHOLD) {
+		if (++st->failures >= ACCTON_I2C_BREAKER_THRESHOLD) {
+			st->open_until = jiffies +
+				msecs_to_jiffies(ACCTON_I2C_BREAKER_COOLDOWN_MS);
+			st->breaker_trips++;
+		}
+		return false;
+	}
+
+	delay = min(ACCTON_I2C_BACKOFF_MIN_US << (*attempt - 1),
+		    ACCTON_I2C_BACKOFF_MAX_US);
+	st->retries++;
+	usleep_range(delay, delay * 2);
+	return true;
+}
+
+/*
+ * Evaluate the I2C expression @expr, retrying on failure as described
+ * above. Yields its last result, or -EIO while the breaker is open.
+ */
+#define accton_i2c_retry(st, expr)					\
+({									\
+	int __status = -EIO;						\
+	int __attempt = 0;						\
+									\
+	if (!accton_i2c_breaker_open(st)) {				\
+		do {							\
+			__status = (expr);				\
+		} while (accton_i2c_retry_next(st, __status, &__attempt)); \
+	}								\
+	__status;							\
+})
+
+/* Body for an "i2c_stats" sysfs attribute */
+static inline ssize_t accton_i2c_stats_show(struct accton_i2c_stats *st,
+					    char *buf)
+{
+	return sprintf(buf,
+		       "retries %lu\nnacks %lu\ntimeouts %lu\nerrors %lu\n"
+		       "breaker_trips %lu\nbreaker_open %d\n"
+		       "last_errno %d\nlast_error_jiffies %lu\n",
+		       st->retries, st->nacks, st->timeouts, st->errors,
+		       st->breaker_trips, accton_i2c_breaker_open(st),
+		       st->last_errno, st->last_error);
+}
+
+#endif /* ACCTON_I2C_RETRY_H */
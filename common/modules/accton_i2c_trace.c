@@ -0,0 +1,146 @@
+/*
+ * accton_i2c_trace.c - I2C access tracing shared by the Accton platform drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/i2c.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/bitops.h>
+#include <linux/math64.h>
+
+#define CREATE_TRACE_POINTS
+#include "accton_i2c_trace.h"
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(accton_i2c_xfer);
+
+bool accton_i2c_trace_hist;
+EXPORT_SYMBOL(accton_i2c_trace_hist);
+module_param_named(histograms, accton_i2c_trace_hist, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(histograms, "Keep per device latency histograms (default false)");
+
+static struct dentry *accton_i2c_debugfs;
+
+void accton_i2c_trace_record(struct accton_i2c_trace *tr,
+			     const struct i2c_client *client, char read_write,
+			     int size, u16 reg, u16 len, int result, u64 start)
+{
+	u64 ns = ktime_to_ns(ktime_get()) - start;
+
+	trace_accton_i2c_xfer(client, read_write, size, reg, len, result, ns);
+
+	if (!accton_i2c_trace_hist)
+		return;
+
+	tr->hist[min_t(int, fls64(div_u64(ns, NSEC_PER_USEC)),
+		       ACCTON_I2C_TRACE_BUCKETS - 1)]++;
+	tr->calls++;
+	tr->total_ns += ns;
+	if (ns > tr->max_ns)
+		tr->max_ns = ns;
+}
+EXPORT_SYMBOL(accton_i2c_trace_record);
+
+static int accton_i2c_trace_show(struct seq_file *s, void *unused)
+{
+	struct accton_i2c_trace *tr = s->private;
+	unsigned long calls = tr->calls;
+	int i;
+
+	seq_printf(s, "calls %lu\navg_ns %llu\nmax_ns %llu\n"
+		   "errors %lu\nnacks %lu\ntimeouts %lu\nlast_errno %d\n",
+		   calls, calls ? div_u64(tr->total_ns, calls) : 0,
+		   tr->max_ns, tr->errors, tr->nacks, tr->timeouts,
+		   tr->last_errno);
+
+	seq_printf(s, "%10s %10s\n", "usecs", "count");
+	for (i = 0; i < ACCTON_I2C_TRACE_BUCKETS; i++) {
+		seq_printf(s, "%9lu%s %10lu\n", i ? 1UL << (i - 1) : 0UL,
+			   i == ACCTON_I2C_TRACE_BUCKETS - 1 ? "+" : " ",
+			   tr->hist[i]);
+	}
+
+	return 0;
+}
+
+static int accton_i2c_trace_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, accton_i2c_trace_show, inode->i_private);
+}
+
+/* Writing anything clears the histogram and the counters */
+static ssize_t accton_i2c_trace_write(struct file *file,
+				      const char __user *buf, size_t count,
+				      loff_t *ppos)
+{
+	struct accton_i2c_trace *tr =
+		((struct seq_file *)file->private_data)->private;
+	struct dentry *dentry = tr->dentry;
+
+	memset(tr, 0, sizeof(*tr));
+	tr->dentry = dentry;
+
+	return count;
+}
+
+static const struct file_operations accton_i2c_trace_fops = {
+	.owner = THIS_MODULE,
+	.open = accton_i2c_trace_open,
+	.read = seq_read,
+	.write = accton_i2c_trace_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/*
+ * Show @tr as /sys/kernel/debug/accton_i2c/<dev_name of client>.
+ * Failing to is not an error, the device just has no file.
+ */
+void accton_i2c_trace_add(struct accton_i2c_trace *tr,
+			  struct i2c_client *client)
+{
+	tr->dentry = debugfs_create_file(dev_name(&client->dev),
+					 S_IRUGO | S_IWUSR, accton_i2c_debugfs,
+					 tr, &accton_i2c_trace_fops);
+}
+EXPORT_SYMBOL(accton_i2c_trace_add);
+
+void accton_i2c_trace_remove(struct accton_i2c_trace *tr)
+{
+	debugfs_remove(tr->dentry);
+	tr->dentry = NULL;
+}
+EXPORT_SYMBOL(accton_i2c_trace_remove);
+
+static int __init accton_i2c_trace_init(void)
+{
+	accton_i2c_debugfs = debugfs_create_dir("accton_i2c", NULL);
+	return 0;
+}
+
+static void __exit accton_i2c_trace_exit(void)
+{
+	debugfs_remove_recursive(accton_i2c_debugfs);
+}
+
+module_init(accton_i2c_trace_init);
+module_exit(accton_i2c_trace_exit);
+
+MODULE_DESCRIPTION("Tracing and latency histograms of Accton driver I2C accesses");
+MODULE_LICENSE("GPL");
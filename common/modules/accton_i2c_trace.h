@@ -0,0 +1,168 @@
+/*
+ * accton_i2c_trace.h - I2C access tracing shared by the Accton platform drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM accton_i2c
+
+#if !defined(ACCTON_I2C_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define ACCTON_I2C_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <linux/i2c.h>
+
+/*
+ * One SMBus/I2C call made by a driver. Retries show up as one event
+ * per attempt, so the gaps between them are the backoff sleeps; the
+ * duration includes the mux channel selects done by the i2c core.
+ */
+TRACE_EVENT(accton_i2c_xfer,
+	TP_PROTO(const struct i2c_client *client, char read_write, int size,
+		 u16 reg, u16 len, int result, u64 duration_ns),
+	TP_ARGS(client, read_write, size, reg, len, result, duration_ns),
+	TP_STRUCT__entry(
+		__field(int, adapter_nr)
+		__field(__u16, addr)
+		__field(char, read_write)
+		__field(int, size)
+		__field(__u16, reg)
+		__field(__u16, len)
+		__field(int, result)
+		__field(__u64, duration_ns)
+	),
+	TP_fast_assign(
+		__entry->adapter_nr = client->adapter->nr;
+		__entry->addr = client->addr;
+		__entry->read_write = read_write;
+		__entry->size = size;
+		__entry->reg = reg;
+		__entry->len = len;
+		__entry->result = result;
+		__entry->duration_ns = duration_ns;
+	),
+	TP_printk("i2c-%d a=%03x %s size=%d reg=0x%02x len=%u res=%d %llu ns",
+		  __entry->adapter_nr, __entry->addr,
+		  __entry->read_write == I2C_SMBUS_READ ? "rd" : "wr",
+		  __entry->size, __entry->reg, __entry->len, __entry->result,
+		  (unsigned long long)__entry->duration_ns)
+);
+
+#endif /* ACCTON_I2C_TRACE_H */
+
+#ifndef ACCTON_I2C_TRACE_API_H
+#define ACCTON_I2C_TRACE_API_H
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/errno.h>
+
+/*
+ * Besides the tracepoint, each device keeps a log2 histogram of its
+ * call latencies, bucket n counting calls of [2^(n-1), 2^n) us, and its
+ * error counters, shown in /sys/kernel/debug/accton_i2c/<dev_name>.
+ * The clock is read only while the tracepoint or the histograms
+ * (accton_i2c_trace.histograms, off by default) are enabled, so the
+ * histograms stay empty until the parameter is set. Errors are always
+ * counted. Counters are updated without locking, like
+ * accton_i2c_stats, so only approximate.
+ *
+ * The tracepoint and the debugfs directory live in accton_i2c_trace.ko.
+ */
+#define ACCTON_I2C_TRACE_BUCKETS	20	/* last one is 2^18 us and more */
+#define ACCTON_I2C_XFER_RAW		0xff	/* size of an i2c_transfer() */
+
+struct dentry;
+
+struct accton_i2c_trace {
+	unsigned long hist[ACCTON_I2C_TRACE_BUCKETS];
+	unsigned long calls;		/* timed calls */
+	u64 total_ns;
+	u64 max_ns;
+	unsigned long errors;
+	unsigned long nacks;
+	unsigned long timeouts;
+	int last_errno;
+	struct dentry *dentry;
+};
+
+extern bool accton_i2c_trace_hist;
+
+void accton_i2c_trace_add(struct accton_i2c_trace *tr,
+			  struct i2c_client *client);
+void accton_i2c_trace_remove(struct accton_i2c_trace *tr);
+void accton_i2c_trace_record(struct accton_i2c_trace *tr,
+			     const struct i2c_client *client, char read_write,
+			     int size, u16 reg, u16 len, int result, u64 start);
+
+/* Timestamp to hand to accton_i2c_trace_end(), 0 when nothing is timed */
+static inline u64 accton_i2c_trace_start(void)
+{
+	if (likely(!accton_i2c_trace_hist && !trace_accton_i2c_xfer_enabled()))
+		return 0;
+	return ktime_to_ns(ktime_get());
+}
+
+static inline void accton_i2c_trace_end(struct accton_i2c_trace *tr,
+					const struct i2c_client *client,
+					char read_write, int size, u16 reg,
+					u16 len, int result, u64 start)
+{
+	if (unlikely(result < 0)) {
+		tr->last_errno = result;
+		switch (result) {
+		case -ENXIO:
+		case -EREMOTEIO:
+			tr->nacks++;
+			break;
+		case -ETIMEDOUT:
+		case -EAGAIN:
+			tr->timeouts++;
+			break;
+		default:
+			tr->errors++;
+			break;
+		}
+	}
+
+	if (unlikely(start))
+		accton_i2c_trace_record(tr, client, read_write, size, reg, len,
+					result, start);
+}
+
+/*
+ * Evaluate the SMBus/I2C expression @expr on @client and account for it
+ * in @tr. Yields the result of @expr.
+ */
+#define accton_i2c_traced(tr, client, read_write, size, reg, len, expr) \
+({									\
+	u64 __start = accton_i2c_trace_start();			\
+	int __result = (expr);						\
+									\
+	accton_i2c_trace_end(tr, client, read_write, size, reg, len,	\
+			     __result, __start);			\
+	__result;							\
+})
+
+#endif /* ACCTON_I2C_TRACE_API_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE accton_i2c_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,266 @@
+/*
+ * accton_lm75.h - LM75 readings for the Accton fan drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ACCTON_LM75_H
+#define ACCTON_LM75_H
+
+#include <linux/kernel.h>
+#include <linux/i2c.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/string.h>
+#include "accton_i2c_trace.h"
+
+/*
+ * The i2c clients bound to the lm75 driver are looked up once and kept,
+ * a bus notifier drops them again when they are unbound or deleted.
+ * The temperature register is read directly, 9-bit resolution as the
+ * lm75 driver sets the chip up, and cached for as long as lm75 would.
+ * Each sensor kept has its accton_i2c_trace file, under the name of the
+ * lm75 client.
+ */
+#define ACCTON_LM75_DRIVER	"lm75"
+#define ACCTON_LM75_REG_TEMP	0x00
+#define ACCTON_LM75_MAX		8
+#define ACCTON_LM75_SAMPLE_MS	500	/* lm75 default sample time */
+#define ACCTON_LM75_RESCAN_MS	1000	/* while sensors are missing */
+
+struct accton_lm75_sensor {
+	struct i2c_client *client;
+	int mc;				/* milli-Celsius */
+	unsigned long last_updated;	/* jiffies */
+	bool valid;
+	struct accton_i2c_trace i2c_trace;
+};
+
+struct accton_lm75_sensors {
+	struct mutex lock;
+	struct notifier_block nb;
+	const unsigned short *addrs;	/* NULL: any lm75 client */
+	int num;			/* sensors expected */
+	struct accton_lm75_sensor sensor[ACCTON_LM75_MAX];
+	int found;
+	unsigned int gen;		/* bumped by the notifier */
+	unsigned long last_scan;	/* jiffies */
+	bool scanned;
+};
+
+struct accton_lm75_scan {
+	struct accton_lm75_sensors *s;
+	struct i2c_client *client[ACCTON_LM75_MAX];
+	int found;
+};
+
+static inline bool accton_lm75_match(struct accton_lm75_sensors *s,
+				     struct device *dev)
+{
+	struct i2c_client *client = i2c_verify_client(dev);
+	int i;
+
+	if (!client || !dev->driver || !dev->driver->name ||
+	    strcmp(dev->driver->name, ACCTON_LM75_DRIVER) != 0)
+		return false;
+
+	if (!s->addrs)
+		return true;
+
+	for (i = 0; i < s->num; i++) {
+		if (client->addr == s->addrs[i])
+			return true;
+	}
+	return false;
+}
+
+static inline int accton_lm75_scan_one(struct device *dev, void *data)
+{
+	struct accton_lm75_scan *scan = data;
+
+	if (scan->found >= scan->s->num || !accton_lm75_match(scan->s, dev))
+		return 0;
+
+	get_device(dev);
+	scan->client[scan->found++] = to_i2c_client(dev);
+	return 0;
+}
+
+static inline void accton_lm75_put_all(struct accton_lm75_sensors *s)
+{
+	int i;
+
+	for (i = 0; i < s->found; i++) {
+		accton_i2c_trace_remove(&s->sensor[i].i2c_trace);
+		put_device(&s->sensor[i].client->dev);
+	}
+	memset(s->sensor, 0, sizeof(s->sensor));
+	s->found = 0;
+}
+
+static inline int accton_lm75_notify(struct notifier_block *nb,
+				     unsigned long action, void *data)
+{
+	struct accton_lm75_sensors *s =
+		container_of(nb, struct accton_lm75_sensors, nb);
+	struct device *dev = data;
+	int i;
+
+	if (action == BUS_NOTIFY_BOUND_DRIVER) {
+		if (!accton_lm75_match(s, dev))
+			return NOTIFY_DONE;
+	} else if (action != BUS_NOTIFY_DEL_DEVICE &&
+		   action != BUS_NOTIFY_UNBOUND_DRIVER) {
+		return NOTIFY_DONE;
+	}
+
+	mutex_lock(&s->lock);
+	s->gen++;
+	if (action == BUS_NOTIFY_BOUND_DRIVER) {
+		s->scanned = false;	/* look again on next use */
+	} else {
+		for (i = 0; i < s->found; i++) {
+			if (&s->sensor[i].client->dev == dev) {
+				/* Simplest to start over from a new scan */
+				accton_lm75_put_all(s);
+				s->scanned = false;
+				break;
+			}
+		}
+	}
+	mutex_unlock(&s->lock);
+
+	return NOTIFY_DONE;
+}
+
+/* Called without s->lock, i2c_for_each_dev() takes the i2c core lock */
+static inline void accton_lm75_rescan(struct accton_lm75_sensors *s)
+{
+	struct accton_lm75_scan scan = { .s = s };
+	unsigned int gen;
+	int i;
+
+	mutex_lock(&s->lock);
+	gen = s->gen;
+	mutex_unlock(&s->lock);
+
+	i2c_for_each_dev(&scan, accton_lm75_scan_one);
+
+	mutex_lock(&s->lock);
+	if (gen == s->gen && scan.found > s->found) {
+		accton_lm75_put_all(s);
+		for (i = 0; i < scan.found; i++) {
+			s->sensor[i].client = scan.client[i];
+			accton_i2c_trace_add(&s->sensor[i].i2c_trace,
+					     scan.client[i]);
+		}
+		s->found = scan.found;
+		scan.found = 0;
+	}
+	s->scanned = true;
+	s->last_scan = jiffies;
+	mutex_unlock(&s->lock);
+
+	/* Lost the race with the notifier, or nothing new */
+	for (i = 0; i < scan.found; i++)
+		put_device(&scan.client[i]->dev);
+}
+
+static inline int accton_lm75_init(struct accton_lm75_sensors *s,
+				   const unsigned short *addrs, int num)
+{
+	memset(s, 0, sizeof(*s));
+	mutex_init(&s->lock);
+	s->addrs = addrs;
+	s->num = min(num, ACCTON_LM75_MAX);
+	s->nb.notifier_call = accton_lm75_notify;
+
+	return bus_register_notifier(&i2c_bus_type, &s->nb);
+}
+
+static inline void accton_lm75_exit(struct accton_lm75_sensors *s)
+{
+	bus_unregister_notifier(&i2c_bus_type, &s->nb);
+	mutex_lock(&s->lock);
+	accton_lm75_put_all(s);
+	mutex_unlock(&s->lock);
+}
+
+/*
+ * Sum the temperatures of the sensors, in milli-Celsius.
+ * Return how many sensors could be read.
+ */
+static inline int accton_lm75_sum(struct accton_lm75_sensors *s, int *sum_mc)
+{
+	struct accton_lm75_sensor *sensor;
+	int i, status, read = 0;
+	bool rescan;
+
+	mutex_lock(&s->lock);
+	rescan = !s->scanned || (s->found < s->num &&
+		 time_after(jiffies, s->last_scan +
+			    msecs_to_jiffies(ACCTON_LM75_RESCAN_MS)));
+	mutex_unlock(&s->lock);
+
+	if (rescan)
+		accton_lm75_rescan(s);
+
+	*sum_mc = 0;
+	mutex_lock(&s->lock);
+	for (i = 0; i < s->found; i++) {
+		sensor = &s->sensor[i];
+
+		if (!sensor->valid || time_after(jiffies, sensor->last_updated +
+				msecs_to_jiffies(ACCTON_LM75_SAMPLE_MS))) {
+			status = accton_i2c_traced(&sensor->i2c_trace,
+					sensor->client, I2C_SMBUS_READ,
+					I2C_SMBUS_WORD_DATA, ACCTON_LM75_REG_TEMP, 2,
+					i2c_smbus_read_word_swapped(sensor->client,
+								    ACCTON_LM75_REG_TEMP));
+			sensor->valid = (status >= 0);
+			sensor->last_updated = jiffies;
+			if (status >= 0)
+				sensor->mc = ((s16)status >> 7) * 500;
+		}
+
+		if (sensor->valid) {
+			*sum_mc += sensor->mc;
+			read++;
+		}
+	}
+	mutex_unlock(&s->lock);
+
+	return read;
+}
+
+/* Hottest of the sensors read by the last accton_lm75_sum() */
+static inline int accton_lm75_max(struct accton_lm75_sensors *s)
+{
+	int i, max_mc = INT_MIN;
+
+	mutex_lock(&s->lock);
+	for (i = 0; i < s->found; i++) {
+		if (s->sensor[i].valid && s->sensor[i].mc > max_mc)
+			max_mc = s->sensor[i].mc;
+	}
+	mutex_unlock(&s->lock);
+
+	return max_mc;
+}
+
+#endif /* ACCTON_LM75_H */
@@ -33,6 +33,7 @@
 #include <linux/jiffies.h>
 #include <linux/i2c/pmbus.h>
 #include "pmbus.h"
+#include "accton_pmbus_telemetry.h"
 
 
 enum chips {
@@ -65,6 +66,27 @@ enum chips {
 
 #define PMBUS_NAME_SIZE		24
 
+/*
+ * The registers are read through the shared PMBus register cache. A
+ * sensor reads its own register when that is older than the interval
+ * of its group; limits are read once, and again after a failed access.
+ */
+enum pmbus_3y_reg_group {
+    PMBUS_3Y_GROUP_STATIC,  /* limits */
+    PMBUS_3Y_GROUP_STATUS,
+    PMBUS_3Y_GROUP_SENSOR,
+    PMBUS_3Y_GROUP_COUNT
+};
+
+static unsigned int group_interval_ms[PMBUS_3Y_GROUP_COUNT] = {
+    [PMBUS_3Y_GROUP_STATUS] = 1000,
+    [PMBUS_3Y_GROUP_SENSOR] = 1000,
+};
+module_param_named(status_interval_ms, group_interval_ms[PMBUS_3Y_GROUP_STATUS], uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(status_interval_ms, "Refresh interval of the status registers in ms");
+module_param_named(sensor_interval_ms, group_interval_ms[PMBUS_3Y_GROUP_SENSOR], uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sensor_interval_ms, "Refresh interval of the sensor registers in ms");
+
 struct pmbus_sensor {
     struct pmbus_sensor *next;
     char name[PMBUS_NAME_SIZE];	/* sysfs sensor name */
@@ -73,6 +95,7 @@ struct pmbus_sensor {
     u16 reg;		/* register */
     enum pmbus_sensor_classes class;	/* sensor class */
     bool update;		/* runtime sensor update needed */
+    int idx;		/* register in the cache */
     int data;		/* Sensor data.
 				   Negative if there was a read error */
 };
@@ -116,7 +139,7 @@ struct pmbus_data {
 
     struct mutex update_lock;
     bool valid;
-    unsigned long last_updated;	/* in jiffies */
+    unsigned long last_updated;	/* of status[], in jiffies */
 
     /*
      * A single status register covers multiple attributes,
@@ -125,6 +148,12 @@ struct pmbus_data {
     u8 status[PB_NUM_STATUS_REG];
     u8 status_register;
 
+    struct accton_pmbus_telemetry pmbus;
+    struct accton_pmbus_reg *regs;
+    int nregs;
+    int status_idx[PB_NUM_STATUS_REG];	/* into regs, -1 if not read */
+    struct device_attribute stats_attr;
+
     u8 currpage;
     bool linear_16;
 };
@@ -139,8 +168,12 @@ int _pmbus_set_page(struct i2c_client *client, u8 page)
     int newpage;
 
     if (page != data->currpage) {
-        rv = i2c_smbus_write_byte_data(client, PMBUS_PAGE, page);
-        newpage = i2c_smbus_read_byte_data(client, PMBUS_PAGE);
+        rv = accton_i2c_traced(&data->pmbus.i2c_trace, client,
+                 I2C_SMBUS_WRITE, I2C_SMBUS_BYTE_DATA, PMBUS_PAGE, 1,
+                 i2c_smbus_write_byte_data(client, PMBUS_PAGE, page));
+        newpage = accton_i2c_traced(&data->pmbus.i2c_trace, client,
+                      I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, PMBUS_PAGE, 1,
+                      i2c_smbus_read_byte_data(client, PMBUS_PAGE));
         if (newpage != page)
             rv = -EIO;
         else
@@ -165,7 +198,9 @@ static int _pmbus_write_byte(struct i2c_client *client, int page, u8 value)
             return status;
     }
     /*Ignore page*/
-    return i2c_smbus_write_byte(client, value);;
+    return accton_i2c_traced(&data->pmbus.i2c_trace, client,
+               I2C_SMBUS_WRITE, I2C_SMBUS_BYTE, value, 0,
+               i2c_smbus_write_byte(client, value));
 }
 
 /*
@@ -175,10 +210,14 @@ static int _pmbus_write_byte(struct i2c_client *client, int page, u8 value)
 static int _pmbus_write_word_data(struct i2c_client *client, int page, int reg,
                                   u16 word)
 {
+    struct pmbus_data *data = i2c_get_clientdata(client);
+
     if (reg >= PMBUS_VIRT_BASE)
         return -ENXIO;
     /*Ignore page*/
-    return i2c_smbus_write_word_data(client, reg, word);
+    return accton_i2c_traced(&data->pmbus.i2c_trace, client,
+               I2C_SMBUS_WRITE, I2C_SMBUS_WORD_DATA, reg, 2,
+               i2c_smbus_write_word_data(client, reg, word));
 }
 
 /*
@@ -187,8 +226,12 @@ static int _pmbus_write_word_data(struct i2c_client *client, int page, int reg,
  */
 static int _pmbus_read_word_data(struct i2c_client *client, int page, int reg)
 {
+    struct pmbus_data *data = i2c_get_clientdata(client);
+
     /*Ignore page*/
-    return i2c_smbus_read_word_data(client, reg);;
+    return accton_i2c_traced(&data->pmbus.i2c_trace, client,
+               I2C_SMBUS_READ, I2C_SMBUS_WORD_DATA, reg, 2,
+               i2c_smbus_read_word_data(client, reg));
 }
 
 /*
@@ -197,11 +240,15 @@ static int _pmbus_read_word_data(struct i2c_client *client, int page, int reg)
  */
 static int _pmbus_read_byte_data(struct i2c_client *client, int page, int reg)
 {
+    struct pmbus_data *data = i2c_get_clientdata(client);
+
     if (reg >= PMBUS_VIRT_BASE)
         return -ENXIO;
 
     /*Ignore page*/
-    return i2c_smbus_read_byte_data(client, reg);
+    return accton_i2c_traced(&data->pmbus.i2c_trace, client,
+               I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA, reg, 1,
+               i2c_smbus_read_byte_data(client, reg));
 }
 
 static void pmbus_clear_fault_page(struct i2c_client *client, int page)
@@ -264,49 +311,35 @@ void _pmbus_clear_faults(struct i2c_client *client)
     for (i = 0; i < data->info->pages; i++)
         pmbus_clear_fault_page(client, i);
 }
+
+/*
+ * The status registers are read together: CLEAR_FAULTS, written after
+ * them, clears them all. Pages are not selected, so each register is
+ * read once for all the pages it stands for.
+ */
 static struct pmbus_data *pmbus_update_device(struct device *dev)
 {
     struct i2c_client *client = to_i2c_client(dev->parent);
     struct pmbus_data *data = i2c_get_clientdata(client);
-    const struct pmbus_driver_info *info = data->info;
-    struct pmbus_sensor *sensor;
+    unsigned int interval = group_interval_ms[PMBUS_3Y_GROUP_STATUS];
+    int i, idx, status;
 
     mutex_lock(&data->update_lock);
-    if (time_after(jiffies, data->last_updated + HZ) || !data->valid) {
-        int i, j;
-
-        for (i = 0; i < info->pages; i++) {
-            data->status[PB_STATUS_BASE + i]
-                = _pmbus_read_byte_data(client, i,
-                                        data->status_register);
-            for (j = 0; j < ARRAY_SIZE(pmbus_status); j++) {
-                struct _pmbus_status *s = &pmbus_status[j];
-
-                if (!(info->func[i] & s->func))
-                    continue;
-                data->status[s->base + i]
-                    = _pmbus_read_byte_data(client, i,
-                                            s->reg);
-            }
+    if (time_after(jiffies, data->last_updated + msecs_to_jiffies(interval)) ||
+            !data->valid) {
+        for (idx = 0; idx < data->nregs; idx++) {
+            if (data->regs[idx].group == PMBUS_3Y_GROUP_STATUS)
+                accton_pmbus_refresh(&data->pmbus, idx);
         }
 
-        if (info->func[0] & PMBUS_HAVE_STATUS_INPUT)
-            data->status[PB_STATUS_INPUT_BASE]
-                = _pmbus_read_byte_data(client, 0,
-                                        PMBUS_STATUS_INPUT);
-
-        if (info->func[0] & PMBUS_HAVE_STATUS_VMON)
-            data->status[PB_STATUS_VMON_BASE]
-                = _pmbus_read_byte_data(client, 0,
-                                        PMBUS_VIRT_STATUS_VMON);
-
-        for (sensor = data->sensors; sensor; sensor = sensor->next) {
-            if (!data->valid || sensor->update)
-                sensor->data
-                    = _pmbus_read_word_data(client,
-                                            sensor->page,
-                                            sensor->reg);
+        for (i = 0; i < PB_NUM_STATUS_REG; i++) {
+            idx = data->status_idx[i];
+            if (idx < 0)
+                continue;
+            status = data->pmbus.cache[idx].status;
+            data->status[i] = (status < 0) ? status : data->pmbus.cache[idx].word;
         }
+
         _pmbus_clear_faults(client);
         data->last_updated = jiffies;
         data->valid = 1;
@@ -315,6 +348,15 @@ static struct pmbus_data *pmbus_update_device(struct device *dev)
     return data;
 }
 
+/* Called with update_lock held */
+static void pmbus_update_sensor(struct pmbus_data *data,
+                                struct pmbus_sensor *sensor)
+{
+    int status = accton_pmbus_update(&data->pmbus, sensor->idx);
+
+    sensor->data = (status < 0) ? status : data->pmbus.cache[sensor->idx].word;
+}
+
 /*
  * Convert linear sensor values to milli- or micro-units
  * depending on sensor type.
@@ -633,7 +675,13 @@ static ssize_t pmbus_show_boolean(struct device *dev,
     struct pmbus_data *data = pmbus_update_device(dev);
     int val;
 
+    mutex_lock(&data->update_lock);
+    if (boolean->s1 && boolean->s2) {
+        pmbus_update_sensor(data, boolean->s1);
+        pmbus_update_sensor(data, boolean->s2);
+    }
     val = pmbus_get_boolean(data, boolean, attr->index);
+    mutex_unlock(&data->update_lock);
     if (val < 0) {
         return snprintf(buf, PAGE_SIZE, "%d\n", 1);
     }
@@ -643,16 +691,18 @@ static ssize_t pmbus_show_boolean(struct device *dev,
 static ssize_t pmbus_show_sensor(struct device *dev,
                                  struct device_attribute *devattr, char *buf)
 {
-    struct pmbus_data *data = pmbus_update_device(dev);
+    struct i2c_client *client = to_i2c_client(dev->parent);
+    struct pmbus_data *data = i2c_get_clientdata(client);
     struct pmbus_sensor *sensor = to_pmbus_sensor(devattr);
+    long val = 0;
 
+    mutex_lock(&data->update_lock);
+    pmbus_update_sensor(data, sensor);
+    if (sensor->data >= 0)
+        val = pmbus_reg2data(data, sensor);
+    mutex_unlock(&data->update_lock);
 
-    if (sensor->data < 0) {
-        return snprintf(buf, PAGE_SIZE, "%d\n", 0);
-    }
-
-
-    return snprintf(buf, PAGE_SIZE, "%ld\n", pmbus_reg2data(data, sensor));
+    return snprintf(buf, PAGE_SIZE, "%ld\n", val);
 }
 
 static ssize_t pmbus_set_sensor(struct device *dev,
@@ -677,10 +727,25 @@ static ssize_t pmbus_set_sensor(struct device *dev,
         rv = ret;
     else
         sensor->data = regval;
+    accton_pmbus_invalidate(&data->pmbus, sensor->idx);
     mutex_unlock(&data->update_lock);
     return rv;
 }
 
+static ssize_t pmbus_show_stats(struct device *dev,
+                                struct device_attribute *da, char *buf)
+{
+    struct i2c_client *client = to_i2c_client(dev->parent);
+    struct pmbus_data *data = i2c_get_clientdata(client);
+    ssize_t ret;
+
+    mutex_lock(&data->update_lock);
+    ret = accton_pmbus_stats_show(&data->pmbus, buf);
+    mutex_unlock(&data->update_lock);
+
+    return ret;
+}
+
 static ssize_t pmbus_show_label(struct device *dev,
                                 struct device_attribute *da, char *buf)
 {
@@ -1675,6 +1740,77 @@ static int pmbus_init_common(struct i2c_client *client, struct pmbus_data *data,
     return 0;
 }
 
+static int pmbus_add_reg(struct pmbus_data *data, int reg, u8 type, u8 group)
+{
+    struct accton_pmbus_reg *r;
+    int i;
+
+    for (i = 0; i < data->nregs; i++) {
+        r = &data->regs[i];
+        if (r->cmd == (u8)reg && r->type == type && r->group == group)
+            return i;
+    }
+
+    r = &data->regs[data->nregs];
+    r->cmd = reg;
+    r->type = type;
+    r->group = group;
+    return data->nregs++;
+}
+
+/*
+ * The table of the registers the status and the sensor attributes read,
+ * for the shared register cache. Registers are not paged here, so each
+ * is in the table once.
+ */
+static int pmbus_init_regs(struct i2c_client *client, struct pmbus_data *data)
+{
+    const struct pmbus_driver_info *info = data->info;
+    struct pmbus_sensor *sensor;
+    int i, j, nregs = PB_NUM_STATUS_REG;
+
+    for (sensor = data->sensors; sensor; sensor = sensor->next)
+        nregs++;
+
+    data->regs = devm_kcalloc(data->dev, nregs, sizeof(*data->regs),
+                              GFP_KERNEL);
+    if (!data->regs)
+        return -ENOMEM;
+
+    for (i = 0; i < PB_NUM_STATUS_REG; i++)
+        data->status_idx[i] = -1;
+
+    for (i = 0; i < info->pages; i++) {
+        data->status_idx[PB_STATUS_BASE + i]
+            = pmbus_add_reg(data, data->status_register,
+                            ACCTON_PMBUS_BYTE, PMBUS_3Y_GROUP_STATUS);
+        for (j = 0; j < ARRAY_SIZE(pmbus_status); j++) {
+            struct _pmbus_status *st = &pmbus_status[j];
+
+            if (!(info->func[i] & st->func))
+                continue;
+            data->status_idx[st->base + i]
+                = pmbus_add_reg(data, st->reg, ACCTON_PMBUS_BYTE,
+                                PMBUS_3Y_GROUP_STATUS);
+        }
+    }
+
+    if (info->func[0] & PMBUS_HAVE_STATUS_INPUT)
+        data->status_idx[PB_STATUS_INPUT_BASE]
+            = pmbus_add_reg(data, PMBUS_STATUS_INPUT, ACCTON_PMBUS_BYTE,
+                            PMBUS_3Y_GROUP_STATUS);
+    /* PMBUS_VIRT_STATUS_VMON is not on the PSU, there is nothing to read */
+
+    for (sensor = data->sensors; sensor; sensor = sensor->next) {
+        sensor->idx = pmbus_add_reg(data, sensor->reg, ACCTON_PMBUS_WORD,
+                                    sensor->update ? PMBUS_3Y_GROUP_SENSOR :
+                                    PMBUS_3Y_GROUP_STATIC);
+    }
+
+    return accton_pmbus_init(&data->pmbus, client, data->regs, data->nregs,
+                             group_interval_ms);
+}
+
 int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
                     struct pmbus_driver_info *info)
 {
@@ -1733,6 +1869,16 @@ int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
         goto out_kfree;
     }
 
+    ret = pmbus_init_regs(client, data);
+    if (ret)
+        goto out_kfree;
+
+    pmbus_dev_attr_init(&data->stats_attr, "pmbus_stats", S_IRUGO,
+                        pmbus_show_stats, NULL);
+    ret = pmbus_add_attribute(data, &data->stats_attr.attr);
+    if (ret)
+        goto out_kfree;
+
     data->groups[0] = &data->group;
     data->hwmon_dev = hwmon_device_register_with_groups(dev, client->name,
                       data, data->groups);
@@ -1744,6 +1890,7 @@ int _pmbus_do_probe(struct i2c_client *client, const struct i2c_device_id *id,
     return 0;
 
 out_kfree:
+    accton_pmbus_free(&data->pmbus);
     kfree(data->group.attrs);
     return ret;
 }
@@ -1955,6 +2102,7 @@ int _pmbus_do_remove(struct i2c_client *client)
 {
     struct pmbus_data *data = i2c_get_clientdata(client);
     hwmon_device_unregister(data->hwmon_dev);
+    accton_pmbus_free(&data->pmbus);
     kfree(data->group.attrs);
     return 0;
 }
@@ -0,0 +1,610 @@
+/*
+ * accton_pmbus_telemetry.h - PMBus register cache shared by the Accton
+ * PSU drivers
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ACCTON_PMBUS_TELEMETRY_H
+#define ACCTON_PMBUS_TELEMETRY_H
+
+#include <linux/kernel.h>
+#include <linux/i2c.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
+
+#include "accton_i2c_retry.h"
+#include "accton_i2c_trace.h"
+
+/*
+ * A PSU driver describes its registers in a table of accton_pmbus_reg.
+ * Each register is read on demand, when it is older than the interval
+ * of its group, so reading one attribute costs one transfer at most.
+ * Groups with a 0 interval hold values that are fixed while the PSU is
+ * inserted: they are read once, and again after any access failed,
+ * which is how a removed PSU shows up.
+ *
+ * When the adapter can do block process calls, PMBus QUERY is used on
+ * first access to skip the commands the PSU does not implement.
+ * Register reads go through accton_i2c_retry(), QUERY is tried once.
+ * Both are traced as accesses of the PSU, see accton_i2c_trace.h.
+ */
+#define ACCTON_PMBUS_QUERY		0x1a
+#define ACCTON_PMBUS_QUERY_SUPPORTED	0x80
+#define ACCTON_PMBUS_BLOCK_MAX		16
+
+enum {
+	ACCTON_PMBUS_BYTE,
+	ACCTON_PMBUS_WORD,
+	ACCTON_PMBUS_BLOCK,	/* i2c block read, count byte included */
+};
+
+struct accton_pmbus_reg {
+	u8 cmd;
+	u8 type;
+	u8 len;		/* bytes of a block read */
+	u8 group;	/* index into the interval table */
+};
+
+#define ACCTON_PMBUS_REG(c, t, g)	{ .cmd = (c), .type = (t), .group = (g) }
+#define ACCTON_PMBUS_BLOCK_REG(c, l, g)	\
+	{ .cmd = (c), .type = ACCTON_PMBUS_BLOCK, .len = (l), .group = (g) }
+
+enum {
+	ACCTON_PMBUS_UNQUERIED = 0,
+	ACCTON_PMBUS_SUPPORTED,
+	ACCTON_PMBUS_UNSUPPORTED,
+};
+
+struct accton_pmbus_cache {
+	unsigned long stamp;	/* jiffies */
+	u8 valid;
+	u8 query;
+	u16 word;		/* byte and word registers */
+	int status;		/* of the last read, returned while fresh */
+	u8 block[ACCTON_PMBUS_BLOCK_MAX + 1];	/* NUL terminated */
+};
+
+/* Callers serialize access, usually with the driver's update_lock */
+struct accton_pmbus_telemetry {
+	struct i2c_client *client;
+	const struct accton_pmbus_reg *regs;
+	const unsigned int *interval_ms;	/* per group */
+	struct accton_pmbus_cache *cache;
+	int nregs;
+	bool query;
+	unsigned long transfers;
+	unsigned long hits;
+	struct accton_i2c_stats i2c_stats;
+	struct accton_i2c_trace i2c_trace;
+};
+
+static inline int accton_pmbus_init(struct accton_pmbus_telemetry *t,
+				    struct i2c_client *client,
+				    const struct accton_pmbus_reg *regs,
+				    int nregs,
+				    const unsigned int *interval_ms)
+{
+	t->client = client;
+	t->regs = regs;
+	t->nregs = nregs;
+	t->interval_ms = interval_ms;
+	t->query = i2c_check_functionality(client->adapter,
+					   I2C_FUNC_SMBUS_BLOCK_PROC_CALL);
+	t->cache = kcalloc(nregs, sizeof(*t->cache), GFP_KERNEL);
+	if (!t->cache)
+		return -ENOMEM;
+
+	accton_i2c_trace_add(&t->i2c_trace, client);
+	return 0;
+}
+
+static inline void accton_pmbus_free(struct accton_pmbus_telemetry *t)
+{
+	accton_i2c_trace_remove(&t->i2c_trace);
+	kfree(t->cache);
+	t->cache = NULL;
+}
+
+static inline void accton_pmbus_invalidate(struct accton_pmbus_telemetry *t,
+					   int idx)
+{
+	t->cache[idx].valid = 0;
+}
+
+/* The PSU stopped answering: forget everything learned from it */
+static inline void accton_pmbus_lost(struct accton_pmbus_telemetry *t)
+{
+	int i;
+
+	for (i = 0; i < t->nregs; i++) {
+		if (!t->interval_ms[t->regs[i].group])
+			t->cache[i].valid = 0;
+		t->cache[i].query = ACCTON_PMBUS_UNQUERIED;
+	}
+}
+
+static inline u8 accton_pmbus_query(struct accton_pmbus_telemetry *t, u8 cmd)
+{
+	struct i2c_client *client = t->client;
+	union i2c_smbus_data data;
+	int status;
+
+	data.block[0] = 1;
+	data.block[1] = cmd;
+	t->transfers++;
+	status = accton_i2c_traced(&t->i2c_trace, client,
+			I2C_SMBUS_WRITE, I2C_SMBUS_BLOCK_PROC_CALL,
+			ACCTON_PMBUS_QUERY, 1,
+			i2c_smbus_xfer(client->adapter, client->addr,
+				       client->flags, I2C_SMBUS_WRITE,
+				       ACCTON_PMBUS_QUERY,
+				       I2C_SMBUS_BLOCK_PROC_CALL, &data));
+
+	/* No answer to QUERY itself says nothing about cmd */
+	if (status < 0 || data.block[0] < 1)
+		return ACCTON_PMBUS_SUPPORTED;
+
+	return (data.block[1] & ACCTON_PMBUS_QUERY_SUPPORTED) ?
+		ACCTON_PMBUS_SUPPORTED : ACCTON_PMBUS_UNSUPPORTED;
+}
+
+/* The one read path for all register sizes */
+static inline int accton_pmbus_read(struct accton_pmbus_telemetry *t, int idx)
+{
+	const struct accton_pmbus_reg *reg = &t->regs[idx];
+	struct accton_pmbus_cache *c = &t->cache[idx];
+	struct i2c_client *client = t->client;
+	int len = min_t(int, reg->len, ACCTON_PMBUS_BLOCK_MAX);
+	int status;
+
+	t->transfers++;
+	switch (reg->type) {
+	case ACCTON_PMBUS_BYTE:
+		status = accton_i2c_retry(&t->i2c_stats,
+				accton_i2c_traced(&t->i2c_trace, client,
+					I2C_SMBUS_READ, I2C_SMBUS_BYTE_DATA,
+					reg->cmd, 1,
+					i2c_smbus_read_byte_data(client,
+								 reg->cmd)));
+		if (status >= 0)
+			c->word = status;
+		break;
+	case ACCTON_PMBUS_WORD:
+		status = accton_i2c_retry(&t->i2c_stats,
+				accton_i2c_traced(&t->i2c_trace, client,
+					I2C_SMBUS_READ, I2C_SMBUS_WORD_DATA,
+					reg->cmd, 2,
+					i2c_smbus_read_word_data(client,
+								 reg->cmd)));
+		if (status >= 0)
+			c->word = status;
+		break;
+	default:
+		memset(c->block, 0, sizeof(c->block));
+		status = accton_i2c_retry(&t->i2c_stats,
+				accton_i2c_traced(&t->i2c_trace, client,
+					I2C_SMBUS_READ,
+					I2C_SMBUS_I2C_BLOCK_DATA, reg->cmd, len,
+					i2c_smbus_read_i2c_block_data(client,
+						reg->cmd, len, c->block)));
+		if (status >= 0 && status != len)
+			status = -EIO;
+		break;
+	}
+
+	if (status < 0) {
+		dev_dbg(&client->dev, "reg %d, err %d\n", reg->cmd, status);
+		c->word = 0;
+		return status;
+	}
+
+	return 0;
+}
+
+/*
+ * Make register idx fresh. On failure its value reads as 0, as the
+ * drivers did before, and a fixed register is read again on its next
+ * access.
+ * Returns the status of the read the value comes from.
+ */
+static inline int accton_pmbus_update(struct accton_pmbus_telemetry *t,
+				      int idx)
+{
+	struct accton_pmbus_cache *c = &t->cache[idx];
+	unsigned int interval = t->interval_ms[t->regs[idx].group];
+	int status;
+
+	if (c->valid && (!interval || time_before(jiffies,
+			c->stamp + msecs_to_jiffies(interval)))) {
+		t->hits++;
+		return c->status;
+	}
+
+	if (t->query && c->query == ACCTON_PMBUS_UNQUERIED)
+		c->query = accton_pmbus_query(t, t->regs[idx].cmd);
+
+	if (c->query == ACCTON_PMBUS_UNSUPPORTED) {
+		c->word = 0;
+		memset(c->block, 0, sizeof(c->block));
+		status = 0;
+	} else {
+		status = accton_pmbus_read(t, idx);
+		if (status < 0)
+			accton_pmbus_lost(t);
+	}
+
+	/* A fixed register only ever holds a value actually read */
+	c->stamp = jiffies;
+	c->valid = status >= 0 || interval;
+	c->status = status;
+	return status;
+}
+
+static inline u16 accton_pmbus_word(struct accton_pmbus_telemetry *t, int idx)
+{
+	accton_pmbus_update(t, idx);
+	return t->cache[idx].word;
+}
+
+static inline const u8 *accton_pmbus_block(struct accton_pmbus_telemetry *t,
+					   int idx)
+{
+	accton_pmbus_update(t, idx);
+	return t->cache[idx].block;
+}
+
+/* Read idx from the PSU now, whatever its age */
+static inline int accton_pmbus_refresh(struct accton_pmbus_telemetry *t,
+				       int idx)
+{
+	accton_pmbus_invalidate(t, idx);
+	return accton_pmbus_update(t, idx);
+}
+
+/*
+ * For a PSU whose values are handed to the driver, by the BMC, rather
+ * than read: set idx as if it had just been read. A register stored
+ * before its first access, in a 0 interval group, is never read.
+ */
+static inline void accton_pmbus_store(struct accton_pmbus_telemetry *t,
+				      int idx, u16 word)
+{
+	struct accton_pmbus_cache *c = &t->cache[idx];
+
+	c->word = (t->regs[idx].type == ACCTON_PMBUS_BYTE) ? (u8)word : word;
+	c->status = 0;
+	c->stamp = jiffies;
+	c->valid = 1;
+}
+
+static inline void accton_pmbus_store_block(struct accton_pmbus_telemetry *t,
+					    int idx, const void *buf, size_t len)
+{
+	struct accton_pmbus_cache *c = &t->cache[idx];
+
+	memset(c->block, 0, sizeof(c->block));
+	memcpy(c->block, buf, min_t(size_t, len,
+				    min_t(int, t->regs[idx].len,
+					  ACCTON_PMBUS_BLOCK_MAX)));
+	c->status = 0;
+	c->stamp = jiffies;
+	c->valid = 1;
+}
+
+/* 2^n for the negative LINEAR exponents, -16..-1 */
+static const int accton_pmbus_pow2[] = {
+	1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048,
+	4096, 8192, 16384, 32768, 65536
+};
+
+/* Scale mantissa * 2^exponent by multiplier, truncating like before */
+static inline int accton_pmbus_scale(int mantissa, int exponent,
+				     int multiplier)
+{
+	if (exponent >= 0)
+		return (mantissa << exponent) * multiplier;
+
+	return (mantissa * multiplier) / accton_pmbus_pow2[-exponent];
+}
+
+/* LINEAR11: 5 bit two's complement exponent, 11 bit mantissa */
+static inline int accton_pmbus_linear11(u16 raw, int multiplier)
+{
+	int exponent = ((s16)raw) >> 11;
+	int mantissa = ((s16)(raw << 5)) >> 5;
+
+	return accton_pmbus_scale(mantissa, exponent, multiplier);
+}
+
+/* LINEAR16: unsigned mantissa, exponent from VOUT_MODE */
+static inline int accton_pmbus_linear16(u16 raw, u8 vout_mode,
+					int multiplier)
+{
+	int exponent = ((s8)(vout_mode << 3)) >> 3;
+
+	return accton_pmbus_scale(raw, exponent, multiplier);
+}
+
+/* Body for a "pmbus_stats" sysfs attribute */
+static inline ssize_t accton_pmbus_stats_show(struct accton_pmbus_telemetry *t,
+					      char *buf)
+{
+	ssize_t len;
+
+	len = sprintf(buf, "transfers %lu\ncache_hits %lu\nquery %d\n",
+		      t->transfers, t->hits, t->query);
+	return len + accton_i2c_stats_show(&t->i2c_stats, buf + len);
+}
+
+/*
+ * Optional power sampling. A delayed work reads READ_PIN, READ_POUT and
+ * READ_IIN every interval_ms, keeps the last samples in a ring and
+ * running min, max and sum per channel, and integrates the input power
+ * into energy. The worker is the only writer, under the driver's lock;
+ * the attributes read through a seqcount and never take the lock.
+ */
+#define ACCTON_PMBUS_RING_SIZE		64	/* power of 2 */
+#define ACCTON_PMBUS_SAMPLE_MIN_MS	20
+
+enum {
+	ACCTON_PMBUS_PIN,	/* mW */
+	ACCTON_PMBUS_POUT,	/* mW */
+	ACCTON_PMBUS_IIN,	/* mA */
+	ACCTON_PMBUS_CHANNELS
+};
+
+struct accton_pmbus_sample {
+	s64 stamp_ms;		/* ktime */
+	u32 value[ACCTON_PMBUS_CHANNELS];
+};
+
+struct accton_pmbus_stat {
+	u32 lowest;
+	u32 highest;
+	u64 sum;
+};
+
+struct accton_pmbus_sampler {
+	struct delayed_work work;
+	struct mutex *lock;		/* protects t */
+	struct accton_pmbus_telemetry *t;
+	int reg[ACCTON_PMBUS_CHANNELS];	/* register index in t */
+	unsigned int interval_ms;
+	bool running;
+	seqcount_t seq;
+	struct accton_pmbus_sample ring[ACCTON_PMBUS_RING_SIZE];
+	unsigned int head;		/* samples written, ever */
+	struct accton_pmbus_stat stat[ACCTON_PMBUS_CHANNELS];
+	u64 count;			/* samples since reset */
+	u64 energy_uj;
+	s64 last_ns;			/* 0: no previous sample */
+	u32 last_pin;
+	unsigned long errors;
+};
+
+static inline void accton_pmbus_sampler_reset(struct accton_pmbus_sampler *s)
+{
+	int i;
+
+	mutex_lock(s->lock);
+	preempt_disable();
+	write_seqcount_begin(&s->seq);
+	for (i = 0; i < ACCTON_PMBUS_CHANNELS; i++) {
+		s->stat[i].lowest = 0;
+		s->stat[i].highest = 0;
+		s->stat[i].sum = 0;
+	}
+	s->count = 0;
+	s->energy_uj = 0;
+	s->last_ns = 0;
+	write_seqcount_end(&s->seq);
+	preempt_enable();
+	mutex_unlock(s->lock);
+}
+
+static inline void accton_pmbus_sampler_add(struct accton_pmbus_sampler *s,
+					    const u32 *value, s64 now_ns)
+{
+	struct accton_pmbus_sample *sample;
+	int i;
+
+	preempt_disable();
+	write_seqcount_begin(&s->seq);
+
+	sample = &s->ring[s->head & (ACCTON_PMBUS_RING_SIZE - 1)];
+	sample->stamp_ms = div_s64(now_ns, NSEC_PER_MSEC);
+	for (i = 0; i < ACCTON_PMBUS_CHANNELS; i++) {
+		struct accton_pmbus_stat *st = &s->stat[i];
+
+		sample->value[i] = value[i];
+		if (!s->count || value[i] < st->lowest)
+			st->lowest = value[i];
+		if (!s->count || value[i] > st->highest)
+			st->highest = value[i];
+		st->sum += value[i];
+	}
+	s->head++;
+	s->count++;
+
+	/* Trapezoid rule, mW * ms = uJ */
+	if (s->last_ns) {
+		s->energy_uj += div_u64((u64)(s->last_pin + value[ACCTON_PMBUS_PIN]) *
+					(u64)(now_ns - s->last_ns),
+					2 * NSEC_PER_MSEC);
+	}
+	s->last_ns = now_ns;
+	s->last_pin = value[ACCTON_PMBUS_PIN];
+
+	write_seqcount_end(&s->seq);
+	preempt_enable();
+}
+
+static inline void accton_pmbus_sample_work(struct work_struct *work)
+{
+	struct accton_pmbus_sampler *s = container_of(to_delayed_work(work),
+					 struct accton_pmbus_sampler, work);
+	u32 value[ACCTON_PMBUS_CHANNELS];
+	int i, status = 0;
+	int raw;
+
+	mutex_lock(s->lock);
+	for (i = 0; i < ACCTON_PMBUS_CHANNELS && !status; i++) {
+		status = accton_pmbus_refresh(s->t, s->reg[i]);
+		raw = accton_pmbus_linear11(s->t->cache[s->reg[i]].word, 1000);
+		value[i] = max(raw, 0);
+	}
+
+	if (status) {
+		/* Do not integrate over the time the PSU did not answer */
+		s->errors++;
+		s->last_ns = 0;
+	} else {
+		accton_pmbus_sampler_add(s, value, ktime_to_ns(ktime_get()));
+	}
+	mutex_unlock(s->lock);
+
+	schedule_delayed_work(&s->work, msecs_to_jiffies(s->interval_ms));
+}
+
+static inline void accton_pmbus_sampler_start(struct accton_pmbus_sampler *s,
+					      struct accton_pmbus_telemetry *t,
+					      struct mutex *lock,
+					      int pin, int pout, int iin,
+					      unsigned int interval_ms)
+{
+	s->t = t;
+	s->lock = lock;
+	s->reg[ACCTON_PMBUS_PIN] = pin;
+	s->reg[ACCTON_PMBUS_POUT] = pout;
+	s->reg[ACCTON_PMBUS_IIN] = iin;
+	s->interval_ms = max_t(unsigned int, interval_ms,
+			       ACCTON_PMBUS_SAMPLE_MIN_MS);
+	seqcount_init(&s->seq);
+	INIT_DELAYED_WORK(&s->work, accton_pmbus_sample_work);
+	s->running = true;
+	schedule_delayed_work(&s->work, 0);
+}
+
+static inline void accton_pmbus_sampler_stop(struct accton_pmbus_sampler *s)
+{
+	if (s->running) {
+		cancel_delayed_work_sync(&s->work);
+		s->running = false;
+	}
+}
+
+static inline void accton_pmbus_sampler_read(struct accton_pmbus_sampler *s,
+					     struct accton_pmbus_stat *stat,
+					     u64 *count, u64 *energy_uj)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&s->seq);
+		memcpy(stat, s->stat, sizeof(s->stat));
+		*count = s->count;
+		*energy_uj = s->energy_uj;
+	} while (read_seqcount_retry(&s->seq, seq));
+}
+
+enum {
+	ACCTON_PMBUS_AVERAGE,
+	ACCTON_PMBUS_HIGHEST,
+	ACCTON_PMBUS_LOWEST,
+};
+
+/* Body of the powerN_average, powerN_input_highest, ... attributes.
+ * scale turns mW into the uW of hwmon, and is 1 for mA.
+ */
+static inline ssize_t accton_pmbus_sampler_show(struct accton_pmbus_sampler *s,
+						int channel, int kind,
+						int scale, char *buf)
+{
+	struct accton_pmbus_stat stat[ACCTON_PMBUS_CHANNELS];
+	u64 count, energy_uj, value = 0;
+
+	accton_pmbus_sampler_read(s, stat, &count, &energy_uj);
+	if (count) {
+		switch (kind) {
+		case ACCTON_PMBUS_AVERAGE:
+			value = div64_u64(stat[channel].sum, count);
+			break;
+		case ACCTON_PMBUS_HIGHEST:
+			value = stat[channel].highest;
+			break;
+		case ACCTON_PMBUS_LOWEST:
+			value = stat[channel].lowest;
+			break;
+		}
+	}
+
+	return sprintf(buf, "%llu\n", value * scale);
+}
+
+static inline ssize_t accton_pmbus_energy_show(struct accton_pmbus_sampler *s,
+					       char *buf)
+{
+	struct accton_pmbus_stat stat[ACCTON_PMBUS_CHANNELS];
+	u64 count, energy_uj;
+
+	accton_pmbus_sampler_read(s, stat, &count, &energy_uj);
+	return sprintf(buf, "%llu\n", energy_uj);
+}
+
+/* The ring, oldest first: "<ms> <pin mW> <pout mW> <iin mA>" per line */
+static inline ssize_t accton_pmbus_samples_show(struct accton_pmbus_sampler *s,
+						char *buf)
+{
+	struct accton_pmbus_sample *ring;
+	unsigned int seq, head, n, i;
+	ssize_t len = 0;
+
+	ring = kmalloc(sizeof(s->ring), GFP_KERNEL);
+	if (!ring)
+		return -ENOMEM;
+
+	do {
+		seq = read_seqcount_begin(&s->seq);
+		memcpy(ring, s->ring, sizeof(s->ring));
+		head = s->head;
+	} while (read_seqcount_retry(&s->seq, seq));
+
+	n = min_t(unsigned int, head, ACCTON_PMBUS_RING_SIZE);
+	for (i = head - n; i != head; i++) {
+		struct accton_pmbus_sample *sample =
+			&ring[i & (ACCTON_PMBUS_RING_SIZE - 1)];
+
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%lld %u %u %u\n",
+				 sample->stamp_ms,
+				 sample->value[ACCTON_PMBUS_PIN],
+				 sample->value[ACCTON_PMBUS_POUT],
+				 sample->value[ACCTON_PMBUS_IIN]);
+	}
+
+	kfree(ring);
+	return len;
+}
+
+#endif /* ACCTON_PMBUS_TELEMETRY_H */
@@ -33,6 +33,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_pmbus_telemetry.h"
 
 #define MAX_FAN_DUTY_CYCLE 100
 
@@ -40,24 +41,56 @@
  */
 static const unsigned short normal_i2c[] = { 0x3c, 0x3d, 0x3e, 0x3f, I2C_CLIENT_END };
 
+enum cpr_4011_4mxx_reg_group {
+    CPR_4011_4MXX_GROUP_STATIC,   /* vout_mode */
+    CPR_4011_4MXX_GROUP_SENSOR,
+    CPR_4011_4MXX_GROUP_COUNT
+};
+
+static const unsigned int group_interval_ms[CPR_4011_4MXX_GROUP_COUNT] = {
+    [CPR_4011_4MXX_GROUP_SENSOR] = 1500,
+};
+
+static unsigned int sample_interval_ms = 0;
+module_param(sample_interval_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(sample_interval_ms, "Sample input/output power every that many ms for the average, highest and energy attributes, 0 to disable");
+
+enum cpr_4011_4mxx_regs {
+    CPR_4011_4MXX_VOUT_MODE,
+    CPR_4011_4MXX_FAN_FAULT,
+    CPR_4011_4MXX_P_OUT,
+    CPR_4011_4MXX_P_IN,
+    CPR_4011_4MXX_V_IN,
+    CPR_4011_4MXX_V_OUT,
+    CPR_4011_4MXX_I_IN,
+    CPR_4011_4MXX_I_OUT,
+    CPR_4011_4MXX_TEMP1,
+    CPR_4011_4MXX_FAN_DUTY_CYCLE1,
+    CPR_4011_4MXX_FAN_SPEED1,
+    CPR_4011_4MXX_REG_COUNT
+};
+
+static const struct accton_pmbus_reg cpr_4011_4mxx_regs[CPR_4011_4MXX_REG_COUNT] = {
+    [CPR_4011_4MXX_VOUT_MODE]       = ACCTON_PMBUS_REG(0x20, ACCTON_PMBUS_BYTE, CPR_4011_4MXX_GROUP_STATIC),
+    [CPR_4011_4MXX_FAN_FAULT]       = ACCTON_PMBUS_REG(0x81, ACCTON_PMBUS_BYTE, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_P_OUT]           = ACCTON_PMBUS_REG(0x96, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_P_IN]            = ACCTON_PMBUS_REG(0x97, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_V_IN]            = ACCTON_PMBUS_REG(0x88, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_V_OUT]           = ACCTON_PMBUS_REG(0x8b, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_I_IN]            = ACCTON_PMBUS_REG(0x89, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_I_OUT]           = ACCTON_PMBUS_REG(0x8c, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_TEMP1]           = ACCTON_PMBUS_REG(0x8d, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_FAN_DUTY_CYCLE1] = ACCTON_PMBUS_REG(0x3b, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+    [CPR_4011_4MXX_FAN_SPEED1]      = ACCTON_PMBUS_REG(0x90, ACCTON_PMBUS_WORD, CPR_4011_4MXX_GROUP_SENSOR),
+};
+
 /* Each client has this additional data 
  */
 struct cpr_4011_4mxx_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
-    char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
-    u8   vout_mode;     /* Register value */
-    u16  v_in;          /* Register value */
-    u16  v_out;         /* Register value */
-    u16  i_in;          /* Register value */
-    u16  i_out;         /* Register value */
-    u16  p_in;          /* Register value */
-    u16  p_out;         /* Register value */
-    u16  temp_input[2]; /* Register value */
-    u8   fan_fault;     /* Register value */
-    u16  fan_duty_cycle[2];  /* Register value */
-    u16  fan_speed[2];  /* Register value */
+    struct accton_pmbus_telemetry pmbus;
+    struct accton_pmbus_sampler power;  /* only with sample_interval_ms */
 };
 
 static ssize_t show_linear(struct device *dev, struct device_attribute *da, char *buf);
@@ -65,7 +98,12 @@ static ssize_t show_fan_fault(struct device *dev, struct device_attribute *da, c
 static ssize_t show_vout(struct device *dev, struct device_attribute *da, char *buf);
 static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da, const char *buf, size_t count);
 static int cpr_4011_4mxx_write_word(struct i2c_client *client, u8 reg, u16 value);
-static struct cpr_4011_4mxx_data *cpr_4011_4mxx_update_device(struct device *dev);
+static ssize_t show_pmbus_stats(struct device *dev, struct device_attribute *da, char *buf);
+static u16 cpr_4011_4mxx_read_reg(struct device *dev, int reg);
+static ssize_t show_power_stat(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t show_energy(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t show_power_samples(struct device *dev, struct device_attribute *da, char *buf);
+static ssize_t set_reset_history(struct device *dev, struct device_attribute *da, const char *buf, size_t count);
 
 enum cpr_4011_4mxx_sysfs_attributes {
     PSU_V_IN,
@@ -80,6 +118,7 @@ enum cpr_4011_4mxx_sysfs_attributes {
     PSU_FAN1_FAULT,
     PSU_FAN1_DUTY_CYCLE,
     PSU_FAN1_SPEED,
+    PSU_PMBUS_STATS,
 };
 
 /* sysfs attributes for hwmon 
@@ -94,6 +133,7 @@ static SENSOR_DEVICE_ATTR(psu_temp1_input, S_IRUGO, show_linear,      NULL, PSU_
 static SENSOR_DEVICE_ATTR(psu_fan1_fault,  S_IRUGO, show_fan_fault,   NULL, PSU_FAN1_FAULT);
 static SENSOR_DEVICE_ATTR(psu_fan1_duty_cycle_percentage, S_IWUSR | S_IRUGO, show_linear, set_fan_duty_cycle, PSU_FAN1_DUTY_CYCLE);
 static SENSOR_DEVICE_ATTR(psu_fan1_speed_rpm, S_IRUGO, show_linear,   NULL, PSU_FAN1_SPEED);
+static SENSOR_DEVICE_ATTR(psu_pmbus_stats, S_IRUGO, show_pmbus_stats, NULL, PSU_PMBUS_STATS);
 
 /*Duplicate nodes for lm-sensors. 1 for input, 2 for output.*/
 static SENSOR_DEVICE_ATTR(in1_input, S_IRUGO, show_linear,    NULL, PSU_V_IN);
@@ -110,6 +150,36 @@ static SENSOR_DEVICE_ATTR(fan1_fault,  S_IRUGO, show_fan_fault,   NULL, PSU_FAN1
 
 
 
+/* Power sampling, present when sample_interval_ms is set. */
+static SENSOR_DEVICE_ATTR_2(power1_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(power1_input_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(power1_input_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR_2(power2_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(power2_input_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(power2_input_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR_2(curr1_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(curr1_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(curr1_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR(energy1_input, S_IRUGO, show_energy, NULL, 0);
+static SENSOR_DEVICE_ATTR(reset_history, S_IWUSR, NULL, set_reset_history, 0);
+static SENSOR_DEVICE_ATTR(psu_power_samples, S_IRUGO, show_power_samples, NULL, 0);
+
+static struct attribute *cpr_4011_4mxx_power_attributes[] = {
+    &sensor_dev_attr_power1_average.dev_attr.attr,
+    &sensor_dev_attr_power1_input_highest.dev_attr.attr,
+    &sensor_dev_attr_power1_input_lowest.dev_attr.attr,
+    &sensor_dev_attr_power2_average.dev_attr.attr,
+    &sensor_dev_attr_power2_input_highest.dev_attr.attr,
+    &sensor_dev_attr_power2_input_lowest.dev_attr.attr,
+    &sensor_dev_attr_curr1_average.dev_attr.attr,
+    &sensor_dev_attr_curr1_highest.dev_attr.attr,
+    &sensor_dev_attr_curr1_lowest.dev_attr.attr,
+    &sensor_dev_attr_energy1_input.dev_attr.attr,
+    &sensor_dev_attr_reset_history.dev_attr.attr,
+    &sensor_dev_attr_psu_power_samples.dev_attr.attr,
+    NULL
+};
+
 static struct attribute *cpr_4011_4mxx_attributes[] = {
     &sensor_dev_attr_psu_v_in.dev_attr.attr,
     &sensor_dev_attr_psu_v_out.dev_attr.attr,
@@ -121,6 +191,7 @@ static struct attribute *cpr_4011_4mxx_attributes[] = {
     &sensor_dev_attr_psu_fan1_fault.dev_attr.attr,
     &sensor_dev_attr_psu_fan1_duty_cycle_percentage.dev_attr.attr,
     &sensor_dev_attr_psu_fan1_speed_rpm.dev_attr.attr,
+    &sensor_dev_attr_psu_pmbus_stats.dev_attr.attr,
      /*Duplicate nodes for lm-sensors.*/
     &sensor_dev_attr_curr1_input.dev_attr.attr,
     &sensor_dev_attr_curr2_input.dev_attr.attr,
@@ -134,14 +205,6 @@ static struct attribute *cpr_4011_4mxx_attributes[] = {
     NULL
 };
 
-static int two_complement_to_int(u16 data, u8 valid_bit, int mask)
-{
-    u16  valid_data  = data & mask;
-    bool is_negative = valid_data >> (valid_bit - 1);
-
-    return is_negative ? (-(((~valid_data) & mask) + 1)) : valid_data;
-}
-
 static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da,
 			const char *buf, size_t count)
 {
@@ -160,8 +223,9 @@ static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *d
         return -EINVAL;
 
     mutex_lock(&data->update_lock);
-    data->fan_duty_cycle[nr] = speed;
-    cpr_4011_4mxx_write_word(client, 0x3B + nr, data->fan_duty_cycle[nr]);
+    cpr_4011_4mxx_write_word(client, 0x3B + nr, speed);
+    if (nr == 0)
+        accton_pmbus_invalidate(&data->pmbus, CPR_4011_4MXX_FAN_DUTY_CYCLE1);
     mutex_unlock(&data->update_lock);
 
     return count;
@@ -171,85 +235,125 @@ static ssize_t show_linear(struct device *dev, struct device_attribute *da,
              char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-
-    u16 value = 0;
-    int exponent, mantissa;
     int multiplier = 1000;
+    int reg;
     
     switch (attr->index) {
     case PSU_V_IN:
-        value = data->v_in;
+        reg = CPR_4011_4MXX_V_IN;
         break;
     case PSU_I_IN:
-        value = data->i_in;
+        reg = CPR_4011_4MXX_I_IN;
         break;
     case PSU_I_OUT:
-        value = data->i_out;
+        reg = CPR_4011_4MXX_I_OUT;
         break;
     case PSU_P_IN_UV:
         multiplier = 1000000;  /*For lm-sensors, unit is micro-Volt.*/
     /*Passing through*/
     case PSU_P_IN:
-        value = data->p_in;
+        reg = CPR_4011_4MXX_P_IN;
         break;
     case PSU_P_OUT_UV:
         multiplier = 1000000;  /*For lm-sensors, unit is micro-Volt.*/
     /*Passing through*/
     case PSU_P_OUT:
-        value = data->p_out;
+        reg = CPR_4011_4MXX_P_OUT;
         break;
     case PSU_TEMP1_INPUT:
-        value = data->temp_input[0];
+        reg = CPR_4011_4MXX_TEMP1;
         break;
     case PSU_FAN1_DUTY_CYCLE:
         multiplier = 1;
-        value = data->fan_duty_cycle[0];
+        reg = CPR_4011_4MXX_FAN_DUTY_CYCLE1;
         break;
     case PSU_FAN1_SPEED:
         multiplier = 1;
-        value = data->fan_speed[0];
+        reg = CPR_4011_4MXX_FAN_SPEED1;
         break;
     default:
-        break;
+        return sprintf(buf, "0\n");
     }
-    
-    exponent = two_complement_to_int(value >> 11, 5, 0x1f);
-    mantissa = two_complement_to_int(value & 0x7ff, 11, 0x7ff);
 
-    return (exponent >= 0) ? sprintf(buf, "%d\n", (mantissa << exponent) * multiplier) :
-                             sprintf(buf, "%d\n", (mantissa * multiplier) / (1 << -exponent));                      
+    return sprintf(buf, "%d\n",
+                   accton_pmbus_linear11(cpr_4011_4mxx_read_reg(dev, reg), multiplier));
 }
 
 static ssize_t show_fan_fault(struct device *dev, struct device_attribute *da,
              char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-
     u8 shift = (attr->index == PSU_FAN1_FAULT) ? 7 : 6;
 
-    return sprintf(buf, "%d\n", data->fan_fault >> shift);
+    return sprintf(buf, "%d\n", cpr_4011_4mxx_read_reg(dev, CPR_4011_4MXX_FAN_FAULT) >> shift);
 }
 
 static ssize_t show_vout(struct device *dev, struct device_attribute *da,
              char *buf)
 {
-    struct cpr_4011_4mxx_data *data = cpr_4011_4mxx_update_device(dev);
-    int exponent, mantissa;
-    int multiplier = 1000;
+    u8 vout_mode = cpr_4011_4mxx_read_reg(dev, CPR_4011_4MXX_VOUT_MODE);
+    u16 v_out = cpr_4011_4mxx_read_reg(dev, CPR_4011_4MXX_V_OUT);
 
-    exponent = two_complement_to_int(data->vout_mode, 5, 0x1f);
-    mantissa = data->v_out;
+    return sprintf(buf, "%d\n", accton_pmbus_linear16(v_out, vout_mode, 1000));
+}
+
+static ssize_t show_pmbus_stats(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
+    ssize_t ret;
+
+    mutex_lock(&data->update_lock);
+    ret = accton_pmbus_stats_show(&data->pmbus, buf);
+    mutex_unlock(&data->update_lock);
+
+    return ret;
+}
+
+static ssize_t show_power_stat(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct sensor_device_attribute_2 *attr = to_sensor_dev_attr_2(da);
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(to_i2c_client(dev));
+    int scale = (attr->nr == ACCTON_PMBUS_IIN) ? 1 : 1000; /* mA, or mW to uW */
+
+    return accton_pmbus_sampler_show(&data->power, attr->nr, attr->index, scale, buf);
+}
+
+static ssize_t show_energy(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(to_i2c_client(dev));
 
-    return (exponent > 0) ? sprintf(buf, "%d\n", (mantissa << exponent) * multiplier) :
-                            sprintf(buf, "%d\n", (mantissa * multiplier) / (1 << -exponent));
+    return accton_pmbus_energy_show(&data->power, buf);
+}
+
+static ssize_t show_power_samples(struct device *dev, struct device_attribute *da,
+             char *buf)
+{
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_pmbus_samples_show(&data->power, buf);
+}
+
+static ssize_t set_reset_history(struct device *dev, struct device_attribute *da,
+             const char *buf, size_t count)
+{
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    accton_pmbus_sampler_reset(&data->power);
+    return count;
 }
 
 static const struct attribute_group cpr_4011_4mxx_group = {
     .attrs = cpr_4011_4mxx_attributes,
 };
 
+static const struct attribute_group cpr_4011_4mxx_power_group = {
+    .attrs = cpr_4011_4mxx_power_attributes,
+};
+
 static int cpr_4011_4mxx_probe(struct i2c_client *client,
             const struct i2c_device_id *dev_id)
 {
@@ -269,9 +373,14 @@ static int cpr_4011_4mxx_probe(struct i2c_client *client,
     }
 
     i2c_set_clientdata(client, data);
-    data->valid = 0;
     mutex_init(&data->update_lock);
 
+    status = accton_pmbus_init(&data->pmbus, client, cpr_4011_4mxx_regs,
+                               CPR_4011_4MXX_REG_COUNT, group_interval_ms);
+    if (status) {
+        goto exit_free;
+    }
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -280,10 +389,20 @@ static int cpr_4011_4mxx_probe(struct i2c_client *client,
         goto exit_free;
     }
 
+    if (sample_interval_ms) {
+        status = sysfs_create_group(&client->dev.kobj, &cpr_4011_4mxx_power_group);
+        if (status) {
+            goto exit_remove;
+        }
+        accton_pmbus_sampler_start(&data->power, &data->pmbus, &data->update_lock,
+                                   CPR_4011_4MXX_P_IN, CPR_4011_4MXX_P_OUT,
+                                   CPR_4011_4MXX_I_IN, sample_interval_ms);
+    }
+
     data->hwmon_dev = hwmon_device_register(&client->dev);
     if (IS_ERR(data->hwmon_dev)) {
         status = PTR_ERR(data->hwmon_dev);
-        goto exit_remove;
+        goto exit_remove_power;
     }
 
     dev_info(&client->dev, "%s: psu '%s'\n",
@@ -291,9 +410,15 @@ static int cpr_4011_4mxx_probe(struct i2c_client *client,
     
     return 0;
 
+exit_remove_power:
+    if (sample_interval_ms) {
+        accton_pmbus_sampler_stop(&data->power);
+        sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_power_group);
+    }
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_group);
 exit_free:
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
 exit:
     
@@ -305,7 +430,12 @@ static int cpr_4011_4mxx_remove(struct i2c_client *client)
     struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
 
     hwmon_device_unregister(data->hwmon_dev);
+    if (sample_interval_ms) {
+        accton_pmbus_sampler_stop(&data->power);
+        sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_power_group);
+    }
     sysfs_remove_group(&client->dev.kobj, &cpr_4011_4mxx_group);
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
     
     return 0;
@@ -328,97 +458,36 @@ static struct i2c_driver cpr_4011_4mxx_driver = {
     .address_list = normal_i2c,
 };
 
-static int cpr_4011_4mxx_read_byte(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_byte_data(client, reg);
-}
-
-static int cpr_4011_4mxx_read_word(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_word_data(client, reg);
-}
-
 static int cpr_4011_4mxx_write_word(struct i2c_client *client, u8 reg, u16 value)
 {
-    return i2c_smbus_write_word_data(client, reg, value);
-}
-
-struct reg_data_byte {
-    u8   reg;
-    u8  *value;
-};
+    struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
 
-struct reg_data_word {
-    u8   reg;
-    u16 *value;
-};
+    return accton_i2c_retry(&data->pmbus.i2c_stats,
+                accton_i2c_traced(&data->pmbus.i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_WORD_DATA, reg, 2,
+                    i2c_smbus_write_word_data(client, reg, value)));
+}
 
-static struct cpr_4011_4mxx_data *cpr_4011_4mxx_update_device(struct device *dev)
+static u16 cpr_4011_4mxx_read_reg(struct device *dev, int reg)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct cpr_4011_4mxx_data *data = i2c_get_clientdata(client);
-    
+    u16 value;
+
     mutex_lock(&data->update_lock);
 
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-        || !data->valid) {
-        int i, status;
-        struct reg_data_byte regs_byte[] = { {0x20, &data->vout_mode},
-                                             {0x81, &data->fan_fault}};
-        struct reg_data_word regs_word[] = { {0x96, &data->p_out}, /*p_out must be the first one.*/
-                                             {0x97, &data->p_in},
-                                             {0x8b, &data->v_out},
-                                             {0x89, &data->i_in},
-                                             {0x8c, &data->i_out},
-                                             {0x8d, &(data->temp_input[0])},
-                                             {0x8e, &(data->temp_input[1])},
-                                             {0x3b, &(data->fan_duty_cycle[0])},
-                                             {0x3c, &(data->fan_duty_cycle[1])},
-                                             {0x90, &(data->fan_speed[0])},
-                                             {0x91, &(data->fan_speed[1])}};
-
-        dev_dbg(&client->dev, "Starting cpr_4011_4mxx update\n");
-
-        /* Read byte data */        
-        for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
-            status = cpr_4011_4mxx_read_byte(client, regs_byte[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_byte[i].reg, status);
-                *(regs_byte[i].value) = 0;
-            }
-            else {
-                *(regs_byte[i].value) = status;
-            }
-        }
-                    
-        /* Read word data */                    
-        for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
-            status = cpr_4011_4mxx_read_word(client, regs_word[i].reg);
-            
-            if (status < 0) {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_word[i].reg, status);
-                *(regs_word[i].value) = 0;
-            }
-            else {
-                *(regs_word[i].value) = status;
-            }
-
-            /*Elimated false values. so p_out must be updated at first. */
-            if (data->p_out == 0) {
-                *(regs_word[i].value) = 0;
-            }
-        }
-        
-        data->last_updated = jiffies;
-        data->valid = 1;
+    /* Elimated false values, the sensors read 0 while p_out is 0. */
+    if (reg >= CPR_4011_4MXX_P_OUT &&
+        accton_pmbus_word(&data->pmbus, CPR_4011_4MXX_P_OUT) == 0) {
+        value = 0;
+    }
+    else {
+        value = accton_pmbus_word(&data->pmbus, reg);
     }
 
     mutex_unlock(&data->update_lock);
 
-    return data;
+    return value;
 }
 
 static int __init cpr_4011_4mxx_init(void)
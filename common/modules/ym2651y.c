@@ -31,6 +31,7 @@
 #include <linux/mutex.h>
 #include <linux/sysfs.h>
 #include <linux/slab.h>
+#include "accton_pmbus_telemetry.h"
 
 #define MAX_FAN_DUTY_CYCLE 100
 
@@ -44,36 +45,104 @@ enum chips {
 	YM2851,
 };
 
+/* Registers are grouped by how fast they change, each attribute only
+ * reads its own register once the interval of its group expired
+ */
+enum ym2651y_reg_group {
+    YM2651Y_GROUP_STATIC,   /* ids, ratings, fan direction: fixed while inserted */
+    YM2651Y_GROUP_STATUS,   /* status word, fault bits */
+    YM2651Y_GROUP_OUTPUT,   /* v_out, i_out, p_out */
+    YM2651Y_GROUP_THERMAL,  /* temperature, fan speed and duty */
+    YM2651Y_GROUP_COUNT
+};
+
+/* Refresh interval of each group, in ms. The static group is only read
+ * again after a failed access, which is how a removed PSU shows up.
+ */
+static unsigned int group_interval_ms[YM2651Y_GROUP_COUNT] = {
+    [YM2651Y_GROUP_STATUS]  = 1500,
+    [YM2651Y_GROUP_OUTPUT]  = 1500,
+    [YM2651Y_GROUP_THERMAL] = 3000,
+};
+module_param_named(status_interval_ms, group_interval_ms[YM2651Y_GROUP_STATUS], uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(status_interval_ms, "Refresh interval of the status registers in ms");
+module_param_named(output_interval_ms, group_interval_ms[YM2651Y_GROUP_OUTPUT], uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(output_interval_ms, "Refresh interval of v_out, i_out and p_out in ms");
+module_param_named(thermal_interval_ms, group_interval_ms[YM2651Y_GROUP_THERMAL], uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(thermal_interval_ms, "Refresh interval of the temperature and fan registers in ms");
+
+static unsigned int sample_interval_ms = 0;
+module_param(sample_interval_ms, uint, S_IRUGO);
+MODULE_PARM_DESC(sample_interval_ms, "Sample input/output power every that many ms for the average, highest and energy attributes, 0 to disable");
+
+/* Registers of the PSU, read through the shared PMBus register cache
+ */
+enum ym2651y_regs {
+    YM2651Y_CAPABILITY,
+    YM2651Y_PMBUS_REVISION,
+    YM2651Y_MFR_VIN_MIN,
+    YM2651Y_MFR_VIN_MAX,
+    YM2651Y_MFR_IIN_MAX,
+    YM2651Y_MFR_PIN_MAX,
+    YM2651Y_MFR_VOUT_MIN,
+    YM2651Y_MFR_VOUT_MAX,
+    YM2651Y_MFR_IOUT_MAX,
+    YM2651Y_MFR_POUT_MAX,
+    YM2651Y_FAN_DIR,
+    YM2651Y_MFR_ID,
+    YM2651Y_MFR_MODEL,
+    YM2651Y_MFR_REVISION,
+    YM2651Y_OVER_TEMP,
+    YM2651Y_FAN_FAULT,
+    YM2651Y_STATUS_WORD,
+    YM2651Y_V_OUT,
+    YM2651Y_I_OUT,
+    YM2651Y_P_OUT,
+    YM2651Y_P_IN,
+    YM2651Y_I_IN,
+    YM2651Y_TEMP,
+    YM2651Y_FAN_DUTY_CYCLE1,
+    YM2651Y_FAN_DUTY_CYCLE2,
+    YM2651Y_FAN_SPEED,
+    YM2651Y_REG_COUNT
+};
+
+static const struct accton_pmbus_reg ym2651y_regs[YM2651Y_REG_COUNT] = {
+    [YM2651Y_CAPABILITY]      = ACCTON_PMBUS_REG(0x19, ACCTON_PMBUS_BYTE, YM2651Y_GROUP_STATIC),
+    [YM2651Y_PMBUS_REVISION]  = ACCTON_PMBUS_REG(0x98, ACCTON_PMBUS_BYTE, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_VIN_MIN]     = ACCTON_PMBUS_REG(0xa0, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_VIN_MAX]     = ACCTON_PMBUS_REG(0xa1, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_IIN_MAX]     = ACCTON_PMBUS_REG(0xa2, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_PIN_MAX]     = ACCTON_PMBUS_REG(0xa3, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_VOUT_MIN]    = ACCTON_PMBUS_REG(0xa4, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_VOUT_MAX]    = ACCTON_PMBUS_REG(0xa5, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_IOUT_MAX]    = ACCTON_PMBUS_REG(0xa6, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_POUT_MAX]    = ACCTON_PMBUS_REG(0xa7, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATIC),
+    [YM2651Y_FAN_DIR]         = ACCTON_PMBUS_BLOCK_REG(0xc3, 4, YM2651Y_GROUP_STATIC), /* count byte first */
+    [YM2651Y_MFR_ID]          = ACCTON_PMBUS_BLOCK_REG(0x99, 9, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_MODEL]       = ACCTON_PMBUS_BLOCK_REG(0x9a, 9, YM2651Y_GROUP_STATIC),
+    [YM2651Y_MFR_REVISION]    = ACCTON_PMBUS_BLOCK_REG(0x9b, 2, YM2651Y_GROUP_STATIC),
+    [YM2651Y_OVER_TEMP]       = ACCTON_PMBUS_REG(0x7d, ACCTON_PMBUS_BYTE, YM2651Y_GROUP_STATUS),
+    [YM2651Y_FAN_FAULT]       = ACCTON_PMBUS_REG(0x81, ACCTON_PMBUS_BYTE, YM2651Y_GROUP_STATUS),
+    [YM2651Y_STATUS_WORD]     = ACCTON_PMBUS_REG(0x79, ACCTON_PMBUS_WORD, YM2651Y_GROUP_STATUS),
+    [YM2651Y_V_OUT]           = ACCTON_PMBUS_REG(0x8b, ACCTON_PMBUS_WORD, YM2651Y_GROUP_OUTPUT),
+    [YM2651Y_I_OUT]           = ACCTON_PMBUS_REG(0x8c, ACCTON_PMBUS_WORD, YM2651Y_GROUP_OUTPUT),
+    [YM2651Y_P_OUT]           = ACCTON_PMBUS_REG(0x96, ACCTON_PMBUS_WORD, YM2651Y_GROUP_OUTPUT),
+    [YM2651Y_P_IN]            = ACCTON_PMBUS_REG(0x97, ACCTON_PMBUS_WORD, YM2651Y_GROUP_OUTPUT),
+    [YM2651Y_I_IN]            = ACCTON_PMBUS_REG(0x89, ACCTON_PMBUS_WORD, YM2651Y_GROUP_OUTPUT),
+    [YM2651Y_TEMP]            = ACCTON_PMBUS_REG(0x8d, ACCTON_PMBUS_WORD, YM2651Y_GROUP_THERMAL),
+    [YM2651Y_FAN_DUTY_CYCLE1] = ACCTON_PMBUS_REG(0x3b, ACCTON_PMBUS_WORD, YM2651Y_GROUP_THERMAL),
+    [YM2651Y_FAN_DUTY_CYCLE2] = ACCTON_PMBUS_REG(0x3c, ACCTON_PMBUS_WORD, YM2651Y_GROUP_THERMAL),
+    [YM2651Y_FAN_SPEED]       = ACCTON_PMBUS_REG(0x90, ACCTON_PMBUS_WORD, YM2651Y_GROUP_THERMAL),
+};
+
 /* Each client has this additional data
  */
 struct ym2651y_data {
     struct device      *hwmon_dev;
     struct mutex        update_lock;
-    char                valid;           /* !=0 if registers are valid */
-    unsigned long       last_updated;    /* In jiffies */
-    u8   capability;     /* Register value */
-    u16  status_word;    /* Register value */
-    u8   fan_fault;      /* Register value */
-    u8   over_temp;      /* Register value */
-    u16  v_out;          /* Register value */
-    u16  i_out;          /* Register value */
-    u16  p_out;          /* Register value */
-    u16  temp;           /* Register value */
-    u16  fan_speed;      /* Register value */
-    u16  fan_duty_cycle[2];  /* Register value */
-    u8   fan_dir[4];     /* Register value */
-    u8   pmbus_revision; /* Register value */
-    u8   mfr_id[10];     /* Register value */
-    u8   mfr_model[10];  /* Register value */
-    u8   mfr_revsion[3]; /* Register value */
-    u16  mfr_vin_min;    /* Register value */
-    u16  mfr_vin_max;    /* Register value */
-    u16  mfr_iin_max;    /* Register value */
-    u16  mfr_iout_max;   /* Register value */
-    u16  mfr_pin_max;    /* Register value */
-    u16  mfr_pout_max;   /* Register value */
-    u16  mfr_vout_min;   /* Register value */
-    u16  mfr_vout_max;   /* Register value */
+    struct accton_pmbus_telemetry pmbus;
+    struct accton_pmbus_sampler power;  /* only with sample_interval_ms */
 };
 
 static ssize_t show_byte(struct device *dev, struct device_attribute *da,
@@ -88,7 +157,17 @@ static ssize_t show_over_temp(struct device *dev, struct device_attribute *da,
                               char *buf);
 static ssize_t show_ascii(struct device *dev, struct device_attribute *da,
                           char *buf);
-static struct ym2651y_data *ym2651y_update_device(struct device *dev);
+static ssize_t show_pmbus_stats(struct device *dev, struct device_attribute *da,
+                                char *buf);
+static u16 ym2651y_read_reg(struct device *dev, int reg);
+static ssize_t show_power_stat(struct device *dev, struct device_attribute *da,
+                               char *buf);
+static ssize_t show_energy(struct device *dev, struct device_attribute *da,
+                           char *buf);
+static ssize_t show_power_samples(struct device *dev, struct device_attribute *da,
+                                  char *buf);
+static ssize_t set_reset_history(struct device *dev, struct device_attribute *da,
+                                 const char *buf, size_t count);
 static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da,
                                   const char *buf, size_t count);
 static int ym2651y_write_word(struct i2c_client *client, u8 reg, u16 value);
@@ -118,7 +197,8 @@ enum ym2651y_sysfs_attributes {
     PSU_MFR_IIN_MAX,
     PSU_MFR_IOUT_MAX,
     PSU_MFR_PIN_MAX,
-    PSU_MFR_POUT_MAX
+    PSU_MFR_POUT_MAX,
+    PSU_PMBUS_STATS
 };
 
 /* sysfs attributes for hwmon
@@ -147,6 +227,7 @@ static SENSOR_DEVICE_ATTR(psu_mfr_iin_max,   S_IRUGO, show_linear, NULL, PSU_MFR
 static SENSOR_DEVICE_ATTR(psu_mfr_iout_max,   S_IRUGO, show_linear, NULL, PSU_MFR_IOUT_MAX);
 static SENSOR_DEVICE_ATTR(psu_mfr_pin_max,   S_IRUGO, show_linear, NULL, PSU_MFR_PIN_MAX);
 static SENSOR_DEVICE_ATTR(psu_mfr_pout_max,   S_IRUGO, show_linear, NULL, PSU_MFR_POUT_MAX);
+static SENSOR_DEVICE_ATTR(psu_pmbus_stats,    S_IRUGO, show_pmbus_stats, NULL, PSU_PMBUS_STATS);
 
 /*Duplicate nodes for lm-sensors.*/
 static SENSOR_DEVICE_ATTR(in3_input, S_IRUGO, show_linear,    NULL, PSU_V_OUT);
@@ -156,6 +237,38 @@ static SENSOR_DEVICE_ATTR(temp1_input, S_IRUGO, show_linear,    NULL, PSU_TEMP1_
 static SENSOR_DEVICE_ATTR(fan1_input, S_IRUGO, show_linear, NULL, PSU_FAN1_SPEED);
 static SENSOR_DEVICE_ATTR(temp1_fault,  S_IRUGO, show_word,      NULL, PSU_TEMP_FAULT);
 
+/* Power sampling, present when sample_interval_ms is set.
+ * power1 is the input, power2 the output, as power2_input above.
+ */
+static SENSOR_DEVICE_ATTR_2(power1_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(power1_input_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(power1_input_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_PIN, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR_2(power2_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(power2_input_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(power2_input_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_POUT, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR_2(curr1_average, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_AVERAGE);
+static SENSOR_DEVICE_ATTR_2(curr1_highest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_HIGHEST);
+static SENSOR_DEVICE_ATTR_2(curr1_lowest, S_IRUGO, show_power_stat, NULL, ACCTON_PMBUS_IIN, ACCTON_PMBUS_LOWEST);
+static SENSOR_DEVICE_ATTR(energy1_input, S_IRUGO, show_energy, NULL, 0);
+static SENSOR_DEVICE_ATTR(reset_history, S_IWUSR, NULL, set_reset_history, 0);
+static SENSOR_DEVICE_ATTR(psu_power_samples, S_IRUGO, show_power_samples, NULL, 0);
+
+static struct attribute *ym2651y_power_attributes[] = {
+    &sensor_dev_attr_power1_average.dev_attr.attr,
+    &sensor_dev_attr_power1_input_highest.dev_attr.attr,
+    &sensor_dev_attr_power1_input_lowest.dev_attr.attr,
+    &sensor_dev_attr_power2_average.dev_attr.attr,
+    &sensor_dev_attr_power2_input_highest.dev_attr.attr,
+    &sensor_dev_attr_power2_input_lowest.dev_attr.attr,
+    &sensor_dev_attr_curr1_average.dev_attr.attr,
+    &sensor_dev_attr_curr1_highest.dev_attr.attr,
+    &sensor_dev_attr_curr1_lowest.dev_attr.attr,
+    &sensor_dev_attr_energy1_input.dev_attr.attr,
+    &sensor_dev_attr_reset_history.dev_attr.attr,
+    &sensor_dev_attr_psu_power_samples.dev_attr.attr,
+    NULL
+};
+
 static struct attribute *ym2651y_attributes[] = {
     &sensor_dev_attr_psu_power_on.dev_attr.attr,
     &sensor_dev_attr_psu_temp_fault.dev_attr.attr,
@@ -181,6 +294,7 @@ static struct attribute *ym2651y_attributes[] = {
     &sensor_dev_attr_psu_mfr_vout_min.dev_attr.attr,
     &sensor_dev_attr_psu_mfr_vout_max.dev_attr.attr,
     &sensor_dev_attr_psu_mfr_iout_max.dev_attr.attr,
+    &sensor_dev_attr_psu_pmbus_stats.dev_attr.attr,
     /*Duplicate nodes for lm-sensors.*/
     &sensor_dev_attr_curr2_input.dev_attr.attr,
     &sensor_dev_attr_in3_input.dev_attr.attr,
@@ -195,9 +309,9 @@ static ssize_t show_byte(struct device *dev, struct device_attribute *da,
                          char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct ym2651y_data *data = ym2651y_update_device(dev);
 
-    return (attr->index == PSU_PMBUS_REVISION) ? sprintf(buf, "%d\n", data->pmbus_revision) :
+    return (attr->index == PSU_PMBUS_REVISION) ?
+           sprintf(buf, "%d\n", ym2651y_read_reg(dev, YM2651Y_PMBUS_REVISION)) :
            sprintf(buf, "0\n");
 }
 
@@ -205,32 +319,24 @@ static ssize_t show_word(struct device *dev, struct device_attribute *da,
                          char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct ym2651y_data *data = ym2651y_update_device(dev);
+    u16 status_word = ym2651y_read_reg(dev, YM2651Y_STATUS_WORD);
     u16 status = 0;
 
     switch (attr->index) {
     case PSU_POWER_ON: /* psu_power_on, low byte bit 6 of status_word, 0=>ON, 1=>OFF */
-        status = (data->status_word & 0x40) ? 0 : 1;
+        status = (status_word & 0x40) ? 0 : 1;
         break;
     case PSU_TEMP_FAULT: /* psu_temp_fault, low byte bit 2 of status_word, 0=>Normal, 1=>temp fault */
-        status = (data->status_word & 0x4) >> 2;
+        status = (status_word & 0x4) >> 2;
         break;
     case PSU_POWER_GOOD: /* psu_power_good, high byte bit 3 of status_word, 0=>OK, 1=>FAIL */
-        status = (data->status_word & 0x800) ? 0 : 1;
+        status = (status_word & 0x800) ? 0 : 1;
         break;
     }
 
     return sprintf(buf, "%d\n", status);
 }
 
-static int two_complement_to_int(u16 data, u8 valid_bit, int mask)
-{
-    u16  valid_data  = data & mask;
-    bool is_negative = valid_data >> (valid_bit - 1);
-
-    return is_negative ? (-(((~valid_data) & mask) + 1)) : valid_data;
-}
-
 static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *da,
                                   const char *buf, size_t count)
 {
@@ -249,8 +355,8 @@ static ssize_t set_fan_duty_cycle(struct device *dev, struct device_attribute *d
         return -EINVAL;
 
     mutex_lock(&data->update_lock);
-    data->fan_duty_cycle[nr] = speed;
-    ym2651y_write_word(client, 0x3B + nr, data->fan_duty_cycle[nr]);
+    ym2651y_write_word(client, 0x3B + nr, speed);
+    accton_pmbus_invalidate(&data->pmbus, YM2651Y_FAN_DUTY_CYCLE1 + nr);
     mutex_unlock(&data->update_lock);
 
     return count;
@@ -260,118 +366,173 @@ static ssize_t show_linear(struct device *dev, struct device_attribute *da,
                            char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct ym2651y_data *data = ym2651y_update_device(dev);
-
-    u16 value = 0;
-    int exponent, mantissa;
     int multiplier = 1000;
+    int reg;
 
     switch (attr->index) {
     case PSU_V_OUT:
-        value = data->v_out;
+        reg = YM2651Y_V_OUT;
         break;
     case PSU_I_OUT:
-        value = data->i_out;
+        reg = YM2651Y_I_OUT;
         break;
     case PSU_P_OUT_UV:
         multiplier = 1000000;  /*For lm-sensors, unit is micro-Volt.*/
     /*Passing through*/
     case PSU_P_OUT:
-        value = data->p_out;
+        reg = YM2651Y_P_OUT;
         break;
     case PSU_TEMP1_INPUT:
-        value = data->temp;
+        reg = YM2651Y_TEMP;
         break;
     case PSU_FAN1_SPEED:
-        value = data->fan_speed;
+        reg = YM2651Y_FAN_SPEED;
         multiplier = 1;
         break;
     case PSU_FAN1_DUTY_CYCLE:
-        value = data->fan_duty_cycle[0];
+        reg = YM2651Y_FAN_DUTY_CYCLE1;
         multiplier = 1;
         break;
     case PSU_MFR_VIN_MIN:
-        value = data->mfr_vin_min;
+        reg = YM2651Y_MFR_VIN_MIN;
         break;
     case PSU_MFR_VIN_MAX:
-        value = data->mfr_vin_max;
+        reg = YM2651Y_MFR_VIN_MAX;
         break;
     case PSU_MFR_VOUT_MIN:
-        value = data->mfr_vout_min;
+        reg = YM2651Y_MFR_VOUT_MIN;
         break;
     case PSU_MFR_VOUT_MAX:
-        value = data->mfr_vout_max;
+        reg = YM2651Y_MFR_VOUT_MAX;
         break;
     case PSU_MFR_PIN_MAX:
-        value = data->mfr_pin_max;
+        reg = YM2651Y_MFR_PIN_MAX;
         break;
     case PSU_MFR_POUT_MAX:
-        value = data->mfr_pout_max;
+        reg = YM2651Y_MFR_POUT_MAX;
         break;
     case PSU_MFR_IOUT_MAX:
-        value = data->mfr_iout_max;
+        reg = YM2651Y_MFR_IOUT_MAX;
         break;
     case PSU_MFR_IIN_MAX:
-        value = data->mfr_iin_max;
+        reg = YM2651Y_MFR_IIN_MAX;
         break;
+    default:
+        return sprintf(buf, "0\n");
     }
 
-    exponent = two_complement_to_int(value >> 11, 5, 0x1f);
-    mantissa = two_complement_to_int(value & 0x7ff, 11, 0x7ff);
-    return (exponent >= 0) ? sprintf(buf, "%d\n", (mantissa << exponent) * multiplier) :
-           sprintf(buf, "%d\n", (mantissa * multiplier) / (1 << -exponent));
+    return sprintf(buf, "%d\n",
+                   accton_pmbus_linear11(ym2651y_read_reg(dev, reg), multiplier));
 }
 
 static ssize_t show_fan_fault(struct device *dev, struct device_attribute *da,
                               char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct ym2651y_data *data = ym2651y_update_device(dev);
-
     u8 shift = (attr->index == PSU_FAN1_FAULT) ? 7 : 6;
 
-    return sprintf(buf, "%d\n", data->fan_fault >> shift);
+    return sprintf(buf, "%d\n", ym2651y_read_reg(dev, YM2651Y_FAN_FAULT) >> shift);
 }
 
 static ssize_t show_over_temp(struct device *dev, struct device_attribute *da,
                               char *buf)
 {
-    struct ym2651y_data *data = ym2651y_update_device(dev);
-
-    return sprintf(buf, "%d\n", data->over_temp >> 7);
+    return sprintf(buf, "%d\n", ym2651y_read_reg(dev, YM2651Y_OVER_TEMP) >> 7);
 }
 
 static ssize_t show_ascii(struct device *dev, struct device_attribute *da,
                           char *buf)
 {
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct ym2651y_data *data = ym2651y_update_device(dev);
-    u8 *ptr = NULL;
+    struct i2c_client *client = to_i2c_client(dev);
+    struct ym2651y_data *data = i2c_get_clientdata(client);
+    const u8 *block;
+    int reg, skip = 0;
+    ssize_t ret;
 
     switch (attr->index) {
     case PSU_FAN_DIRECTION: /* psu_fan_dir */
-        ptr = data->fan_dir;
+        reg = YM2651Y_FAN_DIR;
+        skip = 1;
         break;
     case PSU_MFR_ID: /* psu_mfr_id */
-        ptr = data->mfr_id;
+        reg = YM2651Y_MFR_ID;
         break;
     case PSU_MFR_MODEL: /* psu_mfr_model */
-        ptr = data->mfr_model;
+        reg = YM2651Y_MFR_MODEL;
         break;
     case PSU_MFR_REVISION: /* psu_mfr_revision */
-        ptr = data->mfr_revsion;
+        reg = YM2651Y_MFR_REVISION;
         break;
     default:
         return 0;
     }
 
-    return sprintf(buf, "%s\n", ptr);
+    mutex_lock(&data->update_lock);
+    block = accton_pmbus_block(&data->pmbus, reg);
+    ret = sprintf(buf, "%s\n", block + skip);
+    mutex_unlock(&data->update_lock);
+
+    return ret;
+}
+
+static ssize_t show_pmbus_stats(struct device *dev, struct device_attribute *da,
+                                char *buf)
+{
+    struct i2c_client *client = to_i2c_client(dev);
+    struct ym2651y_data *data = i2c_get_clientdata(client);
+    ssize_t ret;
+
+    mutex_lock(&data->update_lock);
+    ret = accton_pmbus_stats_show(&data->pmbus, buf);
+    mutex_unlock(&data->update_lock);
+
+    return ret;
+}
+
+static ssize_t show_power_stat(struct device *dev, struct device_attribute *da,
+                               char *buf)
+{
+    struct sensor_device_attribute_2 *attr = to_sensor_dev_attr_2(da);
+    struct ym2651y_data *data = i2c_get_clientdata(to_i2c_client(dev));
+    int scale = (attr->nr == ACCTON_PMBUS_IIN) ? 1 : 1000; /* mA, or mW to uW */
+
+    return accton_pmbus_sampler_show(&data->power, attr->nr, attr->index, scale, buf);
+}
+
+static ssize_t show_energy(struct device *dev, struct device_attribute *da,
+                           char *buf)
+{
+    struct ym2651y_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_pmbus_energy_show(&data->power, buf);
+}
+
+static ssize_t show_power_samples(struct device *dev, struct device_attribute *da,
+                                  char *buf)
+{
+    struct ym2651y_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    return accton_pmbus_samples_show(&data->power, buf);
+}
+
+static ssize_t set_reset_history(struct device *dev, struct device_attribute *da,
+                                 const char *buf, size_t count)
+{
+    struct ym2651y_data *data = i2c_get_clientdata(to_i2c_client(dev));
+
+    accton_pmbus_sampler_reset(&data->power);
+    return count;
 }
 
 static const struct attribute_group ym2651y_group = {
     .attrs = ym2651y_attributes,
 };
 
+static const struct attribute_group ym2651y_power_group = {
+    .attrs = ym2651y_power_attributes,
+};
+
 static int ym2651y_probe(struct i2c_client *client,
                          const struct i2c_device_id *dev_id)
 {
@@ -395,6 +556,12 @@ static int ym2651y_probe(struct i2c_client *client,
     i2c_set_clientdata(client, data);
     mutex_init(&data->update_lock);
 
+    status = accton_pmbus_init(&data->pmbus, client, ym2651y_regs,
+                               YM2651Y_REG_COUNT, group_interval_ms);
+    if (status) {
+        goto exit_free;
+    }
+
     dev_info(&client->dev, "chip found\n");
 
     /* Register sysfs hooks */
@@ -403,10 +570,20 @@ static int ym2651y_probe(struct i2c_client *client,
         goto exit_free;
     }
 
+    if (sample_interval_ms) {
+        status = sysfs_create_group(&client->dev.kobj, &ym2651y_power_group);
+        if (status) {
+            goto exit_remove;
+        }
+        accton_pmbus_sampler_start(&data->power, &data->pmbus, &data->update_lock,
+                                   YM2651Y_P_IN, YM2651Y_P_OUT, YM2651Y_I_IN,
+                                   sample_interval_ms);
+    }
+
     data->hwmon_dev = hwmon_device_register(&client->dev);
     if (IS_ERR(data->hwmon_dev)) {
         status = PTR_ERR(data->hwmon_dev);
-        goto exit_remove;
+        goto exit_remove_power;
     }
 
     dev_info(&client->dev, "%s: psu '%s'\n",
@@ -414,9 +591,15 @@ static int ym2651y_probe(struct i2c_client *client,
 
     return 0;
 
+exit_remove_power:
+    if (sample_interval_ms) {
+        accton_pmbus_sampler_stop(&data->power);
+        sysfs_remove_group(&client->dev.kobj, &ym2651y_power_group);
+    }
 exit_remove:
     sysfs_remove_group(&client->dev.kobj, &ym2651y_group);
 exit_free:
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
 exit:
 
@@ -428,7 +611,12 @@ static int ym2651y_remove(struct i2c_client *client)
     struct ym2651y_data *data = i2c_get_clientdata(client);
 
     hwmon_device_unregister(data->hwmon_dev);
+    if (sample_interval_ms) {
+        accton_pmbus_sampler_stop(&data->power);
+        sysfs_remove_group(&client->dev.kobj, &ym2651y_power_group);
+    }
     sysfs_remove_group(&client->dev.kobj, &ym2651y_group);
+    accton_pmbus_free(&data->pmbus);
     kfree(data);
 
     return 0;
@@ -453,161 +641,29 @@ static struct i2c_driver ym2651y_driver = {
     .address_list = normal_i2c,
 };
 
-static int ym2651y_read_byte(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_byte_data(client, reg);
-}
-
-static int ym2651y_read_word(struct i2c_client *client, u8 reg)
-{
-    return i2c_smbus_read_word_data(client, reg);
-}
-
 static int ym2651y_write_word(struct i2c_client *client, u8 reg, u16 value)
 {
-    return i2c_smbus_write_word_data(client, reg, value);
-}
-
-static int ym2651y_read_block(struct i2c_client *client, u8 command, u8 *data,
-                              int data_len)
-{
-    int result = i2c_smbus_read_i2c_block_data(client, command, data_len, data);
-
-    if (unlikely(result < 0))
-        goto abort;
-    if (unlikely(result != data_len)) {
-        result = -EIO;
-        goto abort;
-    }
-
-    result = 0;
+    struct ym2651y_data *data = i2c_get_clientdata(client);
 
-abort:
-    return result;
+    return accton_i2c_retry(&data->pmbus.i2c_stats,
+                accton_i2c_traced(&data->pmbus.i2c_trace, client,
+                    I2C_SMBUS_WRITE, I2C_SMBUS_WORD_DATA, reg, 2,
+                    i2c_smbus_write_word_data(client, reg, value)));
 }
 
-struct reg_data_byte {
-    u8   reg;
-    u8  *value;
-};
-
-struct reg_data_word {
-    u8   reg;
-    u16 *value;
-};
-
-static struct ym2651y_data *ym2651y_update_device(struct device *dev)
+/* Only the register asked for is read, once its group interval expired
+ */
+static u16 ym2651y_read_reg(struct device *dev, int reg)
 {
     struct i2c_client *client = to_i2c_client(dev);
     struct ym2651y_data *data = i2c_get_clientdata(client);
+    u16 value;
 
     mutex_lock(&data->update_lock);
-
-    if (time_after(jiffies, data->last_updated + HZ + HZ / 2)
-            || !data->valid) {
-        int i, status;
-        u8 command;
-        u8 fan_dir[5] = {0};
-        struct reg_data_byte regs_byte[] = { {0x19, &data->capability},
-            {0x7d, &data->over_temp},
-            {0x81, &data->fan_fault},
-            {0x98, &data->pmbus_revision}
-        };
-        struct reg_data_word regs_word[] = { {0x79, &data->status_word},
-            {0x8b, &data->v_out},
-            {0x8c, &data->i_out},
-            {0x96, &data->p_out},
-            {0x8d, &data->temp},
-            {0x3b, &(data->fan_duty_cycle[0])},
-            {0x3c, &(data->fan_duty_cycle[1])},
-            {0x90, &data->fan_speed},
-            {0xa0, &data->mfr_vin_min},
-            {0xa1, &data->mfr_vin_max},
-            {0xa2, &data->mfr_iin_max},
-            {0xa3, &data->mfr_pin_max},
-            {0xa4, &data->mfr_vout_min},
-            {0xa5, &data->mfr_vout_max},
-            {0xa6, &data->mfr_iout_max},
-            {0xa7, &data->mfr_pout_max}
-        };
-
-        dev_dbg(&client->dev, "Starting ym2651 update\n");
-
-        /* Read byte data */
-        for (i = 0; i < ARRAY_SIZE(regs_byte); i++) {
-            status = ym2651y_read_byte(client, regs_byte[i].reg);
-
-            if (status < 0)
-            {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_byte[i].reg, status);
-                *(regs_byte[i].value) = 0;
-            }
-            else {
-                *(regs_byte[i].value) = status;
-            }
-        }
-
-        /* Read word data */
-        for (i = 0; i < ARRAY_SIZE(regs_word); i++) {
-            status = ym2651y_read_word(client, regs_word[i].reg);
-
-            if (status < 0)
-            {
-                dev_dbg(&client->dev, "reg %d, err %d\n",
-                        regs_word[i].reg, status);
-                *(regs_word[i].value) = 0;
-            }
-            else {
-                *(regs_word[i].value) = status;
-            }
-        }
-
-        /* Read fan_direction */
-        command = 0xC3;
-        status = ym2651y_read_block(client, command, fan_dir, ARRAY_SIZE(fan_dir)-1);
-
-        if (status < 0) {
-            dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-        }
-
-        strncpy(data->fan_dir, fan_dir+1, ARRAY_SIZE(data->fan_dir)-1);
-        data->fan_dir[ARRAY_SIZE(data->fan_dir)-1] = '\0';
-
-        /* Read mfr_id */
-        command = 0x99;
-        status = ym2651y_read_block(client, command, data->mfr_id,
-                                    ARRAY_SIZE(data->mfr_id)-1);
-        data->mfr_id[ARRAY_SIZE(data->mfr_id)-1] = '\0';
-
-        if (status < 0)
-            dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-
-        /* Read mfr_model */
-        command = 0x9a;
-        status = ym2651y_read_block(client, command, data->mfr_model,
-                                    ARRAY_SIZE(data->mfr_model)-1);
-        data->mfr_model[ARRAY_SIZE(data->mfr_model)-1] = '\0';
-
-        if (status < 0)
-            dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-
-        /* Read mfr_revsion */
-        command = 0x9b;
-        status = ym2651y_read_block(client, command, data->mfr_revsion,
-                                    ARRAY_SIZE(data->mfr_revsion)-1);
-        data->mfr_revsion[ARRAY_SIZE(data->mfr_revsion)-1] = '\0';
-
-        if (status < 0)
-            dev_dbg(&client->dev, "reg %d, err %d\n", command, status);
-
-        data->last_updated = jiffies;
-        data->valid = 1;
-    }
-
+    value = accton_pmbus_word(&data->pmbus, reg);
     mutex_unlock(&data->update_lock);
 
-    return data;
+    return value;
 }
 
 module_i2c_driver(ym2651y_driver);
@@ -0,0 +1,416 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Usage: %(scriptName)s [options] bmc|check
+
+Test the as7716-32xb IPMI client, accton_as7716_32xb_ipmi, against a
+simulated BMC in a QEMU guest, with no switch. It is the setup of
+OpenIPMI's ipmi_sim for QEMU: the guest has a KCS interface whose BMC
+is reached over a socket in the VM protocol. ipmi_sim itself does not
+answer the Accton OEM commands, so this script takes its place.
+
+    bmc   : run on the host, be the BMC of the guest started with
+                -chardev socket,id=ipmi0,host=HOST,port=PORT,reconnect=10
+                -device ipmi-bmc-extern,id=bmc0,chardev=ipmi0
+                -device isa-ipmi-kcs,bmc=bmc0
+            Answers Get Device ID and what ipmi_si asks at start up,
+            and the OEM commands (netfn 0x34) from built in data.
+    check : run as root in the guest, with the as7716-32xb modules.
+            Loads them, creates their clients on i2c-0 (i2c-stub if
+            the guest has no i2c-0), loads the IPMI client and compares
+            what the drivers show with the data of the BMC.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : run with debug mode
+    -p | --port=PORT        : bmc: TCP port to listen on (default 9002)
+    -b | --build=DIR        : check: insmod the modules from DIR instead
+                              of modprobe
+    -i | --interval=MS      : check: poll_interval_ms of the client
+                              (default 200)
+    -o | --output=FILE      : check: write the JSON results to FILE
+
+check prints one JSON document: the ipmi_stats counters, the refresh
+cycle time, and the attributes that do not show what the BMC answered.
+The exit status is 1 if any is wrong or a request failed.
+"""
+
+import os
+import commands
+import sys, getopt
+import logging
+import json
+import time
+import socket
+
+DEBUG = False
+I2C_PREFIX = '/sys/bus/i2c/devices/'
+IPMI_STATS = '/sys/devices/platform/as7716_32xb_ipmi/ipmi_stats'
+WAIT_CYCLES = 2
+WAIT_TIMEOUT = 30
+
+# VM protocol of QEMU's ipmi-bmc-extern, as ipmi_sim speaks it
+VM_MSG_CHAR = 0xa0
+VM_CMD_CHAR = 0xa1
+VM_ESCAPE_CHAR = 0xaa
+
+NETFN_APP = 0x06
+NETFN_OEM = 0x34
+CC_OK = 0x00
+CC_INVALID_CMD = 0xc1
+
+# What the BMC reports. Port and PSU indexes count from 1.
+QSFP_PRESENT = [1, 5, 32]
+THERMAL_C = [45, 38, 52]
+FAN_PRESENT = [1, 2, 3, 4, 5]
+FAN_FRONT_RPM = [10000, 10100, 10200, 10300, 10400, 0]
+FAN_REAR_RPM = [9000, 9100, 9200, 9300, 9400, 0]
+PSU_PRESENT = [1]
+PSU_SENSORS = (33, 8000, 250)    # temp, fan rpm, p_out
+
+MODULES = ['accton_as7716_32xb_cpld1', 'accton_as7716_32xb_fan',
+           'accton_as7716_32xb_psu', 'accton_as7716_32xb_oom',
+           'accton_as7716_32xb_thermal', 'accton_as7716_32xb_pmbus',
+           'accton_as7716_32xb_sys']
+IPMI_MODULE = 'accton_as7716_32xb_ipmi'
+
+DEVICES = [('as7716_32xb_cpld1', 0x60),
+           ('as7716_32xb_thermal', 0x48),
+           ('as7716_32xb_thermal', 0x49),
+           ('as7716_32xb_thermal', 0x4a),
+           ('as7716_32xb_fan', 0x66),
+           ('as7716_32xb_psu1', 0x53),
+           ('as7716_32xb_psu2', 0x50),
+           ('as7716_32xb_pmbus', 0x5b),
+           ('as7716_32xb_pmbus', 0x58),
+           ('as7716_32xb_sys', 0x56)] + \
+          [('as7716_32xb_oom', int(str(port), 16)) for port in range(1, 33)]
+
+def show_help():
+    print __doc__ % {'scriptName' : sys.argv[0].split("/")[-1]}
+    sys.exit(0)
+
+def log_os_system(cmd, show):
+    logging.info('Run :' + cmd)
+    status, output = commands.getstatusoutput(cmd)
+    if status and show:
+        print('Failed :' + cmd)
+    return status, output
+
+def le16(value):
+    return [value & 0xff, (value >> 8) & 0xff]
+
+def qsfp_page(port, page):
+    """The lower page holds the identifier, page 00h the vendor name"""
+    data = [0] * 128
+    if page == 0:
+        data[0] = 0x11
+    else:
+        data[0] = 0x11
+        for i, c in enumerate('ACCTON SIM P%02d  ' % port):
+            data[20 + i] = ord(c)
+    return data
+
+def sys_eeprom():
+    data = [ord(c) for c in 'TlvInfo\0'] + [0x01, 0x00, 0x00]
+    return data + [0xff] * (256 - len(data))
+
+def oem_answer(cmd, req):
+    if cmd == 0x10 and req == [0x10]:
+        return [1 if p in QSFP_PRESENT else 0 for p in range(1, 33)]
+    if cmd == 0x10 and len(req) == 2:
+        return qsfp_page(req[0], req[1])
+    if cmd == 0x12:
+        rx = [0] * 9
+        for i, c in enumerate(THERMAL_C):
+            rx[2 + 3 * i] = c
+        return rx
+    if cmd == 0x14:
+        rx = [0] * 48
+        for i in range(6):
+            rx[4 * i] = 0 if i + 1 in FAN_PRESENT else 1
+            rx[4 * i + 2:4 * i + 4] = le16(FAN_FRONT_RPM[i])
+            rx[26 + 4 * i:28 + 4 * i] = le16(FAN_REAR_RPM[i])
+        return rx
+    if cmd == 0x16 and len(req) == 1:
+        rx = [0] * 19
+        if req[0] in PSU_PRESENT:
+            rx[2] = 1
+            temp, rpm, p_out = PSU_SENSORS
+            rx[13:15] = le16(temp)
+            rx[15:17] = le16(rpm)
+            rx[17:19] = le16(p_out)
+        else:
+            rx[0] = 1
+        return rx
+    if cmd == 0x18 and len(req) == 2:
+        return sys_eeprom()[req[0]:req[0] + req[1]]
+    return None
+
+def answer(netfn, cmd, req):
+    """Completion code and data of a request"""
+    if netfn == NETFN_APP:
+        if cmd == 0x01:     # Get Device ID: IPMI 2.0, Accton
+            return CC_OK, [0x20, 0x01, 0x01, 0x00, 0x02, 0x00,
+                           0xdb, 0x0e, 0x00, 0x16, 0x77]
+        if cmd in (0x2f, 0x31):     # Get Global Enables, Get Message Flags
+            return CC_OK, [0x00]
+        if cmd in (0x2e, 0x30):     # Set Global Enables, Clear Message Flags
+            return CC_OK, []
+    if netfn == NETFN_OEM:
+        rx = oem_answer(cmd, req)
+        if rx is not None:
+            return CC_OK, rx
+    return CC_INVALID_CMD, []
+
+def vm_encode(msg):
+    out = []
+    for b in msg + [(-sum(msg)) & 0xff]:
+        if b in (VM_MSG_CHAR, VM_CMD_CHAR, VM_ESCAPE_CHAR):
+            out += [VM_ESCAPE_CHAR, b | 0x10]
+        else:
+            out.append(b)
+    return ''.join(chr(b) for b in out + [VM_MSG_CHAR])
+
+def serve(conn, stats):
+    buf, escape = [], False
+    while True:
+        data = conn.recv(4096)
+        if not data:
+            return
+        for c in data:
+            b = ord(c)
+            if escape:
+                buf.append(b & ~0x10)
+                escape = False
+            elif b == VM_ESCAPE_CHAR:
+                escape = True
+            elif b == VM_CMD_CHAR:
+                # Version and capabilities of the VM side, nothing to answer
+                buf = []
+            elif b == VM_MSG_CHAR:
+                msg, buf = buf, []
+                if len(msg) < 4 or sum(msg) & 0xff:
+                    logging.info('bad message %s', msg)
+                    continue
+                seq, netfn, lun, cmd = msg[0], msg[1] >> 2, msg[1] & 3, msg[2]
+                req = msg[3:-1]
+                cc, rx = answer(netfn, cmd, req)
+                key = '%02x/%02x' % (netfn, cmd)
+                stats[key] = stats.get(key, 0) + 1
+                logging.info('netfn %02x cmd %02x %s: cc %02x, %d bytes',
+                             netfn, cmd, req, cc, len(rx))
+                conn.sendall(vm_encode([seq, ((netfn | 1) << 2) | lun, cmd, cc]
+                                       + rx))
+            else:
+                buf.append(b)
+
+def run_bmc(port):
+    s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(('', port))
+    s.listen(1)
+    print 'BMC listening on port %d' % port
+    while True:
+        conn, peer = s.accept()
+        stats = {}
+        print 'Guest connected from %s:%d' % peer
+        try:
+            serve(conn, stats)
+        except socket.error as e:
+            print 'Connection lost: %s' % e
+        conn.close()
+        print 'Guest gone, requests per netfn/cmd: %s' % \
+              json.dumps(stats, sort_keys=True)
+
+def load(mod, build_dir, args=''):
+    if os.path.exists('/sys/module/' + mod):
+        return True
+    if build_dir:
+        cmd = 'insmod %s/%s.ko %s' % (build_dir, mod, args)
+    else:
+        cmd = 'modprobe %s %s' % (mod, args)
+    return log_os_system(cmd, 1)[0] == 0
+
+def read_attr(dev, attr):
+    try:
+        with open(I2C_PREFIX + dev + '/' + attr) as f:
+            return f.read().strip()
+    except IOError:
+        return None
+
+def read_stats():
+    stats = {}
+    try:
+        with open(IPMI_STATS) as f:
+            for line in f:
+                name, value = line.split()
+                stats[name] = int(value)
+    except (IOError, ValueError):
+        pass
+    return stats
+
+def expected_values():
+    """(device, attribute): what it must show"""
+    exp = {}
+    for port in range(1, 33):
+        exp[('0-0060', 'module_present_%d' % port)] = \
+            '1' if port in QSFP_PRESENT else '0'
+    for i, addr in enumerate([0x48, 0x49, 0x4a]):
+        exp[('0-%04x' % addr, 'temp1_input')] = str(THERMAL_C[i] * 1000)
+    for i in range(6):
+        exp[('0-0066', 'fan%d_present' % (i + 1))] = \
+            '1' if i + 1 in FAN_PRESENT else '0'
+        exp[('0-0066', 'fan%d_front_speed_rpm' % (i + 1))] = \
+            str(FAN_FRONT_RPM[i])
+        exp[('0-0066', 'fan%d_rear_speed_rpm' % (i + 1))] = \
+            str(FAN_REAR_RPM[i])
+    for i, addr in enumerate([0x53, 0x50]):
+        present = '1' if i + 1 in PSU_PRESENT else '0'
+        exp[('0-%04x' % addr, 'psu_present')] = present
+        exp[('0-%04x' % addr, 'psu_power_good')] = present
+    return exp
+
+def check_oom(wrong):
+    """Present ports show both pages, absent ones a blank image"""
+    for port in QSFP_PRESENT + [2]:
+        dev = '0-%04x' % int(str(port), 16)
+        if port in QSFP_PRESENT:
+            want = ''.join(chr(b) for b in qsfp_page(port, 0) +
+                           qsfp_page(port, 1))
+        else:
+            want = '\xff' * 256
+        try:
+            with open(I2C_PREFIX + dev + '/eeprom') as f:
+                got = f.read()
+        except IOError as e:
+            wrong[dev + '/eeprom'] = str(e)
+            continue
+        if got[:256] != want:
+            wrong[dev + '/eeprom'] = repr(got[148:164])
+
+def run_check(build_dir, interval):
+    entry = {'passed': False}
+    for mod in ['ipmi_msghandler', 'ipmi_si', 'ipmi_devintf']:
+        log_os_system('modprobe ' + mod, 1)
+    if not os.path.exists(I2C_PREFIX + 'i2c-0'):
+        # The drivers only hold what the client hands them, any bus 0 does
+        log_os_system('modprobe i2c-stub chip_addr=0x03', 1)
+    if not os.path.exists(I2C_PREFIX + 'i2c-0'):
+        entry['error'] = 'no i2c-0'
+        return entry
+
+    for mod in MODULES:
+        if not load(mod, build_dir):
+            entry['error'] = 'cannot load ' + mod
+            return entry
+    created = []
+    for name, addr in DEVICES:
+        if os.path.exists('%s0-%04x' % (I2C_PREFIX, addr)):
+            continue
+        status, output = log_os_system('echo %s 0x%02x > %si2c-0/new_device' %
+                                       (name, addr, I2C_PREFIX), 1)
+        if not status:
+            created.append(addr)
+
+    try:
+        begin = time.time()
+        if not load(IPMI_MODULE, build_dir, 'poll_interval_ms=%d' % interval):
+            entry['error'] = 'cannot load ' + IPMI_MODULE
+            return entry
+        stats = read_stats()
+        while stats.get('cycles', 0) < WAIT_CYCLES and \
+              time.time() - begin < WAIT_TIMEOUT:
+            time.sleep(interval / 1000.0)
+            stats = read_stats()
+        entry['first_cycles_s'] = round(time.time() - begin, 3)
+        entry['ipmi_stats'] = stats
+
+        wrong = {}
+        for (dev, attr), value in sorted(expected_values().items()):
+            got = read_attr(dev, attr)
+            if got != value:
+                wrong[dev + '/' + attr] = got
+        check_oom(wrong)
+        entry['wrong'] = wrong
+        entry['pmbus'] = dict((attr, read_attr('0-005b', attr)) for attr in
+                              ['psu_temp1_input', 'psu_fan1_speed_rpm',
+                               'psu_p_out'])
+        entry['sys_eeprom'] = read_attr('0-0056', 'eeprom') is not None
+        entry['passed'] = (not wrong and entry['sys_eeprom'] and
+                           stats.get('cycles', 0) >= WAIT_CYCLES and
+                           stats.get('errors', 1) == 0)
+    finally:
+        log_os_system('rmmod ' + IPMI_MODULE, 0)
+        for addr in reversed(created):
+            log_os_system('echo 0x%02x > %si2c-0/delete_device' %
+                          (addr, I2C_PREFIX), 0)
+    return entry
+
+def main():
+    global DEBUG
+
+    port = 9002
+    build_dir = None
+    interval = 200
+    output = None
+
+    try:
+        options, args = getopt.getopt(sys.argv[1:], 'hdp:b:i:o:',
+                                      ['help', 'debug', 'port=', 'build=',
+                                       'interval=', 'output='])
+    except getopt.GetoptError:
+        show_help()
+
+    for opt, arg in options:
+        if opt in ('-h', '--help'):
+            show_help()
+        elif opt in ('-d', '--debug'):
+            DEBUG = True
+            logging.basicConfig(level=logging.INFO)
+        elif opt in ('-p', '--port'):
+            port = int(arg)
+        elif opt in ('-b', '--build'):
+            build_dir = os.path.abspath(arg)
+        elif opt in ('-i', '--interval'):
+            interval = int(arg)
+        elif opt in ('-o', '--output'):
+            output = arg
+
+    if args == ['bmc']:
+        run_bmc(port)
+        return 0
+    if args != ['check']:
+        show_help()
+
+    doc = {
+        'kernel': os.uname()[2],
+        'time': int(time.time()),
+        'interval_ms': interval,
+        'result': run_check(build_dir, interval),
+    }
+    text = json.dumps(doc, indent=2, sort_keys=True)
+    if output:
+        with open(output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print text
+    return 0 if doc['result']['passed'] else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
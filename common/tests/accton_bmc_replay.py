@@ -0,0 +1,352 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Usage: %(scriptName)s [options]
+
+Run the wedge100bf psensor driver against a replayed BMC console, with
+no BMC. A pty takes the place of /dev/ttyACM0 and answers the login,
+the prompt and the commands of tty_cmd[] from a recording; the driver
+is loaded once per case and its sysfs values are compared with the
+recording. Must run as root on a box with no /dev/ttyACM0 and with the
+driver not loaded.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : log the console traffic
+    -m | --module=FILE      : insmod FILE, not modprobe the driver
+    -r | --recording=FILE   : console to replay (default: built in 65x)
+    -c | --case=NAME        : run only this case, may be repeated
+    -t | --time=SECONDS     : how long each case runs (default 5)
+    -l | --list             : list the cases and exit
+    -o | --output=FILE      : write the JSON results to FILE, not stdout
+
+A recording is a JSON object: "user", "password", "prompt" and
+"commands", which maps each command the driver runs, as one part of a
+';' separated line, to its output. The 'printf' section tags of the
+snapshot line are answered without it. Cases:
+
+    snapshot : one compound command per refresh, one login in all
+    per_type : one command per sensor type, one login in all
+    relogin  : the BMC drops the session after the first command, the
+               driver must log in again once and read on
+
+Results are one JSON document, per case the logins and commands seen
+on the console, the time to the first values, and the attributes that
+did not read what the recording says. The exit status is 1 if a case
+failed.
+"""
+
+import os
+import sys, getopt
+import logging
+import json
+import time
+import re
+import pty
+import tty
+import select
+import threading
+import commands
+
+DEBUG = False
+DRIVER = 'accton_wedge100bf_psensor'
+TTY_DEVICE = '/dev/ttyACM0'
+SYSFS_DIR = '/sys/devices/platform/wedge_psensor'
+REFRESH_MS = 500
+SENSOR_TYPES = 7
+
+CMD_TEMP = 'cat /sys/bus/i2c/devices/[38]-004*/temp1_input'
+CMD_TEMP_MAX = 'cat /sys/bus/i2c/devices/[38]-004*/temp1_max'
+CMD_TEMP_HYST = 'cat /sys/bus/i2c/devices/[38]-004*/temp1_max_hyst'
+CMD_FAN = 'ls -v /sys/bus/i2c/devices/8-0033/fan*_input | xargs cat'
+CMD_FAN_DN = 'ls -v /sys/bus/i2c/devices/9-0033/fan*_input | xargs cat'
+CMD_PSU1 = 'i2cdump -y -f -r 0x88-0x97 7 0x59 w'
+CMD_PSU2 = 'i2cdump -y -f -r 0x88-0x97 7 0x5a w'
+
+def i2cdump_words(words):
+    lines = ['     0,8  1,9  2,a  3,b  4,c  5,d  6,e  7,f']
+    for row in range(0, len(words), 8):
+        lines.append('%02x: %s' % (0x88 + row,
+                     ' '.join('%04x' % w for w in words[row:row+8])))
+    return '\n'.join(lines)
+
+# Values as an 65x BMC gives them, PMBus words from 0x88 to 0x97
+DEFAULT_CONSOLE = {
+    'user': 'root',
+    'password': '0penBmc',
+    'prompt': 'root@bmc:~# ',
+    'commands': {
+        CMD_TEMP: '27500\n29000\n31250\n26750\n28000\n33500\n30125',
+        CMD_TEMP_MAX: '80000\n80000\n80000\n80000\n80000\n80000\n80000',
+        CMD_TEMP_HYST: '75000\n75000\n75000\n75000\n75000\n75000\n75000',
+        CMD_FAN: '7500\n7650\n7350\n7500\n7800\n7650\n7500\n7350\n7650\n7500',
+        CMD_FAN_DN: '5700\n5850\n5700\n5550\n5850\n5700\n5700\n5850\n5550\n5700',
+        'i2cset -y -f 7 0x70 0 2': '',
+        'i2cset -y -f 7 0x70 0 1': '',
+        CMD_PSU1: i2cdump_words([0xf9b0, 0xd2c6, 0x0000, 0x180c,
+                                 0xd01f, 0x0000, 0x0000, 0x0000,
+                                 0x0000, 0x0000, 0x0000, 0x0000,
+                                 0x0000, 0x0000, 0x0a7a, 0x0aa4]),
+        CMD_PSU2: i2cdump_words([0xf9b1, 0xd2b4, 0x0000, 0x180a,
+                                 0xd01d, 0x0000, 0x0000, 0x0000,
+                                 0x0000, 0x0000, 0x0000, 0x0000,
+                                 0x0000, 0x0000, 0x0a68, 0x0a90]),
+    },
+}
+
+# Attributes checked against the recording: command, name, first index
+EXPECTED = [
+    (CMD_TEMP, 'temp%d_input', 1),
+    (CMD_TEMP_MAX, 'temp%d_max', 1),
+    (CMD_TEMP_HYST, 'temp%d_max_hyst', 1),
+    (CMD_FAN, 'fan%d_input', 1),
+    (CMD_FAN_DN, 'fan%d_input', 11),
+]
+
+# name: module parameters, session dropped after that many commands
+CASES = [
+    ('snapshot', {'snapshot': 1}, None),
+    ('per_type', {'snapshot': 0}, None),
+    ('relogin', {'snapshot': 1}, 1),
+]
+
+PRINTF_TAG = re.compile(r"printf '\|S%d\|\\n' (\d+)$")
+
+def show_help():
+    print __doc__ % {'scriptName' : sys.argv[0].split("/")[-1]}
+    sys.exit(0)
+
+def log_os_system(cmd):
+    status, output = commands.getstatusoutput(cmd)
+    if DEBUG:
+        logging.debug('%s: %d %s', cmd, status, output)
+    return status, output
+
+class BmcConsole(threading.Thread):
+    """Master side of the pty, a getty and a shell playing the recording"""
+
+    def __init__(self, recording, drop_after=None):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.rec = recording
+        self.drop_after = drop_after
+        self.master, self.slave = pty.openpty()
+        tty.setraw(self.slave)
+        self.path = os.ttyname(self.slave)
+        self.state = 'login'
+        self.pending = ''
+        self.logins = 0
+        self.commands = 0
+        self.unknown = []
+        self.stop = threading.Event()
+
+    def send(self, text):
+        if DEBUG:
+            logging.debug('bmc> %r', text)
+        os.write(self.master, text.replace('\n', '\r\n'))
+
+    def run_part(self, part):
+        m = PRINTF_TAG.match(part)
+        if m:
+            return '|S%s|\n' % m.group(1)
+        if part in self.rec['commands']:
+            out = self.rec['commands'][part]
+            return out + '\n' if out else ''
+        self.unknown.append(part)
+        return 'sh: %s: not found\n' % part.split()[0]
+
+    def line(self, line):
+        if DEBUG:
+            logging.debug('bmc< %r', line)
+        if self.state == 'login':
+            if line == self.rec['user']:
+                self.state = 'password'
+                self.send(line + '\nPassword: ')
+            elif line:
+                self.send(line + '\nLogin incorrect\nbmc login: ')
+            else:
+                self.send('\nbmc login: ')
+        elif self.state == 'password':
+            if line == self.rec['password']:
+                self.state = 'shell'
+                self.logins += 1
+                self.send('\n' + self.rec['prompt'])
+            else:
+                self.state = 'login'
+                self.send('\nLogin incorrect\nbmc login: ')
+        elif not line:
+            self.send('\n' + self.rec['prompt'])
+        else:
+            out = ''.join(self.run_part(p.strip()) for p in line.split('; '))
+            self.send(line + '\n' + out + self.rec['prompt'])
+            self.commands += 1
+            if self.commands == self.drop_after:
+                self.state = 'login'
+
+    def run(self):
+        while not self.stop.is_set():
+            r, w, x = select.select([self.master], [], [], 0.1)
+            if not r:
+                continue
+            try:
+                data = os.read(self.master, 4096)
+            except OSError:
+                continue
+            # The driver sends the terminating NUL of its strings too
+            self.pending += data.replace('\0', '').replace('\n', '')
+            while '\r' in self.pending:
+                line, self.pending = self.pending.split('\r', 1)
+                self.line(line)
+
+    def close(self):
+        self.stop.set()
+        self.join()
+        os.close(self.master)
+        os.close(self.slave)
+
+def expected_values(recording):
+    values = {}
+    for cmd, name, first in EXPECTED:
+        nums = re.findall(r'-?\d+', recording['commands'].get(cmd, ''))
+        for i, v in enumerate(nums):
+            values[name % (first + i)] = int(v)
+    return values
+
+def read_attr(name):
+    try:
+        with open(os.path.join(SYSFS_DIR, name)) as f:
+            return int(f.read().strip())
+    except (IOError, ValueError):
+        return None
+
+def load_driver(module, params):
+    args = ' '.join('%s=%s' % kv for kv in sorted(params.items()))
+    if module:
+        return log_os_system('insmod %s %s' % (module, args))
+    return log_os_system('modprobe %s %s' % (DRIVER, args))
+
+def run_case(name, params, drop_after, recording, module, seconds):
+    entry = {'case': name}
+    console = BmcConsole(recording, drop_after)
+    os.symlink(console.path, TTY_DEVICE)
+    console.start()
+
+    params = dict(params)
+    params['refresh_ms'] = ','.join([str(REFRESH_MS)] * SENSOR_TYPES)
+    begin = time.time()
+    status, output = load_driver(module, params)
+    try:
+        if status:
+            entry['error'] = output
+            entry['passed'] = False
+            return entry
+
+        # The first read waits for the first refresh
+        read_attr('temp1_input')
+        entry['first_read_s'] = round(time.time() - begin, 3)
+        time.sleep(seconds)
+
+        wrong = {}
+        for attr, value in sorted(expected_values(recording).items()):
+            got = read_attr(attr)
+            if got != value:
+                wrong[attr] = got
+        entry['wrong'] = wrong
+        entry['update_age_ms'] = read_attr('update_age_ms')
+    finally:
+        if not status:
+            log_os_system('rmmod %s' % DRIVER)
+        console.close()
+        os.unlink(TTY_DEVICE)
+
+    entry['logins'] = console.logins
+    entry['commands'] = console.commands
+    entry['unknown_commands'] = sorted(set(console.unknown))
+    expect_logins = 1 if drop_after is None else 2
+    entry['passed'] = (not wrong and console.logins == expect_logins and
+                       console.commands > (drop_after or 0))
+    return entry
+
+def main():
+    global DEBUG
+
+    module = None
+    recording = DEFAULT_CONSOLE
+    only = []
+    seconds = 5
+    output = None
+
+    try:
+        options, args = getopt.getopt(sys.argv[1:], 'hdm:r:c:t:lo:',
+                                      ['help', 'debug', 'module=',
+                                       'recording=', 'case=', 'time=',
+                                       'list', 'output='])
+    except getopt.GetoptError:
+        show_help()
+
+    for opt, arg in options:
+        if opt in ('-h', '--help'):
+            show_help()
+        elif opt in ('-d', '--debug'):
+            DEBUG = True
+            logging.basicConfig(level=logging.DEBUG)
+        elif opt in ('-m', '--module'):
+            module = arg
+        elif opt in ('-r', '--recording'):
+            with open(arg) as f:
+                recording = json.load(f)
+        elif opt in ('-c', '--case'):
+            only.append(arg)
+        elif opt in ('-t', '--time'):
+            seconds = float(arg)
+        elif opt in ('-l', '--list'):
+            for name, params, drop_after in CASES:
+                print '%-10s %s drop_after=%s' % (name, params, drop_after)
+            return 0
+        elif opt in ('-o', '--output'):
+            output = arg
+
+    if os.geteuid() != 0:
+        print 'Root privileges are required'
+        return 1
+    if os.path.lexists(TTY_DEVICE):
+        print '%s exists, not replacing a real BMC console' % TTY_DEVICE
+        return 1
+    if os.path.exists('/sys/module/%s' % DRIVER):
+        print '%s is loaded, remove it first' % DRIVER
+        return 1
+
+    results = [run_case(name, params, drop_after, recording, module, seconds)
+               for name, params, drop_after in CASES
+               if not only or name in only]
+
+    doc = {
+        'kernel': os.uname()[2],
+        'time': int(time.time()),
+        'results': results,
+    }
+    text = json.dumps(doc, indent=2, sort_keys=True)
+    if output:
+        with open(output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print text
+    return 0 if all(r['passed'] for r in results) else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,874 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2017 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Usage: %(scriptName)s [options] [profile ...]
+
+Measure sysfs attribute latency of the platform drivers without the
+switch: the drivers are bound to i2c-stub chips preloaded with register
+images of the CPLDs, fan board, PSU and transceivers, then the hot
+attributes are read in a loop. Needs root, i2c-stub and i2cset.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : run with debug mode
+    -p | --platform=NAME    : platform profiles to run (default as7716-32x)
+    -n | --reads=N          : timed reads per attribute (default 1000)
+    -b | --build=DIR        : make the modules in DIR against the running
+                              kernel and insmod them from there, instead
+                              of modprobe
+    -B | --baseline=DIR     : also run every profile with the modules
+                              made in DIR, a checkout of the drivers
+                              before a change say, and add its results
+                              to each entry as "baseline"
+    -o | --output=FILE      : write the JSON results to FILE, not stdout
+    -l | --list             : list the profiles of the platform
+
+Test modules, accton_i2c_cpld_bench, are not packaged: they are always
+insmod from common/tests/modules, where they must be made first (see
+the Makefile there).
+
+Results are one JSON document. Per attribute: reads per second, p50 and
+p99 latency in us and, for drivers that include accton_i2c_trace.h,
+the SMBus transactions per read taken from the accton_i2c debugfs
+counters (null otherwise). Profiles may also run functional checks,
+reported with "passed"; the exit status is 1 if any check failed. The
+baseline run does not count: its drivers may predate what is checked.
+"""
+
+import os
+import commands
+import sys, getopt
+import logging
+import json
+import time
+import select
+import socket
+import glob
+
+DEBUG = False
+STUB_NAME = 'SMBus stub driver'
+I2C_PREFIX = '/sys/bus/i2c/devices/'
+TRACE_DEBUGFS = '/sys/kernel/debug/accton_i2c/'
+TRACE_HIST_PARAM = '/sys/module/accton_i2c_trace/parameters/histograms'
+CPLD_BENCH_RUN = '/sys/kernel/debug/accton_i2c_cpld_bench/run'
+TEST_MODULES = ['accton_i2c_cpld_bench']
+TEST_MODULES_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                'modules')
+TRACING = '/sys/kernel/debug/tracing/'
+SMBUS_RESULT = TRACING + 'events/smbus/smbus_result/'
+WARMUP_READS = 10
+NETLINK_KOBJECT_UEVENT = 15
+
+# A QSFP28 lower page and page 00h, identifier and vendor name set
+QSFP_IMAGE = dict([(0, 0x11), (2, 0x04)] +
+                  [(148 + i, ord(c)) for i, c in enumerate('ACCTON BENCH    ')] +
+                  [(128, 0x11)])
+
+# PMBus sensor words of a PSU at 12 V, 250 W
+PMBUS_IMAGE = {0x20: 0x17, 0x88: 0xf0e8, 0x89: 0xb280, 0x8b: 0x1800,
+               0x8c: 0xd2c0, 0x8d: 0xe1e0, 0x90: 0x1a58, 0x96: 0x0b2c,
+               0x97: 0x0b70}
+
+# i2c-stub holds a single adapter, so devices that share an address on
+# the switch (cpld1 and accton_i2c_cpld at 0x60) go in separate profiles.
+# Each profile: modules in load order, chips with their register images
+# {reg: value}, values above 0xff written as words (PMBus), and the
+# attributes to time.
+PROFILES = {
+    'as7716-32x': [
+        {
+            'name': 'cpld_sfp',
+            'modules': ['accton_i2c_trace', 'accton_i2c_cpld',
+                        'accton_as7716_32x_sfp'],
+            'chips': [
+                ('accton_i2c_cpld', 0x60, {0x01: 0x05, 0x30: 0xfe,
+                    0x31: 0xff, 0x32: 0xff, 0x33: 0xff}),
+                ('as7716_32x_sfp1', 0x50, QSFP_IMAGE),
+            ],
+            'attributes': [(0x50, 'sfp_is_present_all'),
+                           (0x50, 'sfp_is_present'),
+                           (0x50, 'sfp_eeprom')],
+        },
+        {
+            'name': 'cpld1_fan_psu',
+            'modules': ['accton_i2c_trace', 'accton_as7716_32x_cpld1',
+                        'accton_as7716_32x_fan', 'accton_as7716_32x_psu',
+                        'ym2651y'],
+            'chips': [
+                ('as7716_32x_cpld1', 0x60, {0x01: 0x05, 0x02: 0xf6,
+                    0x30: 0xfe, 0x31: 0xff, 0x32: 0xff, 0x33: 0xff}),
+                ('as7716_32x_fan', 0x66, dict([(0x0f, 0x00), (0x10, 0x3f),
+                    (0x11, 0x07)] +
+                    [(r, 0x5a) for r in range(0x12, 0x18)] +
+                    [(r, 0x50) for r in range(0x22, 0x28)])),
+                ('as7716_32x_psu1', 0x53, dict(
+                    [(0x20 + i, ord(c)) for i, c in enumerate('YM-2651Y  ')])),
+                ('ym2651', 0x5b, {0x8b: 0x1b00, 0x8c: 0xd2c0,
+                    0x8d: 0xe1e0, 0x90: 0x1a58, 0x96: 0x0b2c}),
+            ],
+            'attributes': [(0x60, 'module_present_all'),
+                           (0x66, 'fan1_front_speed_rpm'),
+                           (0x66, 'fan1_present'),
+                           (0x53, 'psu_present'),
+                           (0x5b, 'psu_p_out')],
+        },
+        {
+            'name': 'pmbus',
+            'modules': ['accton_i2c_trace', 'ym2651y'],
+            'chips': [
+                ('ym2651', 0x5b, PMBUS_IMAGE),
+            ],
+            'attributes': [(0x5b, 'psu_p_out'),
+                           (0x5b, 'psu_mfr_id')],
+            'checks': [('pmbus_cache', {'addr': 0x5b,
+                        'stats': 'psu_pmbus_stats',
+                        'attributes': [('psu_p_out', 1),
+                                       ('psu_mfr_id', 1)]}),
+                       ('smbus_traffic', {'addr': 0x5b,
+                        'attributes': ['psu_p_out', 'psu_mfr_id']})],
+        },
+        {
+            'name': 'optoe',
+            'modules': ['accton_i2c_trace', 'optoe'],
+            'chips': [
+                ('optoe1', 0x50, QSFP_IMAGE),
+            ],
+            'attributes': [(0x50, 'eeprom')],
+            'checks': [('eeprom_xfer', {'addr': 0x50, 'eeprom': 'eeprom',
+                        'knob': 'xfer_max'})],
+        },
+    ],
+    'as6712-32x': [
+        {
+            'name': 'pmbus',
+            'modules': ['accton_i2c_trace', 'cpr_4011_4mxx'],
+            'chips': [
+                ('cpr_4011_4mxx', 0x3c, PMBUS_IMAGE),
+            ],
+            'attributes': [(0x3c, 'psu_p_out'),
+                           (0x3c, 'psu_v_out')],
+            'checks': [('pmbus_cache', {'addr': 0x3c,
+                        'stats': 'psu_pmbus_stats',
+                        'attributes': [('psu_p_out', 1),
+                                       ('psu_v_out', 2)]}),
+                       ('smbus_traffic', {'addr': 0x3c,
+                        'attributes': ['psu_p_out', 'psu_v_out']})],
+        },
+    ],
+    'as7712-32x': [
+        {
+            'name': 'sfp_xfer',
+            'modules': ['accton_i2c_trace', 'accton_i2c_cpld',
+                        'accton_as7712_32x_sfp'],
+            'chips': [
+                ('cpld_as7712', 0x60, {0x01: 0x05, 0x30: 0xfe,
+                    0x31: 0xff, 0x32: 0xff, 0x33: 0xff}),
+                ('sfp1', 0x50, QSFP_IMAGE),
+            ],
+            'attributes': [(0x50, 'sfp_eeprom')],
+            'checks': [('eeprom_xfer', {'addr': 0x50, 'eeprom': 'sfp_eeprom',
+                        'knob': 'sfp_xfer_max'}),
+                       ('present_notify', {'addr': 0x60, 'reg': 0x30,
+                        'attribute': 'module_present_all',
+                        'module': 'accton_i2c_cpld', 'invert': True,
+                        'sfp_addr': 0x50})],
+        },
+        {
+            'name': 'pmbus_3y',
+            'modules': ['accton_i2c_trace', 'accton_pmbus_3y'],
+            'chips': [
+                ('accton_ym2651', 0x5b, PMBUS_IMAGE),
+            ],
+            'attributes': [(0x5b, 'hwmon/hwmon*/power2_input'),
+                           (0x5b, 'hwmon/hwmon*/in1_min')],
+            'checks': [('pmbus_cache', {'addr': 0x5b,
+                        'stats': 'hwmon/hwmon*/pmbus_stats',
+                        'attributes': [('hwmon/hwmon*/power2_input', 1),
+                                       ('hwmon/hwmon*/in1_min', 1)]}),
+                       ('smbus_traffic', {'addr': 0x5b,
+                        'attributes': ['hwmon/hwmon*/power2_input',
+                                       'hwmon/hwmon*/in1_min']})],
+        },
+        {
+            'name': 'cpld_present',
+            'modules': ['accton_i2c_cpld'],
+            'chips': [
+                ('cpld_as7712', 0x60, dict([(0x01, 0x05)] +
+                    [(r, 0xff) for r in range(0x30, 0x34)])),
+            ],
+            'attributes': [(0x60, 'module_present_all'),
+                           (0x60, 'module_present_1')],
+            'checks': [('present_notify', {'addr': 0x60, 'reg': 0x30,
+                        'attribute': 'module_present_all',
+                        'module': 'accton_i2c_cpld', 'invert': True})],
+        },
+    ],
+    'as7816-64x': [
+        {
+            'name': 'cpld_present',
+            'modules': ['accton_i2c_cpld'],
+            'chips': [
+                ('cpld_as7816', 0x60, dict([(0x01, 0x05)] +
+                    [(r, 0xff) for r in range(0x70, 0x78)])),
+            ],
+            'attributes': [(0x60, 'module_present_all'),
+                           (0x60, 'module_present_1')],
+            'checks': [('present_notify', {'addr': 0x60, 'reg': 0x70,
+                        'attribute': 'module_present_all',
+                        'module': 'accton_i2c_cpld', 'invert': True})],
+        },
+        {
+            'name': 'cpld_access',
+            'modules': ['accton_i2c_cpld', 'accton_i2c_cpld_bench'],
+            'chips': [
+                ('cpld_as7816', 0x60, {0x01: 0x05}),
+                ('cpld_plain', 0x62, {0x01: 0x05}),
+                ('cpld_plain', 0x64, {0x01: 0x05}),
+                ('cpld_plain', 0x66, {0x01: 0x05}),
+            ],
+            'attributes': [(0x60, 'version')],
+            'checks': [('cpld_access', {'addrs': [0x60, 0x62, 0x64, 0x66],
+                        'absent': 0x7f})],
+        },
+    ],
+}
+
+def my_log(txt):
+    if DEBUG == True:
+        print "[ACCTON DBG]: " + txt
+    return
+
+def log_os_system(cmd, show):
+    logging.info('Run :' + cmd)
+    status, output = commands.getstatusoutput(cmd)
+    my_log(cmd + " with result:" + str(status))
+    my_log("      output:" + output)
+    if status:
+        logging.info('Failed :' + cmd)
+        if show:
+            print('Failed :' + cmd)
+    return status, output
+
+def show_help():
+    print __doc__ % {'scriptName' : sys.argv[0].split("/")[-1]}
+    sys.exit(0)
+
+def load_modules(modules, build_dir):
+    for mod in modules:
+        if os.path.exists('/sys/module/' + mod):
+            continue
+        ko = '%s/%s.ko' % (build_dir, mod) if build_dir else None
+        if mod in TEST_MODULES:
+            ko = '%s/%s.ko' % (TEST_MODULES_DIR, mod)
+            if not os.path.exists(ko):
+                print 'No %s, make %s first' % (ko, TEST_MODULES_DIR)
+                return False
+        if ko and os.path.exists(ko):
+            status, output = log_os_system('insmod ' + ko, 1)
+        else:
+            # Not built there, as accton_i2c_trace in an older tree: a
+            # module needing it fails to insmod if it is not installed
+            status, output = log_os_system('modprobe ' + mod, not ko)
+            if ko:
+                status = 0
+        if status:
+            return False
+    return True
+
+def unload_modules(modules):
+    for mod in reversed(modules):
+        if os.path.exists('/sys/module/' + mod):
+            log_os_system('rmmod ' + mod, 0)
+
+def stub_bus():
+    for name in os.listdir(I2C_PREFIX):
+        if not name.startswith('i2c-'):
+            continue
+        try:
+            with open(I2C_PREFIX + name + '/name') as f:
+                if f.read().strip() == STUB_NAME:
+                    return int(name[4:])
+        except IOError:
+            pass
+    return None
+
+def stub_setup(profile):
+    addrs = ','.join('0x%02x' % addr for drv, addr, image in profile['chips'])
+    status, output = log_os_system('modprobe i2c-stub chip_addr=' + addrs, 1)
+    if status:
+        return None
+    log_os_system('modprobe i2c-dev', 0)
+
+    bus = stub_bus()
+    if bus is None:
+        print 'No i2c-stub adapter'
+        return None
+
+    for drv, addr, image in profile['chips']:
+        for reg in sorted(image):
+            val = image[reg]
+            log_os_system('i2cset -y -f %d 0x%02x 0x%02x 0x%02x %s' %
+                          (bus, addr, reg, val, 'w' if val > 0xff else 'b'), 1)
+    for drv, addr, image in profile['chips']:
+        log_os_system('echo %s 0x%02x > %si2c-%d/new_device' %
+                      (drv, addr, I2C_PREFIX, bus), 1)
+    return bus
+
+def stub_teardown():
+    log_os_system('modprobe -r i2c-stub', 1)
+
+def trace_calls(dev):
+    """Timed calls so far of the traced device dev, None if untraced"""
+    try:
+        with open(TRACE_DEBUGFS + dev) as f:
+            for line in f:
+                if line.startswith('calls '):
+                    return int(line.split()[1])
+    except (IOError, ValueError):
+        pass
+    return None
+
+def bus_transactions(bus):
+    """Timed calls so far of the traced devices on bus (None if there
+    are none) and the names of all traced devices"""
+    prefix = '%d-' % bus
+    calls = None
+    try:
+        names = os.listdir(TRACE_DEBUGFS)
+    except OSError:
+        return None, set()
+    for name in names:
+        if not name.startswith(prefix):
+            continue
+        try:
+            with open(TRACE_DEBUGFS + name) as f:
+                for line in f:
+                    if line.startswith('calls '):
+                        calls = (calls or 0) + int(line.split()[1])
+                        break
+        except (IOError, ValueError):
+            pass
+    return calls, set(names)
+
+def percentile(sorted_vals, p):
+    if not sorted_vals:
+        return None
+    idx = min(len(sorted_vals) - 1, int(len(sorted_vals) * p / 100.0))
+    return sorted_vals[idx]
+
+def time_attribute(path, reads):
+    for i in range(WARMUP_READS):
+        with open(path) as f:
+            f.read()
+
+    lat = []
+    begin = time.time()
+    for i in range(reads):
+        t0 = time.time()
+        with open(path) as f:
+            f.read()
+        lat.append(time.time() - t0)
+    elapsed = time.time() - begin
+
+    lat.sort()
+    return {
+        'reads_per_sec': round(reads / elapsed, 1) if elapsed > 0 else None,
+        'p50_us': round(percentile(lat, 50) * 1e6, 1),
+        'p99_us': round(percentile(lat, 99) * 1e6, 1),
+    }
+
+def attribute_path(bus, addr, attr):
+    """Path of attr of the device at addr, which may be a glob for the
+    attributes of its hwmon device; None if there is no such file"""
+    paths = glob.glob('%s%d-%04x/%s' % (I2C_PREFIX, bus, addr, attr))
+    return paths[0] if paths else None
+
+def i2cset(bus, addr, reg, val):
+    return log_os_system('i2cset -y -f %d 0x%02x 0x%02x 0x%02x' %
+                         (bus, addr, reg, val), 1)[0] == 0
+
+def i2cget(bus, addr, reg):
+    status, output = log_os_system('i2cget -y -f %d 0x%02x 0x%02x' %
+                                   (bus, addr, reg), 1)
+    return None if status else int(output, 16)
+
+def notify_after(path, action, timeout_ms):
+    """Run action, then wait for sysfs_notify() on path. Returns the ms
+    from action to the wake up, or None on timeout. The attribute is read
+    first so a notification right after action is not missed."""
+    with open(path) as f:
+        f.read()
+        p = select.poll()
+        p.register(f, select.POLLPRI | select.POLLERR)
+        t0 = time.time()
+        action()
+        if not p.poll(timeout_ms):
+            return None
+        return round((time.time() - t0) * 1000, 1)
+
+def uevent_socket():
+    """Socket that gets the kernel uevents, bound before the action"""
+    s = socket.socket(socket.AF_NETLINK, socket.SOCK_DGRAM,
+                      NETLINK_KOBJECT_UEVENT)
+    s.bind((0, 1))
+    return s
+
+def uevent_wait(sock, action, devname, timeout_ms):
+    """Environment of the next uevent action@.../devname, None on timeout"""
+    deadline = time.time() + timeout_ms / 1000.0
+    while True:
+        left = deadline - time.time()
+        if left <= 0 or not select.select([sock], [], [], left)[0]:
+            return None
+        fields = sock.recv(8192).split('\0')
+        env = dict(f.split('=', 1) for f in fields[1:] if '=' in f)
+        if env.get('ACTION') == action and \
+           env.get('DEVPATH', '').endswith('/' + devname):
+            return env
+
+def write_file(path, text):
+    with open(path, 'w') as f:
+        f.write(text)
+
+def check_present_notify(bus, addr, reg, attribute, module, invert,
+                         sfp_addr=None, period=100):
+    """Poll presence every period ms and flip a presence bit behind the
+    driver: poll() on the attribute, and on sfp_is_present_all of the
+    SFP client at sfp_addr if given, must wake up and a change uevent
+    must carry the new bitmap, a set bit for a present port (invert: a
+    clear register bit), with only that bit in CHANGED. With
+    present_poll_ms set to 0 poll() must not wake up, and setting it
+    back must restart the poller. reg is the first presence register,
+    so the bit flipped is port 1."""
+    devname = '%d-%04x' % (bus, addr)
+    path = '%s%s/%s' % (I2C_PREFIX, devname, attribute)
+    param = '/sys/module/%s/parameters/present_poll_ms' % module
+    with open(param) as f:
+        default = int(f.read())
+    timeout = period * 4
+    value = i2cget(bus, addr, reg)
+    if value is None:
+        return {'passed': False, 'error': 'i2cget failed'}
+    write_file(param, str(period))
+
+    # Let the poller take the current bitmap as its reference
+    time.sleep(timeout / 1000.0)
+
+    def flip():
+        i2cset(bus, addr, reg, i2cget(bus, addr, reg) ^ 0x01)
+
+    entry = {'present_poll_ms': period}
+    sock = uevent_socket()
+    try:
+        entry['wake_ms'] = notify_after(path, flip, timeout)
+        env = uevent_wait(sock, 'change', devname, timeout)
+    finally:
+        sock.close()
+    if env is not None:
+        entry['uevent'] = {'PRESENT': env.get('PRESENT'),
+                           'CHANGED': env.get('CHANGED')}
+        want = i2cget(bus, addr, reg)
+        if invert:
+            want = ~want & 0xff
+        uevent_ok = (int(env.get('CHANGED', '0'), 16) == 0x01 and
+                     int(env.get('PRESENT', '0'), 16) & 0xff == want)
+    else:
+        entry['uevent'] = None
+        uevent_ok = False
+
+    sfp_ok = True
+    if sfp_addr is not None:
+        entry['sfp_wake_ms'] = notify_after(attribute_path(bus, sfp_addr,
+                                            'sfp_is_present_all'),
+                                            flip, timeout)
+        sfp_ok = entry['sfp_wake_ms'] is not None
+
+    write_file(param, '0')
+    time.sleep(timeout / 1000.0)
+    entry['wake_ms_stopped'] = notify_after(path, flip, timeout)
+    entry['wake_ms_restarted'] = notify_after(path,
+        lambda: write_file(param, str(period)), timeout)
+
+    i2cset(bus, addr, reg, value)
+    write_file(param, str(default))
+    entry['passed'] = (entry['wake_ms'] is not None and uevent_ok and sfp_ok and
+                       entry['wake_ms_stopped'] is None and
+                       entry['wake_ms_restarted'] is not None)
+    return entry
+
+def pmbus_transfers(path):
+    with open(path) as f:
+        for line in f:
+            if line.startswith('transfers '):
+                return int(line.split()[1])
+    return None
+
+def check_pmbus_cache(bus, addr, stats, attributes, reads=20):
+    """Read each attribute back to back: it must cost at most the given
+    transfers, once more if a refresh interval ends meanwhile, and not
+    one per read"""
+    stats_path = attribute_path(bus, addr, stats)
+    if stats_path is None:
+        return {'passed': False, 'error': 'no ' + stats}
+
+    entry = {'passed': True, 'reads': reads}
+    for attr, most in attributes:
+        path = attribute_path(bus, addr, attr)
+        if path is None:
+            entry['passed'] = False
+            entry[attr] = 'no such attribute'
+            continue
+        before = pmbus_transfers(stats_path)
+        for i in range(reads):
+            with open(path) as f:
+                f.read()
+        transfers = pmbus_transfers(stats_path) - before
+        entry[attr] = transfers
+        if transfers > 2 * most:
+            entry['passed'] = False
+    return entry
+
+def smbus_count(bus, addr, read):
+    """SMBus transfers to addr on bus while read() runs, as the kernel's
+    smbus_result tracepoint sees them: untraced drivers count too"""
+    write_file(SMBUS_RESULT + 'filter',
+               'adapter_nr == %d && addr == %d' % (bus, addr))
+    write_file(TRACING + 'trace', '')
+    write_file(SMBUS_RESULT + 'enable', '1')
+    try:
+        read()
+    finally:
+        write_file(SMBUS_RESULT + 'enable', '0')
+    with open(TRACING + 'trace') as f:
+        return sum(1 for line in f if ' a=%03x ' % addr in line)
+
+def check_smbus_traffic(bus, addr, attributes, reads=10, gap_ms=500):
+    """Transfers and time of reading each attribute reads times, gap_ms
+    apart so that cached values expire on the way. Only a measurement:
+    compare it with the baseline run"""
+    if not os.path.exists(SMBUS_RESULT):
+        return {'passed': False, 'error': 'no smbus tracepoints'}
+
+    entry = {'passed': True, 'reads': reads, 'gap_ms': gap_ms}
+    for attr in attributes:
+        path = attribute_path(bus, addr, attr)
+        if path is None:
+            entry['passed'] = False
+            entry[attr] = 'no such attribute'
+            continue
+        lat = []
+        def read():
+            for i in range(reads):
+                t0 = time.time()
+                with open(path) as f:
+                    f.read()
+                lat.append(time.time() - t0)
+                time.sleep(gap_ms / 1000.0)
+        transfers = smbus_count(bus, addr, read)
+        entry[attr] = {'transfers': transfers,
+                       'max_us': round(max(lat) * 1e6, 1),
+                       'total_us': round(sum(lat) * 1e6, 1)}
+    return entry
+
+def cpld_bench_run(addrs):
+    """Run accton_i2c_cpld_bench on addrs, all at once. Returns the wall
+    time in ns and {addr: (calls, errors, avg_ns)}"""
+    write_file(CPLD_BENCH_RUN, ' '.join('0x%02x' % a for a in addrs))
+    wall, per_addr = None, {}
+    with open(CPLD_BENCH_RUN) as f:
+        for line in f:
+            words = line.split()
+            if words[0] == 'wall_ns':
+                wall = int(words[1])
+            else:
+                per_addr[int(words[0], 16)] = (int(words[2]), int(words[4]),
+                                               int(words[6]))
+    return wall, per_addr
+
+def check_cpld_access(bus, addrs, absent):
+    """Time accton_i2c_cpld_read() in the kernel: on an address with no
+    client (the lookup alone), on each CPLD alone and on all of them at
+    once. Every access to a CPLD must succeed and none to the absent
+    one. i2c-stub is one adapter, so only the lookups can overlap."""
+    entry = {'passed': True}
+    wall, res = cpld_bench_run([absent])
+    calls, errors, entry['lookup_ns'] = res[absent]
+    if errors != calls:
+        entry['passed'] = False
+
+    serial_ns = 0
+    entry['access_ns'] = {}
+    for addr in addrs:
+        wall, res = cpld_bench_run([addr])
+        calls, errors, entry['access_ns']['0x%02x' % addr] = res[addr]
+        serial_ns += wall
+        if errors or not calls:
+            entry['passed'] = False
+
+    wall, res = cpld_bench_run(addrs)
+    entry['concurrent_wall_ns'] = wall
+    entry['serial_wall_ns'] = serial_ns
+    for addr in addrs:
+        calls, errors, avg_ns = res[addr]
+        if errors or not calls:
+            entry['passed'] = False
+    return entry
+
+def adapter_plain_i2c(bus):
+    status, output = log_os_system('i2cdetect -F %d' % bus, 1)
+    for line in output.splitlines():
+        if line.startswith('I2C '):
+            return line.split()[-1] == 'yes'
+    return None
+
+def check_eeprom_xfer(bus, addr, eeprom, knob, sizes=(8, 16, 32, 128, 256),
+                      reads=200):
+    """Time full EEPROM reads for each transfer size written to knob.
+    The knob must take up to the SMBus block limit, and up to a page on
+    adapters that do plain I2C; i2c-stub does not, so there the largest
+    transfer is 32 bytes. Every accepted size must read the same bytes,
+    in no more transactions than a smaller one."""
+    dev = '%d-%04x' % (bus, addr)
+    eeprom_path = attribute_path(bus, addr, eeprom)
+    knob_path = attribute_path(bus, addr, knob)
+    if eeprom_path is None or knob_path is None:
+        return {'passed': False, 'error': 'no %s or %s' % (eeprom, knob)}
+
+    with open(knob_path) as f:
+        default = int(f.read())
+    plain_i2c = adapter_plain_i2c(bus)
+    entry = {'passed': True, 'plain_i2c': plain_i2c,
+             'default_xfer_max': default, 'sizes': {}}
+    content = None
+    last_transactions = None
+    for size in sizes:
+        result = {}
+        entry['sizes'][str(size)] = result
+        try:
+            write_file(knob_path, str(size))
+            result['accepted'] = True
+        except IOError:
+            result['accepted'] = False
+        if plain_i2c is not None and result['accepted'] != \
+           (size <= 32 or (plain_i2c and size <= 128)):
+            entry['passed'] = False
+        if not result['accepted']:
+            continue
+
+        with open(eeprom_path) as f:
+            data = f.read()
+        if content is None:
+            content = data
+        elif data != content:
+            result['same_content'] = False
+            entry['passed'] = False
+
+        before = trace_calls(dev)
+        result.update(time_attribute(eeprom_path, reads))
+        after = trace_calls(dev)
+        if before is not None and after is not None:
+            transactions = float(after - before) / (reads + WARMUP_READS)
+            result['bus_transactions_per_read'] = round(transactions, 3)
+            if last_transactions is not None and \
+               transactions > last_transactions:
+                entry['passed'] = False
+            last_transactions = transactions
+
+    accepted = [(size, entry['sizes'][str(size)]) for size in sizes
+                if entry['sizes'][str(size)].get('p50_us')]
+    if len(accepted) > 1:
+        entry['speedup'] = round(accepted[0][1]['p50_us'] /
+                                 accepted[-1][1]['p50_us'], 2)
+    write_file(knob_path, str(default))
+    return entry
+
+CHECKS = {
+    'present_notify': check_present_notify,
+    'pmbus_cache': check_pmbus_cache,
+    'cpld_access': check_cpld_access,
+    'eeprom_xfer': check_eeprom_xfer,
+    'smbus_traffic': check_smbus_traffic,
+}
+
+def run_profile(profile, reads, build_dir):
+    results = []
+    if not load_modules(profile['modules'], build_dir):
+        return None
+    # The calls counted per device are those of the histograms, off by default
+    if os.path.exists(TRACE_HIST_PARAM):
+        write_file(TRACE_HIST_PARAM, '1')
+    bus = stub_setup(profile)
+    if bus is None:
+        stub_teardown()
+        return None
+
+    try:
+        for addr, attr in profile['attributes']:
+            dev = '%d-%04x' % (bus, addr)
+            path = attribute_path(bus, addr, attr)
+            entry = {'profile': profile['name'], 'device': dev,
+                     'attribute': attr}
+            if path is None:
+                entry['error'] = 'no such attribute'
+                results.append(entry)
+                continue
+
+            before, traced = bus_transactions(bus)
+            try:
+                entry.update(time_attribute(path, reads))
+            except IOError as e:
+                entry['error'] = str(e)
+                results.append(entry)
+                continue
+            after, traced = bus_transactions(bus)
+
+            # Transactions of untraced drivers are not seen at all
+            if dev in traced and before is not None and after is not None:
+                entry['bus_transactions_per_read'] = \
+                    round(float(after - before) / (reads + WARMUP_READS), 3)
+            else:
+                entry['bus_transactions_per_read'] = None
+            results.append(entry)
+
+        for name, kwargs in profile.get('checks', []):
+            entry = {'profile': profile['name'], 'check': name}
+            try:
+                entry.update(CHECKS[name](bus, **kwargs))
+            except (IOError, OSError, ValueError) as e:
+                entry['passed'] = False
+                entry['error'] = str(e)
+            results.append(entry)
+    finally:
+        stub_teardown()
+
+    return results
+
+def add_baseline(results, baseline):
+    """Attach each baseline entry to the entry of the same attribute or
+    check in results"""
+    def key(r):
+        return (r['profile'], r.get('attribute'), r.get('check'))
+    base = dict((key(b), b) for b in baseline)
+    for r in results:
+        b = base.get(key(r))
+        if b is not None:
+            r['baseline'] = dict((k, v) for k, v in b.items()
+                                 if k not in ('profile', 'device',
+                                              'attribute', 'check'))
+
+def main():
+    global DEBUG
+
+    platform = 'as7716-32x'
+    reads = 1000
+    build_dir = None
+    baseline_dir = None
+    output = None
+    list_only = False
+
+    try:
+        options, args = getopt.getopt(sys.argv[1:], 'hdp:n:b:B:o:l',
+                                      ['help', 'debug', 'platform=',
+                                       'reads=', 'build=', 'baseline=',
+                                       'output=', 'list'])
+    except getopt.GetoptError:
+        show_help()
+
+    for opt, arg in options:
+        if opt in ('-h', '--help'):
+            show_help()
+        elif opt in ('-d', '--debug'):
+            DEBUG = True
+            logging.basicConfig(level=logging.INFO)
+        elif opt in ('-p', '--platform'):
+            platform = arg
+        elif opt in ('-n', '--reads'):
+            reads = int(arg)
+        elif opt in ('-b', '--build'):
+            build_dir = os.path.abspath(arg)
+        elif opt in ('-B', '--baseline'):
+            baseline_dir = os.path.abspath(arg)
+        elif opt in ('-o', '--output'):
+            output = arg
+        elif opt in ('-l', '--list'):
+            list_only = True
+
+    if platform not in PROFILES:
+        print 'No profiles for platform ' + platform
+        return 1
+    profiles = PROFILES[platform]
+    if list_only:
+        for p in profiles:
+            print '%-16s %s' % (p['name'],
+                                ' '.join(a for addr, a in p['attributes']))
+        return 0
+    if args:
+        profiles = [p for p in profiles if p['name'] in args]
+
+    if not os.path.isdir(I2C_PREFIX):
+        print 'No I2C support in this kernel, %s is missing' % I2C_PREFIX
+        return 1
+    if stub_bus() is not None:
+        print 'i2c-stub is in use already'
+        return 1
+
+    for d in (build_dir, baseline_dir):
+        if d:
+            status, out = log_os_system('make -C ' + d, 1)
+            if status:
+                return 1
+
+    results = []
+    for p in profiles:
+        if baseline_dir:
+            # Both runs must load their own modules
+            unload_modules(p['modules'])
+        r = run_profile(p, reads, build_dir)
+        if r is None:
+            print 'Profile %s could not be set up' % p['name']
+            return 1
+        if baseline_dir:
+            unload_modules(p['modules'])
+            b = run_profile(p, reads, baseline_dir)
+            unload_modules(p['modules'])
+            if b is None:
+                print 'Profile %s could not be set up with the baseline' % \
+                      p['name']
+                return 1
+            add_baseline(r, b)
+        results.extend(r)
+
+    failed = [r for r in results if r.get('passed') is False]
+    doc = {
+        'platform': platform,
+        'kernel': os.uname()[2],
+        'reads': reads,
+        'baseline': baseline_dir,
+        'time': int(time.time()),
+        'results': results,
+    }
+    text = json.dumps(doc, indent=2, sort_keys=True)
+    if output:
+        with open(output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print text
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,156 @@
+#!/usr/bin/env python
+#
+# Copyright (C) 2018 Accton Technology Corporation
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+"""
+Usage: %(scriptName)s [options] [path ...]
+
+Compare the two ways the FanUtil/ThermalUtil classes read sysfs nodes:
+open, read and close on each read, as they used to, and the descriptors
+kept by SensorNodes. Paths may be globs; without any, the hwmon temp and
+fan inputs of the switch are used. Read only, needs no driver of its own.
+
+options:
+    -h | --help             : this help message
+    -d | --debug            : run with debug mode
+    -n | --reads=N          : timed reads per node and method (default 1000)
+    -o | --output=FILE      : write the JSON results to FILE, not stdout
+
+Results are one JSON document. Per node and method: reads per second
+and p50 and p99 latency in us; per node, the p50 speedup of SensorNodes
+and whether both methods read the same value. The exit status is 1 if
+a node could not be read.
+"""
+
+import os
+import sys, getopt
+import logging
+import json
+import time
+import glob
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                '..', 'classes'))
+from sensorio import SensorNodes
+
+DEBUG = False
+WARMUP_READS = 10
+DEFAULT_PATHS = ['/sys/class/hwmon/hwmon*/temp*_input',
+                 '/sys/class/hwmon/hwmon*/fan*_input',
+                 '/sys/bus/i2c/devices/*/hwmon/hwmon*/temp*_input']
+
+def show_help():
+    print __doc__ % {'scriptName' : sys.argv[0].split("/")[-1]}
+    sys.exit(0)
+
+def percentile(sorted_vals, p):
+    if not sorted_vals:
+        return None
+    idx = min(len(sorted_vals) - 1, int(len(sorted_vals) * p / 100.0))
+    return sorted_vals[idx]
+
+def open_read(path):
+    with open(path) as f:
+        return f.read().rstrip()
+
+def time_reads(read, path, reads):
+    for i in range(WARMUP_READS):
+        value = read(path)
+
+    lat = []
+    begin = time.time()
+    for i in range(reads):
+        t0 = time.time()
+        read(path)
+        lat.append(time.time() - t0)
+    elapsed = time.time() - begin
+
+    lat.sort()
+    return value, {
+        'reads_per_sec': round(reads / elapsed, 1) if elapsed > 0 else None,
+        'p50_us': round(percentile(lat, 50) * 1e6, 1),
+        'p99_us': round(percentile(lat, 99) * 1e6, 1),
+    }
+
+def run_node(nodes, path, reads):
+    entry = {'path': path}
+    try:
+        old, entry['open_read_close'] = time_reads(open_read, path, reads)
+    except IOError as e:
+        entry['error'] = str(e)
+        entry['passed'] = False
+        return entry
+
+    new, entry['sensor_nodes'] = time_reads(nodes.read, path, reads)
+    # A live sensor may move in between, so a differing value is only shown
+    entry['passed'] = new is not None
+    entry['same_value'] = new == old
+    if entry['open_read_close']['p50_us'] and entry['sensor_nodes']['p50_us']:
+        entry['speedup'] = round(entry['open_read_close']['p50_us'] /
+                                 entry['sensor_nodes']['p50_us'], 2)
+    return entry
+
+def main():
+    global DEBUG
+
+    reads = 1000
+    output = None
+
+    try:
+        options, args = getopt.getopt(sys.argv[1:], 'hdn:o:',
+                                      ['help', 'debug', 'reads=', 'output='])
+    except getopt.GetoptError:
+        show_help()
+
+    for opt, arg in options:
+        if opt in ('-h', '--help'):
+            show_help()
+        elif opt in ('-d', '--debug'):
+            DEBUG = True
+            logging.basicConfig(level=logging.DEBUG)
+        elif opt in ('-n', '--reads'):
+            reads = int(arg)
+        elif opt in ('-o', '--output'):
+            output = arg
+
+    paths = []
+    for pattern in args or DEFAULT_PATHS:
+        paths.extend(sorted(glob.glob(pattern)) if glob.has_magic(pattern)
+                     else [pattern])
+    if not paths:
+        print 'No sensor nodes found'
+        return 1
+
+    nodes = SensorNodes()
+    results = [run_node(nodes, path, reads) for path in paths]
+    nodes.close()
+
+    doc = {
+        'kernel': os.uname()[2],
+        'reads': reads,
+        'time': int(time.time()),
+        'results': results,
+    }
+    text = json.dumps(doc, indent=2, sort_keys=True)
+    if output:
+        with open(output, 'w') as f:
+            f.write(text + '\n')
+    else:
+        print text
+    return 0 if all(r['passed'] for r in results) else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
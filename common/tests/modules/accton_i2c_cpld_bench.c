@@ -0,0 +1,188 @@
+/*
+ * accton_i2c_cpld_bench.c - Cost per access of the accton_i2c_cpld accessors
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/sched.h>
+
+/*
+ * Writing CPLD addresses to /sys/kernel/debug/accton_i2c_cpld_bench/run,
+ * "0x60 0x62" say, calls accton_i2c_cpld_read() loops times on each of
+ * them from one thread per address, all running at once; reading the
+ * file shows the result of the last run. An address with no client
+ * costs the lookup only, the accessor fails without going to the bus.
+ */
+#define BENCH_MAX_ADDRS		8
+#define BENCH_ADDR_MAX		0x80
+
+extern int accton_i2c_cpld_read(u8 cpld_addr, u8 reg);
+
+struct bench_thread {
+	struct completion done;
+	u8 addr;
+	unsigned int calls;
+	unsigned int errors;
+	u64 total_ns;
+};
+
+static unsigned int loops = 10000;
+module_param(loops, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(loops, "Accesses per address and run (default 10000)");
+
+static unsigned int reg = 0x01;
+module_param(reg, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(reg, "CPLD register read (default 0x01)");
+
+static DEFINE_MUTEX(bench_lock);	/* one run at a time, and its results */
+static struct bench_thread threads[BENCH_MAX_ADDRS];
+static int num_threads;
+static u64 wall_ns;
+static struct dentry *bench_debugfs;
+
+static int bench_thread_fn(void *arg)
+{
+	struct bench_thread *t = arg;
+	unsigned int i, n = loops;
+	u64 start = ktime_to_ns(ktime_get());
+
+	for (i = 0; i < n; i++) {
+		if (accton_i2c_cpld_read(t->addr, reg) < 0)
+			t->errors++;
+		t->calls++;
+		if (!(i % 1024))
+			cond_resched();
+	}
+	t->total_ns = ktime_to_ns(ktime_get()) - start;
+
+	complete(&t->done);
+	return 0;
+}
+
+static int bench_run_show(struct seq_file *s, void *unused)
+{
+	struct bench_thread *t;
+	int i;
+
+	mutex_lock(&bench_lock);
+	seq_printf(s, "wall_ns %llu\n", wall_ns);
+	for (i = 0; i < num_threads; i++) {
+		t = &threads[i];
+		seq_printf(s, "0x%02x calls %u errors %u avg_ns %llu\n",
+			   t->addr, t->calls, t->errors,
+			   t->calls ? div_u64(t->total_ns, t->calls) : 0);
+	}
+	mutex_unlock(&bench_lock);
+
+	return 0;
+}
+
+static int bench_run_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, bench_run_show, NULL);
+}
+
+static ssize_t bench_run_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buf[64], *p, *tok;
+	unsigned int addr;
+	u64 start;
+	int i, n = 0;
+	ssize_t ret = count;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	mutex_lock(&bench_lock);
+	memset(threads, 0, sizeof(threads));
+	num_threads = 0;
+	wall_ns = 0;
+
+	p = buf;
+	while ((tok = strsep(&p, " \t\n")) != NULL) {
+		if (!*tok)
+			continue;
+		if (n == BENCH_MAX_ADDRS || kstrtouint(tok, 0, &addr) ||
+		    addr >= BENCH_ADDR_MAX) {
+			ret = -EINVAL;
+			goto exit;
+		}
+		threads[n].addr = addr;
+		init_completion(&threads[n].done);
+		n++;
+	}
+
+	start = ktime_to_ns(ktime_get());
+	for (i = 0; i < n; i++) {
+		task = kthread_run(bench_thread_fn, &threads[i], "cpld_bench/%02x",
+				   threads[i].addr);
+		if (IS_ERR(task))
+			complete(&threads[i].done);
+	}
+	for (i = 0; i < n; i++)
+		wait_for_completion(&threads[i].done);
+	wall_ns = ktime_to_ns(ktime_get()) - start;
+	num_threads = n;
+
+exit:
+	mutex_unlock(&bench_lock);
+	return ret;
+}
+
+static const struct file_operations bench_run_fops = {
+	.owner = THIS_MODULE,
+	.open = bench_run_open,
+	.read = seq_read,
+	.write = bench_run_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static int __init accton_i2c_cpld_bench_init(void)
+{
+	bench_debugfs = debugfs_create_dir("accton_i2c_cpld_bench", NULL);
+	if (IS_ERR_OR_NULL(bench_debugfs))
+		return -ENODEV;
+
+	debugfs_create_file("run", S_IRUGO | S_IWUSR, bench_debugfs, NULL,
+			    &bench_run_fops);
+	return 0;
+}
+
+static void __exit accton_i2c_cpld_bench_exit(void)
+{
+	debugfs_remove_recursive(bench_debugfs);
+}
+
+module_init(accton_i2c_cpld_bench_init);
+module_exit(accton_i2c_cpld_bench_exit);
+
+MODULE_DESCRIPTION("Microbenchmark of the accton_i2c_cpld register accessors");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,127 @@
+/*
+ * Board driver for accton wedge100bf_65x: creates the I2C mux tree and
+ * the I2C clients of the platform.
+ *
+ * Copyright (C) 2017 Accton Technology Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*#define DEBUG*/
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/err.h>
+#include "accton_i2c_board.h"
+
+#define DRVNAME "wedge100bf_65x_platform"
+
+/*
+ * The layout accton_wedge100bf_util.py used to build from user space.
+ * i2c-1 is the CP2112 bridge, so its muxes wait for the USB device.
+ */
+static const struct accton_i2c_mux muxes[] = {
+	{  1, 0x70,  2 },
+	{  1, 0x71, 10 },
+	{  1, 0x72, 18 },
+	{  1, 0x73, 26 },
+	{  1, 0x74, 34 },
+	{  2, 0x70, 42 },
+	{  2, 0x71, 50 },
+	{  2, 0x72, 58 },
+	{  2, 0x73, 66 },
+	{  2, 0x74, 74 },
+};
+
+static const struct accton_i2c_dev i2c_devs[] = {
+	{ 41, "24c64", 0x50 },
+};
+
+/* Bus of port 1 to port 64 */
+static const u8 sfp_bus[] = {
+	33, 34, 31, 32, 29, 30, 27, 28, 25, 26, 23, 24, 21, 22, 19, 20,
+	17, 18, 15, 16, 13, 14, 11, 12, 9, 10, 7, 8, 5, 6, 3, 4,
+	73, 74, 71, 72, 69, 70, 67, 68, 65, 66, 63, 64, 61, 62, 59, 60,
+	57, 58, 55, 56, 53, 54, 51, 52, 49, 50, 47, 48, 45, 46, 43, 44
+};
+
+static const struct accton_i2c_ports ports[] = {
+	{ sfp_bus, ARRAY_SIZE(sfp_bus), "sff8436" },
+};
+
+static const struct accton_i2c_board_desc wedge100bf_65x_board = {
+	.muxes     = muxes,
+	.num_muxes = ARRAY_SIZE(muxes),
+	.devs      = i2c_devs,
+	.num_devs  = ARRAY_SIZE(i2c_devs),
+	.ports     = ports,
+	.num_ports = ARRAY_SIZE(ports),
+};
+
+static struct platform_device *board_pdev = NULL;
+
+static int wedge100bf_65x_platform_probe(struct platform_device *pdev)
+{
+	return accton_i2c_board_probe(pdev, &wedge100bf_65x_board);
+}
+
+static int wedge100bf_65x_platform_remove(struct platform_device *pdev)
+{
+	accton_i2c_board_remove(pdev);
+	return 0;
+}
+
+static struct platform_driver wedge100bf_65x_platform_driver = {
+	.probe		= wedge100bf_65x_platform_probe,
+	.remove		= wedge100bf_65x_platform_remove,
+	.driver		= {
+		.name	= DRVNAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static int __init wedge100bf_65x_platform_init(void)
+{
+	int ret;
+
+	ret = platform_driver_register(&wedge100bf_65x_platform_driver);
+	if (ret < 0) {
+		goto exit;
+	}
+
+	board_pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
+	if (IS_ERR(board_pdev)) {
+		ret = PTR_ERR(board_pdev);
+		platform_driver_unregister(&wedge100bf_65x_platform_driver);
+		goto exit;
+	}
+
+exit:
+	return ret;
+}
+
+static void __exit wedge100bf_65x_platform_exit(void)
+{
+	platform_device_unregister(board_pdev);
+	platform_driver_unregister(&wedge100bf_65x_platform_driver);
+}
+
+module_init(wedge100bf_65x_platform_init);
+module_exit(wedge100bf_65x_platform_exit);
+
+MODULE_DESCRIPTION("wedge100bf_65x board driver");
+MODULE_LICENSE("GPL");
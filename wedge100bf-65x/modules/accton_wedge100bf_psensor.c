@@ -38,6 +38,8 @@
 #include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/tty.h>
+#include <linux/seqlock.h>
+#include <linux/workqueue.h>
 #include <asm/uaccess.h>
 
 
@@ -58,7 +60,8 @@ enum mtype {
     MTYPE_MAX,
 };
 
-#define SENSOR_DATA_UPDATE_INTERVAL     (5*HZ)
+#define SENSOR_DATA_UPDATE_INTERVAL     (5000)  /*mini-seconds*/
+#define SENSOR_DATA_MIN_INTERVAL        (100)   /*mini-seconds*/
 #define MAX_THERMAL_COUNT (7)
 #define MAX_FAN_COUNT     (10)
 #define CHASSIS_PSU_CHAR_COUNT     (2)    /*2 for input and output.*/
@@ -97,6 +100,10 @@ enum mtype {
 #define TTY_READ_MAX_LEN        (256)
 
 #define TTY_RESP_SEPARATOR      '|'     /*For the ease to debug*/
+#define TTY_SNAPSHOT_CMD_LEN    (1024)
+#define TTY_SNAPSHOT_BUF_LEN    (4096)
+#define TTY_SNAPSHOT_RX_RETRY   (40)    /*x TTY_RETRY_INTERVAL*/
+#define TTY_SECTION_TAG_LEN     (16)
 #define MAX_ATTR_PATTERN        (8)
 #define MIN_FAN_RPM             (0)
 #define MAX_PSU_VOUT            (12000*1005/1000) /*12 + 0.5%*/
@@ -162,6 +169,7 @@ struct sensor_data {
 enum sysfs_attributes_index {
     INDEX_VERSION,
     INDEX_NAME,
+    INDEX_AGE,
     INDEX_THRM_IN_START = 100,
     INDEX_THRM_MAX_START = 150,
     INDEX_THRM_MAX_HYST_START = 170,
@@ -181,11 +189,18 @@ struct wedge100_data {
     struct platform_device *pdev;
     struct device	    *dev;
     struct device	    *hwmon_dev;
-    struct mutex	    update_lock;
+    struct mutex	    update_lock;    /*Owns the BMC link.*/
+    seqlock_t           sdata_lock;     /*Protects sdata for readers.*/
+    struct delayed_work refresh_work;
     struct tty_struct   *tty;
     struct ktermios     old_ktermios;
+    struct file         *tty_fd;        /*Kept open across transactions.*/
+    bool                logged_in;      /*Cleared when BMC prompt is lost.*/
     bool			 valid[SENSOR_TYPE_MAX];
     unsigned long	 last_updated[SENSOR_TYPE_MAX];	  /* In jiffies */
+    unsigned long	 last_valid[SENSOR_TYPE_MAX];	  /* In jiffies */
+    bool			 fetched[SENSOR_TYPE_MAX];	  /* refresh has run */
+    bool			 seen[SENSOR_TYPE_MAX];	  /* last_valid is set */
     struct sensor_data sdata;
     int num_attributes;
     struct attribute_group group;
@@ -198,6 +213,8 @@ typedef ssize_t (*store_func)(struct device *dev,
                               size_t count);
 static ssize_t show_name(struct device *dev, struct device_attribute *da,
                          char *buf);
+static ssize_t show_age(struct device *dev, struct device_attribute *da,
+                        char *buf);
 static ssize_t show_thermal(struct device *dev, struct device_attribute *da,
                             char *buf);
 static ssize_t show_thermal_max(struct device *dev, struct device_attribute *da,
@@ -457,6 +474,19 @@ static int model_id = MTYPE_BF100_65X;
 module_param(model_id, uint, S_IRUGO);
 MODULE_PARM_DESC(model_id, "Default is BF100_65X.");
 
+/* Fetch all sensor types in one BMC command. */
+static bool snapshot = true;
+module_param(snapshot, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(snapshot, "Read all sensors with one compound command. Default is true.");
+
+/* Refresh period of each sensor type, in the order of enum sensor_type. */
+static unsigned int refresh_ms[SENSOR_TYPE_MAX] = {
+    [0 ... SENSOR_TYPE_MAX-1] = SENSOR_DATA_UPDATE_INTERVAL
+};
+module_param_array(refresh_ms, uint, NULL, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(refresh_ms, "Refresh period in ms of thermal_in,"
+                 "thermal_max,thermal_max_hyst,fan,fan_dn,psu1,psu2.");
+
 static int _tty_wait(struct file *tty_fd, int mdelay) {
     msleep(mdelay);
     return 0;
@@ -564,6 +594,31 @@ static int _tty_rx(struct file *tty_fd, char *buf, int max_len)
     return rc;
 }
 
+/*Keep reading until the pattern shows up or times out.*/
+static int _tty_rx_until(struct file *tty_fd, char *buf, int max_len,
+                         const char *until)
+{
+    int rc, len = 0;
+    u32 timeout = 0;
+
+    memset(buf, 0, max_len);
+    while (len < (max_len - 1) && timeout < TTY_SNAPSHOT_RX_RETRY) {
+        rc = tty_fd->f_op->read(tty_fd, buf + len, max_len - 1 - len, 0);
+        if (rc > 0) {
+            len += rc;
+            if (strstr(buf, until) != NULL)
+                return len;
+            continue;
+        }
+        if (rc < 0 && rc != -EAGAIN)
+            return rc;
+        timeout++;
+        msleep(TTY_RETRY_INTERVAL);
+    }
+    DEBUG_INTR("[RX]%s-%d, %d BYTES, read:\n\"%s\"\n", __func__, __LINE__, len, buf);
+    return -EAGAIN;
+}
+
 /*Clear Rx buffer by reading it out.*/
 static int _tty_clear_rxbuf(struct file *tty_fd, char* buf, size_t max_size) {
     int rc;
@@ -622,6 +677,29 @@ exit:
     return rc;
 }
 
+static int _tty_writeNread_until(struct file *tty_fd,
+                                 char *wr_p, char *rd_p, int rx_max_len,
+                                 const char *until)
+{
+    int     rc;
+    mm_segment_t old_fs;
+
+    if (tty_fd == NULL)
+        return -EINVAL;
+
+    old_fs = get_fs();
+    set_fs(KERNEL_DS);
+    rc = _tty_tx(tty_fd, wr_p);
+    if (rc >= 0) {
+        rc = _tty_rx_until(tty_fd, rd_p, rx_max_len, until);
+    }
+    set_fs(old_fs);
+    if(rc < 0) {
+        dev_err(wedge_data->dev, "Failed on %s ret:%d\n", __func__, rc);
+    }
+    return rc;
+}
+
 static bool _is_logged_in(char *buf)
 {
     DEBUG_INTR("%s-%d, tty_buf:%s\n", __func__, __LINE__, buf);
@@ -680,47 +758,103 @@ static int _tty_login(struct file *tty_fd, char* buf, size_t max_size)
     return -EAGAIN;
 }
 
+/*Open the tty and log in to BMC if the session is not established yet.
+ *Caller must hold update_lock.
+ */
+static int bmc_session_get(char *buf, int buf_size)
+{
+    struct wedge100_data *data = wedge_data;
+
+    if (data->tty_fd == NULL) {
+        if (_tty_open(&data->tty_fd) != 0) {
+            DEBUG_INTR("ERROR: Cannot open TTY device\n");
+            return -EAGAIN;
+        }
+        data->logged_in = false;
+    }
+
+    /*Drop late output of previous command, if any.*/
+    _tty_clear_rxbuf(data->tty_fd, buf, buf_size);
+    if (!data->logged_in) {
+        if (_tty_login(data->tty_fd, buf, buf_size) != 0) {
+            dev_err(data->dev, "Failed to login TTY device\n");
+            _tty_close(&data->tty_fd);
+            return -ENOENT;
+        }
+        data->logged_in = true;
+    }
+    return 0;
+}
+
+static void bmc_session_put(void)
+{
+    struct wedge100_data *data = wedge_data;
+
+    if (data->tty_fd != NULL) {
+        _tty_close(&data->tty_fd);
+    }
+    data->logged_in = false;
+}
+
+/*If until is given, resp must hold max+1 bytes and receives the raw output
+ *up to the pattern. Otherwise the output is read until BMC prompt.
+ */
 static int
-bmc_transaction(char *cmd, char* resp, int max)
+bmc_transaction(char *cmd, char* resp, int max, const char *until)
 {
     u32  i;
-    struct file *tty_fd = NULL;
     char *buf;
     int buf_size = MAXIMUM_TTY_BUFFER_LENGTH;
     int ret = 0;
+    bool relogin = false;
 
     if(!cmd || !resp)
         return -EINVAL;
 
-    if (_tty_open(&tty_fd) != 0) {
-        DEBUG_INTR("ERROR: Cannot open TTY device\n");
-        return -EAGAIN;
-    }
-
     buf = (char *)kmalloc(buf_size, GFP_KERNEL);
     if (!buf) {
-        ret = -ENOMEM;
+        return -ENOMEM;
+    }
+
+retry:
+    ret = bmc_session_get(buf, buf_size);
+    if (ret < 0) {
         goto exit;
     }
 
-    _tty_clear_rxbuf(tty_fd, buf, buf_size);
-    if (_tty_login(tty_fd, buf, buf_size) != 0) {
-        dev_err(wedge_data->dev, "Failed to login TTY device\n");
-        _tty_close(&tty_fd);
-        ret = -ENOENT;
+    if (until != NULL) {
+        ret = _tty_writeNread_until(wedge_data->tty_fd, cmd, resp, max+1, until);
+        if (ret < 0) {
+            wedge_data->logged_in = false;
+            if (!relogin) {
+                relogin = true;
+                goto retry;
+            }
+            bmc_session_put();
+        }
         goto exit;
     }
 
     i = 0;
     do {
-        ret = _tty_writeNread(tty_fd, cmd, buf, buf_size, 200);
+        ret = _tty_writeNread(wedge_data->tty_fd, cmd, buf, buf_size, 200);
         if (ret < 0) {
+            bmc_session_put();
             goto exit;
         }
         i++;
     } while(strstr(buf, TTY_PROMPT) == NULL && i <= TTY_CMD_RETRY);
     if (i > TTY_CMD_RETRY) {
+        /*Prompt is lost, BMC may have rebooted or logged us out.
+         *Re-login once and resend the command.
+         */
+        wedge_data->logged_in = false;
+        if (!relogin) {
+            relogin = true;
+            goto retry;
+        }
         dev_err(wedge_data->dev, "Failed on tty_transaction\n");
+        bmc_session_put();
         ret = -ENOENT;
         goto exit;
     }
@@ -728,11 +862,9 @@ bmc_transaction(char *cmd, char* resp, int max)
     strncpy(resp, buf, max);
 exit:
     kfree(buf);
-    _tty_close(&tty_fd);
     return ret;
 }
 
-
 static void dev_attr_init(struct device_attribute *dev_attr,
                           const char *name, umode_t mode,
                           show_func show, store_func store)
@@ -767,6 +899,19 @@ static int attributs_init(struct wedge100_data *data)
     if (ret)
         return ret;
 
+    /*Age of the oldest valid data, -1 while a type never had any*/
+    sensor = devm_kzalloc(data->dev, sizeof(*sensor), GFP_KERNEL);
+    if (!sensor)
+        return -ENOENT;
+    sensor_dattr = &sensor->sensor_dev_attr;
+    dev_attr = &sensor_dattr->dev_attr;
+    snprintf(sensor->name, sizeof(sensor->name), "update_age_ms");
+    dev_attr_init(dev_attr, sensor->name, S_IRUGO, show_age, NULL);
+    sensor_dattr->index = INDEX_AGE;
+    ret = add_attr2group(data, &dev_attr->attr);
+    if (ret)
+        return ret;
+
     /*types*/
     for (si = 0; si < SENSOR_TYPE_MAX; si++)
     {
@@ -931,30 +1076,10 @@ static int get_pmbus_regs_partial(int *in, int in_cnt, int *out, int *out_cnt)
 }
 
 
-static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
+static int parse_resp(enum sensor_type type, char *ptr, int *out, int out_cnt)
 {
-    char cmd[TTY_CMD_MAX_LEN], resp[TTY_READ_MAX_LEN];
-    char *ptr;
     int ret;
 
-    if (out == NULL)
-        return -EINVAL;
-    if (out_cnt == 0)
-        return 0;
-
-    snprintf(cmd, sizeof(cmd), tty_cmd[type]);
-    DEBUG_INTR("%s-%d, cmd:%s\n", __func__, __LINE__, cmd);
-    ret = bmc_transaction(cmd, resp, sizeof(resp)-1);
-    if (ret < 0)
-        return ret;
-
-    /*Strip off string of command just sent, if any.*/
-    if (strstr(resp, cmd) != NULL) {
-        ptr = resp + strlen(cmd);
-    } else {
-        ptr = resp;
-    }
-
     switch (type) {
     case SENSOR_TYPE_THERMAL_IN:
     case SENSOR_TYPE_THERMAL_MAX:
@@ -980,6 +1105,33 @@ static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
     return 0;
 }
 
+static int comm2BMC(enum sensor_type type, int *out, int out_cnt)
+{
+    char cmd[TTY_CMD_MAX_LEN], resp[TTY_READ_MAX_LEN];
+    char *ptr;
+    int ret;
+
+    if (out == NULL)
+        return -EINVAL;
+    if (out_cnt == 0)
+        return 0;
+
+    snprintf(cmd, sizeof(cmd), tty_cmd[type]);
+    DEBUG_INTR("%s-%d, cmd:%s\n", __func__, __LINE__, cmd);
+    ret = bmc_transaction(cmd, resp, sizeof(resp)-1, NULL);
+    if (ret < 0)
+        return ret;
+
+    /*Strip off string of command just sent, if any.*/
+    if (strstr(resp, cmd) != NULL) {
+        ptr = resp + strlen(cmd);
+    } else {
+        ptr = resp;
+    }
+
+    return parse_resp(type, ptr, out, out_cnt);
+}
+
 static int get_type_data (
     struct sensor_data *data, enum sensor_type type, int index,
     int **out, int *count)
@@ -1015,39 +1167,196 @@ static int get_type_data (
     return 0;
 }
 
-static struct sensor_data*
-update_data(struct device *dev, enum sensor_type type) {
-    struct wedge100_data *data = wedge_data;
-    bool			*valid = &data->valid[type];
-    unsigned long   *last_updated = &data->last_updated[type];
-    struct sensor_data* ret = NULL;
-    int *data_ptr = NULL;
-    int data_cnt, rc;
+/*Section tags are printed by "printf '|S%d|' N", so that the echoed
+ *command line itself never matches a tag.
+ */
+static void snapshot_tag(char *tag, int type)
+{
+    snprintf(tag, TTY_SECTION_TAG_LEN, "%cS%d%c",
+             TTY_RESP_SEPARATOR, type, TTY_RESP_SEPARATOR);
+}
 
-    mutex_lock(&data->update_lock);
-    if (time_after(jiffies, (*last_updated) + SENSOR_DATA_UPDATE_INTERVAL)
-            || !(*valid))
-    {
-        rc = get_type_data(&data->sdata, type, 0, &data_ptr, &data_cnt);
-        if (rc < 0)
-            goto exit_err;
-
-        DEBUG_INTR("%s-%d, type:%d cnt:%d\n", __func__, __LINE__, type, data_cnt);
-        rc = comm2BMC(type, data_ptr, data_cnt);
-        if (rc < 0) {
-            *valid = 0;
-            /*Clear data if failed.*/
-            if (data_ptr != NULL)
-                memset(data_ptr, 0, sizeof(*data_ptr)*data_cnt);
+static int snapshot_cmd(char *cmd, int max)
+{
+    struct sensor_set *model = model_ssets[model_id];
+    int si, len = 0;
+
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        if (!model[si].total)
+            continue;
+        len += snprintf(cmd + len, max - len, "printf '%cS%%d%c\\n' %d; %.*s; ",
+                        TTY_RESP_SEPARATOR, TTY_RESP_SEPARATOR, si,
+                        (int)strcspn(tty_cmd[si], "\r\n"), tty_cmd[si]);
+        if (len >= max)
+            return -E2BIG;
+    }
+    /*End tag*/
+    len += snprintf(cmd + len, max - len, "printf '%cS%%d%c\\n' %d\r\n",
+                    TTY_RESP_SEPARATOR, TTY_RESP_SEPARATOR, SENSOR_TYPE_MAX);
+    if (len >= max)
+        return -E2BIG;
+    return len;
+}
+
+/*Get all sensor types by one BMC transaction, and update them at once.
+ *Caller must hold update_lock.
+ */
+static int update_snapshot(struct wedge100_data *data)
+{
+    struct sensor_set *model = model_ssets[model_id];
+    struct sensor_data *sdata;
+    char tag[TTY_SECTION_TAG_LEN], section[TTY_READ_MAX_LEN];
+    char *cmd, *resp, *cursor, *start, *end;
+    const char next_tag[] = {TTY_RESP_SEPARATOR, 'S', '\0'};
+    bool valid[SENSOR_TYPE_MAX] = {0};
+    int *src, *dst, cnt, len, si, rc;
+
+    cmd = kzalloc(TTY_SNAPSHOT_CMD_LEN, GFP_KERNEL);
+    resp = kzalloc(TTY_SNAPSHOT_BUF_LEN, GFP_KERNEL);
+    sdata = kzalloc(sizeof(*sdata), GFP_KERNEL);
+    if (!cmd || !resp || !sdata) {
+        rc = -ENOMEM;
+        goto exit;
+    }
+
+    rc = snapshot_cmd(cmd, TTY_SNAPSHOT_CMD_LEN);
+    if (rc < 0)
+        goto exit;
+
+    snapshot_tag(tag, SENSOR_TYPE_MAX);
+    rc = bmc_transaction(cmd, resp, TTY_SNAPSHOT_BUF_LEN - 1, tag);
+    if (rc < 0)
+        goto exit;
+
+    cursor = resp;
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        if (!model[si].total) {
+            valid[si] = true;
+            continue;
+        }
+        snapshot_tag(tag, si);
+        start = strstr(cursor, tag);
+        if (start == NULL)
+            continue;
+        start += strlen(tag);
+        /*Section ends at the next tag, whichever type it is.*/
+        end = strstr(start, next_tag);
+        if (end == NULL)
+            end = start + strlen(start);
+        cursor = end;
+
+        len = min_t(int, end - start, sizeof(section) - 1);
+        memcpy(section, start, len);
+        section[len] = '\0';
+
+        get_type_data(sdata, si, 0, &dst, &cnt);
+        if (parse_resp(si, section, dst, cnt) == 0) {
+            valid[si] = true;
+        } else {
+            memset(dst, 0, sizeof(*dst)*cnt);
+        }
+    }
+    rc = 0;
+
+exit:
+    /*Publish all types together, invalid ones are cleared.*/
+    write_seqlock(&data->sdata_lock);
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        if (get_type_data(&data->sdata, si, 0, &dst, &cnt) < 0)
+            continue;
+        if (sdata && valid[si]) {
+            get_type_data(sdata, si, 0, &src, &cnt);
+            memcpy(dst, src, sizeof(*dst)*cnt);
         } else {
-            *valid = 1;
+            memset(dst, 0, sizeof(*dst)*cnt);
+        }
+        data->valid[si] = valid[si];
+        data->last_updated[si] = jiffies;
+        data->fetched[si] = true;
+        if (valid[si]) {
+            data->last_valid[si] = jiffies;
+            data->seen[si] = true;
+        }
+    }
+    write_sequnlock(&data->sdata_lock);
+    kfree(sdata);
+    kfree(resp);
+    kfree(cmd);
+    return rc;
+}
+
+/*Get one sensor type from BMC. Caller must hold update_lock.*/
+static void update_type(struct wedge100_data *data, enum sensor_type type)
+{
+    struct sensor_data sdata;
+    int *src = NULL, *dst = NULL;
+    int cnt, rc;
+
+    memset(&sdata, 0, sizeof(sdata));
+    if (get_type_data(&sdata, type, 0, &src, &cnt) < 0)
+        return;
+
+    DEBUG_INTR("%s-%d, type:%d cnt:%d\n", __func__, __LINE__, type, cnt);
+    rc = comm2BMC(type, src, cnt);
+    if (rc < 0) {
+        /*Clear data if failed.*/
+        memset(src, 0, sizeof(*src)*cnt);
+    }
+
+    write_seqlock(&data->sdata_lock);
+    get_type_data(&data->sdata, type, 0, &dst, &cnt);
+    memcpy(dst, src, sizeof(*dst)*cnt);
+    data->valid[type] = (rc >= 0);
+    data->last_updated[type] = jiffies;
+    data->fetched[type] = true;
+    if (rc >= 0) {
+        data->last_valid[type] = jiffies;
+        data->seen[type] = true;
+    }
+    write_sequnlock(&data->sdata_lock);
+}
+
+static unsigned long refresh_interval(enum sensor_type type)
+{
+    return msecs_to_jiffies(max_t(unsigned int, refresh_ms[type],
+                                  SENSOR_DATA_MIN_INTERVAL));
+}
+
+/*Refresher owns the BMC link, so sysfs readers never wait on the tty.
+ *In snapshot mode every type is refreshed as soon as any type is due.
+ *A BMC transaction takes seconds, so it runs on system_long_wq.
+ */
+static void refresh_work_fn(struct work_struct *work)
+{
+    struct wedge100_data *data = container_of(to_delayed_work(work),
+                                 struct wedge100_data, refresh_work);
+    unsigned long due, next = refresh_interval(0);
+    int si;
+
+    mutex_lock(&data->update_lock);
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        if (time_before(jiffies, data->last_updated[si] + refresh_interval(si)))
+            continue;
+        if (snapshot) {
+            update_snapshot(data);
+            break;
         }
-        *last_updated = jiffies;
+        update_type(data, si);
+    }
+
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        due = data->last_updated[si] + refresh_interval(si);
+        if (time_before_eq(due, jiffies)) {
+            next = 0;
+            break;
+        }
+        next = min(next, due - jiffies);
     }
-    ret =  &data->sdata;
-exit_err:
     mutex_unlock(&data->update_lock);
-    return ret;
+
+    queue_delayed_work(system_long_wq, &data->refresh_work,
+                       max_t(unsigned long, next,
+                             msecs_to_jiffies(SENSOR_DATA_MIN_INTERVAL)));
 }
 
 static ssize_t show_name(struct device *dev, struct device_attribute *da,
@@ -1056,28 +1365,62 @@ static ssize_t show_name(struct device *dev, struct device_attribute *da,
     return sprintf(buf, "%s\n", DRVNAME);
 }
 
+static ssize_t show_age(struct device *dev, struct device_attribute *da,
+                        char *buf)
+{
+    struct wedge100_data *data = wedge_data;
+    struct sensor_set *model = model_ssets[model_id];
+    unsigned long oldest;
+    unsigned int seq;
+    bool never;
+    int si;
+
+    do {
+        seq = read_seqbegin(&data->sdata_lock);
+        oldest = jiffies;
+        never = false;
+        for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+            if (!model[si].total)
+                continue;
+            if (!data->seen[si])
+                never = true;
+            else if (time_before(data->last_valid[si], oldest))
+                oldest = data->last_valid[si];
+        }
+    } while (read_seqretry(&data->sdata_lock, seq));
+
+    if (never)
+        return sprintf(buf, "-1\n");
+    return sprintf(buf, "%u\n", jiffies_to_msecs(jiffies - oldest));
+}
+
 static ssize_t _attr_show(struct device *dev, struct device_attribute *da,
                           char *buf, enum sensor_type type,  int index_start)
 {
-    int index, count, rc;
+    int index, count, rc, val;
     struct sensor_device_attribute *attr = to_sensor_dev_attr(da);
-    struct sensor_data* data;
+    struct wedge100_data *data = wedge_data;
+    unsigned int seq;
     int *out = NULL;
 
     DEBUG_INTR("%s-%d, type:%d start:%d\n", __func__, __LINE__, type, index_start);
-    data = update_data(dev, type);
-    if (data == NULL)
-        return -EINVAL;
+    /*Nothing fetched yet, wait for the first refresh instead of showing 0.*/
+    if (!data->fetched[type])
+        flush_delayed_work(&data->refresh_work);
 
     index = attr->index - index_start;
-    rc = get_type_data(data, type, index, &out, &count);
-    if (rc < 0 || out == NULL)
-        return -EINVAL;
+    do {
+        seq = read_seqbegin(&data->sdata_lock);
+        rc = get_type_data(&data->sdata, type, index, &out, &count);
+        if (rc < 0 || out == NULL)
+            return -EINVAL;
+        val = *out;
+    } while (read_seqretry(&data->sdata_lock, seq));
 
     if( index > count)
         return -EINVAL;
 
-    return sprintf(buf, "%d\n",  *out);
+    return sprintf(buf, "%d\n",  val);
 }
 
 static ssize_t show_thermal(struct device *dev, struct device_attribute *da,
@@ -1165,6 +1508,7 @@ static int add_attr2group(struct wedge100_data *data, struct attribute *attr)
 static int wedge100_probe(struct platform_device *pdev)
 {
     int status = -1;
+    int si;
 
     wedge_data->dev = &pdev->dev;
     status = attributs_init(wedge_data);
@@ -1186,6 +1530,13 @@ static int wedge100_probe(struct platform_device *pdev)
         status = PTR_ERR(wedge_data->hwmon_dev);
         goto exit_remove;
     }
+    for (si = 0; si < SENSOR_TYPE_MAX; si++) {
+        wedge_data->last_updated[si] = jiffies - refresh_interval(si);
+        wedge_data->fetched[si] = false;
+        wedge_data->seen[si] = false;
+    }
+    queue_delayed_work(system_long_wq, &wedge_data->refresh_work, 0);
+
     dev_info(&pdev->dev, "wedge100bf sensors found\n");
     return 0;
 
@@ -1199,7 +1550,11 @@ exit:
 
 static int wedge100_remove(struct platform_device *pdev)
 {
+    cancel_delayed_work_sync(&wedge_data->refresh_work);
     hwmon_device_unregister(wedge_data->hwmon_dev);
+    mutex_lock(&wedge_data->update_lock);
+    bmc_session_put();
+    mutex_unlock(&wedge_data->update_lock);
     sysfs_remove_group(&pdev->dev.kobj, &wedge_data->group);
     kfree(wedge_data->group.attrs);
     return 0;
@@ -1230,6 +1585,8 @@ static int __init wedge100_init(void)
         goto exit;
     }
     mutex_init(&wedge_data->update_lock);
+    seqlock_init(&wedge_data->sdata_lock);
+    INIT_DELAYED_WORK(&wedge_data->refresh_work, refresh_work_fn);
     wedge_data_init(wedge_data);
 
     wedge_data->pdev = platform_device_register_simple(DRVNAME, -1, NULL, 0);
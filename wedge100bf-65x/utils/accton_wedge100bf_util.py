@@ -159,8 +159,13 @@ kos = [
 'modprobe hid-cp2112'      ,
 'modprobe usbhid'      ,
 'modprobe sff_8436_eeprom'      ,
+'modprobe accton_wedge100bf_65x_platform',
 ]
 
+# Set when the board driver has created the devices; they are then
+# removed together with the driver.
+board_path = '/sys/bus/platform/devices/wedge100bf_65x_platform'
+
 def driver_install():
     global FORCE
     status, output = log_os_system("depmod", 1)
@@ -319,6 +324,9 @@ def device_install():
     
 def device_uninstall():
     global FORCE
+
+    if os.path.exists(board_path):
+        return 0
     
     #status, output =log_os_system("ls /sys/bus/i2c/devices/1-0074", 0)
     #if status==0: